@@ -1,7 +1,6 @@
 #include "Address.h"
 #include "HexUtil.hpp"
 #include "openssl/sha.h"
-#include "openssl/ripemd.h"
 #include "base58.hpp"
 
 namespace Address {
@@ -32,20 +31,54 @@ SerializedPubKey serialize_pubkey(const Point &p) {
   return out;
 }
 
-std::string pubkey_to_hash160_hex(const uint8_t *pubkey, const size_t length)
+bool pubkeys_to_hash160_8x(const uint8_t *pubkeys[8], const size_t lengths[8],
+                           uint8_t out[8][RIPEMD160_DIGEST_SIZE])
 {
     /* stage 1 ─ SHA-256 ------------------------------------------------*/
-    uint8_t sha_out[SHA256_DIGEST_LENGTH];
-    SHA256(pubkey, length, sha_out);
+    uint8_t sha_out[8][SHA256_DIGEST_SIZE];
+    if (sha256_8x(pubkeys, lengths, sha_out) != 0)
+        return false;
 
     /* stage 2 ─ RIPEMD-160 ------------------------------------------- */
-    uint8_t h160[RIPEMD160_DIGEST_LENGTH];
-    RIPEMD160(sha_out, SHA256_DIGEST_LENGTH, h160);
+    size_t         sha_lens[8];
+    const uint8_t *sha_ptrs[8];
+    for (int i = 0; i < 8; ++i) {
+        sha_lens[i] = SHA256_DIGEST_SIZE;
+        sha_ptrs[i] = sha_out[i];
+    }
+    return ripemd160_8x(sha_ptrs, sha_lens, out) == 0;
+}
 
+bool pubkeys_to_hash160_16x(const uint8_t *pubkeys[16], const size_t lengths[16],
+                            uint8_t out[16][RIPEMD160_DIGEST_SIZE])
+{
+    uint8_t sha_out[16][SHA256_DIGEST_SIZE];
+    if (sha256_16x(pubkeys, lengths, sha_out) != 0)
+        return false;
+
+    size_t         sha_lens[16];
+    const uint8_t *sha_ptrs[16];
+    for (int i = 0; i < 16; ++i) {
+        sha_lens[i] = SHA256_DIGEST_SIZE;
+        sha_ptrs[i] = sha_out[i];
+    }
+    return ripemd160_16x(sha_ptrs, sha_lens, out) == 0;
+}
+
+std::vector<std::string> pubkeys_to_hash160_hex_8x(const uint8_t *pubkeys[8],
+                              const size_t lengths[8])
+{
+    uint8_t h160[8][RIPEMD160_DIGEST_SIZE];
+    if (!pubkeys_to_hash160_8x(pubkeys, lengths, h160))
+        return std::vector<std::string>();
 
     /* stage 3 ─ bin → hex -------------------------------------------- */
-    std::string hex_str = HexUtil::toHex(h160, RIPEMD160_DIGEST_LENGTH);
-    return hex_str;
+    std::vector<std::string> out_hex;
+    for (int i = 0; i < 8; ++i) {
+        std::string hex_str = HexUtil::toHex(h160[i], RIPEMD160_DIGEST_SIZE);
+        out_hex.push_back(hex_str);
+    }
+    return out_hex;
 }
 
 
@@ -64,11 +97,11 @@ std::string encodeP2PKH_Mainnet(const std::string &h160_hex)
     payload.insert(payload.end(), hash160.begin(), hash160.end());
 
     // Step 2: Compute double SHA256 checksum
-    uint8_t first_sha[SHA256_DIGEST_LENGTH];
+    uint8_t first_sha[SHA256_DIGEST_SIZE];
     SHA256(payload.data(), payload.size(), first_sha);
 
-    uint8_t second_sha[SHA256_DIGEST_LENGTH];
-    SHA256(first_sha, SHA256_DIGEST_LENGTH, second_sha);
+    uint8_t second_sha[SHA256_DIGEST_SIZE];
+    SHA256(first_sha, SHA256_DIGEST_SIZE, second_sha);
 
     // Append checksum (first 4 bytes of second SHA256)
     payload.insert(payload.end(), second_sha, second_sha + 4);
@@ -0,0 +1,207 @@
+#include "Checkpoint.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <queue>
+#include <stdlib.h>
+#include <unistd.h>
+
+// Spill files merged at once; more are merged in several passes
+static const size_t MAX_FAN_IN = 64;
+
+static bool by_first(const ChunkInterval &a, const ChunkInterval &b) {
+  return a.first < b.first;
+}
+
+// True if `next` (not starting before `cur`) overlaps or directly follows `cur`
+static bool touches(const ChunkInterval &cur, const ChunkInterval &next) {
+  ChunkIndex end = cur.last;
+  end.Add(1);
+  return end.IsZero() || next.first <= end;
+}
+
+// Sort and coalesce in place
+static void coalesce(std::vector<ChunkInterval> &runs) {
+  std::sort(runs.begin(), runs.end(), by_first);
+  size_t out = 0;
+  for (size_t i = 0; i < runs.size(); i++) {
+    if (out > 0 && touches(runs[out - 1], runs[i])) {
+      if (runs[i].last > runs[out - 1].last) runs[out - 1].last = runs[i].last;
+    } else {
+      runs[out++] = runs[i];
+    }
+  }
+  runs.resize(out);
+}
+
+IntervalSorter::IntervalSorter(const std::string &temp_dir, size_t run_limit)
+    : temp_dir(temp_dir), run_limit(std::max<size_t>(run_limit, 1)) {
+}
+
+IntervalSorter::~IntervalSorter() {
+  RemoveSpills();
+}
+
+void IntervalSorter::RemoveSpills() {
+  for (const std::string &path : spills) {
+    unlink(path.c_str());
+  }
+  spills.clear();
+}
+
+bool IntervalSorter::Add(const ChunkInterval &run) {
+  if (run.last < run.first) {
+    return true;
+  }
+  buffer.push_back(run);
+  added++;
+  return buffer.size() < run_limit || Spill();
+}
+
+bool IntervalSorter::Spill() {
+  coalesce(buffer);
+  std::string path = temp_dir + "/bitcrack_merge_XXXXXX";
+  int fd = mkstemp(&path[0]);
+  if (fd < 0) {
+    return false;
+  }
+  FILE *file = fdopen(fd, "wb");
+  bool ok = file && fwrite(buffer.data(), sizeof(ChunkInterval), buffer.size(), file) == buffer.size();
+  ok = file && fclose(file) == 0 && ok;
+  spills.push_back(path);
+  buffer.clear();
+  return ok;
+}
+
+bool IntervalSorter::MergeFiles(const std::vector<std::string> &files,
+                                const std::function<void(const ChunkInterval &)> &emit) {
+  struct Head {
+    ChunkInterval run;
+    size_t file;
+  };
+  auto later = [](const Head &a, const Head &b) { return b.run.first < a.run.first; };
+  std::priority_queue<Head, std::vector<Head>, decltype(later)> heads(later);
+
+  std::vector<FILE *> inputs;
+  bool ok = true;
+  for (const std::string &path : files) {
+    FILE *file = fopen(path.c_str(), "rb");
+    if (!file) {
+      ok = false;
+      break;
+    }
+    setvbuf(file, nullptr, _IOFBF, 1 << 20);
+    inputs.push_back(file);
+    Head head;
+    if (fread(&head.run, sizeof(ChunkInterval), 1, file) == 1) {
+      head.file = inputs.size() - 1;
+      heads.push(head);
+    }
+  }
+
+  bool have = false;
+  ChunkInterval cur;
+  while (ok && !heads.empty()) {
+    Head head = heads.top();
+    heads.pop();
+    if (have && touches(cur, head.run)) {
+      if (head.run.last > cur.last) cur.last = head.run.last;
+    } else {
+      if (have) emit(cur);
+      cur = head.run;
+      have = true;
+    }
+    if (fread(&head.run, sizeof(ChunkInterval), 1, inputs[head.file]) == 1) {
+      heads.push(head);
+    }
+  }
+  if (ok && have) {
+    emit(cur);
+  }
+  for (FILE *file : inputs) {
+    fclose(file);
+  }
+  return ok;
+}
+
+bool IntervalSorter::Merge(const std::function<void(const ChunkInterval &)> &emit) {
+  if (spills.empty()) {
+    coalesce(buffer);
+    for (const ChunkInterval &run : buffer) {
+      emit(run);
+    }
+    buffer.clear();
+    added = 0;
+    return true;
+  }
+  if (!buffer.empty() && !Spill()) {
+    RemoveSpills();
+    return false;
+  }
+
+  // Too many files to hold open at once: merge them in groups first
+  while (spills.size() > MAX_FAN_IN) {
+    std::vector<std::string> group(spills.begin(), spills.begin() + MAX_FAN_IN);
+    spills.erase(spills.begin(), spills.begin() + MAX_FAN_IN);
+    std::string path = temp_dir + "/bitcrack_merge_XXXXXX";
+    int fd = mkstemp(&path[0]);
+    FILE *out = fd >= 0 ? fdopen(fd, "wb") : nullptr;
+    bool ok = out != nullptr;
+    if (out) {
+      spills.push_back(path);
+      setvbuf(out, nullptr, _IOFBF, 1 << 20);
+      bool written = true;
+      ok = MergeFiles(group, [out, &written](const ChunkInterval &run) {
+        written = fwrite(&run, sizeof(run), 1, out) == 1 && written;
+      });
+      ok = fclose(out) == 0 && ok && written;
+    }
+    for (const std::string &spill : group) {
+      unlink(spill.c_str());
+    }
+    if (!ok) {
+      RemoveSpills();
+      return false;
+    }
+  }
+
+  bool ok = MergeFiles(spills, emit);
+  RemoveSpills();
+  added = 0;
+  return ok;
+}
+
+void CoverageReport::Gap(const ChunkIndex &first, const ChunkIndex &end) {
+  if (!(first < end)) {
+    return;
+  }
+  ChunkInterval gap = {first, end};
+  gap.last.Sub(ChunkIndex(1));
+  gaps++;
+  ChunkIndex size = gap.Size();
+  if (size > largest_gap_size) {
+    largest_gap_size = size;
+    largest_gap = gap;
+  }
+}
+
+void CoverageReport::Add(const ChunkInterval &run) {
+  ChunkInterval clipped = run;
+  if (!(clipped.first < total)) {
+    return;
+  }
+  if (!(clipped.last < total)) {
+    clipped.last = total;
+    clipped.last.Sub(ChunkIndex(1));
+  }
+  Gap(next, clipped.first);
+  covered.Add(clipped.Size());
+  runs++;
+  next = clipped.last;
+  next.Add(1);
+}
+
+void CoverageReport::Finish() {
+  Gap(next, total);
+  next = total;
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <functional>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "ChunkIndex.hpp"
+
+/*---------------------------------------------------------------
+    Offline checkpoint compaction.
+
+    IntervalSorter takes chunk runs in any order and any number,
+    possibly overlapping, and yields their union as sorted, disjoint,
+    non-adjacent runs. Runs are buffered up to a fixed count, sorted
+    and coalesced, and spilled to temporary files; Merge() then
+    streams a k-way merge of those files. Memory stays bounded
+    whatever the input size.
+
+    CoverageReport consumes the merged runs and counts covered
+    chunks and the gaps between them.
+  --------------------------------------------------------------*/
+class IntervalSorter {
+
+public:
+
+  // Spill files go to `temp_dir`; `run_limit` runs are buffered in memory.
+  explicit IntervalSorter(const std::string &temp_dir, size_t run_limit = 1 << 21);
+  ~IntervalSorter();
+
+  bool Add(const ChunkInterval &run);
+
+  // Emit the union of everything added, in order. The sorter is empty afterwards.
+  bool Merge(const std::function<void(const ChunkInterval &)> &emit);
+
+  uint64_t Added() const { return added; }
+  size_t SpillFiles() const { return spills.size(); }
+
+private:
+
+  bool Spill();
+  bool MergeFiles(const std::vector<std::string> &files,
+                  const std::function<void(const ChunkInterval &)> &emit);
+  void RemoveSpills();
+
+  std::string temp_dir;
+  size_t run_limit;
+  uint64_t added = 0;
+  std::vector<ChunkInterval> buffer;
+  std::vector<std::string> spills;
+
+};
+
+struct CoverageReport {
+
+  explicit CoverageReport(const ChunkIndex &total) : total(total) {}
+
+  // Feed merged runs in order, then call Finish.
+  void Add(const ChunkInterval &run);
+  void Finish();
+
+  ChunkIndex total;
+  ChunkIndex covered;
+  uint64_t runs = 0;
+  uint64_t gaps = 0;
+  ChunkInterval largest_gap = {ChunkIndex(), ChunkIndex()};
+  ChunkIndex largest_gap_size;
+
+private:
+
+  void Gap(const ChunkIndex &first, const ChunkIndex &end);
+
+  ChunkIndex next; // first chunk after the runs seen so far
+
+};
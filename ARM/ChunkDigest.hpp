@@ -0,0 +1,53 @@
+// Running digest of the hash160 values computed while scanning a chunk.
+//
+// Folds the first 8 bytes of every hash160 (both encodings of every key)
+// with XOR and with addition. Both are order independent, so the digest does
+// not depend on how batches are split between threads or on a resume in the
+// middle of the chunk, and two digests of parts of a chunk combine into the
+// digest of the whole. Rescanning the chunk must reproduce it exactly, which
+// a chunk that was marked done without being scanned cannot do.
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+struct ChunkDigest {
+  uint64_t x = 0;
+  uint64_t sum = 0;
+
+  void Fold(const uint8_t *hash160) {
+    uint64_t w;
+    memcpy(&w, hash160, sizeof(w));
+    x ^= w;
+    sum += w;
+  }
+
+  void Merge(const ChunkDigest &o) {
+    x ^= o.x;
+    sum += o.sum;
+  }
+
+  // No digest was recorded (a real chunk digest is never all zero in practice)
+  bool IsEmpty() const { return x == 0 && sum == 0; }
+
+  bool operator==(const ChunkDigest &o) const { return x == o.x && sum == o.sum; }
+  bool operator!=(const ChunkDigest &o) const { return !(*this == o); }
+
+  // "<x>:<sum>", 16 hex digits each
+  std::string ToString() const {
+    char buf[40];
+    snprintf(buf, sizeof(buf), "%016llX:%016llX", (unsigned long long)x, (unsigned long long)sum);
+    return buf;
+  }
+
+  bool Parse(const std::string &s) {
+    unsigned long long a, b;
+    char tail;
+    if (sscanf(s.c_str(), "%llx:%llx%c", &a, &b, &tail) != 2) return false;
+    x = a;
+    sum = b;
+    return true;
+  }
+};
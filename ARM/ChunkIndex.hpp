@@ -0,0 +1,277 @@
+// Fixed-width (256-bit) chunk index and a seeded permutation over [0, total).
+//
+// A job is split into `total` chunks of `range_size` keys. The number of
+// chunks can exceed 2^64 (and 2^128) for wide sampling jobs, so indices are
+// kept at full key width instead of being clamped to a machine word.
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <functional>
+
+#include "include/Int.h"
+
+struct ChunkIndex {
+  static const int LIMBS = 4;
+  uint64_t w[LIMBS]; // little-endian 64-bit limbs
+
+  ChunkIndex() { memset(w, 0, sizeof(w)); }
+  explicit ChunkIndex(uint64_t v) { memset(w, 0, sizeof(w)); w[0] = v; }
+
+  /* ---- conversions ------------------------------------------------ */
+
+  // Read the low 256 bits of an Int (bits64 is the Int's public limb array).
+  static ChunkIndex FromInt(const Int &v) {
+    ChunkIndex r;
+    for (int i = 0; i < LIMBS; i++) r.w[i] = v.bits64[i];
+    return r;
+  }
+
+  void ToInt(Int &out) const {
+    for (int i = 0; i < NB64BLOCK; i++) out.bits64[i] = i < LIMBS ? w[i] : 0;
+  }
+
+  bool FitsUint64() const { return (w[1] | w[2] | w[3]) == 0; }
+  uint64_t ToUint64() const { return w[0]; }
+
+  double ToDouble() const {
+    double r = 0;
+    for (int i = LIMBS - 1; i >= 0; i--) r = r * 18446744073709551616.0 + (double)w[i];
+    return r;
+  }
+
+  /* ---- comparison ------------------------------------------------- */
+
+  int Compare(const ChunkIndex &o) const {
+    for (int i = LIMBS - 1; i >= 0; i--) {
+      if (w[i] != o.w[i]) return w[i] < o.w[i] ? -1 : 1;
+    }
+    return 0;
+  }
+  bool operator==(const ChunkIndex &o) const { return Compare(o) == 0; }
+  bool operator!=(const ChunkIndex &o) const { return Compare(o) != 0; }
+  bool operator<(const ChunkIndex &o) const { return Compare(o) < 0; }
+  bool operator<=(const ChunkIndex &o) const { return Compare(o) <= 0; }
+  bool operator>(const ChunkIndex &o) const { return Compare(o) > 0; }
+  bool operator>=(const ChunkIndex &o) const { return Compare(o) >= 0; }
+
+  bool IsZero() const { return (w[0] | w[1] | w[2] | w[3]) == 0; }
+
+  int GetBitLength() const {
+    for (int i = LIMBS - 1; i >= 0; i--) {
+      if (w[i]) return i * 64 + 64 - __builtin_clzll(w[i]);
+    }
+    return 0;
+  }
+
+  /* ---- arithmetic (mod 2^256) ------------------------------------- */
+
+  void Add(uint64_t a) {
+    for (int i = 0; i < LIMBS && a; i++) {
+      w[i] += a;
+      a = w[i] < a ? 1 : 0;
+    }
+  }
+
+  void Add(const ChunkIndex &a) {
+    unsigned __int128 c = 0;
+    for (int i = 0; i < LIMBS; i++) {
+      c += (unsigned __int128)w[i] + a.w[i];
+      w[i] = (uint64_t)c;
+      c >>= 64;
+    }
+  }
+
+  void Sub(const ChunkIndex &a) {
+    uint64_t borrow = 0;
+    for (int i = 0; i < LIMBS; i++) {
+      uint64_t d = w[i] - a.w[i];
+      uint64_t b = (w[i] < a.w[i]) | (d < borrow);
+      w[i] = d - borrow;
+      borrow = b;
+    }
+  }
+
+  // this <- this * a (low 256 bits)
+  void Mult(const ChunkIndex &a) {
+    uint64_t r[LIMBS] = {0, 0, 0, 0};
+    for (int i = 0; i < LIMBS; i++) {
+      unsigned __int128 c = 0;
+      for (int j = 0; i + j < LIMBS; j++) {
+        c += (unsigned __int128)w[i] * a.w[j] + r[i + j];
+        r[i + j] = (uint64_t)c;
+        c >>= 64;
+      }
+    }
+    memcpy(w, r, sizeof(w));
+  }
+
+  // this <- this / d, returns the remainder
+  uint64_t DivSmall(uint64_t d) {
+    unsigned __int128 rem = 0;
+    for (int i = LIMBS - 1; i >= 0; i--) {
+      unsigned __int128 cur = (rem << 64) | w[i];
+      w[i] = (uint64_t)(cur / d);
+      rem = cur % d;
+    }
+    return (uint64_t)rem;
+  }
+
+  void ShiftR(int n) {
+    if (n <= 0) return;
+    if (n >= 256) { memset(w, 0, sizeof(w)); return; }
+    int limbs = n / 64, bits = n % 64;
+    for (int i = 0; i < LIMBS; i++) {
+      uint64_t lo = i + limbs < LIMBS ? w[i + limbs] : 0;
+      uint64_t hi = i + limbs + 1 < LIMBS ? w[i + limbs + 1] : 0;
+      w[i] = bits ? (lo >> bits) | (hi << (64 - bits)) : lo;
+    }
+  }
+
+  void Xor(const ChunkIndex &a) {
+    for (int i = 0; i < LIMBS; i++) w[i] ^= a.w[i];
+  }
+
+  // Keep only the low n bits.
+  void Mask(int n) {
+    for (int i = 0; i < LIMBS; i++) {
+      int lo = i * 64;
+      if (n <= lo) w[i] = 0;
+      else if (n < lo + 64) w[i] &= (1ULL << (n - lo)) - 1;
+    }
+  }
+
+  /* ---- strings ---------------------------------------------------- */
+
+  std::string GetBase10() const {
+    if (IsZero()) return "0";
+    ChunkIndex t = *this;
+    std::string s;
+    while (!t.IsZero()) s.insert(s.begin(), (char)('0' + t.DivSmall(10)));
+    return s;
+  }
+
+  std::string GetBase16() const {
+    static const char hex[] = "0123456789ABCDEF";
+    std::string s;
+    for (int i = LIMBS - 1; i >= 0; i--) {
+      for (int b = 60; b >= 0; b -= 4) s.push_back(hex[(w[i] >> b) & 0xF]);
+    }
+    size_t nz = s.find_first_not_of('0');
+    return nz == std::string::npos ? "0" : s.substr(nz);
+  }
+
+  // Valid with 0x or without, returns false on invalid input or overflow.
+  bool SetBase16(const std::string &value) {
+    memset(w, 0, sizeof(w));
+    size_t i = (value.size() > 1 && value[0] == '0' && (value[1] == 'x' || value[1] == 'X')) ? 2 : 0;
+    if (i == value.size()) return false;
+    for (; i < value.size(); i++) {
+      char c = value[i];
+      uint64_t d;
+      if ('0' <= c && c <= '9') d = c - '0';
+      else if ('a' <= c && c <= 'f') d = c - 'a' + 10;
+      else if ('A' <= c && c <= 'F') d = c - 'A' + 10;
+      else return false;
+      if (w[LIMBS - 1] >> 60) return false;
+      for (int j = LIMBS - 1; j > 0; j--) w[j] = (w[j] << 4) | (w[j - 1] >> 60);
+      w[0] = (w[0] << 4) | d;
+    }
+    return true;
+  }
+};
+
+struct ChunkIndexHash {
+  size_t operator()(const ChunkIndex &c) const {
+    uint64_t h = c.w[0] ^ (c.w[1] * 0x9E3779B97F4A7C15ULL) ^
+                 (c.w[2] * 0xC2B2AE3D27D4EB4FULL) ^ (c.w[3] * 0x165667B19E3779F9ULL);
+    h ^= h >> 31;
+    return (size_t)h;
+  }
+};
+
+// Run of consecutive chunks [first, last], both inclusive.
+struct ChunkInterval {
+  ChunkIndex first;
+  ChunkIndex last;
+
+  // Number of chunks in the run, mod 2^256.
+  ChunkIndex Size() const {
+    ChunkIndex n = last;
+    n.Sub(first);
+    n.Add(1);
+    return n;
+  }
+};
+
+/*---------------------------------------------------------------
+    Seeded bijection on [0, total).
+
+    Mix() is a bijection on [0, 2^bits) built from odd multiplies,
+    adds and xor-shifts (each invertible mod 2^bits). Cycle-walking
+    restricts it to [0, total): since total > 2^(bits-1), At() needs
+    fewer than two Mix() calls on average. Walking pos = 0..total-1
+    visits every chunk exactly once in a pseudo-random order without
+    any per-chunk memory.
+  --------------------------------------------------------------*/
+class ChunkPermutation {
+
+public:
+
+  void Init(const ChunkIndex &total, uint64_t seed) {
+    total_ = total;
+    bits_ = total.GetBitLength();
+    if (bits_ < 1) bits_ = 1;
+    shift_ = (bits_ + 1) / 2;
+    for (int r = 0; r < ROUNDS; r++) {
+      for (int i = 0; i < ChunkIndex::LIMBS; i++) {
+        mult_[r].w[i] = SplitMix(seed);
+        add_[r].w[i] = SplitMix(seed);
+      }
+      mult_[r].w[0] |= 1;
+      mult_[r].Mask(bits_);
+      add_[r].Mask(bits_);
+    }
+  }
+
+  const ChunkIndex &Total() const { return total_; }
+
+  ChunkIndex At(const ChunkIndex &pos) const {
+    ChunkIndex x = pos;
+    do {
+      x = Mix(x);
+    } while (!(x < total_));
+    return x;
+  }
+
+private:
+
+  static const int ROUNDS = 3;
+
+  static uint64_t SplitMix(uint64_t &s) {
+    uint64_t z = (s += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+  }
+
+  ChunkIndex Mix(ChunkIndex x) const {
+    for (int r = 0; r < ROUNDS; r++) {
+      x.Mult(mult_[r]);
+      x.Add(add_[r]);
+      x.Mask(bits_);
+      ChunkIndex t = x;
+      t.ShiftR(shift_);
+      x.Xor(t);
+    }
+    return x;
+  }
+
+  ChunkIndex total_;
+  int bits_ = 1;
+  int shift_ = 1;
+  ChunkIndex mult_[ROUNDS];
+  ChunkIndex add_[ROUNDS];
+
+};
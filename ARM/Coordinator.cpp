@@ -0,0 +1,371 @@
+#include "Coordinator.h"
+
+#include <cmath>
+#include <poll.h>
+#include <sstream>
+#include <sys/socket.h>
+#include <unistd.h>
+
+// Upper bound on chunks per lease, whatever the reported speed.
+static const uint64_t MAX_LEASE_CHUNKS = 65536;
+
+Coordinator::Coordinator(ChunkScheduler &scheduler, const JobSpec &job,
+                         int lease_seconds, int lease_timeout)
+    : scheduler(scheduler), job(job), lease_seconds(lease_seconds),
+      lease_timeout(lease_timeout) {
+  ChunkIndex size;
+  size.SetBase16(job.range_size);
+  range_keys = size.ToDouble();
+}
+
+bool Coordinator::Serve(const std::string &listen_addr) {
+  int listen_fd = Net::listen_on(listen_addr);
+  if (listen_fd < 0) {
+    return false;
+  }
+
+  uint64_t next_conn = 1;
+  while (!stop_flag) {
+    {
+      std::lock_guard<std::mutex> lock(mtx);
+      ExpireLeases();
+      if (Finished()) {
+        break;
+      }
+    }
+    ReapHandlers();
+
+    pollfd pfd = {listen_fd, POLLIN, 0};
+    if (poll(&pfd, 1, 250) <= 0) {
+      continue;
+    }
+    int fd = accept(listen_fd, nullptr, nullptr);
+    if (fd < 0) {
+      continue;
+    }
+    uint64_t conn_id = next_conn++;
+    std::lock_guard<std::mutex> lock(conn_mutex);
+    conn_fds[conn_id] = fd;
+    handlers[conn_id] = std::thread(&Coordinator::HandleConnection, this, conn_id, fd);
+  }
+  close(listen_fd);
+  if (listen_addr.compare(0, 5, "unix:") == 0) {
+    unlink(listen_addr.substr(5).c_str());
+  }
+
+  // Wake up the handlers still blocked on their sockets
+  {
+    std::lock_guard<std::mutex> lock(conn_mutex);
+    for (auto &entry : conn_fds) {
+      shutdown(entry.second, SHUT_RDWR);
+    }
+  }
+  for (auto &handler : handlers) {
+    handler.second.join();
+  }
+  handlers.clear();
+  finished_conns.clear();
+  return true;
+}
+
+void Coordinator::Stop() {
+  stop_flag = true;
+}
+
+size_t Coordinator::Handlers() {
+  std::lock_guard<std::mutex> lock(conn_mutex);
+  return handlers.size();
+}
+
+// Join the handlers whose connections closed, so a long run does not pile up
+// one finished thread per worker that ever connected
+void Coordinator::ReapHandlers() {
+  std::vector<std::thread> done;
+  {
+    std::lock_guard<std::mutex> lock(conn_mutex);
+    for (uint64_t conn_id : finished_conns) {
+      auto it = handlers.find(conn_id);
+      if (it != handlers.end()) {
+        done.push_back(std::move(it->second));
+        handlers.erase(it);
+      }
+    }
+    finished_conns.clear();
+  }
+  for (auto &handler : done) {
+    handler.join();
+  }
+}
+
+void Coordinator::HandleConnection(uint64_t conn_id, int fd) {
+  Net::LineConn conn(fd);
+  {
+    std::lock_guard<std::mutex> lock(mtx);
+    Touch(conn_id);
+  }
+
+  std::string line;
+  while (!stop_flag && conn.ReadLine(line)) {
+    std::istringstream iss(line);
+    std::string cmd;
+    iss >> cmd;
+    {
+      std::lock_guard<std::mutex> lock(mtx);
+      Touch(conn_id);
+    }
+
+    bool ok = true;
+    if (cmd == "HELLO") {
+      std::ostringstream out;
+      out << "JOB " << job.range_start << " " << job.range_end << " " << job.range_size
+          << " " << lease_timeout << " " << job.addresses.size();
+      ok = conn.WriteLine(out.str());
+      for (size_t i = 0; ok && i < job.addresses.size(); i++) {
+        ok = conn.WriteLine("ADDRESS " + job.addresses[i]);
+      }
+    } else if (cmd == "LEASE") {
+      int threads = 1;
+      double keys_per_sec = 0;
+      iss >> threads >> keys_per_sec;
+      ok = conn.WriteLine(LeaseChunks(conn_id, threads, keys_per_sec));
+    } else if (cmd == "COMPLETE") {
+      std::string hex, digest_hex;
+      ChunkIndex idx;
+      ChunkDigest digest;
+      iss >> hex >> digest_hex;
+      if (!idx.SetBase16(hex) || (!digest_hex.empty() && !digest.Parse(digest_hex))) {
+        ok = conn.WriteLine("ERROR bad index");
+      } else if (CompleteChunk(conn_id, idx)) {
+        if (on_complete) on_complete(idx, digest);
+        ok = conn.WriteLine("OK");
+      } else {
+        ok = conn.WriteLine("STALE");
+      }
+    } else if (cmd == "FOUND") {
+      std::string privkey, address;
+      iss >> privkey >> address;
+      if (on_found) on_found(privkey, address);
+      ok = conn.WriteLine("OK");
+    } else if (cmd == "HEARTBEAT") {
+      ok = conn.WriteLine("OK");
+    } else {
+      ok = conn.WriteLine("ERROR unknown command");
+    }
+    if (!ok) {
+      break;
+    }
+  }
+
+  // Whatever the worker still held goes back into the pool right away
+  {
+    std::lock_guard<std::mutex> lock(mtx);
+    Release(conn_id);
+  }
+  std::lock_guard<std::mutex> lock(conn_mutex);
+  conn_fds.erase(conn_id);
+  finished_conns.push_back(conn_id);
+  conn.Close();
+}
+
+std::string Coordinator::LeaseChunks(uint64_t conn_id, int threads, double keys_per_sec) {
+  std::lock_guard<std::mutex> lock(mtx);
+  ExpireLeases();
+
+  // Size the lease so it lasts about lease_seconds at the reported speed
+  uint64_t count = threads > 0 ? (uint64_t)threads : 1;
+  if (keys_per_sec > 0 && range_keys > 0) {
+    double wanted = std::ceil(keys_per_sec * lease_seconds / range_keys);
+    count = wanted < 1 ? 1 : (wanted > MAX_LEASE_CHUNKS ? MAX_LEASE_CHUNKS : (uint64_t)wanted);
+  }
+
+  Session &session = sessions[conn_id];
+  std::ostringstream chunks;
+  uint64_t leased = 0;
+  while (leased < count) {
+    ChunkIndex idx;
+    if (!requeue.empty()) {
+      idx = *requeue.begin();
+      requeue.erase(requeue.begin());
+    } else if (!scheduler.Claim(idx)) {
+      break;
+    }
+    session.chunks.insert(idx);
+    outstanding[idx] = conn_id;
+    chunks << " " << idx.GetBase16();
+    leased++;
+  }
+
+  if (leased > 0) {
+    return "CHUNKS " + std::to_string(leased) + chunks.str();
+  }
+  if (!outstanding.empty()) {
+    // Other workers still hold leases that may come back
+    return "WAIT 1000";
+  }
+  return "DONE";
+}
+
+bool Coordinator::CompleteChunk(uint64_t conn_id, const ChunkIndex &idx) {
+  std::lock_guard<std::mutex> lock(mtx);
+  auto it = outstanding.find(idx);
+  if (it != outstanding.end()) {
+    if (it->second != conn_id) {
+      // Leased to another worker since this one's lease expired; only the
+      // holder's completion counts
+      return false;
+    }
+    auto session = sessions.find(it->second);
+    if (session != sessions.end()) {
+      session->second.chunks.erase(idx);
+    }
+    outstanding.erase(it);
+  } else if (!requeue.erase(idx)) {
+    // Already completed by whoever it was re-issued to
+    return false;
+  }
+  completed++;
+  return true;
+}
+
+// Caller holds mtx.
+void Coordinator::Touch(uint64_t conn_id) {
+  sessions[conn_id].deadline =
+      std::chrono::steady_clock::now() + std::chrono::seconds(lease_timeout);
+}
+
+// Caller holds mtx.
+void Coordinator::Release(uint64_t conn_id) {
+  auto it = sessions.find(conn_id);
+  if (it == sessions.end()) {
+    return;
+  }
+  for (const ChunkIndex &idx : it->second.chunks) {
+    outstanding.erase(idx);
+    requeue.insert(idx);
+  }
+  sessions.erase(it);
+}
+
+// Caller holds mtx.
+void Coordinator::ExpireLeases() {
+  auto now = std::chrono::steady_clock::now();
+  for (auto &entry : sessions) {
+    Session &session = entry.second;
+    if (session.deadline >= now || session.chunks.empty()) {
+      continue;
+    }
+    for (const ChunkIndex &idx : session.chunks) {
+      outstanding.erase(idx);
+      requeue.insert(idx);
+    }
+    session.chunks.clear();
+  }
+}
+
+// Caller holds mtx.
+bool Coordinator::Finished() {
+  return outstanding.empty() && requeue.empty() && scheduler.Exhausted();
+}
+
+/*---------------------------------------------------------------
+    Worker side
+  --------------------------------------------------------------*/
+
+bool CoordinatorClient::Connect(const std::string &addr, const std::string &name, JobSpec &job) {
+  std::lock_guard<std::mutex> lock(mtx);
+  int fd = Net::connect_to(addr);
+  if (fd < 0) {
+    return false;
+  }
+  conn = Net::LineConn(fd);
+
+  std::string line;
+  if (!conn.WriteLine("HELLO " + name) || !conn.ReadLine(line)) {
+    conn.Close();
+    return false;
+  }
+  std::istringstream iss(line);
+  std::string cmd;
+  size_t count = 0;
+  iss >> cmd >> job.range_start >> job.range_end >> job.range_size >> lease_timeout >> count;
+  if (cmd != "JOB" || iss.fail()) {
+    conn.Close();
+    return false;
+  }
+  job.addresses.clear();
+  for (size_t i = 0; i < count; i++) {
+    if (!conn.ReadLine(line) || line.compare(0, 8, "ADDRESS ") != 0) {
+      conn.Close();
+      return false;
+    }
+    job.addresses.push_back(line.substr(8));
+  }
+  return true;
+}
+
+bool CoordinatorClient::Request(const std::string &req, std::string &resp) {
+  std::lock_guard<std::mutex> lock(mtx);
+  return conn.WriteLine(req) && conn.ReadLine(resp);
+}
+
+CoordinatorClient::LeaseResult CoordinatorClient::Lease(int threads, double keys_per_sec,
+                                                        std::vector<ChunkIndex> &chunks,
+                                                        int &wait_ms) {
+  std::ostringstream req;
+  req << "LEASE " << threads << " " << (uint64_t)keys_per_sec;
+  std::string resp;
+  if (!Request(req.str(), resp)) {
+    return LEASE_ERROR;
+  }
+
+  std::istringstream iss(resp);
+  std::string cmd;
+  iss >> cmd;
+  if (cmd == "CHUNKS") {
+    size_t count = 0;
+    iss >> count;
+    for (size_t i = 0; i < count; i++) {
+      std::string hex;
+      ChunkIndex idx;
+      iss >> hex;
+      if (!idx.SetBase16(hex)) {
+        return LEASE_ERROR;
+      }
+      chunks.push_back(idx);
+    }
+    return LEASE_OK;
+  }
+  if (cmd == "WAIT") {
+    iss >> wait_ms;
+    return LEASE_WAIT;
+  }
+  if (cmd == "DONE") {
+    return LEASE_DONE;
+  }
+  return LEASE_ERROR;
+}
+
+bool CoordinatorClient::Complete(const ChunkIndex &idx, const ChunkDigest &digest) {
+  std::string resp;
+  std::string req = "COMPLETE " + idx.GetBase16();
+  if (!digest.IsEmpty()) {
+    req += " " + digest.ToString();
+  }
+  // STALE means someone else finished it first; nothing to retry.
+  return Request(req, resp) && (resp == "OK" || resp == "STALE");
+}
+
+bool CoordinatorClient::Found(const std::string &privkey, const std::string &address) {
+  std::string resp;
+  return Request("FOUND " + privkey + " " + address, resp) && resp == "OK";
+}
+
+bool CoordinatorClient::Heartbeat(double keys_per_sec) {
+  std::string resp;
+  return Request("HEARTBEAT " + std::to_string((uint64_t)keys_per_sec), resp) && resp == "OK";
+}
+
+void CoordinatorClient::Close() {
+  std::lock_guard<std::mutex> lock(mtx);
+  conn.Close();
+}
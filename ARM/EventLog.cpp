@@ -0,0 +1,117 @@
+#include "EventLog.h"
+
+// How often the logger thread wakes up to drain the queue
+static const int DRAIN_MS = 50;
+
+std::string json_string(const std::string &value) {
+  std::string out = "\"";
+  for (unsigned char c : value) {
+    if (c == '"' || c == '\\') {
+      out += '\\';
+      out += (char)c;
+    } else if (c < 0x20) {
+      char buf[8];
+      snprintf(buf, sizeof(buf), "\\u%04x", c);
+      out += buf;
+    } else {
+      out += (char)c;
+    }
+  }
+  return out + "\"";
+}
+
+EventLog::EventLog(Formatter format, FILE *text_out, std::mutex &text_mutex, int lines_per_second,
+                   FILE *json_out)
+    : format(format), text_out(text_out), text_mutex(text_mutex), lines_per_second(lines_per_second),
+      json_out(json_out) {
+}
+
+EventLog::~EventLog() {
+  Stop();
+}
+
+void EventLog::Start() {
+  window_start = std::chrono::steady_clock::now();
+  stopping = false;
+  thread = std::thread(&EventLog::Run, this);
+}
+
+void EventLog::Stop() {
+  if (!thread.joinable()) {
+    return;
+  }
+  stopping = true;
+  thread.join();
+}
+
+bool EventLog::Post(const LogEvent &event) {
+  if (queue.TryPush(event)) {
+    return true;
+  }
+  dropped.fetch_add(1, std::memory_order_relaxed);
+  return false;
+}
+
+void EventLog::Write(const std::string &text, bool flush) {
+  std::lock_guard<std::mutex> lock(text_mutex);
+  fputs(text.c_str(), text_out);
+  if (flush) {
+    fflush(text_out);
+  }
+}
+
+void EventLog::Drain() {
+  std::string text, json, lines;
+  LogEvent event;
+  bool wrote_json = false;
+  while (queue.TryPop(event)) {
+    text.clear();
+    json.clear();
+    format(event, text, json);
+    if (json_out && !json.empty()) {
+      fputs(json.c_str(), json_out);
+      fputc('\n', json_out);
+      wrote_json = true;
+    }
+    if (text.empty() || lines_per_second <= 0) {
+      continue;
+    }
+    if (window_lines < lines_per_second) {
+      lines += text + "\n";
+      window_lines++;
+    } else {
+      suppressed++;
+      last_suppressed = text;
+    }
+  }
+  if (wrote_json) {
+    fflush(json_out);
+  }
+
+  // A new window: sum up what the last one skipped with its latest line
+  auto now = std::chrono::steady_clock::now();
+  if (now - window_start >= std::chrono::seconds(1) || stopping) {
+    if (suppressed > 0) {
+      lines += last_suppressed + " (" + std::to_string(suppressed) + " more lines skipped)\n";
+    }
+    window_start = now;
+    window_lines = 0;
+    suppressed = 0;
+  }
+  uint64_t lost = dropped.load(std::memory_order_relaxed);
+  if (lost != reported_dropped) {
+    lines += "[!] " + std::to_string(lost - reported_dropped) + " status events dropped, the log queue was full\n";
+    reported_dropped = lost;
+  }
+  if (!lines.empty()) {
+    Write(lines, true);
+  }
+}
+
+void EventLog::Run() {
+  while (!stopping.load()) {
+    Drain();
+    std::this_thread::sleep_for(std::chrono::milliseconds(DRAIN_MS));
+  }
+  Drain();
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <mutex>
+#include <stdint.h>
+#include <string>
+#include <thread>
+
+#include "ChunkIndex.hpp"
+#include "MpscQueue.hpp"
+
+/*---------------------------------------------------------------
+    Status events off the workers' path.
+
+    Workers post fixed-size events to a lock-free queue and carry
+    on; a logger thread formats them, prints at most a set number
+    of text lines per second (the rest are summed up in one line)
+    and writes every event as a JSON line for log shippers. A full
+    queue drops the event and counts it instead of blocking.
+  --------------------------------------------------------------*/
+
+enum LogEventKind : uint8_t {
+  LOG_RANGE_COMPLETED,
+};
+
+struct LogEvent {
+  LogEventKind kind;
+  int job;            // index of the job
+  ChunkIndex range;   // range index
+  uint64_t completed; // ranges of the job completed by this process, this one included
+  uint64_t scanned;   // ranges of the job scanned so far, restored ones included
+  int64_t elapsed_ms; // since the scan started
+  int64_t unix_ms;    // when it happened
+};
+
+// `"..."` with JSON escapes
+std::string json_string(const std::string &value);
+
+class EventLog {
+
+public:
+
+  // Fills in the text line (without newline, empty for none) and the JSON object of an event
+  typedef std::function<void(const LogEvent &, std::string &text, std::string &json)> Formatter;
+
+  // Text lines go to `text_out`, written under `text_mutex`, at most
+  // `lines_per_second` of them (0 prints none). JSON lines go to `json_out`
+  // unless it is null.
+  EventLog(Formatter format, FILE *text_out, std::mutex &text_mutex, int lines_per_second, FILE *json_out);
+  ~EventLog();
+
+  void Start();
+
+  // Write out what is queued and stop the logger thread.
+  void Stop();
+
+  // Never blocks. False if the queue was full and the event was dropped.
+  bool Post(const LogEvent &event);
+
+  uint64_t Dropped() const { return dropped.load(std::memory_order_relaxed); }
+
+  static const size_t QUEUE_SIZE = 4096;
+
+private:
+
+  void Run();
+  void Drain();
+  void Write(const std::string &text, bool flush);
+
+  Formatter format;
+  FILE *text_out;
+  std::mutex &text_mutex;
+  int lines_per_second;
+  FILE *json_out;
+
+  MpscQueue<LogEvent, QUEUE_SIZE> queue;
+  std::atomic<uint64_t> dropped{0};
+  uint64_t reported_dropped = 0;
+  std::atomic<bool> stopping{false};
+  std::thread thread;
+
+  // Rate limit, logger thread only
+  std::chrono::steady_clock::time_point window_start;
+  int window_lines = 0;
+  uint64_t suppressed = 0;
+  std::string last_suppressed;
+
+};
@@ -0,0 +1,263 @@
+#include "Hash.h"
+#include "sha256_scalar.h"
+#include "ripemd160_scalar.h"
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#if defined(__aarch64__)
+#include "sha256_neon.h"
+#include "ripemd160_neon.h"
+#include "sha256_armv8.h"
+#if defined(__linux__)
+#include <sys/auxv.h>
+#include <asm/hwcap.h>
+#endif
+#endif
+
+static int sha256_8x_scalar(const uint8_t *inputs[8], const size_t lengths[8],
+                            uint8_t outputs[8][SHA256_DIGEST_SIZE]) {
+    for (int i = 0; i < 8; ++i) {
+        sha256_scalar(inputs[i], lengths[i], outputs[i]);
+    }
+    return 0;
+}
+
+static int ripemd160_8x_scalar(const uint8_t *inputs[8], const size_t lengths[8],
+                               uint8_t outputs[8][RIPEMD160_DIGEST_SIZE]) {
+    for (int i = 0; i < 8; ++i) {
+        ripemd160_scalar(inputs[i], lengths[i], outputs[i]);
+    }
+    return 0;
+}
+
+#if defined(__aarch64__)
+static int sha256_8x_neon(const uint8_t *inputs[8], const size_t lengths[8],
+                          uint8_t outputs[8][SHA256_DIGEST_SIZE]) {
+    sha256neon_8(inputs, lengths, outputs);
+    return 0;
+}
+
+static int ripemd160_8x_neon(const uint8_t *inputs[8], const size_t lengths[8],
+                             uint8_t outputs[8][RIPEMD160_DIGEST_SIZE]) {
+    ripemd160neon_8(inputs, lengths, outputs);
+    return 0;
+}
+
+static int sha256_8x_sha2(const uint8_t *inputs[8], const size_t lengths[8],
+                          uint8_t outputs[8][SHA256_DIGEST_SIZE]) {
+    sha256armv8_n(inputs, lengths, outputs, 8);
+    return 0;
+}
+
+static int sha256_16x_sha2(const uint8_t *inputs[16], const size_t lengths[16],
+                           uint8_t outputs[16][SHA256_DIGEST_SIZE]) {
+    sha256armv8_n(inputs, lengths, outputs, 16);
+    return 0;
+}
+#endif
+
+
+/* ------------------------------------------------------------------ */
+/* Dispatch                                                           */
+/* ------------------------------------------------------------------ */
+
+static int cpu_has_all(void) {
+    return 1;
+}
+
+#if defined(__aarch64__)
+static int cpu_has_sha2(void) {
+#if defined(__linux__)
+    return (getauxval(AT_HWCAP) & HWCAP_SHA2) != 0;
+#elif defined(__APPLE__)
+    // Every Apple silicon core has them
+    return 1;
+#else
+    return 0;
+#endif
+}
+#endif
+
+typedef struct {
+    const char *name;
+    int (*supported)(void);
+    int (*sha256)(const uint8_t *inputs[8], const size_t lengths[8], uint8_t outputs[8][SHA256_DIGEST_SIZE]);
+    int (*ripemd160)(const uint8_t *inputs[8], const size_t lengths[8], uint8_t outputs[8][RIPEMD160_DIGEST_SIZE]);
+    // 16-lane kernels, or NULL to make two 8-lane calls
+    int (*sha256_16)(const uint8_t *inputs[16], const size_t lengths[16], uint8_t outputs[16][SHA256_DIGEST_SIZE]);
+    int (*ripemd160_16)(const uint8_t *inputs[16], const size_t lengths[16], uint8_t outputs[16][RIPEMD160_DIGEST_SIZE]);
+} HashKernels;
+
+// Roughly slowest first; on a tie in timing the later one is kept. NEON
+// is part of every AArch64 CPU, so only the SHA-256 instructions are
+// looked for. Other targets have the scalar kernels alone.
+static const HashKernels kernels[] = {
+    {"scalar", cpu_has_all, sha256_8x_scalar, ripemd160_8x_scalar, NULL, NULL},
+#if defined(__aarch64__)
+    {"neon", cpu_has_all, sha256_8x_neon, ripemd160_8x_neon, NULL, NULL},
+    {"sha2", cpu_has_sha2, sha256_8x_sha2, ripemd160_8x_neon, sha256_16x_sha2, NULL},
+#endif
+};
+#define KERNEL_COUNT ((int)(sizeof(kernels) / sizeof(kernels[0])))
+
+// 16 inputs with a given set: its 16-lane kernels, or two 8-lane calls
+static int sha256_16_with(const HashKernels *k, const uint8_t *inputs[16], const size_t lengths[16],
+                          uint8_t outputs[16][SHA256_DIGEST_SIZE]) {
+    if (k->sha256_16) {
+        return k->sha256_16(inputs, lengths, outputs);
+    }
+    if (k->sha256(inputs, lengths, outputs) != 0) {
+        return -1;
+    }
+    return k->sha256(inputs + 8, lengths + 8, outputs + 8);
+}
+
+static int ripemd160_16_with(const HashKernels *k, const uint8_t *inputs[16], const size_t lengths[16],
+                             uint8_t outputs[16][RIPEMD160_DIGEST_SIZE]) {
+    if (k->ripemd160_16) {
+        return k->ripemd160_16(inputs, lengths, outputs);
+    }
+    if (k->ripemd160(inputs, lengths, outputs) != 0) {
+        return -1;
+    }
+    return k->ripemd160(inputs + 8, lengths + 8, outputs + 8);
+}
+
+static double now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+// Nanoseconds per key for hash160 of both encodings of 16 public keys, as
+// the scan loop does it: the best of a few short runs, to ride out noise
+static double time_kernels(const HashKernels *k) {
+    uint8_t keys[16][65];
+    const uint8_t *inputs[16];
+    size_t compressed[16], uncompressed[16], sha_lengths[16];
+    const uint8_t *sha_inputs[16];
+    uint8_t sha_out[16][SHA256_DIGEST_SIZE];
+    uint8_t rmd_out[16][RIPEMD160_DIGEST_SIZE];
+    for (int i = 0; i < 16; ++i) {
+        for (int j = 0; j < 65; ++j) {
+            keys[i][j] = (uint8_t)(i * 65 + j);
+        }
+        inputs[i] = keys[i];
+        compressed[i] = 33;
+        uncompressed[i] = 65;
+        sha_lengths[i] = SHA256_DIGEST_SIZE;
+        sha_inputs[i] = sha_out[i];
+    }
+
+    const int RUNS = 5, BATCHES = 16;
+    double best = 0;
+    for (int run = 0; run < RUNS; ++run) {
+        double began = now_ns();
+        for (int n = 0; n < BATCHES; ++n) {
+            sha256_16_with(k, inputs, uncompressed, sha_out);
+            ripemd160_16_with(k, sha_inputs, sha_lengths, rmd_out);
+            sha256_16_with(k, inputs, compressed, sha_out);
+            ripemd160_16_with(k, sha_inputs, sha_lengths, rmd_out);
+            keys[0][1] ^= rmd_out[0][0];
+        }
+        double elapsed = (now_ns() - began) / (BATCHES * 16);
+        if (run == 0 || elapsed < best) {
+            best = elapsed;
+        }
+    }
+    return best;
+}
+
+static double timings[KERNEL_COUNT];
+
+// Selected once at startup, before the workers start. A race on first use
+// may time the kernels twice and keep either pick: they hash the same.
+static const HashKernels *selected = NULL;
+
+static const HashKernels *selected_kernels(void) {
+    if (!selected) {
+        hash_select_isa(NULL);
+    }
+    return selected;
+}
+
+int hash_select_isa(const char *name) {
+    if (!name || strcmp(name, "auto") == 0) {
+        const HashKernels *fastest = NULL;
+        for (int i = 0; i < KERNEL_COUNT; ++i) {
+            if (!kernels[i].supported()) {
+                continue;
+            }
+            timings[i] = time_kernels(&kernels[i]);
+            if (!fastest || timings[i] <= timings[fastest - kernels]) {
+                fastest = &kernels[i];
+            }
+        }
+        if (!fastest) {
+            return -1;
+        }
+        selected = fastest;
+        return 0;
+    }
+    for (int i = 0; i < KERNEL_COUNT; ++i) {
+        if (strcmp(kernels[i].name, name) == 0) {
+            if (!kernels[i].supported()) {
+                return -1;
+            }
+            selected = &kernels[i];
+            return 0;
+        }
+    }
+    return -1;
+}
+
+const char *hash_isa_name(void) {
+    return selected_kernels()->name;
+}
+
+int hash_isa_count(void) {
+    return KERNEL_COUNT;
+}
+
+const char *hash_isa_at(int i) {
+    return i >= 0 && i < KERNEL_COUNT ? kernels[i].name : NULL;
+}
+
+int hash_isa_supported(const char *name) {
+    for (int i = 0; i < KERNEL_COUNT; ++i) {
+        if (strcmp(kernels[i].name, name) == 0) {
+            return kernels[i].supported();
+        }
+    }
+    return 0;
+}
+
+double hash_isa_ns_per_key(const char *name) {
+    for (int i = 0; i < KERNEL_COUNT; ++i) {
+        if (strcmp(kernels[i].name, name) == 0) {
+            return timings[i];
+        }
+    }
+    return 0;
+}
+
+int sha256_8x(const uint8_t *inputs[8], const size_t lengths[8],
+              uint8_t outputs[8][SHA256_DIGEST_SIZE]) {
+    return selected_kernels()->sha256(inputs, lengths, outputs);
+}
+
+int ripemd160_8x(const uint8_t *inputs[8], const size_t lengths[8],
+                 uint8_t outputs[8][RIPEMD160_DIGEST_SIZE]) {
+    return selected_kernels()->ripemd160(inputs, lengths, outputs);
+}
+
+int sha256_16x(const uint8_t *inputs[16], const size_t lengths[16],
+               uint8_t outputs[16][SHA256_DIGEST_SIZE]) {
+    return sha256_16_with(selected_kernels(), inputs, lengths, outputs);
+}
+
+int ripemd160_16x(const uint8_t *inputs[16], const size_t lengths[16],
+                  uint8_t outputs[16][RIPEMD160_DIGEST_SIZE]) {
+    return ripemd160_16_with(selected_kernels(), inputs, lengths, outputs);
+}
@@ -0,0 +1,90 @@
+#ifndef HASH_AVX2_C_H
+#define HASH_AVX2_C_H
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+
+#define SHA256_DIGEST_SIZE 32
+#define RIPEMD160_DIGEST_SIZE 20
+
+/**
+ * Hash kernels, one set per instruction set. Which one is fastest depends
+ * on the CPU (the SHA-256 instructions against NEON lanes), so unless
+ * hash_select_isa chose one, every set the CPU supports is timed hashing a
+ * batch of public keys on first use and the fastest is kept.
+ */
+
+/**
+ * Select the kernels by name ("scalar", "neon", "sha2"), or time
+ * the supported ones and keep the fastest for NULL or "auto".
+ *
+ * @return 0 on success, -1 if the name is unknown or the CPU lacks the
+ *         instructions.
+ */
+int hash_select_isa(const char *name);
+
+/** Name of the kernels in use, selecting the fastest ones if none are yet. */
+const char *hash_isa_name(void);
+
+/** Number of kernel sets built in, and the name of the i-th. */
+int hash_isa_count(void);
+const char *hash_isa_at(int i);
+
+/** 1 if this CPU can run the named kernels. */
+int hash_isa_supported(const char *name);
+
+/**
+ * Nanoseconds per key the named kernels took to hash a batch of public
+ * keys when "auto" timed them, or 0 if they were not timed.
+ */
+double hash_isa_ns_per_key(const char *name);
+
+/**
+ * Compute SHA256 on 8 inputs in parallel with the selected kernels.
+ *
+ * @param inputs   Array of 8 pointers to input buffers.
+ * @param lengths  Array of 8 lengths for each input buffer.
+ * @param outputs  Output array [8][SHA256_DIGEST_SIZE] to receive digests.
+ * @return 0 on success, -1 on allocation error.
+ */
+int sha256_8x(const uint8_t *inputs[8], const size_t lengths[8],
+             uint8_t outputs[8][SHA256_DIGEST_SIZE]);
+
+/**
+ * Compute RIPEMD160 on 8 inputs in parallel with the selected kernels.
+ *
+ * @param inputs   Array of 8 pointers to input buffers.
+ * @param lengths  Array of 8 lengths for each input buffer.
+ * @param outputs  Output array [8][RIPEMD160_DIGEST_SIZE] to receive digests.
+ * @return 0 on success, -1 on allocation error.
+ */
+int ripemd160_8x(const uint8_t *inputs[8], const size_t lengths[8],
+                 uint8_t outputs[8][RIPEMD160_DIGEST_SIZE]);
+
+/**
+ * Compute SHA256 on 16 inputs with the selected kernels: one call of the
+ * SHA-256 instruction kernels where the CPU has them, two 8-lane calls
+ * otherwise.
+ *
+ * @param inputs   Array of 16 pointers to input buffers.
+ * @param lengths  Array of 16 lengths for each input buffer.
+ * @param outputs  Output array [16][SHA256_DIGEST_SIZE] to receive digests.
+ * @return 0 on success, -1 on allocation error.
+ */
+int sha256_16x(const uint8_t *inputs[16], const size_t lengths[16],
+               uint8_t outputs[16][SHA256_DIGEST_SIZE]);
+
+/**
+ * Compute RIPEMD160 on 16 inputs in parallel with the selected kernels.
+ *
+ * @param inputs   Array of 16 pointers to input buffers.
+ * @param lengths  Array of 16 lengths for each input buffer.
+ * @param outputs  Output array [16][RIPEMD160_DIGEST_SIZE] to receive digests.
+ * @return 0 on success, -1 on allocation error.
+ */
+int ripemd160_16x(const uint8_t *inputs[16], const size_t lengths[16],
+                  uint8_t outputs[16][RIPEMD160_DIGEST_SIZE]);
+
+#endif // HASH_AVX2_C_H
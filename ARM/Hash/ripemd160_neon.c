@@ -0,0 +1,328 @@
+// RIPEMD-160 with NEON, which every AArch64 CPU has: 4 lanes per vector, so
+// 8 messages are two batches whose steps are interleaved, on top of the two
+// independent lines of each. Empty on other targets, where Hash.c keeps the
+// scalar kernels.
+#if defined(__aarch64__)
+
+#include "ripemd160_neon.h"
+#include <string.h>
+
+void ripemd160_neon_initialize(uint32x4_t *s) {
+    s[0] = vdupq_n_u32(0x67452301ul);
+    s[1] = vdupq_n_u32(0xEFCDAB89ul);
+    s[2] = vdupq_n_u32(0x98BADCFEul);
+    s[3] = vdupq_n_u32(0x10325476ul);
+    s[4] = vdupq_n_u32(0xC3D2E1F0ul);
+}
+
+// A rotate is a shift and a shift-insert
+#define ROL(x, n) vsliq_n_u32(vshrq_n_u32(x, 32 - (n)), x, n)
+
+// RIPEMD-160 functions: f2 and f4 are bitwise selects, f3 and f5 use or-not
+#define f1(x, y, z) veorq_u32(x, veorq_u32(y, z))
+#define f2(x, y, z) vbslq_u32(x, y, z)
+#define f3(x, y, z) veorq_u32(vornq_u32(x, y), z)
+#define f4(x, y, z) vbslq_u32(z, x, y)
+#define f5(x, y, z) veorq_u32(x, vornq_u32(y, z))
+
+// Addition helpers
+#define add3(x0, x1, x2) vaddq_u32(vaddq_u32(x0, x1), x2)
+#define add4(x0, x1, x2, x3) vaddq_u32(vaddq_u32(x0, x1), vaddq_u32(x2, x3))
+
+// Round function
+#define Round(a, b, c, d, e, f, x, k, r) \
+    u = add4(a, f, x, vdupq_n_u32(k));   \
+    a = vaddq_u32(ROL(u, r), e);         \
+    c = ROL(c, 10);
+
+// Macro definitions for each operation in the rounds
+#define R11(a, b, c, d, e, x, r) Round(a, b, c, d, e, f1(b, c, d), x, 0, r)
+#define R21(a, b, c, d, e, x, r) Round(a, b, c, d, e, f2(b, c, d), x, 0x5A827999ul, r)
+#define R31(a, b, c, d, e, x, r) Round(a, b, c, d, e, f3(b, c, d), x, 0x6ED9EBA1ul, r)
+#define R41(a, b, c, d, e, x, r) Round(a, b, c, d, e, f4(b, c, d), x, 0x8F1BBCDCul, r)
+#define R51(a, b, c, d, e, x, r) Round(a, b, c, d, e, f5(b, c, d), x, 0xA953FD4Eul, r)
+#define R12(a, b, c, d, e, x, r) Round(a, b, c, d, e, f5(b, c, d), x, 0x50A28BE6ul, r)
+#define R22(a, b, c, d, e, x, r) Round(a, b, c, d, e, f4(b, c, d), x, 0x5C4DD124ul, r)
+#define R32(a, b, c, d, e, x, r) Round(a, b, c, d, e, f3(b, c, d), x, 0x6D703EF3ul, r)
+#define R42(a, b, c, d, e, x, r) Round(a, b, c, d, e, f2(b, c, d), x, 0x7A6D76E9ul, r)
+#define R52(a, b, c, d, e, x, r) Round(a, b, c, d, e, f1(b, c, d), x, 0, r)
+
+// The 160 steps, left and right lines alternating: STEP(round, the state
+// words in their order for the step, message word index, rotation). Each step
+// runs on both batches before the next.
+#define RIPEMD160_STEPS(STEP)             \
+    STEP(R11, a1, b1, c1, d1, e1, 0, 11)  \
+    STEP(R12, a2, b2, c2, d2, e2, 5, 8)   \
+    STEP(R11, e1, a1, b1, c1, d1, 1, 14)  \
+    STEP(R12, e2, a2, b2, c2, d2, 14, 9)  \
+    STEP(R11, d1, e1, a1, b1, c1, 2, 15)  \
+    STEP(R12, d2, e2, a2, b2, c2, 7, 9)   \
+    STEP(R11, c1, d1, e1, a1, b1, 3, 12)  \
+    STEP(R12, c2, d2, e2, a2, b2, 0, 11)  \
+    STEP(R11, b1, c1, d1, e1, a1, 4, 5)   \
+    STEP(R12, b2, c2, d2, e2, a2, 9, 13)  \
+    STEP(R11, a1, b1, c1, d1, e1, 5, 8)   \
+    STEP(R12, a2, b2, c2, d2, e2, 2, 15)  \
+    STEP(R11, e1, a1, b1, c1, d1, 6, 7)   \
+    STEP(R12, e2, a2, b2, c2, d2, 11, 15) \
+    STEP(R11, d1, e1, a1, b1, c1, 7, 9)   \
+    STEP(R12, d2, e2, a2, b2, c2, 4, 5)   \
+    STEP(R11, c1, d1, e1, a1, b1, 8, 11)  \
+    STEP(R12, c2, d2, e2, a2, b2, 13, 7)  \
+    STEP(R11, b1, c1, d1, e1, a1, 9, 13)  \
+    STEP(R12, b2, c2, d2, e2, a2, 6, 7)   \
+    STEP(R11, a1, b1, c1, d1, e1, 10, 14) \
+    STEP(R12, a2, b2, c2, d2, e2, 15, 8)  \
+    STEP(R11, e1, a1, b1, c1, d1, 11, 15) \
+    STEP(R12, e2, a2, b2, c2, d2, 8, 11)  \
+    STEP(R11, d1, e1, a1, b1, c1, 12, 6)  \
+    STEP(R12, d2, e2, a2, b2, c2, 1, 14)  \
+    STEP(R11, c1, d1, e1, a1, b1, 13, 7)  \
+    STEP(R12, c2, d2, e2, a2, b2, 10, 14) \
+    STEP(R11, b1, c1, d1, e1, a1, 14, 9)  \
+    STEP(R12, b2, c2, d2, e2, a2, 3, 12)  \
+    STEP(R11, a1, b1, c1, d1, e1, 15, 8)  \
+    STEP(R12, a2, b2, c2, d2, e2, 12, 6)  \
+    STEP(R21, e1, a1, b1, c1, d1, 7, 7)   \
+    STEP(R22, e2, a2, b2, c2, d2, 6, 9)   \
+    STEP(R21, d1, e1, a1, b1, c1, 4, 6)   \
+    STEP(R22, d2, e2, a2, b2, c2, 11, 13) \
+    STEP(R21, c1, d1, e1, a1, b1, 13, 8)  \
+    STEP(R22, c2, d2, e2, a2, b2, 3, 15)  \
+    STEP(R21, b1, c1, d1, e1, a1, 1, 13)  \
+    STEP(R22, b2, c2, d2, e2, a2, 7, 7)   \
+    STEP(R21, a1, b1, c1, d1, e1, 10, 11) \
+    STEP(R22, a2, b2, c2, d2, e2, 0, 12)  \
+    STEP(R21, e1, a1, b1, c1, d1, 6, 9)   \
+    STEP(R22, e2, a2, b2, c2, d2, 13, 8)  \
+    STEP(R21, d1, e1, a1, b1, c1, 15, 7)  \
+    STEP(R22, d2, e2, a2, b2, c2, 5, 9)   \
+    STEP(R21, c1, d1, e1, a1, b1, 3, 15)  \
+    STEP(R22, c2, d2, e2, a2, b2, 10, 11) \
+    STEP(R21, b1, c1, d1, e1, a1, 12, 7)  \
+    STEP(R22, b2, c2, d2, e2, a2, 14, 7)  \
+    STEP(R21, a1, b1, c1, d1, e1, 0, 12)  \
+    STEP(R22, a2, b2, c2, d2, e2, 15, 7)  \
+    STEP(R21, e1, a1, b1, c1, d1, 9, 15)  \
+    STEP(R22, e2, a2, b2, c2, d2, 8, 12)  \
+    STEP(R21, d1, e1, a1, b1, c1, 5, 9)   \
+    STEP(R22, d2, e2, a2, b2, c2, 12, 7)  \
+    STEP(R21, c1, d1, e1, a1, b1, 2, 11)  \
+    STEP(R22, c2, d2, e2, a2, b2, 4, 6)   \
+    STEP(R21, b1, c1, d1, e1, a1, 14, 7)  \
+    STEP(R22, b2, c2, d2, e2, a2, 9, 15)  \
+    STEP(R21, a1, b1, c1, d1, e1, 11, 13) \
+    STEP(R22, a2, b2, c2, d2, e2, 1, 13)  \
+    STEP(R21, e1, a1, b1, c1, d1, 8, 12)  \
+    STEP(R22, e2, a2, b2, c2, d2, 2, 11)  \
+    STEP(R31, d1, e1, a1, b1, c1, 3, 11)  \
+    STEP(R32, d2, e2, a2, b2, c2, 15, 9)  \
+    STEP(R31, c1, d1, e1, a1, b1, 10, 13) \
+    STEP(R32, c2, d2, e2, a2, b2, 5, 7)   \
+    STEP(R31, b1, c1, d1, e1, a1, 14, 6)  \
+    STEP(R32, b2, c2, d2, e2, a2, 1, 15)  \
+    STEP(R31, a1, b1, c1, d1, e1, 4, 7)   \
+    STEP(R32, a2, b2, c2, d2, e2, 3, 11)  \
+    STEP(R31, e1, a1, b1, c1, d1, 9, 14)  \
+    STEP(R32, e2, a2, b2, c2, d2, 7, 8)   \
+    STEP(R31, d1, e1, a1, b1, c1, 15, 9)  \
+    STEP(R32, d2, e2, a2, b2, c2, 14, 6)  \
+    STEP(R31, c1, d1, e1, a1, b1, 8, 13)  \
+    STEP(R32, c2, d2, e2, a2, b2, 6, 6)   \
+    STEP(R31, b1, c1, d1, e1, a1, 1, 15)  \
+    STEP(R32, b2, c2, d2, e2, a2, 9, 14)  \
+    STEP(R31, a1, b1, c1, d1, e1, 2, 14)  \
+    STEP(R32, a2, b2, c2, d2, e2, 11, 12) \
+    STEP(R31, e1, a1, b1, c1, d1, 7, 8)   \
+    STEP(R32, e2, a2, b2, c2, d2, 8, 13)  \
+    STEP(R31, d1, e1, a1, b1, c1, 0, 13)  \
+    STEP(R32, d2, e2, a2, b2, c2, 12, 5)  \
+    STEP(R31, c1, d1, e1, a1, b1, 6, 6)   \
+    STEP(R32, c2, d2, e2, a2, b2, 2, 14)  \
+    STEP(R31, b1, c1, d1, e1, a1, 13, 5)  \
+    STEP(R32, b2, c2, d2, e2, a2, 10, 13) \
+    STEP(R31, a1, b1, c1, d1, e1, 11, 12) \
+    STEP(R32, a2, b2, c2, d2, e2, 0, 13)  \
+    STEP(R31, e1, a1, b1, c1, d1, 5, 7)   \
+    STEP(R32, e2, a2, b2, c2, d2, 4, 7)   \
+    STEP(R31, d1, e1, a1, b1, c1, 12, 5)  \
+    STEP(R32, d2, e2, a2, b2, c2, 13, 5)  \
+    STEP(R41, c1, d1, e1, a1, b1, 1, 11)  \
+    STEP(R42, c2, d2, e2, a2, b2, 8, 15)  \
+    STEP(R41, b1, c1, d1, e1, a1, 9, 12)  \
+    STEP(R42, b2, c2, d2, e2, a2, 6, 5)   \
+    STEP(R41, a1, b1, c1, d1, e1, 11, 14) \
+    STEP(R42, a2, b2, c2, d2, e2, 4, 8)   \
+    STEP(R41, e1, a1, b1, c1, d1, 10, 15) \
+    STEP(R42, e2, a2, b2, c2, d2, 1, 11)  \
+    STEP(R41, d1, e1, a1, b1, c1, 0, 14)  \
+    STEP(R42, d2, e2, a2, b2, c2, 3, 14)  \
+    STEP(R41, c1, d1, e1, a1, b1, 8, 15)  \
+    STEP(R42, c2, d2, e2, a2, b2, 11, 14) \
+    STEP(R41, b1, c1, d1, e1, a1, 12, 9)  \
+    STEP(R42, b2, c2, d2, e2, a2, 15, 6)  \
+    STEP(R41, a1, b1, c1, d1, e1, 4, 8)   \
+    STEP(R42, a2, b2, c2, d2, e2, 0, 14)  \
+    STEP(R41, e1, a1, b1, c1, d1, 13, 9)  \
+    STEP(R42, e2, a2, b2, c2, d2, 5, 6)   \
+    STEP(R41, d1, e1, a1, b1, c1, 3, 14)  \
+    STEP(R42, d2, e2, a2, b2, c2, 12, 9)  \
+    STEP(R41, c1, d1, e1, a1, b1, 7, 5)   \
+    STEP(R42, c2, d2, e2, a2, b2, 2, 12)  \
+    STEP(R41, b1, c1, d1, e1, a1, 15, 6)  \
+    STEP(R42, b2, c2, d2, e2, a2, 13, 9)  \
+    STEP(R41, a1, b1, c1, d1, e1, 14, 8)  \
+    STEP(R42, a2, b2, c2, d2, e2, 9, 12)  \
+    STEP(R41, e1, a1, b1, c1, d1, 5, 6)   \
+    STEP(R42, e2, a2, b2, c2, d2, 7, 5)   \
+    STEP(R41, d1, e1, a1, b1, c1, 6, 5)   \
+    STEP(R42, d2, e2, a2, b2, c2, 10, 15) \
+    STEP(R41, c1, d1, e1, a1, b1, 2, 12)  \
+    STEP(R42, c2, d2, e2, a2, b2, 14, 8)  \
+    STEP(R51, b1, c1, d1, e1, a1, 4, 9)   \
+    STEP(R52, b2, c2, d2, e2, a2, 12, 8)  \
+    STEP(R51, a1, b1, c1, d1, e1, 0, 15)  \
+    STEP(R52, a2, b2, c2, d2, e2, 15, 5)  \
+    STEP(R51, e1, a1, b1, c1, d1, 5, 5)   \
+    STEP(R52, e2, a2, b2, c2, d2, 10, 12) \
+    STEP(R51, d1, e1, a1, b1, c1, 9, 11)  \
+    STEP(R52, d2, e2, a2, b2, c2, 4, 9)   \
+    STEP(R51, c1, d1, e1, a1, b1, 7, 6)   \
+    STEP(R52, c2, d2, e2, a2, b2, 1, 12)  \
+    STEP(R51, b1, c1, d1, e1, a1, 12, 8)  \
+    STEP(R52, b2, c2, d2, e2, a2, 5, 5)   \
+    STEP(R51, a1, b1, c1, d1, e1, 2, 13)  \
+    STEP(R52, a2, b2, c2, d2, e2, 8, 14)  \
+    STEP(R51, e1, a1, b1, c1, d1, 10, 12) \
+    STEP(R52, e2, a2, b2, c2, d2, 7, 6)   \
+    STEP(R51, d1, e1, a1, b1, c1, 14, 5)  \
+    STEP(R52, d2, e2, a2, b2, c2, 6, 8)   \
+    STEP(R51, c1, d1, e1, a1, b1, 1, 12)  \
+    STEP(R52, c2, d2, e2, a2, b2, 2, 13)  \
+    STEP(R51, b1, c1, d1, e1, a1, 3, 13)  \
+    STEP(R52, b2, c2, d2, e2, a2, 13, 6)  \
+    STEP(R51, a1, b1, c1, d1, e1, 8, 14)  \
+    STEP(R52, a2, b2, c2, d2, e2, 14, 5)  \
+    STEP(R51, e1, a1, b1, c1, d1, 11, 11) \
+    STEP(R52, e2, a2, b2, c2, d2, 0, 15)  \
+    STEP(R51, d1, e1, a1, b1, c1, 6, 8)   \
+    STEP(R52, d2, e2, a2, b2, c2, 3, 13)  \
+    STEP(R51, c1, d1, e1, a1, b1, 15, 5)  \
+    STEP(R52, c2, d2, e2, a2, b2, 9, 11)  \
+    STEP(R51, b1, c1, d1, e1, a1, 13, 6)  \
+    STEP(R52, b2, c2, d2, e2, a2, 11, 11)
+
+#define TWO(R, a, b, c, d, e, i, r) R(a##x, b##x, c##x, d##x, e##x, wx[i], r); \
+                                    R(a##y, b##y, c##y, d##y, e##y, wy[i], r);
+
+void ripemd160_neon_transform_2x(uint32x4_t sx[5], uint32x4_t sy[5], const uint8_t *blocks[8]) {
+    uint32x4_t a1x = sx[0], b1x = sx[1], c1x = sx[2], d1x = sx[3], e1x = sx[4];
+    uint32x4_t a1y = sy[0], b1y = sy[1], c1y = sy[2], d1y = sy[3], e1y = sy[4];
+    uint32x4_t a2x = a1x, b2x = b1x, c2x = c1x, d2x = d1x, e2x = e1x;
+    uint32x4_t a2y = a1y, b2y = b1y, c2y = c1y, d2y = d1y, e2y = e1y;
+    uint32x4_t u;
+
+    // Word i of every lane (little-endian, as the blocks are)
+    uint32_t words[16][8] __attribute__((aligned(16)));
+    for (int l = 0; l < 8; ++l) {
+        for (int i = 0; i < 16; ++i) {
+            memcpy(&words[i][l], blocks[l] + i * 4, 4);
+        }
+    }
+    uint32x4_t wx[16], wy[16];
+    for (int i = 0; i < 16; ++i) {
+        wx[i] = vld1q_u32(&words[i][0]);
+        wy[i] = vld1q_u32(&words[i][4]);
+    }
+
+    RIPEMD160_STEPS(TWO)
+
+    uint32x4_t t = sx[0];
+    sx[0] = add3(sx[1], c1x, d2x);
+    sx[1] = add3(sx[2], d1x, e2x);
+    sx[2] = add3(sx[3], e1x, a2x);
+    sx[3] = add3(sx[4], a1x, b2x);
+    sx[4] = add3(t, b1x, c2x);
+    t = sy[0];
+    sy[0] = add3(sy[1], c1y, d2y);
+    sy[1] = add3(sy[2], d1y, e2y);
+    sy[2] = add3(sy[3], e1y, a2y);
+    sy[3] = add3(sy[4], a1y, b2y);
+    sy[4] = add3(t, b1y, c2y);
+}
+
+// Block j of a message after padding (0x80, zeros, the length in bits
+// little-endian at the end of its last block). Blocks past the last one are zeros.
+static void padded_block(const uint8_t *data, size_t length, size_t j, uint8_t block[64]) {
+    size_t offset = j * 64;
+    size_t n = length > offset ? length - offset : 0;
+    if (n > 64) {
+        n = 64;
+    }
+    if (n) {
+        memcpy(block, data + offset, n);
+    }
+    memset(block + n, 0, 64 - n);
+    if (length >= offset && length - offset < 64) {
+        block[length - offset] = 0x80;
+    }
+    if (((length + 8) / 64 + 1) * 64 == offset + 64) {
+        uint64_t bit_length = (uint64_t)length * 8;
+        memcpy(block + 56, &bit_length, 8);
+    }
+}
+
+void ripemd160neon_8(const uint8_t *data[8], const size_t lengths[8], uint8_t hashes[8][20]) {
+    uint32x4_t sx[5], sy[5];
+    uint32x4_t dx[5], dy[5];
+    ripemd160_neon_initialize(sx);
+    ripemd160_neon_initialize(sy);
+    for (int k = 0; k < 5; ++k) {
+        dx[k] = vdupq_n_u32(0);
+        dy[k] = vdupq_n_u32(0);
+    }
+
+    size_t lane_blocks[8];
+    size_t max_blocks = 0;
+    for (int i = 0; i < 8; ++i) {
+        lane_blocks[i] = (lengths[i] + 8) / 64 + 1;
+        if (lane_blocks[i] > max_blocks) {
+            max_blocks = lane_blocks[i];
+        }
+    }
+
+    // A lane's digest is its state after its own last block, selected with a
+    // mask; the blocks of zeros it goes on hashing after that are ignored
+    uint8_t buffers[8][64] __attribute__((aligned(16)));
+    const uint8_t *block_ptrs[8];
+    for (int i = 0; i < 8; ++i) {
+        block_ptrs[i] = buffers[i];
+    }
+    for (size_t j = 0; j < max_blocks; ++j) {
+        uint32_t ending[8];
+        for (int i = 0; i < 8; ++i) {
+            padded_block(data[i], lengths[i], j, buffers[i]);
+            ending[i] = lane_blocks[i] == j + 1 ? 0xFFFFFFFFu : 0;
+        }
+        ripemd160_neon_transform_2x(sx, sy, block_ptrs);
+        uint32x4_t mx = vld1q_u32(ending);
+        uint32x4_t my = vld1q_u32(ending + 4);
+        for (int k = 0; k < 5; ++k) {
+            dx[k] = vbslq_u32(mx, sx[k], dx[k]);
+            dy[k] = vbslq_u32(my, sy[k], dy[k]);
+        }
+    }
+
+    uint32_t words[5][8]; // words[state_index][lane]
+    for (int k = 0; k < 5; ++k) {
+        vst1q_u32(words[k], dx[k]);
+        vst1q_u32(words[k] + 4, dy[k]);
+    }
+    for (int i = 0; i < 8; ++i) {
+        for (int k = 0; k < 5; ++k) {
+            memcpy(hashes[i] + k * 4, &words[k][i], 4);
+        }
+    }
+}
+
+#endif // __aarch64__
@@ -0,0 +1,18 @@
+#ifndef RIPEMD160_NEON_H
+#define RIPEMD160_NEON_H
+
+#include <arm_neon.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Initialize RIPEMD-160 state, one message per lane
+void ripemd160_neon_initialize(uint32x4_t *s);
+
+// One block of each of two batches of 4 messages, their steps interleaved:
+// blocks[0..3] for the lanes of sx, blocks[4..7] for those of sy
+void ripemd160_neon_transform_2x(uint32x4_t sx[5], uint32x4_t sy[5], const uint8_t *blocks[8]);
+
+// RIPEMD-160 of 8 messages of arbitrary size, message i in lane i % 4 of batch i / 4
+void ripemd160neon_8(const uint8_t *data[8], const size_t lengths[8], uint8_t hashes[8][20]);
+
+#endif // RIPEMD160_NEON_H
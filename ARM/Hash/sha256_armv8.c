@@ -0,0 +1,176 @@
+// SHA-256 with the ARMv8 SHA-256 instructions (optional in ARMv8-A, on
+// every Graviton, Ampere Altra and Apple core), in any AArch64 build;
+// Hash.c calls it only on CPUs that have them. One message per stream
+// rather than one per vector lane: each sha256h/sha256h2 pair does four
+// rounds of one message, and two messages are interleaved so the
+// instructions of one hide the latency of the other's.
+#if defined(__aarch64__)
+
+#if defined(__clang__)
+#pragma clang attribute push(__attribute__((target("sha2"))), apply_to = function)
+#elif defined(__GNUC__)
+#pragma GCC target("+crypto")
+#endif
+
+#include "sha256_armv8.h"
+#include <string.h>
+
+static const uint32_t K[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5,
+    0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
+    0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc,
+    0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7,
+    0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
+    0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3,
+    0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5,
+    0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+    0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+// Message words 4i..4i+3 from the 16 before them
+#define SCHEDULE(w, i) vsha256su1q_u32(vsha256su0q_u32(w[i - 4], w[i - 3]), w[i - 2], w[i - 1])
+
+// Four rounds: sha256h updates ABCD and sha256h2 EFGH, from the same
+// four words of message plus constant
+#define ROUNDS4(abcd, efgh, w, i)                       \
+    msg = vaddq_u32(w[i], vld1q_u32(&K[4 * (i)]));      \
+    prev = abcd;                                        \
+    abcd = vsha256hq_u32(abcd, efgh, msg);              \
+    efgh = vsha256h2q_u32(efgh, prev, msg);
+
+// Four message words, big-endian in the block
+#define LOADW(block, i) vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8((block) + 16 * (i))))
+
+void sha256_armv8_transform(uint32x4_t *abcd, uint32x4_t *efgh, const uint8_t block[64]) {
+    uint32x4_t s0 = *abcd;
+    uint32x4_t s1 = *efgh;
+    uint32x4_t w[16];
+    uint32x4_t msg, prev;
+
+    for (int i = 0; i < 4; ++i) {
+        w[i] = LOADW(block, i);
+    }
+    for (int i = 0; i < 16; ++i) {
+        if (i >= 4) {
+            w[i] = SCHEDULE(w, i);
+        }
+        ROUNDS4(s0, s1, w, i);
+    }
+
+    *abcd = vaddq_u32(*abcd, s0);
+    *efgh = vaddq_u32(*efgh, s1);
+}
+
+void sha256_armv8_transform_2way(uint32x4_t abcd[2], uint32x4_t efgh[2], const uint8_t *blocks[2]) {
+    uint32x4_t x0 = abcd[0], x1 = efgh[0];
+    uint32x4_t y0 = abcd[1], y1 = efgh[1];
+    uint32x4_t wx[16], wy[16];
+    uint32x4_t msg, prev;
+
+    for (int i = 0; i < 4; ++i) {
+        wx[i] = LOADW(blocks[0], i);
+        wy[i] = LOADW(blocks[1], i);
+    }
+    for (int i = 0; i < 16; ++i) {
+        if (i >= 4) {
+            wx[i] = SCHEDULE(wx, i);
+            wy[i] = SCHEDULE(wy, i);
+        }
+        ROUNDS4(x0, x1, wx, i);
+        ROUNDS4(y0, y1, wy, i);
+    }
+
+    abcd[0] = vaddq_u32(abcd[0], x0);
+    efgh[0] = vaddq_u32(efgh[0], x1);
+    abcd[1] = vaddq_u32(abcd[1], y0);
+    efgh[1] = vaddq_u32(efgh[1], y1);
+}
+
+// The initial hash values as ABCD / EFGH
+static void initialize(uint32x4_t *abcd, uint32x4_t *efgh) {
+    static const uint32_t init[8] = {0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+                                     0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19};
+    *abcd = vld1q_u32(init);
+    *efgh = vld1q_u32(init + 4);
+}
+
+// The state words a..h, stored big-endian
+static void store_digest(uint32x4_t abcd, uint32x4_t efgh, uint8_t out[32]) {
+    vst1q_u8(out, vrev32q_u8(vreinterpretq_u8_u32(abcd)));
+    vst1q_u8(out + 16, vrev32q_u8(vreinterpretq_u8_u32(efgh)));
+}
+
+// Block j of a message after padding (0x80, zeros, the length in bits
+// big-endian at the end of its last block)
+static void padded_block(const uint8_t *data, size_t length, size_t j, uint8_t block[64]) {
+    size_t offset = j * 64;
+    size_t n = length > offset ? length - offset : 0;
+    if (n > 64) {
+        n = 64;
+    }
+    if (n) {
+        memcpy(block, data + offset, n);
+    }
+    memset(block + n, 0, 64 - n);
+    if (length >= offset && length - offset < 64) {
+        block[length - offset] = 0x80;
+    }
+    if (((length + 8) / 64 + 1) * 64 == offset + 64) {
+        uint64_t bit_length = __builtin_bswap64((uint64_t)length * 8);
+        memcpy(block + 56, &bit_length, 8);
+    }
+}
+
+// A message by itself, blocks from `first` on, from the state given
+static void finish_one(const uint8_t *data, size_t length, size_t first, uint32x4_t abcd, uint32x4_t efgh,
+                       uint8_t out[32]) {
+    uint8_t block[64];
+    size_t blocks = (length + 8) / 64 + 1;
+    for (size_t j = first; j < blocks; ++j) {
+        padded_block(data, length, j, block);
+        sha256_armv8_transform(&abcd, &efgh, block);
+    }
+    store_digest(abcd, efgh, out);
+}
+
+void sha256armv8_n(const uint8_t *data[], const size_t lengths[], uint8_t hashes[][32], int count) {
+    int i = 0;
+    for (; i + 1 < count; i += 2) {
+        uint32x4_t abcd[2], efgh[2];
+        initialize(&abcd[0], &efgh[0]);
+        initialize(&abcd[1], &efgh[1]);
+
+        // Both streams for the blocks the two messages have, then the
+        // longer one alone (the pubkeys of a batch are all one length)
+        size_t blocks0 = (lengths[i] + 8) / 64 + 1;
+        size_t blocks1 = (lengths[i + 1] + 8) / 64 + 1;
+        size_t shared = blocks0 < blocks1 ? blocks0 : blocks1;
+        uint8_t buffers[2][64];
+        const uint8_t *block_ptrs[2] = {buffers[0], buffers[1]};
+        for (size_t j = 0; j < shared; ++j) {
+            padded_block(data[i], lengths[i], j, buffers[0]);
+            padded_block(data[i + 1], lengths[i + 1], j, buffers[1]);
+            sha256_armv8_transform_2way(abcd, efgh, block_ptrs);
+        }
+        finish_one(data[i], lengths[i], shared, abcd[0], efgh[0], hashes[i]);
+        finish_one(data[i + 1], lengths[i + 1], shared, abcd[1], efgh[1], hashes[i + 1]);
+    }
+    if (i < count) {
+        uint32x4_t abcd, efgh;
+        initialize(&abcd, &efgh);
+        finish_one(data[i], lengths[i], 0, abcd, efgh, hashes[i]);
+    }
+}
+
+#if defined(__clang__)
+#pragma clang attribute pop
+#endif
+
+#endif // __aarch64__
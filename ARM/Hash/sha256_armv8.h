@@ -0,0 +1,19 @@
+#ifndef SHA256_ARMV8_H
+#define SHA256_ARMV8_H
+
+#include <arm_neon.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// One block of one message; the state is kept as the ABCD / EFGH register
+// pair the SHA-256 instructions work on
+void sha256_armv8_transform(uint32x4_t *abcd, uint32x4_t *efgh, const uint8_t block[64]);
+
+// One block of each of two independent messages, interleaved so that each
+// stream's rounds fill the other's latency
+void sha256_armv8_transform_2way(uint32x4_t abcd[2], uint32x4_t efgh[2], const uint8_t *blocks[2]);
+
+// SHA-256 of `count` messages of arbitrary size, two at a time
+void sha256armv8_n(const uint8_t *data[], const size_t lengths[], uint8_t hashes[][32], int count);
+
+#endif // SHA256_ARMV8_H
@@ -0,0 +1,200 @@
+// SHA-256 with NEON, which every AArch64 CPU has: 4 lanes per vector, so
+// 8 messages are two batches whose rounds are interleaved, each filling
+// the other's latency. Empty on other targets, where Hash.c keeps the
+// scalar kernels.
+#if defined(__aarch64__)
+
+#include "sha256_neon.h"
+#include <string.h>
+
+void sha256_neon_initialize(uint32x4_t *s) {
+    const uint32_t init[8] = {
+        0x6a09e667,
+        0xbb67ae85,
+        0x3c6ef372,
+        0xa54ff53a,
+        0x510e527f,
+        0x9b05688c,
+        0x1f83d9ab,
+        0x5be0cd19
+    };
+
+    for (int i = 0; i < 8; ++i) {
+        s[i] = vdupq_n_u32(init[i]);
+    }
+}
+
+// A rotate is a shift and a shift-insert; Ch and Maj are one bitwise select
+#define ROR(x, n)     vsriq_n_u32(vshlq_n_u32(x, 32 - (n)), x, n)
+#define SHR(x, n)     vshrq_n_u32(x, n)
+#define XOR3(x, y, z) veorq_u32(veorq_u32(x, y), z)
+#define Ch(x, y, z)   vbslq_u32(x, y, z)
+#define Maj(x, y, z)  vbslq_u32(veorq_u32(x, y), z, y)
+
+#define S0(x) XOR3(ROR(x, 2), ROR(x, 13), ROR(x, 22))
+#define S1(x) XOR3(ROR(x, 6), ROR(x, 11), ROR(x, 25))
+#define s0(x) XOR3(ROR(x, 7), ROR(x, 18), SHR(x, 3))
+#define s1(x) XOR3(ROR(x, 17), ROR(x, 19), SHR(x, 10))
+
+#define Round(a, b, c, d, e, f, g, h, Kt, Wt)                                              \
+    T1 = vaddq_u32(vaddq_u32(vaddq_u32(h, S1(e)), vaddq_u32(Ch(e, f, g), Kt)), Wt); \
+    T2 = vaddq_u32(S0(a), Maj(a, b, c));                                            \
+    h = g;                                                                          \
+    g = f;                                                                          \
+    f = e;                                                                          \
+    e = vaddq_u32(d, T1);                                                           \
+    d = c;                                                                          \
+    c = b;                                                                          \
+    b = a;                                                                          \
+    a = vaddq_u32(T1, T2);
+
+static const uint32_t K[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5,
+    0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
+    0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc,
+    0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7,
+    0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
+    0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3,
+    0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5,
+    0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+    0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+// Message schedule of 4 lanes, lanes `first`..`first + 3` of `words`
+static void message_schedule(uint32x4_t W[64], uint32_t words[16][8], int first) {
+    for (int t = 0; t < 16; ++t) {
+        W[t] = vld1q_u32(&words[t][first]);
+    }
+    for (int t = 16; t < 64; ++t) {
+        W[t] = vaddq_u32(vaddq_u32(s1(W[t - 2]), W[t - 7]), vaddq_u32(s0(W[t - 15]), W[t - 16]));
+    }
+}
+
+void sha256_neon_transform_2x(uint32x4_t sx[8], uint32x4_t sy[8], const uint8_t *blocks[8]) {
+    uint32x4_t ax = sx[0], bx = sx[1], cx = sx[2], dx = sx[3];
+    uint32x4_t ex = sx[4], fx = sx[5], gx = sx[6], hx = sx[7];
+    uint32x4_t ay = sy[0], by = sy[1], cy = sy[2], dy = sy[3];
+    uint32x4_t ey = sy[4], fy = sy[5], gy = sy[6], hy = sy[7];
+    uint32x4_t T1, T2;
+
+    // Word t of every lane (big-endian), then the rest of both schedules
+    uint32_t words[16][8] __attribute__((aligned(16)));
+    for (int i = 0; i < 8; ++i) {
+        for (int t = 0; t < 16; ++t) {
+            uint32_t word;
+            memcpy(&word, blocks[i] + t * 4, 4);
+            words[t][i] = __builtin_bswap32(word);
+        }
+    }
+    uint32x4_t Wx[64], Wy[64];
+    message_schedule(Wx, words, 0);
+    message_schedule(Wy, words, 4);
+
+    for (int t = 0; t < 64; ++t) {
+        uint32x4_t Kt = vdupq_n_u32(K[t]);
+        Round(ax, bx, cx, dx, ex, fx, gx, hx, Kt, Wx[t]);
+        Round(ay, by, cy, dy, ey, fy, gy, hy, Kt, Wy[t]);
+    }
+
+    sx[0] = vaddq_u32(sx[0], ax);
+    sx[1] = vaddq_u32(sx[1], bx);
+    sx[2] = vaddq_u32(sx[2], cx);
+    sx[3] = vaddq_u32(sx[3], dx);
+    sx[4] = vaddq_u32(sx[4], ex);
+    sx[5] = vaddq_u32(sx[5], fx);
+    sx[6] = vaddq_u32(sx[6], gx);
+    sx[7] = vaddq_u32(sx[7], hx);
+    sy[0] = vaddq_u32(sy[0], ay);
+    sy[1] = vaddq_u32(sy[1], by);
+    sy[2] = vaddq_u32(sy[2], cy);
+    sy[3] = vaddq_u32(sy[3], dy);
+    sy[4] = vaddq_u32(sy[4], ey);
+    sy[5] = vaddq_u32(sy[5], fy);
+    sy[6] = vaddq_u32(sy[6], gy);
+    sy[7] = vaddq_u32(sy[7], hy);
+}
+
+// Block j of a message after padding (0x80, zeros, the length in bits
+// big-endian at the end of its last block). Blocks past the last one are zeros.
+static void padded_block(const uint8_t *data, size_t length, size_t j, uint8_t block[64]) {
+    size_t offset = j * 64;
+    size_t n = length > offset ? length - offset : 0;
+    if (n > 64) {
+        n = 64;
+    }
+    if (n) {
+        memcpy(block, data + offset, n);
+    }
+    memset(block + n, 0, 64 - n);
+    if (length >= offset && length - offset < 64) {
+        block[length - offset] = 0x80;
+    }
+    if (((length + 8) / 64 + 1) * 64 == offset + 64) {
+        uint64_t bit_length = __builtin_bswap64((uint64_t)length * 8);
+        memcpy(block + 56, &bit_length, 8);
+    }
+}
+
+void sha256neon_8(const uint8_t *data[8], const size_t lengths[8], uint8_t hashes[8][32]) {
+    uint32x4_t sx[8], sy[8];
+    uint32x4_t dx[8], dy[8];
+    sha256_neon_initialize(sx);
+    sha256_neon_initialize(sy);
+    for (int k = 0; k < 8; ++k) {
+        dx[k] = vdupq_n_u32(0);
+        dy[k] = vdupq_n_u32(0);
+    }
+
+    // Blocks of each message once padded, and the most of any
+    size_t lane_blocks[8];
+    size_t max_blocks = 0;
+    for (int i = 0; i < 8; ++i) {
+        lane_blocks[i] = (lengths[i] + 8) / 64 + 1;
+        if (lane_blocks[i] > max_blocks) {
+            max_blocks = lane_blocks[i];
+        }
+    }
+
+    // A lane's digest is its state after its own last block, selected with a
+    // mask; the blocks of zeros it goes on hashing after that are ignored
+    uint8_t buffers[8][64] __attribute__((aligned(16)));
+    const uint8_t *block_ptrs[8];
+    for (int i = 0; i < 8; ++i) {
+        block_ptrs[i] = buffers[i];
+    }
+    for (size_t j = 0; j < max_blocks; ++j) {
+        uint32_t ending[8];
+        for (int i = 0; i < 8; ++i) {
+            padded_block(data[i], lengths[i], j, buffers[i]);
+            ending[i] = lane_blocks[i] == j + 1 ? 0xFFFFFFFFu : 0;
+        }
+        sha256_neon_transform_2x(sx, sy, block_ptrs);
+        uint32x4_t mx = vld1q_u32(ending);
+        uint32x4_t my = vld1q_u32(ending + 4);
+        for (int k = 0; k < 8; ++k) {
+            dx[k] = vbslq_u32(mx, sx[k], dx[k]);
+            dy[k] = vbslq_u32(my, sy[k], dy[k]);
+        }
+    }
+
+    uint32_t words[8][8]; // words[state_index][lane]
+    for (int k = 0; k < 8; ++k) {
+        vst1q_u32(words[k], dx[k]);
+        vst1q_u32(words[k] + 4, dy[k]);
+    }
+    for (int i = 0; i < 8; ++i) {
+        for (int k = 0; k < 8; ++k) {
+            uint32_t word = __builtin_bswap32(words[k][i]);
+            memcpy(hashes[i] + k * 4, &word, 4);
+        }
+    }
+}
+
+#endif // __aarch64__
@@ -0,0 +1,18 @@
+#ifndef SHA256_NEON_H
+#define SHA256_NEON_H
+
+#include <arm_neon.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Initialize SHA-256 state with initial hash values, one message per lane
+void sha256_neon_initialize(uint32x4_t *s);
+
+// One block of each of two batches of 4 messages, their rounds interleaved:
+// blocks[0..3] for the lanes of sx, blocks[4..7] for those of sy
+void sha256_neon_transform_2x(uint32x4_t sx[8], uint32x4_t sy[8], const uint8_t *blocks[8]);
+
+// SHA-256 of 8 messages of arbitrary size, message i in lane i % 4 of batch i / 4
+void sha256neon_8(const uint8_t *data[8], const size_t lengths[8], uint8_t hashes[8][32]);
+
+#endif // SHA256_NEON_H
@@ -0,0 +1,136 @@
+#pragma once
+
+#include <chrono>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "ChunkDigest.hpp"
+
+/*---------------------------------------------------------------
+    Binary write-ahead checkpoint journal.
+
+    Completed chunks are appended as fixed-size, CRC-protected
+    records to `<path>`. Records are queued in memory and written
+    and fdatasync'ed in groups, at most `fsync_ms` apart, so a
+    completion costs a push under a mutex. A crash loses at most the
+    last group, and those chunks are simply scanned again.
+
+    From time to time the journal is folded into `<path>.snap`, a
+    sorted sparse bitmap of 64-chunk words, and truncated. Resuming
+    reads the snapshot plus the records written after it, without
+    parsing text.
+
+    A chunk interrupted part way is recorded with the offset it was
+    scanned up to. Those records are carried over into the journal
+    that follows a snapshot until the chunk completes.
+
+    Records carry the chunk's digest (see ChunkDigest.hpp). The
+    snapshot keeps only which chunks are done, so digests are moved
+    to the append-only `<path>.digests` before the journal is
+    truncated, where audits (--verify-chunk) find them.
+
+    Only jobs whose chunk count fits in 64 bits can be journaled.
+  --------------------------------------------------------------*/
+
+enum JournalRecordType : uint32_t {
+  JOURNAL_COMPLETE = 1, // chunk `idx` was scanned
+  JOURNAL_PARTIAL = 2,  // chunk `idx` was scanned up to key offset value | aux << 64
+};
+
+struct JournalRecord {
+  uint32_t type;
+  uint32_t crc;   // CRC-32 of the record with this field zeroed
+  uint64_t idx;   // chunk index
+  uint64_t value; // type specific, 0 for a plain completion
+  uint64_t aux;
+  uint64_t digest_x;   // digest of the keys scanned, 0 if none was taken
+  uint64_t digest_sum;
+};
+
+struct JournalPartial {
+  uint64_t idx;
+  uint64_t offset_lo; // keys of the chunk already scanned
+  uint64_t offset_hi;
+  ChunkDigest digest; // of those keys
+};
+
+class CheckpointJournal {
+
+public:
+
+  ~CheckpointJournal();
+
+  // Read the snapshot and journal of `path` and append every completed chunk
+  // to `completed` and every interrupted one to `partial`. Missing files are
+  // an empty checkpoint; a torn or corrupt tail ends the replay. Returns false
+  // if the files belong to another job.
+  static bool Load(const std::string &path, const std::string &job_key, uint64_t total,
+                   std::vector<uint64_t> &completed, std::vector<JournalPartial> &partial);
+  // Same, passing completed chunks to `on_complete` instead of collecting them.
+  static bool Load(const std::string &path, const std::string &job_key, uint64_t total,
+                   const std::function<void(uint64_t)> &on_complete,
+                   std::vector<JournalPartial> &partial);
+  // Same, keeping the snapshot as stored: (word, bits) pairs in `words`, word
+  // ascending and bit b of word w for chunk 64 * w + b (see
+  // ChunkScheduler::MarkScannedWords). Only the chunks completed after the
+  // snapshot go to `completed`, one by one.
+  static bool Load(const std::string &path, const std::string &job_key, uint64_t total,
+                   std::vector<uint64_t> &words, std::vector<uint64_t> &completed,
+                   std::vector<JournalPartial> &partial);
+
+  // True if `path` starts like a checkpoint journal.
+  static bool IsJournal(const std::string &path);
+
+  // Pass every recorded digest of a completed chunk to `on_digest`, from
+  // `<path>.digests` and the journal. Returns false for another job's files.
+  static bool LoadDigests(const std::string &path, const std::string &job_key, uint64_t total,
+                          const std::function<void(uint64_t, const ChunkDigest &)> &on_digest);
+
+  // Open for appending, creating the journal if needed. fsync_ms = 0 syncs every record.
+  bool Open(const std::string &path, const std::string &job_key, uint64_t total, int fsync_ms);
+
+  void Complete(uint64_t idx, const ChunkDigest &digest = ChunkDigest());
+  void Partial(const JournalPartial &partial);
+
+  // Write and sync the queued records if the fsync interval has passed, and
+  // fold the journal into the snapshot once it has grown large.
+  void Tick();
+
+  // Write and sync the queued records now.
+  void Flush();
+
+  // Fold the journal into the snapshot and truncate it.
+  bool Snapshot();
+
+  // Flush, snapshot and close.
+  void Close();
+
+  bool IsOpen() const { return fd >= 0; }
+
+  // Called with the duration of every write and sync of queued records, in
+  // microseconds, under the journal lock.
+  std::function<void(uint64_t)> on_sync;
+
+private:
+
+  void Append(const JournalRecord &record);
+  bool FlushLocked();
+  bool SnapshotLocked();
+  bool SaveDigestsLocked();
+
+  std::mutex mtx;
+  int fd = -1;
+  std::string path;
+  uint64_t job_hash = 0;
+  uint64_t total = 0;
+  int fsync_ms = 1000;
+  std::vector<JournalRecord> queued;   // not yet written
+  std::vector<uint64_t> unsnapshotted; // completed since the last snapshot
+  std::map<uint64_t, JournalRecord> partials; // interrupted and not completed since
+  std::chrono::steady_clock::time_point last_sync;
+
+};
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <stdint.h>
+
+/*---------------------------------------------------------------
+    Bounded multi-producer / single-consumer queue.
+
+    Any thread may push; one thread pops. Each slot carries a
+    sequence number telling whether it is free for the producer of
+    a given position or filled for the consumer, so a push is one
+    compare-and-swap on the tail and a pop none. Neither side ever
+    waits: a push into a full queue fails and the caller decides
+    what to drop.
+  --------------------------------------------------------------*/
+
+template <typename T, size_t N>
+class MpscQueue {
+
+  static_assert(N >= 2 && (N & (N - 1)) == 0, "queue size must be a power of two");
+
+public:
+
+  MpscQueue() {
+    for (size_t i = 0; i < N; i++) {
+      slots[i].seq.store(i, std::memory_order_relaxed);
+    }
+  }
+
+  // Any thread. False if the queue is full.
+  bool TryPush(const T &value) {
+    size_t pos = tail.load(std::memory_order_relaxed);
+    for (;;) {
+      Slot &slot = slots[pos & (N - 1)];
+      size_t seq = slot.seq.load(std::memory_order_acquire);
+      intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+      if (diff == 0) {
+        if (tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+          slot.value = value;
+          slot.seq.store(pos + 1, std::memory_order_release);
+          return true;
+        }
+      } else if (diff < 0) {
+        return false;
+      } else {
+        pos = tail.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+  // Consumer only. False if nothing is ready.
+  bool TryPop(T &value) {
+    Slot &slot = slots[head & (N - 1)];
+    if (slot.seq.load(std::memory_order_acquire) != head + 1) {
+      return false;
+    }
+    value = slot.value;
+    slot.seq.store(head + N, std::memory_order_release);
+    head++;
+    return true;
+  }
+
+private:
+
+  struct Slot {
+    std::atomic<size_t> seq;
+    T value;
+  };
+
+  Slot slots[N];
+  alignas(64) std::atomic<size_t> tail{0}; // next position to fill
+  alignas(64) size_t head = 0;             // next position to consume
+
+};
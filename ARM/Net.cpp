@@ -0,0 +1,154 @@
+#include "Net.h"
+
+#include <cstring>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace Net {
+
+static bool is_unix(const std::string &addr) {
+  return addr.compare(0, 5, "unix:") == 0;
+}
+
+static bool fill_unix(const std::string &addr, sockaddr_un &sa) {
+  std::string path = addr.substr(5);
+  if (path.empty() || path.size() >= sizeof(sa.sun_path)) {
+    return false;
+  }
+  memset(&sa, 0, sizeof(sa));
+  sa.sun_family = AF_UNIX;
+  memcpy(sa.sun_path, path.c_str(), path.size() + 1);
+  return true;
+}
+
+static bool split_host_port(const std::string &addr, std::string &host, std::string &port) {
+  size_t colon = addr.rfind(':');
+  if (colon == std::string::npos) {
+    return false;
+  }
+  host = addr.substr(0, colon);
+  port = addr.substr(colon + 1);
+  // Allow [::1]:port
+  if (host.size() >= 2 && host.front() == '[' && host.back() == ']') {
+    host = host.substr(1, host.size() - 2);
+  }
+  return !port.empty();
+}
+
+int listen_on(const std::string &addr) {
+  if (is_unix(addr)) {
+    sockaddr_un sa;
+    if (!fill_unix(addr, sa)) return -1;
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) return -1;
+    unlink(sa.sun_path);
+    if (bind(fd, (sockaddr *)&sa, sizeof(sa)) != 0 || listen(fd, 64) != 0) {
+      close(fd);
+      return -1;
+    }
+    return fd;
+  }
+
+  std::string host, port;
+  if (!split_host_port(addr, host, port)) return -1;
+
+  addrinfo hints{}, *res = nullptr;
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_STREAM;
+  hints.ai_flags = AI_PASSIVE;
+  if (getaddrinfo(host.empty() ? nullptr : host.c_str(), port.c_str(), &hints, &res) != 0) {
+    return -1;
+  }
+  int fd = -1;
+  for (addrinfo *ai = res; ai; ai = ai->ai_next) {
+    fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+    if (fd < 0) continue;
+    int one = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    if (bind(fd, ai->ai_addr, ai->ai_addrlen) == 0 && listen(fd, 64) == 0) break;
+    close(fd);
+    fd = -1;
+  }
+  freeaddrinfo(res);
+  return fd;
+}
+
+int connect_to(const std::string &addr) {
+  if (is_unix(addr)) {
+    sockaddr_un sa;
+    if (!fill_unix(addr, sa)) return -1;
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) return -1;
+    if (connect(fd, (sockaddr *)&sa, sizeof(sa)) != 0) {
+      close(fd);
+      return -1;
+    }
+    return fd;
+  }
+
+  std::string host, port;
+  if (!split_host_port(addr, host, port)) return -1;
+
+  addrinfo hints{}, *res = nullptr;
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_STREAM;
+  if (getaddrinfo(host.empty() ? "localhost" : host.c_str(), port.c_str(), &hints, &res) != 0) {
+    return -1;
+  }
+  int fd = -1;
+  for (addrinfo *ai = res; ai; ai = ai->ai_next) {
+    fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+    if (fd < 0) continue;
+    if (connect(fd, ai->ai_addr, ai->ai_addrlen) == 0) {
+      int one = 1;
+      setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+      break;
+    }
+    close(fd);
+    fd = -1;
+  }
+  freeaddrinfo(res);
+  return fd;
+}
+
+bool LineConn::ReadLine(std::string &line) {
+  for (;;) {
+    size_t nl = buf.find('\n');
+    if (nl != std::string::npos) {
+      line = buf.substr(0, nl);
+      buf.erase(0, nl + 1);
+      return true;
+    }
+    if (fd < 0) return false;
+    char tmp[4096];
+    ssize_t n = recv(fd, tmp, sizeof(tmp), 0);
+    if (n <= 0) return false;
+    buf.append(tmp, (size_t)n);
+  }
+}
+
+bool LineConn::WriteLine(const std::string &line) {
+  if (fd < 0) return false;
+  std::string msg = line + "\n";
+  size_t off = 0;
+  while (off < msg.size()) {
+    ssize_t n = send(fd, msg.data() + off, msg.size() - off, MSG_NOSIGNAL);
+    if (n <= 0) return false;
+    off += (size_t)n;
+  }
+  return true;
+}
+
+void LineConn::Close() {
+  if (fd >= 0) {
+    close(fd);
+    fd = -1;
+  }
+  buf.clear();
+}
+
+} // namespace Net
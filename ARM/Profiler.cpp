@@ -0,0 +1,215 @@
+#include "Profiler.h"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+static const char *STAGE_NAMES[STAGE_COUNT] = {"EC step", "serialize", "hash160", "lookup"};
+
+uint64_t Profiler::Ticks() {
+#if defined(__x86_64__) || defined(__i386__)
+  return __rdtsc();
+#elif defined(__aarch64__)
+  uint64_t ticks;
+  asm volatile("mrs %0, cntvct_el0" : "=r"(ticks));
+  return ticks;
+#else
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+static int open_counter(uint64_t config, int group_fd) {
+  perf_event_attr attr;
+  memset(&attr, 0, sizeof(attr));
+  attr.size = sizeof(attr);
+  attr.type = PERF_TYPE_HARDWARE;
+  attr.config = config;
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+  attr.read_format = PERF_FORMAT_GROUP;
+  // This thread only, on whatever CPU it runs
+  return (int)syscall(__NR_perf_event_open, &attr, 0, -1, group_fd, 0);
+}
+
+ThreadProfile::ThreadProfile(int sample_every, bool hardware)
+    : sample_every(sample_every > 0 ? sample_every : 1) {
+  if (!hardware) {
+    return;
+  }
+  group_fd = open_counter(PERF_COUNT_HW_CPU_CYCLES, -1);
+  if (group_fd < 0) {
+    open_errno = errno;
+    return;
+  }
+  const uint64_t members[COUNTER_COUNT - 1] = {PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_CACHE_MISSES};
+  for (int i = 0; i < COUNTER_COUNT - 1; i++) {
+    member_fds[i] = open_counter(members[i], group_fd);
+    if (member_fds[i] < 0) {
+      open_errno = errno;
+      for (int j = 0; j < i; j++) {
+        close(member_fds[j]);
+        member_fds[j] = -1;
+      }
+      close(group_fd);
+      group_fd = -1;
+      return;
+    }
+  }
+}
+
+ThreadProfile::~ThreadProfile() {
+  for (int fd : member_fds) {
+    if (fd >= 0) {
+      close(fd);
+    }
+  }
+  if (group_fd >= 0) {
+    close(group_fd);
+  }
+}
+
+bool ThreadProfile::ReadCounters(uint64_t values[COUNTER_COUNT]) {
+  struct {
+    uint64_t nr;
+    uint64_t values[COUNTER_COUNT];
+  } group;
+  if (read(group_fd, &group, sizeof(group)) != (ssize_t)sizeof(group) || group.nr != COUNTER_COUNT) {
+    return false;
+  }
+  memcpy(values, group.values, sizeof(group.values));
+  return true;
+}
+
+void ThreadProfile::Begin() {
+  if (group_fd >= 0) {
+    ReadCounters(last_counters);
+  }
+  last_ticks = Profiler::Ticks();
+}
+
+void ThreadProfile::Mark(ProfileStage stage) {
+  uint64_t now = Profiler::Ticks();
+  StageTotals &stage_totals = totals[stage];
+  stage_totals.ticks += now - last_ticks;
+  stage_totals.marks++;
+  uint64_t counters[COUNTER_COUNT];
+  if (group_fd >= 0 && ReadCounters(counters)) {
+    for (int i = 0; i < COUNTER_COUNT; i++) {
+      stage_totals.counters[i] += counters[i] - last_counters[i];
+      last_counters[i] = counters[i];
+    }
+  }
+  // Reading the counters is a system call; keep it out of the next stage
+  last_ticks = Profiler::Ticks();
+}
+
+Profiler::Profiler(int sample_every, bool hardware, int batch_keys)
+    : sample_every(sample_every), hardware(hardware), batch_keys(batch_keys), start_ticks(Ticks()),
+      start_time(std::chrono::steady_clock::now()) {
+}
+
+ThreadProfile *Profiler::Register() {
+  std::lock_guard<std::mutex> lock(mtx);
+  threads.emplace_back(new ThreadProfile(sample_every, hardware));
+  ThreadProfile *profile = threads.back().get();
+  if (hardware && !profile->Hardware()) {
+    // Usually perf_event_paranoid or a container without the syscall; stop trying
+    hardware = false;
+    hardware_error = strerror(profile->HardwareError());
+  }
+  return profile;
+}
+
+static void add_totals(StageTotals &sum, const StageTotals &t) {
+  sum.ticks += t.ticks;
+  sum.marks += t.marks;
+  for (int c = 0; c < COUNTER_COUNT; c++) {
+    sum.counters[c] += t.counters[c];
+  }
+}
+
+void Profiler::Unregister(ThreadProfile *profile) {
+  std::lock_guard<std::mutex> lock(mtx);
+  for (auto it = threads.begin(); it != threads.end(); ++it) {
+    if (it->get() != profile) {
+      continue;
+    }
+    for (int s = 0; s < STAGE_COUNT; s++) {
+      add_totals(retired[s], profile->Totals(s));
+    }
+    retired_any = true;
+    retired_counted = retired_counted && profile->Hardware();
+    threads.erase(it);
+    return;
+  }
+}
+
+size_t Profiler::Registered() const {
+  std::lock_guard<std::mutex> lock(mtx);
+  return threads.size();
+}
+
+std::string Profiler::Report() const {
+  std::lock_guard<std::mutex> lock(mtx);
+  StageTotals sum[STAGE_COUNT];
+  bool counted = (!threads.empty() || retired_any) && retired_counted;
+  for (int s = 0; s < STAGE_COUNT; s++) {
+    sum[s] = retired[s];
+  }
+  for (const auto &thread : threads) {
+    counted = counted && thread->Hardware();
+    for (int s = 0; s < STAGE_COUNT; s++) {
+      add_totals(sum[s], thread->Totals(s));
+    }
+  }
+
+  double elapsed_ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start_time).count();
+  double ticks_per_ns = elapsed_ns > 0 ? (Ticks() - start_ticks) / elapsed_ns : 1;
+  uint64_t all_ticks = 0;
+  for (int s = 0; s < STAGE_COUNT; s++) {
+    all_ticks += sum[s].ticks;
+  }
+
+  std::string out;
+  char line[160];
+  snprintf(line, sizeof(line), "[+] Stage profile, 1 in %d batches sampled (%llu batches):\n", sample_every,
+           (unsigned long long)sum[STAGE_HASH].marks);
+  out += line;
+  snprintf(line, sizeof(line), "    %-10s %7s %10s", "stage", "share", "ns/key");
+  out += line;
+  if (counted) {
+    snprintf(line, sizeof(line), " %12s %6s %14s", "cycles/key", "IPC", "misses/key");
+    out += line;
+  }
+  out += "\n";
+  for (int s = 0; s < STAGE_COUNT; s++) {
+    double keys = sum[s].marks * (double)batch_keys;
+    if (keys == 0) {
+      continue;
+    }
+    snprintf(line, sizeof(line), "    %-10s %6.1f%% %10.1f", STAGE_NAMES[s],
+             all_ticks ? sum[s].ticks * 100.0 / all_ticks : 0.0, sum[s].ticks / ticks_per_ns / keys);
+    out += line;
+    if (counted) {
+      double cycles = (double)sum[s].counters[COUNTER_CYCLES];
+      snprintf(line, sizeof(line), " %12.1f %6.2f %14.3f", cycles / keys,
+               cycles > 0 ? sum[s].counters[COUNTER_INSTRUCTIONS] / cycles : 0.0,
+               sum[s].counters[COUNTER_CACHE_MISSES] / keys);
+      out += line;
+    }
+    out += "\n";
+  }
+  if (!counted && !hardware_error.empty()) {
+    out += "    (hardware counters unavailable: " + hardware_error + ")\n";
+  }
+  return out;
+}
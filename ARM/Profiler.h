@@ -0,0 +1,116 @@
+#pragma once
+
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+/*---------------------------------------------------------------
+    Per-stage profiler for --profile.
+
+    Every thread that scans registers a ThreadProfile and reports
+    stage boundaries on a sample of its batches: Begin() before the
+    first stage, Mark(stage) after each one. Time is read from the
+    TSC (the virtual counter on ARM). Where perf_event_open is
+    allowed, cycles, instructions and cache misses of the thread
+    are read at the same boundaries. Each thread only touches its
+    own totals; Report() adds them up once the threads are done.
+    Threads that exit hand theirs back with Unregister(), so a pool
+    that parks and restarts workers keeps no counters open for them.
+  --------------------------------------------------------------*/
+
+enum ProfileStage {
+  STAGE_EC_STEP,   // Secp256K1::NextKey
+  STAGE_SERIALIZE, // Address::serialize_pubkey
+  STAGE_HASH,      // hash160 of both encodings
+  STAGE_LOOKUP,    // hex conversion, digest and target lookup
+  STAGE_COUNT
+};
+
+enum ProfileCounter {
+  COUNTER_CYCLES,
+  COUNTER_INSTRUCTIONS,
+  COUNTER_CACHE_MISSES,
+  COUNTER_COUNT
+};
+
+struct StageTotals {
+  uint64_t ticks = 0;
+  uint64_t marks = 0;
+  uint64_t counters[COUNTER_COUNT] = {0, 0, 0};
+};
+
+class ThreadProfile {
+
+public:
+
+  ThreadProfile(int sample_every, bool hardware);
+  ~ThreadProfile();
+
+  // True on one call in `sample_every` from the code that starts with
+  // `stage`: profile this batch
+  bool Due(ProfileStage stage) { return ++calls[stage] % sample_every == 0; }
+
+  void Begin();
+  void Mark(ProfileStage stage);
+
+  bool Hardware() const { return group_fd >= 0; }
+  int HardwareError() const { return open_errno; } // errno of perf_event_open, 0 if opened
+  const StageTotals &Totals(int stage) const { return totals[stage]; }
+
+private:
+
+  bool ReadCounters(uint64_t values[COUNTER_COUNT]);
+
+  int sample_every;
+  uint64_t calls[STAGE_COUNT] = {0, 0, 0, 0};
+  int group_fd = -1;
+  int open_errno = 0;
+  int member_fds[COUNTER_COUNT - 1] = {-1, -1};
+  uint64_t last_ticks = 0;
+  uint64_t last_counters[COUNTER_COUNT] = {0, 0, 0};
+  StageTotals totals[STAGE_COUNT];
+
+};
+
+class Profiler {
+
+public:
+
+  // Profile one batch in `sample_every`; try the hardware counters if `hardware`.
+  // Per-key figures divide each batch by `batch_keys`.
+  explicit Profiler(int sample_every = 64, bool hardware = true, int batch_keys = 8);
+
+  // A profile for the calling thread (perf counters follow the thread that
+  // opens them), owned by the profiler
+  ThreadProfile *Register();
+  // The thread is done with `profile`: its totals are kept for the report
+  // and the profile is freed, closing its counters
+  void Unregister(ThreadProfile *profile);
+
+  // Profiles of threads that have not unregistered
+  size_t Registered() const;
+
+  // Breakdown table of everything recorded. Call once the threads have stopped.
+  std::string Report() const;
+
+  static uint64_t Ticks();
+
+private:
+
+  int sample_every;
+  bool hardware;
+  int batch_keys;
+  std::string hardware_error; // why the counters are unavailable, if they are
+  uint64_t start_ticks;
+  std::chrono::steady_clock::time_point start_time;
+  mutable std::mutex mtx;
+  std::vector<std::unique_ptr<ThreadProfile>> threads;
+  // Totals of unregistered threads
+  StageTotals retired[STAGE_COUNT];
+  bool retired_any = false;
+  bool retired_counted = true; // every one of them had the hardware counters
+
+};
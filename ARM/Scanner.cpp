@@ -0,0 +1,143 @@
+#include "Scanner.h"
+
+#include "HexUtil.hpp"
+
+thread_local ThreadProfile *thread_profile = nullptr;
+
+void range_bounds(Config &config, const ChunkIndex &range_idx, Int &range_start, Int &range_end) {
+  Int range_size_multiplier;
+  range_idx.ToInt(range_size_multiplier);
+  range_size_multiplier.Mult(config.range_size);
+  range_start = *config.range_start;
+  range_start.Add(&range_size_multiplier);
+
+  range_end = range_start;
+  range_end.Add(config.range_size);
+
+  // Make sure range_end doesn't exceed the total range (range_end is inclusive)
+  Int last = *config.range_end;
+  last.AddOne();
+  if (range_end.IsGreater(&last)) {
+    range_end.Set(&last);
+  }
+}
+
+int batch_keys(const Int &next, const Int &end) {
+  Int first = next;
+  Int left = end;
+  if (!first.IsLower(&left)) {
+    return 0;
+  }
+  left.Sub(&first);
+  Int batch((uint64_t)SCAN_BATCH);
+  return left.IsLower(&batch) ? (int)left.bits64[0] : SCAN_BATCH;
+}
+
+void compute_pubkeys(Secp256K1 *s, Point &current, SerializedPubKey pubkeys[SCAN_BATCH]) {
+  if (thread_profile && thread_profile->Due(STAGE_EC_STEP)) {
+    // The same work, one step after the other so each can be timed
+    Point points[SCAN_BATCH];
+    thread_profile->Begin();
+    points[0] = current;
+    for (int i = 1; i < SCAN_BATCH; i++) {
+      points[i] = s->NextKey(points[i - 1]);
+    }
+    current = s->NextKey(points[SCAN_BATCH - 1]);
+    thread_profile->Mark(STAGE_EC_STEP);
+    for (int i = 0; i < SCAN_BATCH; i++) {
+      pubkeys[i] = Address::serialize_pubkey(points[i]);
+    }
+    thread_profile->Mark(STAGE_SERIALIZE);
+    return;
+  }
+  for (int i = 0; i < SCAN_BATCH; i++) {
+    pubkeys[i] = Address::serialize_pubkey(current);
+    current = s->NextKey(current);
+  }
+}
+
+void check_pubkeys(const SerializedPubKey pubkeys[SCAN_BATCH], const Int &first, int count,
+                   const std::unordered_set<std::string> &targets, const TargetFilter &filter,
+                   const HitHandler &on_hit, ChunkDigest &digest, WorkerStats &stats) {
+  bool profiled = thread_profile && thread_profile->Due(STAGE_HASH);
+  if (profiled) {
+    thread_profile->Begin();
+  }
+  const uint8_t *uncomp_pubkeys_ptrs[SCAN_BATCH];
+  const uint8_t *comp_pubkeys_ptrs[SCAN_BATCH];
+  size_t lengths[SCAN_BATCH];
+  size_t comp_lengths[SCAN_BATCH];
+  for (int i = 0; i < SCAN_BATCH; i++) {
+    uncomp_pubkeys_ptrs[i] = pubkeys[i].uncompressed.data();
+    comp_pubkeys_ptrs[i] = pubkeys[i].compressed.data();
+    lengths[i] = 65;
+    comp_lengths[i] = 33;
+  }
+
+  uint8_t hash160_uncomp[SCAN_BATCH][20];
+  Address::pubkeys_to_hash160_16x(uncomp_pubkeys_ptrs, lengths, hash160_uncomp);
+  uint8_t hash160_comp[SCAN_BATCH][20];
+  Address::pubkeys_to_hash160_16x(comp_pubkeys_ptrs, comp_lengths, hash160_comp);
+  if (profiled) {
+    thread_profile->Mark(STAGE_HASH);
+  }
+
+  for (int i = 0; i < count; i++) {
+    digest.Fold(hash160_uncomp[i]);
+    digest.Fold(hash160_comp[i]);
+  }
+
+  // Only the hashes whose prefix matches a target's are hex-encoded and
+  // looked up; the rest are turned away on one word. A key's uncompressed
+  // hit is still passed on before its compressed one.
+  uint32_t uncomp_candidates = filter.Screen(hash160_uncomp, count);
+  uint32_t comp_candidates = filter.Screen(hash160_comp, count);
+  if (uncomp_candidates | comp_candidates) {
+    stats.CountFilterPasses((uint64_t)(__builtin_popcount(uncomp_candidates) + __builtin_popcount(comp_candidates)));
+  }
+  for (uint32_t m = uncomp_candidates | comp_candidates; m; m &= m - 1) {
+    int i = __builtin_ctz(m);
+    std::string uncomp_hash, comp_hash;
+    bool found_uncomp = false, found_comp = false;
+    if (uncomp_candidates >> i & 1) {
+      uncomp_hash = HexUtil::toHex(hash160_uncomp[i], 20);
+      found_uncomp = targets.find(uncomp_hash) != targets.end();
+    }
+    if (comp_candidates >> i & 1) {
+      comp_hash = HexUtil::toHex(hash160_comp[i], 20);
+      found_comp = targets.find(comp_hash) != targets.end();
+    }
+    if (found_uncomp || found_comp) {
+      Int found_privkey = first;
+      found_privkey.Add(i);
+      if (found_uncomp) {
+        on_hit(found_privkey, uncomp_hash, false);
+      }
+      if (found_comp) {
+        on_hit(found_privkey, comp_hash, true);
+      }
+    }
+  }
+  if (profiled) {
+    thread_profile->Mark(STAGE_LOOKUP);
+  }
+}
+
+uint64_t scan_range(Secp256K1 *s, Int &start, Int end, const std::unordered_set<std::string> &targets,
+                    const TargetFilter &filter, const HitHandler &on_hit, ChunkDigest &digest, WorkerStats &stats,
+                    const std::atomic<bool> &stop) {
+  // Compute the start pubkey.
+  Point current = s->ComputePublicKey(&start, true);
+  uint64_t keys = 0;
+
+  int count;
+  while ((count = batch_keys(start, end)) > 0 && !stop.load(std::memory_order_relaxed)) {
+    SerializedPubKey pubkeys[SCAN_BATCH];
+    compute_pubkeys(s, current, pubkeys);
+    check_pubkeys(pubkeys, start, count, targets, filter, on_hit, digest, stats);
+    start.Add((uint64_t)count);
+    keys += count;
+    stats.CountKeys(count);
+  }
+  return keys;
+}
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <unordered_set>
+#include <vector>
+
+#include "ChunkIndex.hpp"
+
+/*---------------------------------------------------------------
+    Hands out chunk indices in [0, total) in a random order.
+
+    Chunks restored from a checkpoint are skipped, whether recorded
+    one by one or as runs from a compacted checkpoint. Every other chunk
+    is issued at most once per run; the permutation cursor is the only
+    per-run state, so memory does not grow with the job size.
+  --------------------------------------------------------------*/
+class ChunkScheduler {
+
+public:
+
+  void Init(const ChunkIndex &total, uint64_t seed);
+
+  // Record a chunk that was completed in a previous run.
+  // Returns false if it is out of range or already recorded.
+  bool MarkScanned(const ChunkIndex &idx);
+
+  // Record a run of chunks completed in a previous run. Returns how many of
+  // them were not recorded before. Cheapest before any single MarkScanned.
+  uint64_t MarkScannedRange(const ChunkInterval &run);
+
+  // Record the chunks of a journal snapshot as it is stored: (word, bits)
+  // pairs, word ascending, bit b of word w standing for chunk 64 * w + b.
+  // Returns how many of them were not recorded before. The words are kept
+  // as they are, so millions of chunks restore in one copy.
+  uint64_t MarkScannedWords(const std::vector<uint64_t> &pairs);
+
+  // Claim the next unscanned chunk. Returns false once every chunk was issued.
+  bool Claim(ChunkIndex &idx);
+
+  // True once every chunk has been issued (or restored).
+  bool Exhausted();
+
+  const ChunkIndex &Total() const { return perm.Total(); }
+
+  // Chunks restored from the checkpoint plus chunks claimed in this run.
+  uint64_t ScannedCount() const { return scanned_count; }
+
+private:
+
+  std::mutex mtx;
+  ChunkPermutation perm;
+  ChunkIndex cursor;
+  // Restored chunks the cursor has not reached yet.
+  std::unordered_set<ChunkIndex, ChunkIndexHash> restored;
+  // Restored runs, first -> last, disjoint. Kept for the whole run.
+  std::map<ChunkIndex, ChunkIndex> restored_runs;
+  // Restored snapshot words, (word, bits) sorted by word. Kept for the whole run.
+  std::vector<std::pair<uint64_t, uint64_t>> restored_words;
+
+  bool InRestoredRun(const ChunkIndex &idx) const;
+  bool InRestoredWords(const ChunkIndex &idx) const;
+  // Drop the restored snapshot chunks in [first, last], returning how many there were
+  uint64_t TakeRestoredWords(uint64_t first, uint64_t last);
+  std::atomic<uint64_t> scanned_count{0};
+
+};
+
+/*---------------------------------------------------------------
+    Weighted fair share between jobs served by one worker pool.
+
+    Stride scheduling: each job has a virtual time that advances by
+    cost / weight whenever one of its chunks is handed out, and the
+    next chunk comes from the runnable job with the smallest virtual
+    time. Charging keys instead of chunks keeps jobs with different
+    range sizes fair to each other.
+  --------------------------------------------------------------*/
+class FairShare {
+
+public:
+
+  // Register a job with a positive weight; returns its id.
+  int Add(double weight);
+
+  // Runnable job with the smallest virtual time, or -1 once all are retired.
+  int Pick();
+
+  // Account `cost` (keys) handed out to `job`.
+  void Charge(int job, double cost);
+
+  // The job has nothing left to hand out.
+  void Retire(int job);
+
+private:
+
+  struct Entry {
+    double weight;
+    double vtime;
+    bool retired;
+  };
+
+  std::mutex mtx;
+  std::vector<Entry> entries;
+
+};
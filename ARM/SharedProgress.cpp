@@ -0,0 +1,335 @@
+#include "SharedProgress.h"
+
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <ctime>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define SHARED_MAGIC 0x31475250484B4342ULL // "BCKHPRG1"
+#define SHARED_VERSION 1
+#define MAX_SLOTS 128
+#define MAX_SLOT_LEASES 512
+
+// Lease entries hold range index + 1 so that 0 means "free".
+struct SharedProgress::Slot {
+  uint64_t pid;
+  uint64_t pid_ns;    // pid namespace inode; pids are only comparable within one namespace
+  uint64_t heartbeat; // CLOCK_REALTIME seconds
+  uint64_t reserved;
+  uint64_t leases[MAX_SLOT_LEASES];
+};
+
+struct SharedProgress::Header {
+  uint64_t magic;
+  uint64_t version;
+  uint64_t job_hash;
+  uint64_t total;
+  uint64_t seed;
+  uint64_t initialized;
+  alignas(64) uint64_t cursor;    // next permutation position to hand out
+  alignas(64) uint64_t completed; // number of bits set in the bitmap
+  alignas(64) Slot slots[MAX_SLOTS];
+};
+
+static uint64_t now_seconds() {
+  return (uint64_t)time(nullptr);
+}
+
+static uint64_t pid_namespace() {
+  struct stat st;
+  if (stat("/proc/self/ns/pid", &st) != 0) {
+    return 0;
+  }
+  return (uint64_t)st.st_ino;
+}
+
+static uint64_t fnv1a(const std::string &s) {
+  uint64_t h = 0xCBF29CE484222325ULL;
+  for (unsigned char c : s) {
+    h ^= c;
+    h *= 0x100000001B3ULL;
+  }
+  return h;
+}
+
+SharedProgress::~SharedProgress() {
+  Close();
+}
+
+SharedProgress::Slot *SharedProgress::SlotAt(int i) const {
+  return &header->slots[i];
+}
+
+uint64_t *SharedProgress::Bitmap() const {
+  return (uint64_t *)((uint8_t *)map + sizeof(Header));
+}
+
+bool SharedProgress::Open(const std::string &path, const std::string &job_key,
+                          const ChunkIndex &total_ranges, int timeout) {
+  std::lock_guard<std::mutex> lock(mtx);
+  if (!total_ranges.FitsUint64() || total_ranges.ToUint64() > MAX_SHARED_RANGES) {
+    return false;
+  }
+  total = total_ranges.ToUint64();
+  lease_timeout = timeout;
+
+  fd = open(path.c_str(), O_RDWR | O_CREAT, 0644);
+  if (fd < 0) {
+    return false;
+  }
+
+  // Serialize initialization between processes starting at the same time
+  flock(fd, LOCK_EX);
+  map_size = sizeof(Header) + ((total + 63) / 64) * sizeof(uint64_t);
+  struct stat st;
+  bool ok = fstat(fd, &st) == 0;
+  bool fresh = ok && st.st_size == 0;
+  if (fresh) {
+    ok = ftruncate(fd, (off_t)map_size) == 0;
+  } else if (ok) {
+    ok = (size_t)st.st_size >= map_size;
+  }
+  if (ok) {
+    map = mmap(nullptr, map_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ok = map != MAP_FAILED;
+    if (!ok) map = nullptr;
+  }
+  if (ok) {
+    header = (Header *)map;
+    if (fresh) {
+      // ftruncate zero-filled the bitmap and slots
+      header->magic = SHARED_MAGIC;
+      header->version = SHARED_VERSION;
+      header->job_hash = fnv1a(job_key);
+      header->total = total;
+      uint64_t seed = ((uint64_t)getpid() << 32) ^ (uint64_t)time(nullptr) ^ (uint64_t)(uintptr_t)&seed;
+      header->seed = seed;
+      header->cursor = 0;
+      header->completed = 0;
+      msync(map, sizeof(Header), MS_SYNC);
+      __atomic_store_n(&header->initialized, 1, __ATOMIC_RELEASE);
+    }
+    ok = header->magic == SHARED_MAGIC && header->version == SHARED_VERSION &&
+         header->job_hash == fnv1a(job_key) && header->total == total;
+  }
+  flock(fd, LOCK_UN);
+  if (!ok) {
+    if (map) munmap(map, map_size);
+    map = nullptr;
+    header = nullptr;
+    close(fd);
+    fd = -1;
+    return false;
+  }
+  perm.Init(ChunkIndex(total), header->seed);
+
+  // Take a free slot; ranges left in it by a process that exited are ours to finish
+  uint64_t pid = (uint64_t)getpid();
+  for (int i = 0; i < MAX_SLOTS && !own; i++) {
+    uint64_t expected = 0;
+    if (__atomic_compare_exchange_n(&SlotAt(i)->pid, &expected, pid, false,
+                                    __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+      own = SlotAt(i);
+    }
+  }
+  if (!own) {
+    munmap(map, map_size);
+    map = nullptr;
+    header = nullptr;
+    close(fd);
+    fd = -1;
+    return false;
+  }
+  own->pid_ns = pid_namespace();
+  __atomic_store_n(&own->heartbeat, now_seconds(), __ATOMIC_RELEASE);
+  // A survivor may be recovering this slot's leases right now, as it was
+  // free; take each with an exchange, as RecoverOrphans does, so every
+  // range goes to exactly one of us
+  for (int i = 0; i < MAX_SLOT_LEASES; i++) {
+    if (__atomic_load_n(&own->leases[i], __ATOMIC_ACQUIRE) == 0) {
+      continue;
+    }
+    uint64_t v = __atomic_exchange_n(&own->leases[i], 0, __ATOMIC_ACQ_REL);
+    if (v && StampLease(v - 1)) {
+      pending.push_back(v - 1);
+    }
+  }
+  RecoverOrphans();
+  return true;
+}
+
+void SharedProgress::Close() {
+  std::lock_guard<std::mutex> lock(mtx);
+  if (!map) {
+    return;
+  }
+  // Leases still stamped in the slot are adopted by whoever takes it or recovers it
+  __atomic_store_n(&own->heartbeat, 0, __ATOMIC_RELEASE);
+  __atomic_store_n(&own->pid, 0, __ATOMIC_RELEASE);
+  msync(map, map_size, MS_ASYNC);
+  munmap(map, map_size);
+  close(fd);
+  map = nullptr;
+  header = nullptr;
+  own = nullptr;
+  fd = -1;
+  pending.clear();
+}
+
+void SharedProgress::MarkScanned(const ChunkIndex &idx) {
+  if (idx.FitsUint64() && idx.ToUint64() < total) {
+    Complete(idx);
+  }
+}
+
+bool SharedProgress::IsCompleted(const ChunkIndex &idx) const {
+  if (!idx.FitsUint64() || idx.ToUint64() >= total) {
+    return false;
+  }
+  uint64_t i = idx.ToUint64();
+  return (__atomic_load_n(&Bitmap()[i / 64], __ATOMIC_ACQUIRE) >> (i % 64)) & 1;
+}
+
+bool SharedProgress::IsAlive(const Slot *slot, uint64_t now) const {
+  uint64_t pid = __atomic_load_n(&slot->pid, __ATOMIC_ACQUIRE);
+  if (pid == 0) {
+    return false;
+  }
+  if (slot->pid_ns == own->pid_ns && kill((pid_t)pid, 0) != 0 && errno == ESRCH) {
+    return false;
+  }
+  // A zero stamp means the owner is still opening the file
+  uint64_t heartbeat = __atomic_load_n(&slot->heartbeat, __ATOMIC_ACQUIRE);
+  return heartbeat == 0 || now <= heartbeat + (uint64_t)lease_timeout;
+}
+
+// Caller holds mtx.
+bool SharedProgress::StampLease(uint64_t idx) {
+  for (int i = 0; i < MAX_SLOT_LEASES; i++) {
+    if (own->leases[i] == 0) {
+      __atomic_store_n(&own->leases[i], idx + 1, __ATOMIC_RELEASE);
+      return true;
+    }
+  }
+  return false;
+}
+
+// Caller holds mtx.
+void SharedProgress::RecoverOrphans() {
+  uint64_t now = now_seconds();
+  last_recovery = now;
+  for (int s = 0; s < MAX_SLOTS; s++) {
+    Slot *slot = SlotAt(s);
+    if (slot == own || IsAlive(slot, now)) {
+      continue;
+    }
+    uint64_t pid = __atomic_load_n(&slot->pid, __ATOMIC_ACQUIRE);
+    for (int i = 0; i < MAX_SLOT_LEASES; i++) {
+      if (__atomic_load_n(&slot->leases[i], __ATOMIC_ACQUIRE) == 0) {
+        continue;
+      }
+      // The exchange makes sure only one survivor adopts each range
+      uint64_t v = __atomic_exchange_n(&slot->leases[i], 0, __ATOMIC_ACQ_REL);
+      if (v && StampLease(v - 1)) {
+        pending.push_back(v - 1);
+      } else if (v) {
+        // Our own table is full; leave it for someone else
+        __atomic_store_n(&slot->leases[i], v, __ATOMIC_RELEASE);
+      }
+    }
+    if (pid != 0) {
+      // Free the dead process's slot
+      __atomic_store_n(&slot->heartbeat, 0, __ATOMIC_RELEASE);
+      __atomic_compare_exchange_n(&slot->pid, &pid, 0, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+    }
+  }
+}
+
+bool SharedProgress::Claim(ChunkIndex &idx) {
+  std::lock_guard<std::mutex> lock(mtx);
+  if (!map) {
+    return false;
+  }
+  __atomic_store_n(&own->heartbeat, now_seconds(), __ATOMIC_RELEASE);
+  if (now_seconds() > last_recovery) {
+    RecoverOrphans();
+  }
+
+  for (int attempt = 0; attempt < 2; attempt++) {
+    while (!pending.empty()) {
+      uint64_t i = pending.front();
+      pending.pop_front();
+      idx = ChunkIndex(i);
+      if (!IsCompleted(idx)) {
+        return true;
+      }
+      // Finished before its owner went away; just drop the stamp
+      for (int l = 0; l < MAX_SLOT_LEASES; l++) {
+        if (own->leases[l] == i + 1) __atomic_store_n(&own->leases[l], 0, __ATOMIC_RELEASE);
+      }
+    }
+
+    for (;;) {
+      uint64_t pos = __atomic_load_n(&header->cursor, __ATOMIC_ACQUIRE);
+      if (pos >= total) {
+        break;
+      }
+      if (!__atomic_compare_exchange_n(&header->cursor, &pos, pos + 1, false,
+                                       __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+        continue;
+      }
+      idx = perm.At(ChunkIndex(pos));
+      if (IsCompleted(idx)) {
+        continue;
+      }
+      // With a full lease table the range is still ours, it just cannot be
+      // recovered by others if we crash.
+      StampLease(idx.ToUint64());
+      return true;
+    }
+
+    // Cursor exhausted: abandoned leases are all that is left
+    RecoverOrphans();
+    if (pending.empty()) {
+      break;
+    }
+  }
+  return false;
+}
+
+bool SharedProgress::Complete(const ChunkIndex &idx) {
+  std::lock_guard<std::mutex> lock(mtx);
+  if (!map || !idx.FitsUint64() || idx.ToUint64() >= total) {
+    return false;
+  }
+  uint64_t i = idx.ToUint64();
+  uint64_t bit = 1ULL << (i % 64);
+  uint64_t old = __atomic_fetch_or(&Bitmap()[i / 64], bit, __ATOMIC_ACQ_REL);
+  bool fresh = (old & bit) == 0;
+  if (fresh) {
+    __atomic_fetch_add(&header->completed, 1, __ATOMIC_ACQ_REL);
+  }
+  for (int l = 0; l < MAX_SLOT_LEASES; l++) {
+    if (own->leases[l] == i + 1) {
+      __atomic_store_n(&own->leases[l], 0, __ATOMIC_RELEASE);
+      break;
+    }
+  }
+  return fresh;
+}
+
+void SharedProgress::Heartbeat() {
+  std::lock_guard<std::mutex> lock(mtx);
+  if (own) {
+    __atomic_store_n(&own->heartbeat, now_seconds(), __ATOMIC_RELEASE);
+  }
+}
+
+uint64_t SharedProgress::CompletedCount() const {
+  return header ? __atomic_load_n(&header->completed, __ATOMIC_ACQUIRE) : 0;
+}
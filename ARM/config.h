@@ -1,23 +1,76 @@
 #pragma once
 
+#include <functional>
 #include <vector>
 
 #include "include/Int.h"
+#include "ChunkIndex.hpp"
+#include "ChunkDigest.hpp"
+
+// A range interrupted part way: keys before `next` were scanned, `digest`
+// covers them
+struct PartialRange {
+    ChunkIndex idx;
+    Int next;
+    ChunkDigest digest;
+};
 
 struct Config {
     Int *range_start;
     Int *range_end;
     Int *range_size;
     int workers;
-    uint64_t total_ranges; // total number of ranges available
+    ChunkIndex total_ranges; // total number of ranges available
     std::vector<std::string> addresses;
-    std::vector<Int *> scanned_ranges;
+    std::vector<ChunkIndex> scanned_ranges; // indices of ranges restored from `range:` lines
+    std::vector<PartialRange> partial_ranges; // restored from `partial: <range> <next key>` lines
+    std::vector<ChunkInterval> scanned_runs;  // from `ranges: <first range> <last range>` lines
+    std::vector<uint64_t> scanned_words; // checkpoint journal snapshot, (word, bits) pairs
     std::string found_keys_file;
+    int lease_seconds;  // coordinator: work per lease at the worker's speed
+    int lease_timeout;  // coordinator: seconds of worker silence before re-issue
+    std::string shared_progress; // progress file shared by processes on this host
+    std::string checkpoint_journal; // binary checkpoint used instead of `range:` lines
+    int journal_fsync_ms;           // longest time a completion waits to be synced
+    std::string cpu_affinity;    // none, auto, or a cpu list such as 0-7,16-23
+    std::string smt_pairing;     // none, or split: EC and hashing on the two SMT threads of a core
+    std::string tail_scheduling; // none, or speed: slow cores stop claiming near the end of the job
+    std::string control_socket;  // resize the worker pool at runtime (WORKERS/GROW/SHRINK/STATUS)
+    std::string metrics_listen;  // Prometheus metrics over HTTP, e.g. 127.0.0.1:9464
+    std::string metrics_file;    // the same metrics rewritten every few seconds, for a textfile collector
+    std::string log_json;        // status events as JSON lines, appended to this file
+    int log_lines_per_second;    // most range lines printed per second, 0 for none
+};
+
+struct JobListEntry {
+    std::string config_file;
+    double weight; // share of the worker pool relative to the other jobs
 };
 
 void save_default_config(std::string path);
 
-int load_config(std::string path, Config &config);
+// With read_checkpoint false, `range:`, `ranges:` and `partial:` lines are
+// skipped (see stream_checkpoint).
+int load_config(std::string path, Config &config, bool read_checkpoint = true);
+
+// Pass every run of ranges in a config file's checkpoint to `on_run` and every
+// interrupted range to `on_partial`, without keeping them in memory, and the
+// digest recorded on a `range:` line, if any, to `on_digest`. `config` is the
+// job, loaded from this file or another one. Returns -1 on error.
+int stream_checkpoint(std::string path, Config &config,
+                      const std::function<void(const ChunkInterval &)> &on_run,
+                      const std::function<void(const PartialRange &)> &on_partial,
+                      const std::function<void(const ChunkIndex &, const ChunkDigest &)> &on_digest = nullptr);
+
+// Load a job list: pool settings (workers, cpu_affinity, smt_pairing,
+// tail_scheduling, control_socket, metrics_listen, metrics_file, log_json,
+// log_lines_per_second) plus one `job: <config_file> [weight]` line per job. Each
+// job config keeps its own range, addresses and `range:` checkpoint; pool
+// settings in it are ignored. Returns -1 on error.
+int load_job_list(std::string path, Config &settings, std::vector<JobListEntry> &jobs);
+
+// Validate the range fields and pre-compute total_ranges. Returns -1 on error.
+int compute_total_ranges(Config &config);
 
 void free_config(Config &config);
 
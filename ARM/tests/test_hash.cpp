@@ -0,0 +1,218 @@
+#include <cstdio>
+#include <cstring>
+#include <stdint.h>
+#include "../Hash/Hash.h"
+
+static void to_hex(const uint8_t* digest, size_t len, char* out) {
+    static const char hex[] = "0123456789abcdef";
+    for (size_t i = 0; i < len; ++i) {
+        out[i*2] = hex[(digest[i] >> 4) & 0xF];
+        out[i*2 + 1] = hex[digest[i] & 0xF];
+    }
+    out[len*2] = '\0';
+}
+
+// The known-answer vectors with the selected kernels
+static bool check_vectors() {
+    const char* messages[8] = {"", "abc", "hello world", "BitCrack",
+                                "test", "1234567890", "OpenAI", "foo bar"};
+    const char* sha_expect[8] = {
+        "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855",
+        "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad",
+        "b94d27b9934d3e08a52e52d7da7dabfac484efe37a5380ee9088f7ace2efcde9",
+        "dd8a07f4f180cdd21a22edef65e6a23820aa1c6e65b119cffa31fda567512a4f",
+        "9f86d081884c7d659a2feaa0c55ad015a3bf4f1b2b0b822cd15d6c15b0f00a08",
+        "c775e7b757ede630cd0aa1113bd102661ab38829ca52a6422ab782862f268646",
+        "8b7d1a3187ab355dc31bc683aaa71ab5ed217940c12196a9cd5f4ca984babfa4",
+        "fbc1a9f858ea9e177916964bd88c3d37b91a1e84412765e29950777f265c4b75"};
+    const char* ripemd_expect[8] = {
+        "9c1185a5c5e9fc54612808977ee8f548b2258d31",
+        "8eb208f7e05d987a9b044a8e98c6b087f15a0bfc",
+        "98c615784ccb5fe5936fbc0cbe9dfdb408d92f0f",
+        "604012d06a8331ea7ebfe563d0b74f7f2930a955",
+        "5e52fee47e6b070565f74372468cdc699de89107",
+        "9d752daa3fb4df29837088e1e5a1acf74932e074",
+        "303e5cdaf4970c8ae7572a9a7864ef341ca9c14d",
+        "daba326b8e276af34297f879f6234bcef2528efa"};
+
+    const uint8_t* inputs[8];
+    size_t lengths[8];
+    for (int i = 0; i < 8; ++i) {
+        inputs[i] = (const uint8_t*)messages[i];
+        lengths[i] = strlen(messages[i]);
+    }
+
+    uint8_t sha_out[8][SHA256_DIGEST_SIZE];
+    uint8_t rip_out[8][RIPEMD160_DIGEST_SIZE];
+
+    if (sha256_8x(inputs, lengths, sha_out) != 0) {
+        printf("sha256_8x failed\n");
+        return false;
+    }
+    if (ripemd160_8x(inputs, lengths, rip_out) != 0) {
+        printf("ripemd160_8x failed\n");
+        return false;
+    }
+
+    char hexbuf[65];
+    for (int i = 0; i < 8; ++i) {
+        to_hex(sha_out[i], SHA256_DIGEST_SIZE, hexbuf);
+        if (strcmp(hexbuf, sha_expect[i]) != 0) {
+            printf("SHA256 mismatch %d: %s != %s\n", i, hexbuf, sha_expect[i]);
+            return false;
+        }
+    }
+
+    char hexbuf2[41];
+    for (int i = 0; i < 8; ++i) {
+        to_hex(rip_out[i], RIPEMD160_DIGEST_SIZE, hexbuf2);
+        if (strcmp(hexbuf2, ripemd_expect[i]) != 0) {
+            printf("RIPEMD160 mismatch %d: %s != %s\n", i, hexbuf2, ripemd_expect[i]);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// 16-lane calls must match the scalar kernels lane for lane, with every
+// lane at a different length
+static bool check_16_lanes() {
+    static const size_t lane_lengths[16] = {0, 1, 32, 33, 55, 56, 63, 64, 65, 100, 119, 120, 127, 128, 200, 300};
+    static uint8_t buffers[16][300];
+    const uint8_t* inputs[16];
+    size_t lengths[16];
+    for (int i = 0; i < 16; ++i) {
+        for (size_t j = 0; j < lane_lengths[i]; ++j) {
+            buffers[i][j] = (uint8_t)(i * 31 + j * 7 + 1);
+        }
+        inputs[i] = buffers[i];
+        lengths[i] = lane_lengths[i];
+    }
+
+    const char* reference = "scalar";
+    uint8_t sha_ref[16][SHA256_DIGEST_SIZE];
+    uint8_t rip_ref[16][RIPEMD160_DIGEST_SIZE];
+    hash_select_isa(reference);
+    for (int half = 0; half < 16; half += 8) {
+        if (sha256_8x(inputs + half, lengths + half, sha_ref + half) != 0 ||
+            ripemd160_8x(inputs + half, lengths + half, rip_ref + half) != 0) {
+            printf("%s kernels failed\n", reference);
+            return false;
+        }
+    }
+
+    for (int k = 0; k < hash_isa_count(); ++k) {
+        const char* isa = hash_isa_at(k);
+        if (hash_select_isa(isa) != 0) {
+            continue;
+        }
+        uint8_t sha_out[16][SHA256_DIGEST_SIZE];
+        uint8_t rip_out[16][RIPEMD160_DIGEST_SIZE];
+        if (sha256_16x(inputs, lengths, sha_out) != 0 || ripemd160_16x(inputs, lengths, rip_out) != 0) {
+            printf("16-lane %s kernels failed\n", isa);
+            return false;
+        }
+        for (int i = 0; i < 16; ++i) {
+            if (memcmp(sha_out[i], sha_ref[i], SHA256_DIGEST_SIZE) != 0 ||
+                memcmp(rip_out[i], rip_ref[i], RIPEMD160_DIGEST_SIZE) != 0) {
+                printf("16-lane %s kernels differ from %s in lane %d (%zu bytes)\n", isa, reference, i, lengths[i]);
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+// Random lengths and bytes through the 8- and 16-lane calls of every set,
+// against the scalar kernels: there is no OpenSSL to fuzz against when
+// cross-compiling
+static bool check_random(int iterations) {
+    static uint8_t buffers[16][300];
+    const uint8_t* inputs[16];
+    size_t lengths[16];
+    uint32_t seed = 1;
+    for (int n = 0; n < iterations; ++n) {
+        for (int i = 0; i < 16; ++i) {
+            seed = seed * 1103515245 + 12345;
+            lengths[i] = (seed >> 8) % 300;
+            for (size_t j = 0; j < lengths[i]; ++j) {
+                seed = seed * 1103515245 + 12345;
+                buffers[i][j] = (uint8_t)(seed >> 16);
+            }
+            inputs[i] = buffers[i];
+        }
+
+        uint8_t sha_ref[16][SHA256_DIGEST_SIZE];
+        uint8_t rip_ref[16][RIPEMD160_DIGEST_SIZE];
+        hash_select_isa("scalar");
+        sha256_16x(inputs, lengths, sha_ref);
+        ripemd160_16x(inputs, lengths, rip_ref);
+
+        for (int k = 0; k < hash_isa_count(); ++k) {
+            const char* isa = hash_isa_at(k);
+            if (hash_select_isa(isa) != 0) {
+                continue;
+            }
+            for (int lanes = 8; lanes <= 16; lanes += 8) {
+                uint8_t sha_out[16][SHA256_DIGEST_SIZE];
+                uint8_t rip_out[16][RIPEMD160_DIGEST_SIZE];
+                int failed = lanes == 8 ? sha256_8x(inputs, lengths, sha_out) | ripemd160_8x(inputs, lengths, rip_out)
+                                        : sha256_16x(inputs, lengths, sha_out) | ripemd160_16x(inputs, lengths, rip_out);
+                if (failed) {
+                    printf("%d-lane %s kernels failed\n", lanes, isa);
+                    return false;
+                }
+                for (int i = 0; i < lanes; ++i) {
+                    if (memcmp(sha_out[i], sha_ref[i], SHA256_DIGEST_SIZE) != 0 ||
+                        memcmp(rip_out[i], rip_ref[i], RIPEMD160_DIGEST_SIZE) != 0) {
+                        printf("%d-lane %s kernels differ from scalar in lane %d (%zu bytes), iteration %d\n",
+                               lanes, isa, i, lengths[i], n);
+                        return false;
+                    }
+                }
+            }
+        }
+    }
+    return true;
+}
+
+int main() {
+    // Every kernel set this CPU can run; the scalar one always can
+    if (!hash_isa_supported("scalar") || hash_select_isa("no-such-isa") == 0) {
+        printf("Kernel selection broken\n");
+        return 1;
+    }
+    for (int i = 0; i < hash_isa_count(); ++i) {
+        const char* isa = hash_isa_at(i);
+        if (!hash_isa_supported(isa)) {
+            printf("Skipping %s kernels, not supported by this CPU\n", isa);
+            continue;
+        }
+        if (hash_select_isa(isa) != 0 || strcmp(hash_isa_name(), isa) != 0) {
+            printf("Could not select %s kernels\n", isa);
+            return 1;
+        }
+        if (!check_vectors()) {
+            printf("with %s kernels\n", isa);
+            return 1;
+        }
+    }
+
+    if (!check_16_lanes()) {
+        return 1;
+    }
+    if (!check_random(500)) {
+        return 1;
+    }
+
+    // "auto" times every supported set and keeps one of them
+    if (hash_select_isa("auto") != 0 || !hash_isa_supported(hash_isa_name()) ||
+        hash_isa_ns_per_key(hash_isa_name()) <= 0) {
+        printf("Timed kernel selection broken\n");
+        return 1;
+    }
+
+    printf("All hash tests passed\n");
+    return 0;
+}
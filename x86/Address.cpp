@@ -31,13 +31,13 @@ SerializedPubKey serialize_pubkey(const Point &p) {
   return out;
 }
 
-std::vector<std::string> pubkeys_to_hash160_hex_8x(const uint8_t *pubkeys[8],
-                              const size_t lengths[8])
+bool pubkeys_to_hash160_8x(const uint8_t *pubkeys[8], const size_t lengths[8],
+                           uint8_t out[8][RIPEMD160_DIGEST_SIZE])
 {
     /* stage 1 ─ SHA-256 ------------------------------------------------*/
     uint8_t sha_out[8][SHA256_DIGEST_SIZE];
     if (sha256_8x(pubkeys, lengths, sha_out) != 0)
-        return std::vector<std::string>();
+        return false;
 
     /* stage 2 ─ RIPEMD-160 ------------------------------------------- */
     size_t         sha_lens[8];
@@ -46,8 +46,30 @@ std::vector<std::string> pubkeys_to_hash160_hex_8x(const uint8_t *pubkeys[8],
         sha_lens[i] = SHA256_DIGEST_SIZE;
         sha_ptrs[i] = sha_out[i];
     }
+    return ripemd160_8x(sha_ptrs, sha_lens, out) == 0;
+}
+
+bool pubkeys_to_hash160_16x(const uint8_t *pubkeys[16], const size_t lengths[16],
+                            uint8_t out[16][RIPEMD160_DIGEST_SIZE])
+{
+    uint8_t sha_out[16][SHA256_DIGEST_SIZE];
+    if (sha256_16x(pubkeys, lengths, sha_out) != 0)
+        return false;
+
+    size_t         sha_lens[16];
+    const uint8_t *sha_ptrs[16];
+    for (int i = 0; i < 16; ++i) {
+        sha_lens[i] = SHA256_DIGEST_SIZE;
+        sha_ptrs[i] = sha_out[i];
+    }
+    return ripemd160_16x(sha_ptrs, sha_lens, out) == 0;
+}
+
+std::vector<std::string> pubkeys_to_hash160_hex_8x(const uint8_t *pubkeys[8],
+                              const size_t lengths[8])
+{
     uint8_t h160[8][RIPEMD160_DIGEST_SIZE];
-    if (ripemd160_8x(sha_ptrs, sha_lens, h160) != 0)
+    if (!pubkeys_to_hash160_8x(pubkeys, lengths, h160))
         return std::vector<std::string>();
 
     /* stage 3 ─ bin → hex -------------------------------------------- */
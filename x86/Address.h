@@ -28,6 +28,14 @@ namespace Address {
 // Non-template specific function for Point type
 SerializedPubKey serialize_pubkey(const Point &p);
 
+// hash160 of 8 public keys at once. Returns false if the hash kernels fail.
+bool pubkeys_to_hash160_8x(const uint8_t *pubkeys[8], const size_t lengths[8],
+                           uint8_t out[8][RIPEMD160_DIGEST_SIZE]);
+
+// hash160 of 16 public keys at once, in one pass where the CPU has 16-lane kernels
+bool pubkeys_to_hash160_16x(const uint8_t *pubkeys[16], const size_t lengths[16],
+                            uint8_t out[16][RIPEMD160_DIGEST_SIZE]);
+
 std::vector<std::string> pubkeys_to_hash160_hex_8x(const uint8_t *pubkeys[8],
                                                    const size_t lengths[8]);
 
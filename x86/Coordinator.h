@@ -0,0 +1,124 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "ChunkDigest.hpp"
+#include "ChunkIndex.hpp"
+#include "Net.h"
+#include "Scheduler.h"
+
+/*---------------------------------------------------------------
+    Chunk lease protocol (one request line, one response line):
+
+      HELLO <name>              -> JOB <start> <end> <size> <lease_timeout> <n>
+                                   followed by n lines "ADDRESS <address>"
+      LEASE <threads> <keys/s>  -> CHUNKS <n> <idx>... | WAIT <ms> | DONE
+      COMPLETE <idx> [<digest>] -> OK | STALE
+      FOUND <privkey> <address> -> OK
+      HEARTBEAT <keys/s>        -> OK
+
+    Numbers are hex except threads, keys/s, ms and lease_timeout.
+    The digest is the chunk's ChunkDigest, x:sum in hex. STALE also
+    answers a chunk that is now leased to another worker.
+  --------------------------------------------------------------*/
+
+struct JobSpec {
+  std::string range_start; // hex
+  std::string range_end;   // hex, inclusive
+  std::string range_size;  // hex
+  std::vector<std::string> addresses;
+};
+
+class Coordinator {
+
+public:
+
+  // lease_seconds: amount of work a lease should cover at the worker's
+  // reported speed. lease_timeout: seconds of silence before a worker's
+  // chunks are handed to someone else.
+  Coordinator(ChunkScheduler &scheduler, const JobSpec &job,
+              int lease_seconds, int lease_timeout);
+
+  // Called once per completed chunk and per reported key, outside the
+  // coordinator lock.
+  std::function<void(const ChunkIndex &, const ChunkDigest &)> on_complete;
+  std::function<void(const std::string &, const std::string &)> on_found;
+
+  // Serve until every chunk is completed or Stop() is called.
+  // Returns false if the address could not be bound.
+  bool Serve(const std::string &listen_addr);
+  void Stop();
+
+  uint64_t Completed() const { return completed; }
+  // Handler threads not joined yet: open connections plus the ones that just closed.
+  size_t Handlers();
+
+private:
+
+  struct Session {
+    std::set<ChunkIndex> chunks;
+    std::chrono::steady_clock::time_point deadline;
+  };
+
+  void HandleConnection(uint64_t conn_id, int fd);
+  void ReapHandlers();
+  std::string LeaseChunks(uint64_t conn_id, int threads, double keys_per_sec);
+  bool CompleteChunk(uint64_t conn_id, const ChunkIndex &idx);
+  void Touch(uint64_t conn_id);
+  void Release(uint64_t conn_id);
+  void ExpireLeases();
+  bool Finished();
+
+  ChunkScheduler &scheduler;
+  JobSpec job;
+  double range_keys;
+  int lease_seconds;
+  int lease_timeout;
+
+  std::mutex mtx;
+  std::map<uint64_t, Session> sessions;
+  std::map<ChunkIndex, uint64_t> outstanding; // chunk -> session holding it
+  std::set<ChunkIndex> requeue;                // expired or released chunks
+
+  std::atomic<bool> stop_flag{false};
+  std::atomic<uint64_t> completed{0};
+
+  std::mutex conn_mutex;
+  std::map<uint64_t, int> conn_fds;
+  std::map<uint64_t, std::thread> handlers;
+  std::vector<uint64_t> finished_conns; // handlers that returned, joined by Serve
+
+};
+
+class CoordinatorClient {
+
+public:
+
+  enum LeaseResult { LEASE_OK, LEASE_WAIT, LEASE_DONE, LEASE_ERROR };
+
+  bool Connect(const std::string &addr, const std::string &name, JobSpec &job);
+  LeaseResult Lease(int threads, double keys_per_sec, std::vector<ChunkIndex> &chunks, int &wait_ms);
+  bool Complete(const ChunkIndex &idx, const ChunkDigest &digest = ChunkDigest());
+  bool Found(const std::string &privkey, const std::string &address);
+  bool Heartbeat(double keys_per_sec);
+  void Close();
+
+  int LeaseTimeout() const { return lease_timeout; }
+
+private:
+
+  bool Request(const std::string &req, std::string &resp);
+
+  std::mutex mtx;
+  Net::LineConn conn;
+  int lease_timeout = 0;
+
+};
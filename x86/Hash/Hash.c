@@ -1,9 +1,33 @@
 #include "Hash.h"
+#include "sha256_avx2.h"
+#include "ripemd160_avx2.h"
+#include "sha256_avx512.h"
+#include "ripemd160_avx512.h"
+#include "sha256_shani.h"
+#include "sha256_scalar.h"
+#include "ripemd160_scalar.h"
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 
-int sha256_8x(const uint8_t *inputs[8], const size_t lengths[8],
-              uint8_t outputs[8][SHA256_DIGEST_SIZE]) {
+static int sha256_8x_scalar(const uint8_t *inputs[8], const size_t lengths[8],
+                            uint8_t outputs[8][SHA256_DIGEST_SIZE]) {
+    for (int i = 0; i < 8; ++i) {
+        sha256_scalar(inputs[i], lengths[i], outputs[i]);
+    }
+    return 0;
+}
+
+static int ripemd160_8x_scalar(const uint8_t *inputs[8], const size_t lengths[8],
+                               uint8_t outputs[8][RIPEMD160_DIGEST_SIZE]) {
+    for (int i = 0; i < 8; ++i) {
+        ripemd160_scalar(inputs[i], lengths[i], outputs[i]);
+    }
+    return 0;
+}
+
+static int sha256_8x_avx2(const uint8_t *inputs[8], const size_t lengths[8],
+                          uint8_t outputs[8][SHA256_DIGEST_SIZE]) {
     void *aligned[8];
     // The block size for SHA-256 is 64 bytes. 128 extra bytes is safe.
     const size_t SHA256_BLOCK_SIZE = 64;
@@ -47,8 +71,8 @@ int sha256_8x(const uint8_t *inputs[8], const size_t lengths[8],
     return 0;
 }
 
-int ripemd160_8x(const uint8_t *inputs[8], const size_t lengths[8],
-                 uint8_t outputs[8][RIPEMD160_DIGEST_SIZE])
+static int ripemd160_8x_avx2(const uint8_t *inputs[8], const size_t lengths[8],
+                             uint8_t outputs[8][RIPEMD160_DIGEST_SIZE])
 {
     void *aligned[8];
     // 64-byte block + some extra. 128 is usually safe.
@@ -91,3 +115,257 @@ int ripemd160_8x(const uint8_t *inputs[8], const size_t lengths[8],
     return 0;
 }
 
+static int sha256_16x_avx2(const uint8_t *inputs[16], const size_t lengths[16],
+                           uint8_t outputs[16][SHA256_DIGEST_SIZE]) {
+    sha256avx2_16B(inputs, lengths, outputs);
+    return 0;
+}
+
+static int ripemd160_16x_avx2(const uint8_t *inputs[16], const size_t lengths[16],
+                              uint8_t outputs[16][RIPEMD160_DIGEST_SIZE]) {
+    ripemd160avx2_16(inputs, lengths, outputs);
+    return 0;
+}
+
+static int sha256_16x_avx512(const uint8_t *inputs[16], const size_t lengths[16],
+                             uint8_t outputs[16][SHA256_DIGEST_SIZE]) {
+    sha256avx512_16(inputs, lengths, outputs);
+    return 0;
+}
+
+static int ripemd160_16x_avx512(const uint8_t *inputs[16], const size_t lengths[16],
+                                uint8_t outputs[16][RIPEMD160_DIGEST_SIZE]) {
+    ripemd160avx512_16(inputs, lengths, outputs);
+    return 0;
+}
+
+static int sha256_8x_shani(const uint8_t *inputs[8], const size_t lengths[8],
+                           uint8_t outputs[8][SHA256_DIGEST_SIZE]) {
+    sha256shani_n(inputs, lengths, outputs, 8);
+    return 0;
+}
+
+static int sha256_16x_shani(const uint8_t *inputs[16], const size_t lengths[16],
+                            uint8_t outputs[16][SHA256_DIGEST_SIZE]) {
+    sha256shani_n(inputs, lengths, outputs, 16);
+    return 0;
+}
+
+
+/* ------------------------------------------------------------------ */
+/* Dispatch                                                           */
+/* ------------------------------------------------------------------ */
+
+static int cpu_has_all(void) {
+    return 1;
+}
+
+static int cpu_has_avx2(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    // Also checks that the OS saves the YMM registers
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+#else
+    return 0;
+#endif
+}
+
+static int cpu_has_avx512(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    // vprold and vpternlogd are AVX-512F; the 8-lane calls still use AVX2
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx2");
+#else
+    return 0;
+#endif
+}
+
+static int cpu_has_shani(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    // RIPEMD-160 stays on the AVX2 kernels
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("sha") && __builtin_cpu_supports("sse4.1") && __builtin_cpu_supports("avx2");
+#else
+    return 0;
+#endif
+}
+
+typedef struct {
+    const char *name;
+    int (*supported)(void);
+    int (*sha256)(const uint8_t *inputs[8], const size_t lengths[8], uint8_t outputs[8][SHA256_DIGEST_SIZE]);
+    int (*ripemd160)(const uint8_t *inputs[8], const size_t lengths[8], uint8_t outputs[8][RIPEMD160_DIGEST_SIZE]);
+    // 16-lane kernels, or NULL to make two 8-lane calls
+    int (*sha256_16)(const uint8_t *inputs[16], const size_t lengths[16], uint8_t outputs[16][SHA256_DIGEST_SIZE]);
+    int (*ripemd160_16)(const uint8_t *inputs[16], const size_t lengths[16], uint8_t outputs[16][RIPEMD160_DIGEST_SIZE]);
+} HashKernels;
+
+// Roughly slowest first; on a tie in timing the later one is kept
+static const HashKernels kernels[] = {
+    {"scalar", cpu_has_all, sha256_8x_scalar, ripemd160_8x_scalar, NULL, NULL},
+    {"avx2", cpu_has_avx2, sha256_8x_avx2, ripemd160_8x_avx2, sha256_16x_avx2, ripemd160_16x_avx2},
+    {"shani", cpu_has_shani, sha256_8x_shani, ripemd160_8x_avx2, sha256_16x_shani, ripemd160_16x_avx2},
+    {"avx512", cpu_has_avx512, sha256_8x_avx2, ripemd160_8x_avx2, sha256_16x_avx512, ripemd160_16x_avx512},
+};
+#define KERNEL_COUNT ((int)(sizeof(kernels) / sizeof(kernels[0])))
+
+// 16 inputs with a given set: its 16-lane kernels, or two 8-lane calls
+static int sha256_16_with(const HashKernels *k, const uint8_t *inputs[16], const size_t lengths[16],
+                          uint8_t outputs[16][SHA256_DIGEST_SIZE]) {
+    if (k->sha256_16) {
+        return k->sha256_16(inputs, lengths, outputs);
+    }
+    if (k->sha256(inputs, lengths, outputs) != 0) {
+        return -1;
+    }
+    return k->sha256(inputs + 8, lengths + 8, outputs + 8);
+}
+
+static int ripemd160_16_with(const HashKernels *k, const uint8_t *inputs[16], const size_t lengths[16],
+                             uint8_t outputs[16][RIPEMD160_DIGEST_SIZE]) {
+    if (k->ripemd160_16) {
+        return k->ripemd160_16(inputs, lengths, outputs);
+    }
+    if (k->ripemd160(inputs, lengths, outputs) != 0) {
+        return -1;
+    }
+    return k->ripemd160(inputs + 8, lengths + 8, outputs + 8);
+}
+
+static double now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+// Nanoseconds per key for hash160 of both encodings of 16 public keys, as
+// the scan loop does it: the best of a few short runs, to ride out noise
+static double time_kernels(const HashKernels *k) {
+    uint8_t keys[16][65];
+    const uint8_t *inputs[16];
+    size_t compressed[16], uncompressed[16], sha_lengths[16];
+    const uint8_t *sha_inputs[16];
+    uint8_t sha_out[16][SHA256_DIGEST_SIZE];
+    uint8_t rmd_out[16][RIPEMD160_DIGEST_SIZE];
+    for (int i = 0; i < 16; ++i) {
+        for (int j = 0; j < 65; ++j) {
+            keys[i][j] = (uint8_t)(i * 65 + j);
+        }
+        inputs[i] = keys[i];
+        compressed[i] = 33;
+        uncompressed[i] = 65;
+        sha_lengths[i] = SHA256_DIGEST_SIZE;
+        sha_inputs[i] = sha_out[i];
+    }
+
+    const int RUNS = 5, BATCHES = 16;
+    double best = 0;
+    for (int run = 0; run < RUNS; ++run) {
+        double began = now_ns();
+        for (int n = 0; n < BATCHES; ++n) {
+            sha256_16_with(k, inputs, uncompressed, sha_out);
+            ripemd160_16_with(k, sha_inputs, sha_lengths, rmd_out);
+            sha256_16_with(k, inputs, compressed, sha_out);
+            ripemd160_16_with(k, sha_inputs, sha_lengths, rmd_out);
+            keys[0][1] ^= rmd_out[0][0];
+        }
+        double elapsed = (now_ns() - began) / (BATCHES * 16);
+        if (run == 0 || elapsed < best) {
+            best = elapsed;
+        }
+    }
+    return best;
+}
+
+static double timings[KERNEL_COUNT];
+
+// Selected once at startup, before the workers start. A race on first use
+// may time the kernels twice and keep either pick: they hash the same.
+static const HashKernels *selected = NULL;
+
+static const HashKernels *selected_kernels(void) {
+    if (!selected) {
+        hash_select_isa(NULL);
+    }
+    return selected;
+}
+
+int hash_select_isa(const char *name) {
+    if (!name || strcmp(name, "auto") == 0) {
+        const HashKernels *fastest = NULL;
+        for (int i = 0; i < KERNEL_COUNT; ++i) {
+            if (!kernels[i].supported()) {
+                continue;
+            }
+            timings[i] = time_kernels(&kernels[i]);
+            if (!fastest || timings[i] <= timings[fastest - kernels]) {
+                fastest = &kernels[i];
+            }
+        }
+        if (!fastest) {
+            return -1;
+        }
+        selected = fastest;
+        return 0;
+    }
+    for (int i = 0; i < KERNEL_COUNT; ++i) {
+        if (strcmp(kernels[i].name, name) == 0) {
+            if (!kernels[i].supported()) {
+                return -1;
+            }
+            selected = &kernels[i];
+            return 0;
+        }
+    }
+    return -1;
+}
+
+const char *hash_isa_name(void) {
+    return selected_kernels()->name;
+}
+
+int hash_isa_count(void) {
+    return KERNEL_COUNT;
+}
+
+const char *hash_isa_at(int i) {
+    return i >= 0 && i < KERNEL_COUNT ? kernels[i].name : NULL;
+}
+
+int hash_isa_supported(const char *name) {
+    for (int i = 0; i < KERNEL_COUNT; ++i) {
+        if (strcmp(kernels[i].name, name) == 0) {
+            return kernels[i].supported();
+        }
+    }
+    return 0;
+}
+
+double hash_isa_ns_per_key(const char *name) {
+    for (int i = 0; i < KERNEL_COUNT; ++i) {
+        if (strcmp(kernels[i].name, name) == 0) {
+            return timings[i];
+        }
+    }
+    return 0;
+}
+
+int sha256_8x(const uint8_t *inputs[8], const size_t lengths[8],
+              uint8_t outputs[8][SHA256_DIGEST_SIZE]) {
+    return selected_kernels()->sha256(inputs, lengths, outputs);
+}
+
+int ripemd160_8x(const uint8_t *inputs[8], const size_t lengths[8],
+                 uint8_t outputs[8][RIPEMD160_DIGEST_SIZE]) {
+    return selected_kernels()->ripemd160(inputs, lengths, outputs);
+}
+
+int sha256_16x(const uint8_t *inputs[16], const size_t lengths[16],
+               uint8_t outputs[16][SHA256_DIGEST_SIZE]) {
+    return sha256_16_with(selected_kernels(), inputs, lengths, outputs);
+}
+
+int ripemd160_16x(const uint8_t *inputs[16], const size_t lengths[16],
+                  uint8_t outputs[16][RIPEMD160_DIGEST_SIZE]) {
+    return ripemd160_16_with(selected_kernels(), inputs, lengths, outputs);
+}
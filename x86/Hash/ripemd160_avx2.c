@@ -1,3 +1,10 @@
+// AVX2 code in any build; Hash.c calls it only on CPUs that have AVX2
+#if defined(__clang__)
+#pragma clang attribute push(__attribute__((target("avx2"))), apply_to = function)
+#elif defined(__GNUC__)
+#pragma GCC target("avx2")
+#endif
+
 #include "ripemd160_avx2.h"
 #include <immintrin.h>
 #include <string.h>
@@ -68,6 +75,176 @@ static const uint32_t _init[] __attribute__((aligned(32))) = {
 #define R42(a, b, c, d, e, x, r) Round(a, b, c, d, e, f2(b, c, d), x, 0x7A6D76E9ul, r)
 #define R52(a, b, c, d, e, x, r) Round(a, b, c, d, e, f1(b, c, d), x, 0, r)
 
+// The 160 steps, left and right lines alternating: STEP(round, the state
+// words in their order for the step, message word index, rotation). The
+// one-batch transform runs each step once, the two-batch one runs it on
+// both batches before moving on.
+#define RIPEMD160_STEPS(STEP)             \
+    STEP(R11, a1, b1, c1, d1, e1, 0, 11)  \
+    STEP(R12, a2, b2, c2, d2, e2, 5, 8)   \
+    STEP(R11, e1, a1, b1, c1, d1, 1, 14)  \
+    STEP(R12, e2, a2, b2, c2, d2, 14, 9)  \
+    STEP(R11, d1, e1, a1, b1, c1, 2, 15)  \
+    STEP(R12, d2, e2, a2, b2, c2, 7, 9)   \
+    STEP(R11, c1, d1, e1, a1, b1, 3, 12)  \
+    STEP(R12, c2, d2, e2, a2, b2, 0, 11)  \
+    STEP(R11, b1, c1, d1, e1, a1, 4, 5)   \
+    STEP(R12, b2, c2, d2, e2, a2, 9, 13)  \
+    STEP(R11, a1, b1, c1, d1, e1, 5, 8)   \
+    STEP(R12, a2, b2, c2, d2, e2, 2, 15)  \
+    STEP(R11, e1, a1, b1, c1, d1, 6, 7)   \
+    STEP(R12, e2, a2, b2, c2, d2, 11, 15) \
+    STEP(R11, d1, e1, a1, b1, c1, 7, 9)   \
+    STEP(R12, d2, e2, a2, b2, c2, 4, 5)   \
+    STEP(R11, c1, d1, e1, a1, b1, 8, 11)  \
+    STEP(R12, c2, d2, e2, a2, b2, 13, 7)  \
+    STEP(R11, b1, c1, d1, e1, a1, 9, 13)  \
+    STEP(R12, b2, c2, d2, e2, a2, 6, 7)   \
+    STEP(R11, a1, b1, c1, d1, e1, 10, 14) \
+    STEP(R12, a2, b2, c2, d2, e2, 15, 8)  \
+    STEP(R11, e1, a1, b1, c1, d1, 11, 15) \
+    STEP(R12, e2, a2, b2, c2, d2, 8, 11)  \
+    STEP(R11, d1, e1, a1, b1, c1, 12, 6)  \
+    STEP(R12, d2, e2, a2, b2, c2, 1, 14)  \
+    STEP(R11, c1, d1, e1, a1, b1, 13, 7)  \
+    STEP(R12, c2, d2, e2, a2, b2, 10, 14) \
+    STEP(R11, b1, c1, d1, e1, a1, 14, 9)  \
+    STEP(R12, b2, c2, d2, e2, a2, 3, 12)  \
+    STEP(R11, a1, b1, c1, d1, e1, 15, 8)  \
+    STEP(R12, a2, b2, c2, d2, e2, 12, 6)  \
+    STEP(R21, e1, a1, b1, c1, d1, 7, 7)   \
+    STEP(R22, e2, a2, b2, c2, d2, 6, 9)   \
+    STEP(R21, d1, e1, a1, b1, c1, 4, 6)   \
+    STEP(R22, d2, e2, a2, b2, c2, 11, 13) \
+    STEP(R21, c1, d1, e1, a1, b1, 13, 8)  \
+    STEP(R22, c2, d2, e2, a2, b2, 3, 15)  \
+    STEP(R21, b1, c1, d1, e1, a1, 1, 13)  \
+    STEP(R22, b2, c2, d2, e2, a2, 7, 7)   \
+    STEP(R21, a1, b1, c1, d1, e1, 10, 11) \
+    STEP(R22, a2, b2, c2, d2, e2, 0, 12)  \
+    STEP(R21, e1, a1, b1, c1, d1, 6, 9)   \
+    STEP(R22, e2, a2, b2, c2, d2, 13, 8)  \
+    STEP(R21, d1, e1, a1, b1, c1, 15, 7)  \
+    STEP(R22, d2, e2, a2, b2, c2, 5, 9)   \
+    STEP(R21, c1, d1, e1, a1, b1, 3, 15)  \
+    STEP(R22, c2, d2, e2, a2, b2, 10, 11) \
+    STEP(R21, b1, c1, d1, e1, a1, 12, 7)  \
+    STEP(R22, b2, c2, d2, e2, a2, 14, 7)  \
+    STEP(R21, a1, b1, c1, d1, e1, 0, 12)  \
+    STEP(R22, a2, b2, c2, d2, e2, 15, 7)  \
+    STEP(R21, e1, a1, b1, c1, d1, 9, 15)  \
+    STEP(R22, e2, a2, b2, c2, d2, 8, 12)  \
+    STEP(R21, d1, e1, a1, b1, c1, 5, 9)   \
+    STEP(R22, d2, e2, a2, b2, c2, 12, 7)  \
+    STEP(R21, c1, d1, e1, a1, b1, 2, 11)  \
+    STEP(R22, c2, d2, e2, a2, b2, 4, 6)   \
+    STEP(R21, b1, c1, d1, e1, a1, 14, 7)  \
+    STEP(R22, b2, c2, d2, e2, a2, 9, 15)  \
+    STEP(R21, a1, b1, c1, d1, e1, 11, 13) \
+    STEP(R22, a2, b2, c2, d2, e2, 1, 13)  \
+    STEP(R21, e1, a1, b1, c1, d1, 8, 12)  \
+    STEP(R22, e2, a2, b2, c2, d2, 2, 11)  \
+    STEP(R31, d1, e1, a1, b1, c1, 3, 11)  \
+    STEP(R32, d2, e2, a2, b2, c2, 15, 9)  \
+    STEP(R31, c1, d1, e1, a1, b1, 10, 13) \
+    STEP(R32, c2, d2, e2, a2, b2, 5, 7)   \
+    STEP(R31, b1, c1, d1, e1, a1, 14, 6)  \
+    STEP(R32, b2, c2, d2, e2, a2, 1, 15)  \
+    STEP(R31, a1, b1, c1, d1, e1, 4, 7)   \
+    STEP(R32, a2, b2, c2, d2, e2, 3, 11)  \
+    STEP(R31, e1, a1, b1, c1, d1, 9, 14)  \
+    STEP(R32, e2, a2, b2, c2, d2, 7, 8)   \
+    STEP(R31, d1, e1, a1, b1, c1, 15, 9)  \
+    STEP(R32, d2, e2, a2, b2, c2, 14, 6)  \
+    STEP(R31, c1, d1, e1, a1, b1, 8, 13)  \
+    STEP(R32, c2, d2, e2, a2, b2, 6, 6)   \
+    STEP(R31, b1, c1, d1, e1, a1, 1, 15)  \
+    STEP(R32, b2, c2, d2, e2, a2, 9, 14)  \
+    STEP(R31, a1, b1, c1, d1, e1, 2, 14)  \
+    STEP(R32, a2, b2, c2, d2, e2, 11, 12) \
+    STEP(R31, e1, a1, b1, c1, d1, 7, 8)   \
+    STEP(R32, e2, a2, b2, c2, d2, 8, 13)  \
+    STEP(R31, d1, e1, a1, b1, c1, 0, 13)  \
+    STEP(R32, d2, e2, a2, b2, c2, 12, 5)  \
+    STEP(R31, c1, d1, e1, a1, b1, 6, 6)   \
+    STEP(R32, c2, d2, e2, a2, b2, 2, 14)  \
+    STEP(R31, b1, c1, d1, e1, a1, 13, 5)  \
+    STEP(R32, b2, c2, d2, e2, a2, 10, 13) \
+    STEP(R31, a1, b1, c1, d1, e1, 11, 12) \
+    STEP(R32, a2, b2, c2, d2, e2, 0, 13)  \
+    STEP(R31, e1, a1, b1, c1, d1, 5, 7)   \
+    STEP(R32, e2, a2, b2, c2, d2, 4, 7)   \
+    STEP(R31, d1, e1, a1, b1, c1, 12, 5)  \
+    STEP(R32, d2, e2, a2, b2, c2, 13, 5)  \
+    STEP(R41, c1, d1, e1, a1, b1, 1, 11)  \
+    STEP(R42, c2, d2, e2, a2, b2, 8, 15)  \
+    STEP(R41, b1, c1, d1, e1, a1, 9, 12)  \
+    STEP(R42, b2, c2, d2, e2, a2, 6, 5)   \
+    STEP(R41, a1, b1, c1, d1, e1, 11, 14) \
+    STEP(R42, a2, b2, c2, d2, e2, 4, 8)   \
+    STEP(R41, e1, a1, b1, c1, d1, 10, 15) \
+    STEP(R42, e2, a2, b2, c2, d2, 1, 11)  \
+    STEP(R41, d1, e1, a1, b1, c1, 0, 14)  \
+    STEP(R42, d2, e2, a2, b2, c2, 3, 14)  \
+    STEP(R41, c1, d1, e1, a1, b1, 8, 15)  \
+    STEP(R42, c2, d2, e2, a2, b2, 11, 14) \
+    STEP(R41, b1, c1, d1, e1, a1, 12, 9)  \
+    STEP(R42, b2, c2, d2, e2, a2, 15, 6)  \
+    STEP(R41, a1, b1, c1, d1, e1, 4, 8)   \
+    STEP(R42, a2, b2, c2, d2, e2, 0, 14)  \
+    STEP(R41, e1, a1, b1, c1, d1, 13, 9)  \
+    STEP(R42, e2, a2, b2, c2, d2, 5, 6)   \
+    STEP(R41, d1, e1, a1, b1, c1, 3, 14)  \
+    STEP(R42, d2, e2, a2, b2, c2, 12, 9)  \
+    STEP(R41, c1, d1, e1, a1, b1, 7, 5)   \
+    STEP(R42, c2, d2, e2, a2, b2, 2, 12)  \
+    STEP(R41, b1, c1, d1, e1, a1, 15, 6)  \
+    STEP(R42, b2, c2, d2, e2, a2, 13, 9)  \
+    STEP(R41, a1, b1, c1, d1, e1, 14, 8)  \
+    STEP(R42, a2, b2, c2, d2, e2, 9, 12)  \
+    STEP(R41, e1, a1, b1, c1, d1, 5, 6)   \
+    STEP(R42, e2, a2, b2, c2, d2, 7, 5)   \
+    STEP(R41, d1, e1, a1, b1, c1, 6, 5)   \
+    STEP(R42, d2, e2, a2, b2, c2, 10, 15) \
+    STEP(R41, c1, d1, e1, a1, b1, 2, 12)  \
+    STEP(R42, c2, d2, e2, a2, b2, 14, 8)  \
+    STEP(R51, b1, c1, d1, e1, a1, 4, 9)   \
+    STEP(R52, b2, c2, d2, e2, a2, 12, 8)  \
+    STEP(R51, a1, b1, c1, d1, e1, 0, 15)  \
+    STEP(R52, a2, b2, c2, d2, e2, 15, 5)  \
+    STEP(R51, e1, a1, b1, c1, d1, 5, 5)   \
+    STEP(R52, e2, a2, b2, c2, d2, 10, 12) \
+    STEP(R51, d1, e1, a1, b1, c1, 9, 11)  \
+    STEP(R52, d2, e2, a2, b2, c2, 4, 9)   \
+    STEP(R51, c1, d1, e1, a1, b1, 7, 6)   \
+    STEP(R52, c2, d2, e2, a2, b2, 1, 12)  \
+    STEP(R51, b1, c1, d1, e1, a1, 12, 8)  \
+    STEP(R52, b2, c2, d2, e2, a2, 5, 5)   \
+    STEP(R51, a1, b1, c1, d1, e1, 2, 13)  \
+    STEP(R52, a2, b2, c2, d2, e2, 8, 14)  \
+    STEP(R51, e1, a1, b1, c1, d1, 10, 12) \
+    STEP(R52, e2, a2, b2, c2, d2, 7, 6)   \
+    STEP(R51, d1, e1, a1, b1, c1, 14, 5)  \
+    STEP(R52, d2, e2, a2, b2, c2, 6, 8)   \
+    STEP(R51, c1, d1, e1, a1, b1, 1, 12)  \
+    STEP(R52, c2, d2, e2, a2, b2, 2, 13)  \
+    STEP(R51, b1, c1, d1, e1, a1, 3, 13)  \
+    STEP(R52, b2, c2, d2, e2, a2, 13, 6)  \
+    STEP(R51, a1, b1, c1, d1, e1, 8, 14)  \
+    STEP(R52, a2, b2, c2, d2, e2, 14, 5)  \
+    STEP(R51, e1, a1, b1, c1, d1, 11, 11) \
+    STEP(R52, e2, a2, b2, c2, d2, 0, 15)  \
+    STEP(R51, d1, e1, a1, b1, c1, 6, 8)   \
+    STEP(R52, d2, e2, a2, b2, c2, 3, 13)  \
+    STEP(R51, c1, d1, e1, a1, b1, 15, 5)  \
+    STEP(R52, c2, d2, e2, a2, b2, 9, 11)  \
+    STEP(R51, b1, c1, d1, e1, a1, 13, 6)  \
+    STEP(R52, b2, c2, d2, e2, a2, 11, 11)
+
+#define ONE(R, a, b, c, d, e, i, r) R(a, b, c, d, e, w[i], r);
+#define TWO(R, a, b, c, d, e, i, r) R(a##x, b##x, c##x, d##x, e##x, wx[i], r); \
+                                    R(a##y, b##y, c##y, d##y, e##y, wy[i], r);
+
 // Macro to load words from the message blocks
 #define LOADW(i) _mm256_set_epi32(*((uint32_t *)blk[0] + i), *((uint32_t *)blk[1] + i), \
                                   *((uint32_t *)blk[2] + i), *((uint32_t *)blk[3] + i), \
@@ -103,172 +280,9 @@ void ripemd160_avx2_transform(__m256i *s, uint8_t *blk[8]) {
         w[i] = LOADW(i);
     }
 
-    // Rounds 0-15
-    R11(a1, b1, c1, d1, e1, w[0], 11);
-    R12(a2, b2, c2, d2, e2, w[5], 8);
-    R11(e1, a1, b1, c1, d1, w[1], 14);
-    R12(e2, a2, b2, c2, d2, w[14], 9);
-    R11(d1, e1, a1, b1, c1, w[2], 15);
-    R12(d2, e2, a2, b2, c2, w[7], 9);
-    R11(c1, d1, e1, a1, b1, w[3], 12);
-    R12(c2, d2, e2, a2, b2, w[0], 11);
-    R11(b1, c1, d1, e1, a1, w[4], 5);
-    R12(b2, c2, d2, e2, a2, w[9], 13);
-    R11(a1, b1, c1, d1, e1, w[5], 8);
-    R12(a2, b2, c2, d2, e2, w[2], 15);
-    R11(e1, a1, b1, c1, d1, w[6], 7);
-    R12(e2, a2, b2, c2, d2, w[11], 15);
-    R11(d1, e1, a1, b1, c1, w[7], 9);
-    R12(d2, e2, a2, b2, c2, w[4], 5);
-    R11(c1, d1, e1, a1, b1, w[8], 11);
-    R12(c2, d2, e2, a2, b2, w[13], 7);
-    R11(b1, c1, d1, e1, a1, w[9], 13);
-    R12(b2, c2, d2, e2, a2, w[6], 7);
-    R11(a1, b1, c1, d1, e1, w[10], 14);
-    R12(a2, b2, c2, d2, e2, w[15], 8);
-    R11(e1, a1, b1, c1, d1, w[11], 15);
-    R12(e2, a2, b2, c2, d2, w[8], 11);
-    R11(d1, e1, a1, b1, c1, w[12], 6);
-    R12(d2, e2, a2, b2, c2, w[1], 14);
-    R11(c1, d1, e1, a1, b1, w[13], 7);
-    R12(c2, d2, e2, a2, b2, w[10], 14);
-    R11(b1, c1, d1, e1, a1, w[14], 9);
-    R12(b2, c2, d2, e2, a2, w[3], 12);
-    R11(a1, b1, c1, d1, e1, w[15], 8);
-    R12(a2, b2, c2, d2, e2, w[12], 6);
-
-    R21(e1, a1, b1, c1, d1, w[7], 7);
-    R22(e2, a2, b2, c2, d2, w[6], 9);
-    R21(d1, e1, a1, b1, c1, w[4], 6);
-    R22(d2, e2, a2, b2, c2, w[11], 13);
-    R21(c1, d1, e1, a1, b1, w[13], 8);
-    R22(c2, d2, e2, a2, b2, w[3], 15);
-    R21(b1, c1, d1, e1, a1, w[1], 13);
-    R22(b2, c2, d2, e2, a2, w[7], 7);
-    R21(a1, b1, c1, d1, e1, w[10], 11);
-    R22(a2, b2, c2, d2, e2, w[0], 12);
-    R21(e1, a1, b1, c1, d1, w[6], 9);
-    R22(e2, a2, b2, c2, d2, w[13], 8);
-    R21(d1, e1, a1, b1, c1, w[15], 7);
-    R22(d2, e2, a2, b2, c2, w[5], 9);
-    R21(c1, d1, e1, a1, b1, w[3], 15);
-    R22(c2, d2, e2, a2, b2, w[10], 11);
-    R21(b1, c1, d1, e1, a1, w[12], 7);
-    R22(b2, c2, d2, e2, a2, w[14], 7);
-    R21(a1, b1, c1, d1, e1, w[0], 12);
-    R22(a2, b2, c2, d2, e2, w[15], 7);
-    R21(e1, a1, b1, c1, d1, w[9], 15);
-    R22(e2, a2, b2, c2, d2, w[8], 12);
-    R21(d1, e1, a1, b1, c1, w[5], 9);
-    R22(d2, e2, a2, b2, c2, w[12], 7);
-    R21(c1, d1, e1, a1, b1, w[2], 11);
-    R22(c2, d2, e2, a2, b2, w[4], 6);
-    R21(b1, c1, d1, e1, a1, w[14], 7);
-    R22(b2, c2, d2, e2, a2, w[9], 15);
-    R21(a1, b1, c1, d1, e1, w[11], 13);
-    R22(a2, b2, c2, d2, e2, w[1], 13);
-    R21(e1, a1, b1, c1, d1, w[8], 12);
-    R22(e2, a2, b2, c2, d2, w[2], 11);
-
-    R31(d1, e1, a1, b1, c1, w[3], 11);
-    R32(d2, e2, a2, b2, c2, w[15], 9);
-    R31(c1, d1, e1, a1, b1, w[10], 13);
-    R32(c2, d2, e2, a2, b2, w[5], 7);
-    R31(b1, c1, d1, e1, a1, w[14], 6);
-    R32(b2, c2, d2, e2, a2, w[1], 15);
-    R31(a1, b1, c1, d1, e1, w[4], 7);
-    R32(a2, b2, c2, d2, e2, w[3], 11);
-    R31(e1, a1, b1, c1, d1, w[9], 14);
-    R32(e2, a2, b2, c2, d2, w[7], 8);
-    R31(d1, e1, a1, b1, c1, w[15], 9);
-    R32(d2, e2, a2, b2, c2, w[14], 6);
-    R31(c1, d1, e1, a1, b1, w[8], 13);
-    R32(c2, d2, e2, a2, b2, w[6], 6);
-    R31(b1, c1, d1, e1, a1, w[1], 15);
-    R32(b2, c2, d2, e2, a2, w[9], 14);
-    R31(a1, b1, c1, d1, e1, w[2], 14);
-    R32(a2, b2, c2, d2, e2, w[11], 12);
-    R31(e1, a1, b1, c1, d1, w[7], 8);
-    R32(e2, a2, b2, c2, d2, w[8], 13);
-    R31(d1, e1, a1, b1, c1, w[0], 13);
-    R32(d2, e2, a2, b2, c2, w[12], 5);
-    R31(c1, d1, e1, a1, b1, w[6], 6);
-    R32(c2, d2, e2, a2, b2, w[2], 14);
-    R31(b1, c1, d1, e1, a1, w[13], 5);
-    R32(b2, c2, d2, e2, a2, w[10], 13);
-    R31(a1, b1, c1, d1, e1, w[11], 12);
-    R32(a2, b2, c2, d2, e2, w[0], 13);
-    R31(e1, a1, b1, c1, d1, w[5], 7);
-    R32(e2, a2, b2, c2, d2, w[4], 7);
-    R31(d1, e1, a1, b1, c1, w[12], 5);
-    R32(d2, e2, a2, b2, c2, w[13], 5);
-
-    R41(c1, d1, e1, a1, b1, w[1], 11);
-    R42(c2, d2, e2, a2, b2, w[8], 15);
-    R41(b1, c1, d1, e1, a1, w[9], 12);
-    R42(b2, c2, d2, e2, a2, w[6], 5);
-    R41(a1, b1, c1, d1, e1, w[11], 14);
-    R42(a2, b2, c2, d2, e2, w[4], 8);
-    R41(e1, a1, b1, c1, d1, w[10], 15);
-    R42(e2, a2, b2, c2, d2, w[1], 11);
-    R41(d1, e1, a1, b1, c1, w[0], 14);
-    R42(d2, e2, a2, b2, c2, w[3], 14);
-    R41(c1, d1, e1, a1, b1, w[8], 15);
-    R42(c2, d2, e2, a2, b2, w[11], 14);
-    R41(b1, c1, d1, e1, a1, w[12], 9);
-    R42(b2, c2, d2, e2, a2, w[15], 6);
-    R41(a1, b1, c1, d1, e1, w[4], 8);
-    R42(a2, b2, c2, d2, e2, w[0], 14);
-    R41(e1, a1, b1, c1, d1, w[13], 9);
-    R42(e2, a2, b2, c2, d2, w[5], 6);
-    R41(d1, e1, a1, b1, c1, w[3], 14);
-    R42(d2, e2, a2, b2, c2, w[12], 9);
-    R41(c1, d1, e1, a1, b1, w[7], 5);
-    R42(c2, d2, e2, a2, b2, w[2], 12);
-    R41(b1, c1, d1, e1, a1, w[15], 6);
-    R42(b2, c2, d2, e2, a2, w[13], 9);
-    R41(a1, b1, c1, d1, e1, w[14], 8);
-    R42(a2, b2, c2, d2, e2, w[9], 12);
-    R41(e1, a1, b1, c1, d1, w[5], 6);
-    R42(e2, a2, b2, c2, d2, w[7], 5);
-    R41(d1, e1, a1, b1, c1, w[6], 5);
-    R42(d2, e2, a2, b2, c2, w[10], 15);
-    R41(c1, d1, e1, a1, b1, w[2], 12);
-    R42(c2, d2, e2, a2, b2, w[14], 8);
-
-    R51(b1, c1, d1, e1, a1, w[4], 9);
-    R52(b2, c2, d2, e2, a2, w[12], 8);
-    R51(a1, b1, c1, d1, e1, w[0], 15);
-    R52(a2, b2, c2, d2, e2, w[15], 5);
-    R51(e1, a1, b1, c1, d1, w[5], 5);
-    R52(e2, a2, b2, c2, d2, w[10], 12);
-    R51(d1, e1, a1, b1, c1, w[9], 11);
-    R52(d2, e2, a2, b2, c2, w[4], 9);
-    R51(c1, d1, e1, a1, b1, w[7], 6);
-    R52(c2, d2, e2, a2, b2, w[1], 12);
-    R51(b1, c1, d1, e1, a1, w[12], 8);
-    R52(b2, c2, d2, e2, a2, w[5], 5);
-    R51(a1, b1, c1, d1, e1, w[2], 13);
-    R52(a2, b2, c2, d2, e2, w[8], 14);
-    R51(e1, a1, b1, c1, d1, w[10], 12);
-    R52(e2, a2, b2, c2, d2, w[7], 6);
-    R51(d1, e1, a1, b1, c1, w[14], 5);
-    R52(d2, e2, a2, b2, c2, w[6], 8);
-    R51(c1, d1, e1, a1, b1, w[1], 12);
-    R52(c2, d2, e2, a2, b2, w[2], 13);
-    R51(b1, c1, d1, e1, a1, w[3], 13);
-    R52(b2, c2, d2, e2, a2, w[13], 6);
-    R51(a1, b1, c1, d1, e1, w[8], 14);
-    R52(a2, b2, c2, d2, e2, w[14], 5);
-    R51(e1, a1, b1, c1, d1, w[11], 11);
-    R52(e2, a2, b2, c2, d2, w[0], 15);
-    R51(d1, e1, a1, b1, c1, w[6], 8);
-    R52(d2, e2, a2, b2, c2, w[3], 13);
-    R51(c1, d1, e1, a1, b1, w[15], 5);
-    R52(c2, d2, e2, a2, b2, w[9], 11);
-    R51(b1, c1, d1, e1, a1, w[13], 6);
-    R52(b2, c2, d2, e2, a2, w[11], 11);
-    
+    // Rounds 0-79 of both lines
+    RIPEMD160_STEPS(ONE)
+
     // Combine results and update state
     __m256i t = s[0];
     s[0] = add3(s[1], c1, d2);
@@ -278,6 +292,50 @@ void ripemd160_avx2_transform(__m256i *s, uint8_t *blk[8]) {
     s[4] = add3(t, b1, c2);
 }
 
+// One block of each of two batches of 8 messages. The left and right lines
+// already give two chains per batch; two batches double that, and the
+// steps alternate between them so neither waits on its own last result.
+void ripemd160_avx2_transform_2x(__m256i *sx, __m256i *sy, uint8_t *blkx[8], uint8_t *blky[8]) {
+    __m256i a1x = _mm256_load_si256(sx + 0);
+    __m256i b1x = _mm256_load_si256(sx + 1);
+    __m256i c1x = _mm256_load_si256(sx + 2);
+    __m256i d1x = _mm256_load_si256(sx + 3);
+    __m256i e1x = _mm256_load_si256(sx + 4);
+    __m256i a1y = _mm256_load_si256(sy + 0);
+    __m256i b1y = _mm256_load_si256(sy + 1);
+    __m256i c1y = _mm256_load_si256(sy + 2);
+    __m256i d1y = _mm256_load_si256(sy + 3);
+    __m256i e1y = _mm256_load_si256(sy + 4);
+    __m256i a2x = a1x, b2x = b1x, c2x = c1x, d2x = d1x, e2x = e1x;
+    __m256i a2y = a1y, b2y = b1y, c2y = c1y, d2y = d1y, e2y = e1y;
+
+    __m256i u;
+    __m256i wx[16], wy[16];
+    uint8_t **blk = blkx;
+    for (int i = 0; i < 16; ++i) {
+        wx[i] = LOADW(i);
+    }
+    blk = blky;
+    for (int i = 0; i < 16; ++i) {
+        wy[i] = LOADW(i);
+    }
+
+    RIPEMD160_STEPS(TWO)
+
+    __m256i t = sx[0];
+    sx[0] = add3(sx[1], c1x, d2x);
+    sx[1] = add3(sx[2], d1x, e2x);
+    sx[2] = add3(sx[3], e1x, a2x);
+    sx[3] = add3(sx[4], a1x, b2x);
+    sx[4] = add3(t, b1x, c2x);
+    t = sy[0];
+    sy[0] = add3(sy[1], c1y, d2y);
+    sy[1] = add3(sy[2], d1y, e2y);
+    sy[2] = add3(sy[3], e1y, a2y);
+    sy[3] = add3(sy[4], a1y, b2y);
+    sy[4] = add3(t, b1y, c2y);
+}
+
 #ifdef WIN64
 #define DEPACK(d, i)                                   \
     ((uint32_t *)d)[0] = _mm256_extract_epi32(s[0], i); \
@@ -319,12 +377,13 @@ void ripemd160avx2_32(
     // Initialize state
     ripemd160_avx2_initialize(s);
 
-    // Find maximum padded length
+    // Padded length of each message, and the longest
+    size_t padded_lens[8];
     size_t max_padded_len = 0;
     for (int i = 0; i < 8; ++i) {
-        size_t padded_len = ((lengths[i] + 8) / 64 + 1) * 64;
-        if (padded_len > max_padded_len) {
-            max_padded_len = padded_len;
+        padded_lens[i] = ((lengths[i] + 8) / 64 + 1) * 64;
+        if (padded_lens[i] > max_padded_len) {
+            max_padded_len = padded_lens[i];
         }
     }
 
@@ -347,12 +406,15 @@ void ripemd160avx2_32(
         padded[i][lengths[i]] = 0x80;
         memset(padded[i] + lengths[i] + 1, 0, max_padded_len - lengths[i] - 1);
         
-        // Append message length in bits (little-endian)
+        // Append message length in bits (little-endian) at the end of its own last block
         uint64_t bit_length = lengths[i] * 8;
-        memcpy(padded[i] + max_padded_len - 8, &bit_length, 8);
+        memcpy(padded[i] + padded_lens[i] - 8, &bit_length, 8);
     }
 
-    // Process all blocks in parallel
+    // Process all blocks in parallel. A message shorter than the longest is
+    // done after its own last block: its state is taken then, and the blocks
+    // of zeros the lane goes on hashing are ignored. Message i is in lane 7 - i.
+    ALIGN32 uint32_t final_state[5][8];
     size_t blocks = max_padded_len / 64;
     for (size_t j = 0; j < blocks; j++) {
         uint8_t* block_ptrs[8];
@@ -360,6 +422,27 @@ void ripemd160avx2_32(
             block_ptrs[i] = padded[i] + j * 64;
         }
         ripemd160_avx2_transform(s, block_ptrs);
+
+        int ending = 0;
+        for (int i = 0; i < 8; ++i) {
+            ending |= padded_lens[i] == (j + 1) * 64;
+        }
+        if (ending) {
+            ALIGN32 uint32_t current[5][8];
+            for (int k = 0; k < 5; ++k) {
+                _mm256_store_si256((__m256i *)current[k], s[k]);
+            }
+            for (int i = 0; i < 8; ++i) {
+                if (padded_lens[i] == (j + 1) * 64) {
+                    for (int k = 0; k < 5; ++k) {
+                        final_state[k][7 - i] = current[k][7 - i];
+                    }
+                }
+            }
+        }
+    }
+    for (int k = 0; k < 5; ++k) {
+        s[k] = _mm256_load_si256((const __m256i *)final_state[k]);
     }
 
     // Clean up
@@ -384,4 +467,84 @@ void ripemd160avx2_32(
     DEPACK(d5, 2);
     DEPACK(d6, 1);
     DEPACK(d7, 0);
-} 
\ No newline at end of file
+}
+
+// Block j of a message after padding (0x80, zeros, the length in bits
+// little-endian at the end of its last block). Blocks past the last one are zeros.
+static void padded_block(const uint8_t *data, size_t length, size_t j, uint8_t block[64]) {
+    size_t offset = j * 64;
+    size_t n = length > offset ? length - offset : 0;
+    if (n > 64) {
+        n = 64;
+    }
+    if (n) {
+        memcpy(block, data + offset, n);
+    }
+    memset(block + n, 0, 64 - n);
+    if (length >= offset && length - offset < 64) {
+        block[length - offset] = 0x80;
+    }
+    if (((length + 8) / 64 + 1) * 64 == offset + 64) {
+        uint64_t bit_length = (uint64_t)length * 8;
+        memcpy(block + 56, &bit_length, 8);
+    }
+}
+
+// RIPEMD-160 of 16 messages as two 8-lane batches run through the
+// interleaved transform. Message i is in batch i / 8, lane 7 - i % 8.
+void ripemd160avx2_16(const uint8_t *data[16], const size_t lengths[16], uint8_t hashes[16][20]) {
+    __m256i s[2][5];
+    __m256i digest[2][5];
+    ripemd160_avx2_initialize(s[0]);
+    ripemd160_avx2_initialize(s[1]);
+    for (int k = 0; k < 5; ++k) {
+        digest[0][k] = digest[1][k] = _mm256_setzero_si256();
+    }
+
+    size_t lane_blocks[16];
+    size_t max_blocks = 0;
+    for (int i = 0; i < 16; ++i) {
+        lane_blocks[i] = (lengths[i] + 8) / 64 + 1;
+        if (lane_blocks[i] > max_blocks) {
+            max_blocks = lane_blocks[i];
+        }
+    }
+
+    // A lane's digest is its state after its own last block, blended in
+    ALIGN32 uint8_t buffers[16][64];
+    uint8_t *block_ptrs[16];
+    for (int i = 0; i < 16; ++i) {
+        block_ptrs[i] = buffers[i];
+    }
+    for (size_t j = 0; j < max_blocks; ++j) {
+        int32_t ending[16];
+        for (int i = 0; i < 16; ++i) {
+            padded_block(data[i], lengths[i], j, buffers[i]);
+            ending[i] = lane_blocks[i] == j + 1 ? -1 : 0;
+        }
+        ripemd160_avx2_transform_2x(s[0], s[1], block_ptrs, block_ptrs + 8);
+        for (int batch = 0; batch < 2; ++batch) {
+            const int32_t *e = ending + 8 * batch;
+            __m256i mask = _mm256_set_epi32(e[0], e[1], e[2], e[3], e[4], e[5], e[6], e[7]);
+            for (int k = 0; k < 5; ++k) {
+                digest[batch][k] = _mm256_blendv_epi8(digest[batch][k], s[batch][k], mask);
+            }
+        }
+    }
+
+    for (int batch = 0; batch < 2; ++batch) {
+        ALIGN32 uint32_t words[5][8]; // words[state_index][lane]
+        for (int k = 0; k < 5; ++k) {
+            _mm256_store_si256((__m256i *)words[k], digest[batch][k]);
+        }
+        for (int i = 0; i < 8; ++i) {
+            for (int k = 0; k < 5; ++k) {
+                memcpy(hashes[8 * batch + i] + k * 4, &words[k][7 - i], 4);
+            }
+        }
+    }
+}
+
+#if defined(__clang__)
+#pragma clang attribute pop
+#endif
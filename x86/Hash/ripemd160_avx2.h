@@ -10,6 +10,12 @@ void ripemd160_avx2_initialize(__m256i *state);
 // Transform AVX2
 void ripemd160_avx2_transform(__m256i *state, uint8_t *blocks[8]);
 
+// One block of each of two batches of 8 messages, their steps interleaved
+void ripemd160_avx2_transform_2x(__m256i *sx, __m256i *sy, uint8_t *blkx[8], uint8_t *blky[8]);
+
+// RIPEMD-160 of 16 messages of arbitrary size, two interleaved batches of 8
+void ripemd160avx2_16(const uint8_t *data[16], const size_t lengths[16], uint8_t hashes[16][20]);
+
 // Hashing functions
 void ripemd160avx2_32(
     unsigned char *i0, unsigned char *i1, unsigned char *i2, unsigned char *i3,
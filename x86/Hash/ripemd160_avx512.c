@@ -0,0 +1,343 @@
+// Sixteen lanes with AVX-512F in any build. vprold does the rotates in one
+// instruction and vpternlogd each boolean function, which the AVX2 kernel
+// spells out with shifts, ors and nots. Hash.c calls it only on CPUs that
+// have AVX-512F.
+#if defined(__clang__)
+#pragma clang attribute push(__attribute__((target("avx512f"))), apply_to = function)
+#elif defined(__GNUC__)
+#pragma GCC target("avx512f")
+// GCC 12's headers build the unmasked shifts and rotates from a
+// self-initialised _mm512_undefined_epi32() and warn about it (GCC PR 105593)
+#pragma GCC diagnostic ignored "-Wuninitialized"
+#endif
+
+#include "ripemd160_avx512.h"
+#include <immintrin.h>
+#include <string.h>
+#include <stdint.h>
+
+#ifdef _MSC_VER
+#define ALIGN64 __declspec(align(64))
+#else
+#define ALIGN64 __attribute__((aligned(64)))
+#endif
+
+// AVX-512 operations
+#define ROL(x, n) _mm512_rol_epi32(x, n)
+
+// RIPEMD-160 functions as ternary logic truth tables, x as the high bit
+#define f1(x, y, z) _mm512_ternarylogic_epi32(x, y, z, 0x96) // x ^ y ^ z
+#define f2(x, y, z) _mm512_ternarylogic_epi32(x, y, z, 0xCA) // (x & y) | (~x & z)
+#define f3(x, y, z) _mm512_ternarylogic_epi32(x, y, z, 0x59) // (x | ~y) ^ z
+#define f4(x, y, z) _mm512_ternarylogic_epi32(x, y, z, 0xE4) // (x & z) | (y & ~z)
+#define f5(x, y, z) _mm512_ternarylogic_epi32(x, y, z, 0x2D) // x ^ (y | ~z)
+
+// Addition helpers
+#define add3(x0, x1, x2) _mm512_add_epi32(_mm512_add_epi32(x0, x1), x2)
+#define add4(x0, x1, x2, x3) _mm512_add_epi32(_mm512_add_epi32(x0, x1), _mm512_add_epi32(x2, x3))
+
+// Round function
+#define Round(a, b, c, d, e, f, x, k, r)   \
+    u = add4(a, f, x, _mm512_set1_epi32(k)); \
+    a = _mm512_add_epi32(ROL(u, r), e);     \
+    c = ROL(c, 10);
+
+// Macro definitions for each operation in the rounds
+#define R11(a, b, c, d, e, x, r) Round(a, b, c, d, e, f1(b, c, d), x, 0, r)
+#define R21(a, b, c, d, e, x, r) Round(a, b, c, d, e, f2(b, c, d), x, 0x5A827999ul, r)
+#define R31(a, b, c, d, e, x, r) Round(a, b, c, d, e, f3(b, c, d), x, 0x6ED9EBA1ul, r)
+#define R41(a, b, c, d, e, x, r) Round(a, b, c, d, e, f4(b, c, d), x, 0x8F1BBCDCul, r)
+#define R51(a, b, c, d, e, x, r) Round(a, b, c, d, e, f5(b, c, d), x, 0xA953FD4Eul, r)
+#define R12(a, b, c, d, e, x, r) Round(a, b, c, d, e, f5(b, c, d), x, 0x50A28BE6ul, r)
+#define R22(a, b, c, d, e, x, r) Round(a, b, c, d, e, f4(b, c, d), x, 0x5C4DD124ul, r)
+#define R32(a, b, c, d, e, x, r) Round(a, b, c, d, e, f3(b, c, d), x, 0x6D703EF3ul, r)
+#define R42(a, b, c, d, e, x, r) Round(a, b, c, d, e, f2(b, c, d), x, 0x7A6D76E9ul, r)
+#define R52(a, b, c, d, e, x, r) Round(a, b, c, d, e, f1(b, c, d), x, 0, r)
+
+// Initialize state with initial hash values
+void ripemd160_avx512_initialize(__m512i *s) {
+    s[0] = _mm512_set1_epi32(0x67452301);
+    s[1] = _mm512_set1_epi32(0xEFCDAB89);
+    s[2] = _mm512_set1_epi32(0x98BADCFE);
+    s[3] = _mm512_set1_epi32(0x10325476);
+    s[4] = _mm512_set1_epi32(0xC3D2E1F0);
+}
+
+// Transform function processes one block for each message
+void ripemd160_avx512_transform(__m512i *s, const uint8_t *blocks[16]) {
+    __m512i a1 = s[0];
+    __m512i b1 = s[1];
+    __m512i c1 = s[2];
+    __m512i d1 = s[3];
+    __m512i e1 = s[4];
+
+    // Initialize second set of variables
+    __m512i a2 = a1;
+    __m512i b2 = b1;
+    __m512i c2 = c1;
+    __m512i d2 = d1;
+    __m512i e2 = e1;
+
+    __m512i u;
+    __m512i w[16];
+
+    // Load message words (little-endian), word i of every lane
+    ALIGN64 uint32_t words[16][16];
+    for (int l = 0; l < 16; ++l) {
+        for (int i = 0; i < 16; ++i) {
+            memcpy(&words[i][l], blocks[l] + i * 4, 4);
+        }
+    }
+    for (int i = 0; i < 16; ++i) {
+        w[i] = _mm512_load_si512((const void *)words[i]);
+    }
+
+    // Rounds 0-15
+    R11(a1, b1, c1, d1, e1, w[0], 11);
+    R12(a2, b2, c2, d2, e2, w[5], 8);
+    R11(e1, a1, b1, c1, d1, w[1], 14);
+    R12(e2, a2, b2, c2, d2, w[14], 9);
+    R11(d1, e1, a1, b1, c1, w[2], 15);
+    R12(d2, e2, a2, b2, c2, w[7], 9);
+    R11(c1, d1, e1, a1, b1, w[3], 12);
+    R12(c2, d2, e2, a2, b2, w[0], 11);
+    R11(b1, c1, d1, e1, a1, w[4], 5);
+    R12(b2, c2, d2, e2, a2, w[9], 13);
+    R11(a1, b1, c1, d1, e1, w[5], 8);
+    R12(a2, b2, c2, d2, e2, w[2], 15);
+    R11(e1, a1, b1, c1, d1, w[6], 7);
+    R12(e2, a2, b2, c2, d2, w[11], 15);
+    R11(d1, e1, a1, b1, c1, w[7], 9);
+    R12(d2, e2, a2, b2, c2, w[4], 5);
+    R11(c1, d1, e1, a1, b1, w[8], 11);
+    R12(c2, d2, e2, a2, b2, w[13], 7);
+    R11(b1, c1, d1, e1, a1, w[9], 13);
+    R12(b2, c2, d2, e2, a2, w[6], 7);
+    R11(a1, b1, c1, d1, e1, w[10], 14);
+    R12(a2, b2, c2, d2, e2, w[15], 8);
+    R11(e1, a1, b1, c1, d1, w[11], 15);
+    R12(e2, a2, b2, c2, d2, w[8], 11);
+    R11(d1, e1, a1, b1, c1, w[12], 6);
+    R12(d2, e2, a2, b2, c2, w[1], 14);
+    R11(c1, d1, e1, a1, b1, w[13], 7);
+    R12(c2, d2, e2, a2, b2, w[10], 14);
+    R11(b1, c1, d1, e1, a1, w[14], 9);
+    R12(b2, c2, d2, e2, a2, w[3], 12);
+    R11(a1, b1, c1, d1, e1, w[15], 8);
+    R12(a2, b2, c2, d2, e2, w[12], 6);
+
+    R21(e1, a1, b1, c1, d1, w[7], 7);
+    R22(e2, a2, b2, c2, d2, w[6], 9);
+    R21(d1, e1, a1, b1, c1, w[4], 6);
+    R22(d2, e2, a2, b2, c2, w[11], 13);
+    R21(c1, d1, e1, a1, b1, w[13], 8);
+    R22(c2, d2, e2, a2, b2, w[3], 15);
+    R21(b1, c1, d1, e1, a1, w[1], 13);
+    R22(b2, c2, d2, e2, a2, w[7], 7);
+    R21(a1, b1, c1, d1, e1, w[10], 11);
+    R22(a2, b2, c2, d2, e2, w[0], 12);
+    R21(e1, a1, b1, c1, d1, w[6], 9);
+    R22(e2, a2, b2, c2, d2, w[13], 8);
+    R21(d1, e1, a1, b1, c1, w[15], 7);
+    R22(d2, e2, a2, b2, c2, w[5], 9);
+    R21(c1, d1, e1, a1, b1, w[3], 15);
+    R22(c2, d2, e2, a2, b2, w[10], 11);
+    R21(b1, c1, d1, e1, a1, w[12], 7);
+    R22(b2, c2, d2, e2, a2, w[14], 7);
+    R21(a1, b1, c1, d1, e1, w[0], 12);
+    R22(a2, b2, c2, d2, e2, w[15], 7);
+    R21(e1, a1, b1, c1, d1, w[9], 15);
+    R22(e2, a2, b2, c2, d2, w[8], 12);
+    R21(d1, e1, a1, b1, c1, w[5], 9);
+    R22(d2, e2, a2, b2, c2, w[12], 7);
+    R21(c1, d1, e1, a1, b1, w[2], 11);
+    R22(c2, d2, e2, a2, b2, w[4], 6);
+    R21(b1, c1, d1, e1, a1, w[14], 7);
+    R22(b2, c2, d2, e2, a2, w[9], 15);
+    R21(a1, b1, c1, d1, e1, w[11], 13);
+    R22(a2, b2, c2, d2, e2, w[1], 13);
+    R21(e1, a1, b1, c1, d1, w[8], 12);
+    R22(e2, a2, b2, c2, d2, w[2], 11);
+
+    R31(d1, e1, a1, b1, c1, w[3], 11);
+    R32(d2, e2, a2, b2, c2, w[15], 9);
+    R31(c1, d1, e1, a1, b1, w[10], 13);
+    R32(c2, d2, e2, a2, b2, w[5], 7);
+    R31(b1, c1, d1, e1, a1, w[14], 6);
+    R32(b2, c2, d2, e2, a2, w[1], 15);
+    R31(a1, b1, c1, d1, e1, w[4], 7);
+    R32(a2, b2, c2, d2, e2, w[3], 11);
+    R31(e1, a1, b1, c1, d1, w[9], 14);
+    R32(e2, a2, b2, c2, d2, w[7], 8);
+    R31(d1, e1, a1, b1, c1, w[15], 9);
+    R32(d2, e2, a2, b2, c2, w[14], 6);
+    R31(c1, d1, e1, a1, b1, w[8], 13);
+    R32(c2, d2, e2, a2, b2, w[6], 6);
+    R31(b1, c1, d1, e1, a1, w[1], 15);
+    R32(b2, c2, d2, e2, a2, w[9], 14);
+    R31(a1, b1, c1, d1, e1, w[2], 14);
+    R32(a2, b2, c2, d2, e2, w[11], 12);
+    R31(e1, a1, b1, c1, d1, w[7], 8);
+    R32(e2, a2, b2, c2, d2, w[8], 13);
+    R31(d1, e1, a1, b1, c1, w[0], 13);
+    R32(d2, e2, a2, b2, c2, w[12], 5);
+    R31(c1, d1, e1, a1, b1, w[6], 6);
+    R32(c2, d2, e2, a2, b2, w[2], 14);
+    R31(b1, c1, d1, e1, a1, w[13], 5);
+    R32(b2, c2, d2, e2, a2, w[10], 13);
+    R31(a1, b1, c1, d1, e1, w[11], 12);
+    R32(a2, b2, c2, d2, e2, w[0], 13);
+    R31(e1, a1, b1, c1, d1, w[5], 7);
+    R32(e2, a2, b2, c2, d2, w[4], 7);
+    R31(d1, e1, a1, b1, c1, w[12], 5);
+    R32(d2, e2, a2, b2, c2, w[13], 5);
+
+    R41(c1, d1, e1, a1, b1, w[1], 11);
+    R42(c2, d2, e2, a2, b2, w[8], 15);
+    R41(b1, c1, d1, e1, a1, w[9], 12);
+    R42(b2, c2, d2, e2, a2, w[6], 5);
+    R41(a1, b1, c1, d1, e1, w[11], 14);
+    R42(a2, b2, c2, d2, e2, w[4], 8);
+    R41(e1, a1, b1, c1, d1, w[10], 15);
+    R42(e2, a2, b2, c2, d2, w[1], 11);
+    R41(d1, e1, a1, b1, c1, w[0], 14);
+    R42(d2, e2, a2, b2, c2, w[3], 14);
+    R41(c1, d1, e1, a1, b1, w[8], 15);
+    R42(c2, d2, e2, a2, b2, w[11], 14);
+    R41(b1, c1, d1, e1, a1, w[12], 9);
+    R42(b2, c2, d2, e2, a2, w[15], 6);
+    R41(a1, b1, c1, d1, e1, w[4], 8);
+    R42(a2, b2, c2, d2, e2, w[0], 14);
+    R41(e1, a1, b1, c1, d1, w[13], 9);
+    R42(e2, a2, b2, c2, d2, w[5], 6);
+    R41(d1, e1, a1, b1, c1, w[3], 14);
+    R42(d2, e2, a2, b2, c2, w[12], 9);
+    R41(c1, d1, e1, a1, b1, w[7], 5);
+    R42(c2, d2, e2, a2, b2, w[2], 12);
+    R41(b1, c1, d1, e1, a1, w[15], 6);
+    R42(b2, c2, d2, e2, a2, w[13], 9);
+    R41(a1, b1, c1, d1, e1, w[14], 8);
+    R42(a2, b2, c2, d2, e2, w[9], 12);
+    R41(e1, a1, b1, c1, d1, w[5], 6);
+    R42(e2, a2, b2, c2, d2, w[7], 5);
+    R41(d1, e1, a1, b1, c1, w[6], 5);
+    R42(d2, e2, a2, b2, c2, w[10], 15);
+    R41(c1, d1, e1, a1, b1, w[2], 12);
+    R42(c2, d2, e2, a2, b2, w[14], 8);
+
+    R51(b1, c1, d1, e1, a1, w[4], 9);
+    R52(b2, c2, d2, e2, a2, w[12], 8);
+    R51(a1, b1, c1, d1, e1, w[0], 15);
+    R52(a2, b2, c2, d2, e2, w[15], 5);
+    R51(e1, a1, b1, c1, d1, w[5], 5);
+    R52(e2, a2, b2, c2, d2, w[10], 12);
+    R51(d1, e1, a1, b1, c1, w[9], 11);
+    R52(d2, e2, a2, b2, c2, w[4], 9);
+    R51(c1, d1, e1, a1, b1, w[7], 6);
+    R52(c2, d2, e2, a2, b2, w[1], 12);
+    R51(b1, c1, d1, e1, a1, w[12], 8);
+    R52(b2, c2, d2, e2, a2, w[5], 5);
+    R51(a1, b1, c1, d1, e1, w[2], 13);
+    R52(a2, b2, c2, d2, e2, w[8], 14);
+    R51(e1, a1, b1, c1, d1, w[10], 12);
+    R52(e2, a2, b2, c2, d2, w[7], 6);
+    R51(d1, e1, a1, b1, c1, w[14], 5);
+    R52(d2, e2, a2, b2, c2, w[6], 8);
+    R51(c1, d1, e1, a1, b1, w[1], 12);
+    R52(c2, d2, e2, a2, b2, w[2], 13);
+    R51(b1, c1, d1, e1, a1, w[3], 13);
+    R52(b2, c2, d2, e2, a2, w[13], 6);
+    R51(a1, b1, c1, d1, e1, w[8], 14);
+    R52(a2, b2, c2, d2, e2, w[14], 5);
+    R51(e1, a1, b1, c1, d1, w[11], 11);
+    R52(e2, a2, b2, c2, d2, w[0], 15);
+    R51(d1, e1, a1, b1, c1, w[6], 8);
+    R52(d2, e2, a2, b2, c2, w[3], 13);
+    R51(c1, d1, e1, a1, b1, w[15], 5);
+    R52(c2, d2, e2, a2, b2, w[9], 11);
+    R51(b1, c1, d1, e1, a1, w[13], 6);
+    R52(b2, c2, d2, e2, a2, w[11], 11);
+
+    // Combine results and update state
+    __m512i t = s[0];
+    s[0] = add3(s[1], c1, d2);
+    s[1] = add3(s[2], d1, e2);
+    s[2] = add3(s[3], e1, a2);
+    s[3] = add3(s[4], a1, b2);
+    s[4] = add3(t, b1, c2);
+}
+
+// Block j of a message after padding (0x80, zeros, the length in bits
+// little-endian at the end of its last block). Blocks past the last one are
+// zeros.
+static void padded_block(const uint8_t *data, size_t length, size_t j, uint8_t block[64]) {
+    size_t offset = j * 64;
+    size_t n = length > offset ? length - offset : 0;
+    if (n > 64) {
+        n = 64;
+    }
+    if (n) {
+        memcpy(block, data + offset, n);
+    }
+    memset(block + n, 0, 64 - n);
+    if (length >= offset && length - offset < 64) {
+        block[length - offset] = 0x80;
+    }
+    if (((length + 8) / 64 + 1) * 64 == offset + 64) {
+        uint64_t bit_length = (uint64_t)length * 8;
+        memcpy(block + 56, &bit_length, 8);
+    }
+}
+
+void ripemd160avx512_16(const uint8_t *data[16], const size_t lengths[16], uint8_t hashes[16][20]) {
+    __m512i s[5];
+    __m512i digest[5];
+    ripemd160_avx512_initialize(s);
+    for (int k = 0; k < 5; ++k) {
+        digest[k] = _mm512_setzero_si512();
+    }
+
+    size_t lane_blocks[16];
+    size_t max_blocks = 0;
+    for (int i = 0; i < 16; ++i) {
+        lane_blocks[i] = (lengths[i] + 8) / 64 + 1;
+        if (lane_blocks[i] > max_blocks) {
+            max_blocks = lane_blocks[i];
+        }
+    }
+
+    // Each lane's state is kept, under a mask, after its own last block
+    ALIGN64 uint8_t buffers[16][64];
+    const uint8_t *block_ptrs[16];
+    for (int i = 0; i < 16; ++i) {
+        block_ptrs[i] = buffers[i];
+    }
+    for (size_t j = 0; j < max_blocks; ++j) {
+        __mmask16 ending = 0;
+        for (int i = 0; i < 16; ++i) {
+            padded_block(data[i], lengths[i], j, buffers[i]);
+            if (lane_blocks[i] == j + 1) {
+                ending |= (__mmask16)(1u << i);
+            }
+        }
+        ripemd160_avx512_transform(s, block_ptrs);
+        for (int k = 0; k < 5; ++k) {
+            digest[k] = _mm512_mask_mov_epi32(digest[k], ending, s[k]);
+        }
+    }
+
+    // The state words are the digest, little-endian
+    ALIGN64 uint32_t words[5][16];
+    for (int k = 0; k < 5; ++k) {
+        _mm512_store_si512((void *)words[k], digest[k]);
+    }
+    for (int i = 0; i < 16; ++i) {
+        for (int k = 0; k < 5; ++k) {
+            memcpy(hashes[i] + k * 4, &words[k][i], 4);
+        }
+    }
+}
+
+#if defined(__clang__)
+#pragma clang attribute pop
+#endif
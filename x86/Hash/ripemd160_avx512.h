@@ -0,0 +1,17 @@
+#ifndef RIPEMD160_AVX512_H
+#define RIPEMD160_AVX512_H
+
+#include <immintrin.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Initialize RIPEMD-160 state, one message per lane
+void ripemd160_avx512_initialize(__m512i *s);
+
+// Transform function processes one block for each of 16 messages
+void ripemd160_avx512_transform(__m512i *state, const uint8_t *blocks[16]);
+
+// RIPEMD-160 of 16 messages of arbitrary size, message i in lane i
+void ripemd160avx512_16(const uint8_t *data[16], const size_t lengths[16], uint8_t hashes[16][20]);
+
+#endif // RIPEMD160_AVX512_H
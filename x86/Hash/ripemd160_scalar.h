@@ -0,0 +1,10 @@
+#ifndef RIPEMD160_SCALAR_H
+#define RIPEMD160_SCALAR_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// RIPEMD-160 of one message, without vector instructions
+void ripemd160_scalar(const uint8_t *data, size_t length, uint8_t out[20]);
+
+#endif // RIPEMD160_SCALAR_H
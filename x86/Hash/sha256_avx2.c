@@ -1,3 +1,11 @@
+// Built for AVX2 whatever the build flags; only called once the CPU is
+// known to support it (see the dispatch in Hash.c)
+#if defined(__clang__)
+#pragma clang attribute push(__attribute__((target("avx2"))), apply_to = function)
+#elif defined(__GNUC__)
+#pragma GCC target("avx2")
+#endif
+
 #include "sha256_avx2.h"
 #include <immintrin.h>
 #include <string.h>
@@ -50,22 +58,28 @@ void sha256_avx2_initialize(__m256i* s) {
     b = a;                                                                       \
     a = _mm256_add_epi32(T1, T2);
 
-void sha256_avx2_transform(__m256i* state, const uint8_t* data[8]) {
-    __m256i a, b, c, d, e, f, g, h;
-    __m256i W[64];
-    __m256i T1, T2;
+// SHA-256 constants
+static const uint32_t K[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5,
+    0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
+    0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc,
+    0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7,
+    0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
+    0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3,
+    0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5,
+    0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+    0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
 
-    // Load state into local variables
-    a = state[0];
-    b = state[1];
-    c = state[2];
-    d = state[3];
-    e = state[4];
-    f = state[5];
-    g = state[6];
-    h = state[7];
-
-    // Prepare message schedule W[0..15]
+// Message schedule W[0..63] of one block of each of 8 messages
+static void message_schedule(__m256i W[64], const uint8_t* data[8]) {
     for (int t = 0; t < 16; ++t) {
         uint32_t wt[8];
         for (int i = 0; i < 8; ++i) {
@@ -74,33 +88,29 @@ void sha256_avx2_transform(__m256i* state, const uint8_t* data[8]) {
         }
         W[t] = _mm256_setr_epi32(wt[0], wt[1], wt[2], wt[3], wt[4], wt[5], wt[6], wt[7]);
     }
-
-    // Message schedule (message expansion) W[16..63]
     for (int t = 16; t < 64; ++t) {
         W[t] = _mm256_add_epi32(
                     _mm256_add_epi32(s1(W[t - 2]), W[t - 7]),
                     _mm256_add_epi32(s0(W[t - 15]), W[t - 16]));
     }
+}
 
-    // SHA-256 constants
-    static const uint32_t K[64] = {
-        0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5,
-        0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
-        0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
-        0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
-        0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc,
-        0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
-        0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7,
-        0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
-        0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
-        0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
-        0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3,
-        0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
-        0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5,
-        0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
-        0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
-        0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
-    };
+void sha256_avx2_transform(__m256i* state, const uint8_t* data[8]) {
+    __m256i a, b, c, d, e, f, g, h;
+    __m256i W[64];
+    __m256i T1, T2;
+
+    // Load state into local variables
+    a = state[0];
+    b = state[1];
+    c = state[2];
+    d = state[3];
+    e = state[4];
+    f = state[5];
+    g = state[6];
+    h = state[7];
+
+    message_schedule(W, data);
 
     // Main loop of SHA-256
     for (int t = 0; t < 64; ++t) {
@@ -119,6 +129,48 @@ void sha256_avx2_transform(__m256i* state, const uint8_t* data[8]) {
     state[7] = _mm256_add_epi32(state[7], h);
 }
 
+void sha256_avx2_transform_2x(__m256i* state0, __m256i* state1, const uint8_t* data0[8], const uint8_t* data1[8]) {
+    __m256i a0 = state0[0], b0 = state0[1], c0 = state0[2], d0 = state0[3];
+    __m256i e0 = state0[4], f0 = state0[5], g0 = state0[6], h0 = state0[7];
+    __m256i a1 = state1[0], b1 = state1[1], c1 = state1[2], d1 = state1[3];
+    __m256i e1 = state1[4], f1 = state1[5], g1 = state1[6], h1 = state1[7];
+    __m256i W0[64], W1[64];
+
+    message_schedule(W0, data0);
+    message_schedule(W1, data1);
+
+    // The two chains share nothing, so each round of one can issue while
+    // the other's waits on its previous round
+    for (int t = 0; t < 64; ++t) {
+        __m256i Kt = _mm256_set1_epi32(K[t]);
+        {
+            __m256i T1, T2;
+            Round(a0, b0, c0, d0, e0, f0, g0, h0, Kt, W0[t]);
+        }
+        {
+            __m256i T1, T2;
+            Round(a1, b1, c1, d1, e1, f1, g1, h1, Kt, W1[t]);
+        }
+    }
+
+    state0[0] = _mm256_add_epi32(state0[0], a0);
+    state0[1] = _mm256_add_epi32(state0[1], b0);
+    state0[2] = _mm256_add_epi32(state0[2], c0);
+    state0[3] = _mm256_add_epi32(state0[3], d0);
+    state0[4] = _mm256_add_epi32(state0[4], e0);
+    state0[5] = _mm256_add_epi32(state0[5], f0);
+    state0[6] = _mm256_add_epi32(state0[6], g0);
+    state0[7] = _mm256_add_epi32(state0[7], h0);
+    state1[0] = _mm256_add_epi32(state1[0], a1);
+    state1[1] = _mm256_add_epi32(state1[1], b1);
+    state1[2] = _mm256_add_epi32(state1[2], c1);
+    state1[3] = _mm256_add_epi32(state1[3], d1);
+    state1[4] = _mm256_add_epi32(state1[4], e1);
+    state1[5] = _mm256_add_epi32(state1[5], f1);
+    state1[6] = _mm256_add_epi32(state1[6], g1);
+    state1[7] = _mm256_add_epi32(state1[7], h1);
+}
+
 // Main function to compute SHA-256 hash for 8 messages of arbitrary size
 void sha256avx2_8B(
     const uint8_t* data0, const uint8_t* data1, const uint8_t* data2, const uint8_t* data3,
@@ -135,12 +187,13 @@ void sha256avx2_8B(
     // Initialize the state with the initial hash values
     sha256_avx2_initialize(state);
 
-    // Find maximum padded length
+    // Padded length of each message, and the longest
+    size_t padded_lens[8];
     size_t max_padded_len = 0;
     for (int i = 0; i < 8; ++i) {
-        size_t padded_len = ((lengths[i] + 8) / 64 + 1) * 64;
-        if (padded_len > max_padded_len) {
-            max_padded_len = padded_len;
+        padded_lens[i] = ((lengths[i] + 8) / 64 + 1) * 64;
+        if (padded_lens[i] > max_padded_len) {
+            max_padded_len = padded_lens[i];
         }
     }
 
@@ -163,13 +216,16 @@ void sha256avx2_8B(
         padded[i][lengths[i]] = 0x80;
         memset(padded[i] + lengths[i] + 1, 0, max_padded_len - lengths[i] - 1);
         
-        // Append message length in bits (big-endian)
+        // Append message length in bits (big-endian) at the end of its own last block
         uint64_t bit_length = lengths[i] * 8;
         bit_length = __builtin_bswap64(bit_length);
-        memcpy(padded[i] + max_padded_len - 8, &bit_length, 8);
+        memcpy(padded[i] + padded_lens[i] - 8, &bit_length, 8);
     }
 
-    // Process all blocks in parallel
+    // Process all blocks in parallel. A message shorter than the longest is
+    // done after its own last block: its state is taken then, and the blocks
+    // of zeros the lane goes on hashing are ignored.
+    ALIGN32 uint32_t digest[8][8]; // digest[state_index][element_index]
     size_t blocks = max_padded_len / 64;
     for (size_t j = 0; j < blocks; j++) {
         const uint8_t* block_ptrs[8];
@@ -177,6 +233,24 @@ void sha256avx2_8B(
             block_ptrs[i] = padded[i] + j * 64;
         }
         sha256_avx2_transform(state, block_ptrs);
+
+        int ending = 0;
+        for (int i = 0; i < 8; ++i) {
+            ending |= padded_lens[i] == (j + 1) * 64;
+        }
+        if (ending) {
+            ALIGN32 uint32_t current[8][8];
+            for (int k = 0; k < 8; ++k) {
+                _mm256_store_si256((__m256i*)current[k], state[k]);
+            }
+            for (int i = 0; i < 8; ++i) {
+                if (padded_lens[i] == (j + 1) * 64) {
+                    for (int k = 0; k < 8; ++k) {
+                        digest[k][i] = current[k][i];
+                    }
+                }
+            }
+        }
     }
 
     // Clean up
@@ -184,13 +258,6 @@ void sha256avx2_8B(
         _mm_free(padded[i]);
     }
 
-    // Store the resulting state
-    ALIGN32 uint32_t digest[8][8]; // digest[state_index][element_index]
-
-    for (int i = 0; i < 8; ++i) {
-        _mm256_store_si256((__m256i*)digest[i], state[i]);
-    }
-
     unsigned char* hashArray[8] = { hash0, hash1, hash2, hash3, hash4, hash5, hash6, hash7 };
 
     // Extract the hash values and copy to output buffers
@@ -206,4 +273,84 @@ void sha256avx2_8B(
             memcpy(hash + j * 4, &word, 4);
         }
     }
-} 
\ No newline at end of file
+}
+
+// Block j of a message after padding (0x80, zeros, the length in bits
+// big-endian at the end of its last block). Blocks past the last one are zeros.
+static void padded_block(const uint8_t* data, size_t length, size_t j, uint8_t block[64]) {
+    size_t offset = j * 64;
+    size_t n = length > offset ? length - offset : 0;
+    if (n > 64) {
+        n = 64;
+    }
+    if (n) {
+        memcpy(block, data + offset, n);
+    }
+    memset(block + n, 0, 64 - n);
+    if (length >= offset && length - offset < 64) {
+        block[length - offset] = 0x80;
+    }
+    if (((length + 8) / 64 + 1) * 64 == offset + 64) {
+        uint64_t bit_length = __builtin_bswap64((uint64_t)length * 8);
+        memcpy(block + 56, &bit_length, 8);
+    }
+}
+
+// SHA-256 of 16 messages as two 8-lane batches run through the interleaved
+// transform. Message i is batch i / 8, lane i % 8.
+void sha256avx2_16B(const uint8_t* data[16], const size_t lengths[16], uint8_t hashes[16][32]) {
+    __m256i state[2][8];
+    __m256i digest[2][8];
+    sha256_avx2_initialize(state[0]);
+    sha256_avx2_initialize(state[1]);
+    for (int k = 0; k < 8; ++k) {
+        digest[0][k] = digest[1][k] = _mm256_setzero_si256();
+    }
+
+    size_t lane_blocks[16];
+    size_t max_blocks = 0;
+    for (int i = 0; i < 16; ++i) {
+        lane_blocks[i] = (lengths[i] + 8) / 64 + 1;
+        if (lane_blocks[i] > max_blocks) {
+            max_blocks = lane_blocks[i];
+        }
+    }
+
+    // A lane's digest is its state after its own last block, blended in
+    ALIGN32 uint8_t buffers[16][64];
+    const uint8_t* block_ptrs[16];
+    for (int i = 0; i < 16; ++i) {
+        block_ptrs[i] = buffers[i];
+    }
+    for (size_t j = 0; j < max_blocks; ++j) {
+        ALIGN32 int32_t ending[16];
+        for (int i = 0; i < 16; ++i) {
+            padded_block(data[i], lengths[i], j, buffers[i]);
+            ending[i] = lane_blocks[i] == j + 1 ? -1 : 0;
+        }
+        sha256_avx2_transform_2x(state[0], state[1], block_ptrs, block_ptrs + 8);
+        for (int batch = 0; batch < 2; ++batch) {
+            __m256i mask = _mm256_load_si256((const __m256i*)(ending + 8 * batch));
+            for (int k = 0; k < 8; ++k) {
+                digest[batch][k] = _mm256_blendv_epi8(digest[batch][k], state[batch][k], mask);
+            }
+        }
+    }
+
+    for (int batch = 0; batch < 2; ++batch) {
+        ALIGN32 uint32_t words[8][8]; // words[state_index][lane]
+        for (int k = 0; k < 8; ++k) {
+            _mm256_store_si256((__m256i*)words[k], digest[batch][k]);
+        }
+        for (int i = 0; i < 8; ++i) {
+            for (int k = 0; k < 8; ++k) {
+                uint32_t word = __builtin_bswap32(words[k][i]);
+                memcpy(hashes[8 * batch + i] + k * 4, &word, 4);
+            }
+        }
+    }
+}
+
+#if defined(__clang__)
+#pragma clang attribute pop
+#endif
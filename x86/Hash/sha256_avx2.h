@@ -10,6 +10,12 @@ void sha256_avx2_initialize(__m256i* s);
 // Transform function processes one block for each message
 void sha256_avx2_transform(__m256i* state, const uint8_t* data[8]);
 
+// One block of each of two independent 8-message batches, their rounds interleaved
+void sha256_avx2_transform_2x(__m256i* state0, __m256i* state1, const uint8_t* data0[8], const uint8_t* data1[8]);
+
+// SHA-256 of 16 messages of arbitrary size, two interleaved batches of 8
+void sha256avx2_16B(const uint8_t* data[16], const size_t lengths[16], uint8_t hashes[16][32]);
+
 // Main function to compute SHA-256 hash for 8 messages of arbitrary size
 void sha256avx2_8B(
     const uint8_t* data0, const uint8_t* data1, const uint8_t* data2, const uint8_t* data3,
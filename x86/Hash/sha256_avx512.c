@@ -0,0 +1,211 @@
+// Sixteen lanes with AVX-512F whatever the build flags: native rotates
+// (vprord) and three-input logic (vpternlogd) where the AVX2 kernel needs
+// shift/or pairs and two-step boolean functions. Hash.c calls it only on
+// CPUs that have AVX-512F.
+#if defined(__clang__)
+#pragma clang attribute push(__attribute__((target("avx512f"))), apply_to = function)
+#elif defined(__GNUC__)
+#pragma GCC target("avx512f")
+// GCC 12's headers build the unmasked shifts and rotates from a
+// self-initialised _mm512_undefined_epi32() and warn about it (GCC PR 105593)
+#pragma GCC diagnostic ignored "-Wuninitialized"
+#endif
+
+#include "sha256_avx512.h"
+#include <immintrin.h>
+#include <string.h>
+#include <stdint.h>
+
+#ifdef _MSC_VER
+#define ALIGN64 __declspec(align(64))
+#else
+#define ALIGN64 __attribute__((aligned(64)))
+#endif
+
+// Initialize SHA-256 state with initial hash values
+void sha256_avx512_initialize(__m512i *s) {
+    const uint32_t init[8] = {
+        0x6a09e667,
+        0xbb67ae85,
+        0x3c6ef372,
+        0xa54ff53a,
+        0x510e527f,
+        0x9b05688c,
+        0x1f83d9ab,
+        0x5be0cd19
+    };
+
+    for (int i = 0; i < 8; ++i) {
+        s[i] = _mm512_set1_epi32(init[i]);
+    }
+}
+
+// SHA-256 macros using AVX-512 intrinsics. The ternary logic immediates are
+// the truth tables of the functions, first operand as the high bit.
+#define ROR(x, n)     _mm512_ror_epi32(x, n)
+#define SHR(x, n)     _mm512_srli_epi32(x, n)
+#define XOR3(x, y, z) _mm512_ternarylogic_epi32(x, y, z, 0x96)
+#define Ch(x, y, z)   _mm512_ternarylogic_epi32(x, y, z, 0xCA)
+#define Maj(x, y, z)  _mm512_ternarylogic_epi32(x, y, z, 0xE8)
+
+#define S0(x) XOR3(ROR(x, 2), ROR(x, 13), ROR(x, 22))
+#define S1(x) XOR3(ROR(x, 6), ROR(x, 11), ROR(x, 25))
+#define s0(x) XOR3(ROR(x, 7), ROR(x, 18), SHR(x, 3))
+#define s1(x) XOR3(ROR(x, 17), ROR(x, 19), SHR(x, 10))
+
+#define Round(a, b, c, d, e, f, g, h, Kt, Wt)                                    \
+    T1 = _mm512_add_epi32(_mm512_add_epi32(_mm512_add_epi32(_mm512_add_epi32(h, S1(e)), Ch(e, f, g)), Kt), Wt); \
+    T2 = _mm512_add_epi32(S0(a), Maj(a, b, c));                                  \
+    h = g;                                                                       \
+    g = f;                                                                       \
+    f = e;                                                                       \
+    e = _mm512_add_epi32(d, T1);                                                 \
+    d = c;                                                                       \
+    c = b;                                                                       \
+    b = a;                                                                       \
+    a = _mm512_add_epi32(T1, T2);
+
+static const uint32_t K[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5,
+    0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
+    0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc,
+    0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7,
+    0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
+    0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3,
+    0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5,
+    0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+    0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+void sha256_avx512_transform(__m512i *state, const uint8_t *blocks[16]) {
+    __m512i a, b, c, d, e, f, g, h;
+    __m512i W[64];
+    __m512i T1, T2;
+
+    a = state[0];
+    b = state[1];
+    c = state[2];
+    d = state[3];
+    e = state[4];
+    f = state[5];
+    g = state[6];
+    h = state[7];
+
+    // Message schedule W[0..15], word t of every lane (big-endian)
+    ALIGN64 uint32_t words[16][16];
+    for (int i = 0; i < 16; ++i) {
+        for (int t = 0; t < 16; ++t) {
+            uint32_t word;
+            memcpy(&word, blocks[i] + t * 4, 4);
+            words[t][i] = __builtin_bswap32(word);
+        }
+    }
+    for (int t = 0; t < 16; ++t) {
+        W[t] = _mm512_load_si512((const void *)words[t]);
+    }
+
+    // Message expansion W[16..63]
+    for (int t = 16; t < 64; ++t) {
+        W[t] = _mm512_add_epi32(
+                    _mm512_add_epi32(s1(W[t - 2]), W[t - 7]),
+                    _mm512_add_epi32(s0(W[t - 15]), W[t - 16]));
+    }
+
+    for (int t = 0; t < 64; ++t) {
+        __m512i Kt = _mm512_set1_epi32(K[t]);
+        Round(a, b, c, d, e, f, g, h, Kt, W[t]);
+    }
+
+    state[0] = _mm512_add_epi32(state[0], a);
+    state[1] = _mm512_add_epi32(state[1], b);
+    state[2] = _mm512_add_epi32(state[2], c);
+    state[3] = _mm512_add_epi32(state[3], d);
+    state[4] = _mm512_add_epi32(state[4], e);
+    state[5] = _mm512_add_epi32(state[5], f);
+    state[6] = _mm512_add_epi32(state[6], g);
+    state[7] = _mm512_add_epi32(state[7], h);
+}
+
+// Block j of a message after padding (0x80, zeros, the length in bits
+// big-endian at the end of its last block), built in place of copying the
+// whole message. Blocks past the last one are zeros.
+static void padded_block(const uint8_t *data, size_t length, size_t j, uint8_t block[64]) {
+    size_t offset = j * 64;
+    size_t n = length > offset ? length - offset : 0;
+    if (n > 64) {
+        n = 64;
+    }
+    if (n) {
+        memcpy(block, data + offset, n);
+    }
+    memset(block + n, 0, 64 - n);
+    if (length >= offset && length - offset < 64) {
+        block[length - offset] = 0x80;
+    }
+    if (((length + 8) / 64 + 1) * 64 == offset + 64) {
+        uint64_t bit_length = __builtin_bswap64((uint64_t)length * 8);
+        memcpy(block + 56, &bit_length, 8);
+    }
+}
+
+void sha256avx512_16(const uint8_t *data[16], const size_t lengths[16], uint8_t hashes[16][32]) {
+    __m512i state[8];
+    __m512i digest[8];
+    sha256_avx512_initialize(state);
+    for (int k = 0; k < 8; ++k) {
+        digest[k] = _mm512_setzero_si512();
+    }
+
+    // Blocks of each message once padded, and the most of any
+    size_t lane_blocks[16];
+    size_t max_blocks = 0;
+    for (int i = 0; i < 16; ++i) {
+        lane_blocks[i] = (lengths[i] + 8) / 64 + 1;
+        if (lane_blocks[i] > max_blocks) {
+            max_blocks = lane_blocks[i];
+        }
+    }
+
+    // A lane's digest is its state after its own last block, taken with a
+    // mask; the blocks of zeros it goes on hashing after that are ignored
+    ALIGN64 uint8_t buffers[16][64];
+    const uint8_t *block_ptrs[16];
+    for (int i = 0; i < 16; ++i) {
+        block_ptrs[i] = buffers[i];
+    }
+    for (size_t j = 0; j < max_blocks; ++j) {
+        __mmask16 ending = 0;
+        for (int i = 0; i < 16; ++i) {
+            padded_block(data[i], lengths[i], j, buffers[i]);
+            if (lane_blocks[i] == j + 1) {
+                ending |= (__mmask16)(1u << i);
+            }
+        }
+        sha256_avx512_transform(state, block_ptrs);
+        for (int k = 0; k < 8; ++k) {
+            digest[k] = _mm512_mask_mov_epi32(digest[k], ending, state[k]);
+        }
+    }
+
+    ALIGN64 uint32_t words[8][16]; // words[state_index][lane]
+    for (int k = 0; k < 8; ++k) {
+        _mm512_store_si512((void *)words[k], digest[k]);
+    }
+    for (int i = 0; i < 16; ++i) {
+        for (int k = 0; k < 8; ++k) {
+            uint32_t word = __builtin_bswap32(words[k][i]);
+            memcpy(hashes[i] + k * 4, &word, 4);
+        }
+    }
+}
+
+#if defined(__clang__)
+#pragma clang attribute pop
+#endif
@@ -0,0 +1,17 @@
+#ifndef SHA256_AVX512_H
+#define SHA256_AVX512_H
+
+#include <immintrin.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Initialize SHA-256 state with initial hash values, one message per lane
+void sha256_avx512_initialize(__m512i *s);
+
+// Transform function processes one block for each of 16 messages
+void sha256_avx512_transform(__m512i *state, const uint8_t *blocks[16]);
+
+// SHA-256 of 16 messages of arbitrary size, message i in lane i
+void sha256avx512_16(const uint8_t *data[16], const size_t lengths[16], uint8_t hashes[16][32]);
+
+#endif // SHA256_AVX512_H
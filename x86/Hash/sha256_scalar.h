@@ -0,0 +1,10 @@
+#ifndef SHA256_SCALAR_H
+#define SHA256_SCALAR_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// SHA-256 of one message, without vector instructions
+void sha256_scalar(const uint8_t *data, size_t length, uint8_t out[32]);
+
+#endif // SHA256_SCALAR_H
@@ -0,0 +1,184 @@
+// SHA-256 with the SHA extensions (Intel since Goldmont and Ice Lake, AMD
+// since Zen), in any build; Hash.c calls it only on CPUs that have them.
+// One message per stream rather than one per vector lane: each
+// sha256rnds2 does two rounds of one message, and two messages are
+// interleaved so the instructions of one hide the latency of the other's.
+#if defined(__clang__)
+#pragma clang attribute push(__attribute__((target("sha,sse4.1,ssse3"))), apply_to = function)
+#elif defined(__GNUC__)
+#pragma GCC target("sha,sse4.1,ssse3")
+#endif
+
+#include "sha256_shani.h"
+#include <immintrin.h>
+#include <string.h>
+#include <stdint.h>
+
+#ifdef _MSC_VER
+#define ALIGN16 __declspec(align(16))
+#else
+#define ALIGN16 __attribute__((aligned(16)))
+#endif
+
+static const uint32_t K[64] ALIGN16 = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5,
+    0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
+    0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc,
+    0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7,
+    0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
+    0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3,
+    0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5,
+    0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+    0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+// Byte order of each 32-bit word reversed: message and digest are big-endian
+#define BSWAP_MASK _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL)
+
+// Message words 4i..4i+3 from the 16 before them
+#define SCHEDULE(w, i) \
+    _mm_sha256msg2_epu32(_mm_add_epi32(_mm_sha256msg1_epu32(w[i - 4], w[i - 3]), \
+                                       _mm_alignr_epi8(w[i - 1], w[i - 2], 4)), w[i - 1])
+
+// Four rounds: two sha256rnds2, each taking two words of message plus constant
+#define ROUNDS4(abef, cdgh, w, i)                                                    \
+    msg = _mm_add_epi32(w[i], _mm_load_si128((const __m128i *)&K[4 * (i)]));     \
+    cdgh = _mm_sha256rnds2_epu32(cdgh, abef, msg);                              \
+    abef = _mm_sha256rnds2_epu32(abef, cdgh, _mm_shuffle_epi32(msg, 0x0E));
+
+void sha256_shani_transform(__m128i *abef, __m128i *cdgh, const uint8_t block[64]) {
+    const __m128i mask = BSWAP_MASK;
+    __m128i s0 = *abef;
+    __m128i s1 = *cdgh;
+    __m128i w[16];
+    __m128i msg;
+
+    for (int i = 0; i < 4; ++i) {
+        w[i] = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(block + 16 * i)), mask);
+    }
+    for (int i = 0; i < 16; ++i) {
+        if (i >= 4) {
+            w[i] = SCHEDULE(w, i);
+        }
+        ROUNDS4(s0, s1, w, i);
+    }
+
+    *abef = _mm_add_epi32(*abef, s0);
+    *cdgh = _mm_add_epi32(*cdgh, s1);
+}
+
+void sha256_shani_transform_2way(__m128i abef[2], __m128i cdgh[2], const uint8_t *blocks[2]) {
+    const __m128i mask = BSWAP_MASK;
+    __m128i x0 = abef[0], x1 = cdgh[0];
+    __m128i y0 = abef[1], y1 = cdgh[1];
+    __m128i wx[16], wy[16];
+    __m128i msg;
+
+    for (int i = 0; i < 4; ++i) {
+        wx[i] = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(blocks[0] + 16 * i)), mask);
+        wy[i] = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(blocks[1] + 16 * i)), mask);
+    }
+    for (int i = 0; i < 16; ++i) {
+        if (i >= 4) {
+            wx[i] = SCHEDULE(wx, i);
+            wy[i] = SCHEDULE(wy, i);
+        }
+        ROUNDS4(x0, x1, wx, i);
+        ROUNDS4(y0, y1, wy, i);
+    }
+
+    abef[0] = _mm_add_epi32(abef[0], x0);
+    cdgh[0] = _mm_add_epi32(cdgh[0], x1);
+    abef[1] = _mm_add_epi32(abef[1], y0);
+    cdgh[1] = _mm_add_epi32(cdgh[1], y1);
+}
+
+// The initial hash values as ABEF / CDGH
+static void initialize(__m128i *abef, __m128i *cdgh) {
+    *abef = _mm_set_epi32(0x6a09e667, 0xbb67ae85, 0x510e527f, 0x9b05688c);
+    *cdgh = _mm_set_epi32(0x3c6ef372, 0xa54ff53a, 0x1f83d9ab, 0x5be0cd19);
+}
+
+// ABEF / CDGH back to the state words a..h, stored big-endian
+static void store_digest(__m128i abef, __m128i cdgh, uint8_t out[32]) {
+    const __m128i mask = BSWAP_MASK;
+    __m128i feba = _mm_shuffle_epi32(abef, 0x1B);
+    __m128i dchg = _mm_shuffle_epi32(cdgh, 0xB1);
+    __m128i dcba = _mm_blend_epi16(feba, dchg, 0xF0);
+    __m128i hgfe = _mm_alignr_epi8(dchg, feba, 8);
+    _mm_storeu_si128((__m128i *)out, _mm_shuffle_epi8(dcba, mask));
+    _mm_storeu_si128((__m128i *)(out + 16), _mm_shuffle_epi8(hgfe, mask));
+}
+
+// Block j of a message after padding (0x80, zeros, the length in bits
+// big-endian at the end of its last block)
+static void padded_block(const uint8_t *data, size_t length, size_t j, uint8_t block[64]) {
+    size_t offset = j * 64;
+    size_t n = length > offset ? length - offset : 0;
+    if (n > 64) {
+        n = 64;
+    }
+    if (n) {
+        memcpy(block, data + offset, n);
+    }
+    memset(block + n, 0, 64 - n);
+    if (length >= offset && length - offset < 64) {
+        block[length - offset] = 0x80;
+    }
+    if (((length + 8) / 64 + 1) * 64 == offset + 64) {
+        uint64_t bit_length = __builtin_bswap64((uint64_t)length * 8);
+        memcpy(block + 56, &bit_length, 8);
+    }
+}
+
+// A message by itself, blocks from `first` on, from the state given
+static void finish_one(const uint8_t *data, size_t length, size_t first, __m128i abef, __m128i cdgh,
+                       uint8_t out[32]) {
+    uint8_t block[64];
+    size_t blocks = (length + 8) / 64 + 1;
+    for (size_t j = first; j < blocks; ++j) {
+        padded_block(data, length, j, block);
+        sha256_shani_transform(&abef, &cdgh, block);
+    }
+    store_digest(abef, cdgh, out);
+}
+
+void sha256shani_n(const uint8_t *data[], const size_t lengths[], uint8_t hashes[][32], int count) {
+    int i = 0;
+    for (; i + 1 < count; i += 2) {
+        __m128i abef[2], cdgh[2];
+        initialize(&abef[0], &cdgh[0]);
+        initialize(&abef[1], &cdgh[1]);
+
+        // Both streams for the blocks the two messages have, then the
+        // longer one alone (the pubkeys of a batch are all one length)
+        size_t blocks0 = (lengths[i] + 8) / 64 + 1;
+        size_t blocks1 = (lengths[i + 1] + 8) / 64 + 1;
+        size_t shared = blocks0 < blocks1 ? blocks0 : blocks1;
+        uint8_t buffers[2][64];
+        const uint8_t *block_ptrs[2] = {buffers[0], buffers[1]};
+        for (size_t j = 0; j < shared; ++j) {
+            padded_block(data[i], lengths[i], j, buffers[0]);
+            padded_block(data[i + 1], lengths[i + 1], j, buffers[1]);
+            sha256_shani_transform_2way(abef, cdgh, block_ptrs);
+        }
+        finish_one(data[i], lengths[i], shared, abef[0], cdgh[0], hashes[i]);
+        finish_one(data[i + 1], lengths[i + 1], shared, abef[1], cdgh[1], hashes[i + 1]);
+    }
+    if (i < count) {
+        __m128i abef, cdgh;
+        initialize(&abef, &cdgh);
+        finish_one(data[i], lengths[i], 0, abef, cdgh, hashes[i]);
+    }
+}
+
+#if defined(__clang__)
+#pragma clang attribute pop
+#endif
@@ -0,0 +1,19 @@
+#ifndef SHA256_SHANI_H
+#define SHA256_SHANI_H
+
+#include <immintrin.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// One block of one message; the state is kept as the ABEF / CDGH register
+// pair the SHA instructions work on
+void sha256_shani_transform(__m128i *abef, __m128i *cdgh, const uint8_t block[64]);
+
+// One block of each of two independent messages, interleaved so that each
+// stream's rounds fill the other's latency
+void sha256_shani_transform_2way(__m128i abef[2], __m128i cdgh[2], const uint8_t *blocks[2]);
+
+// SHA-256 of `count` messages of arbitrary size, two at a time
+void sha256shani_n(const uint8_t *data[], const size_t lengths[], uint8_t hashes[][32], int count);
+
+#endif // SHA256_SHANI_H
@@ -0,0 +1,622 @@
+#include "Journal.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define JOURNAL_MAGIC 0x314C4E524A4B4342ULL  // "BCKJRNL1"
+#define SNAPSHOT_MAGIC 0x31504E53504B4342ULL // "BCKPSNP1"
+#define DIGESTS_MAGIC 0x3147494450434B42ULL  // "BKCPDIG1"
+#define JOURNAL_VERSION 2
+
+// Fold the journal into the snapshot after this many completions (32 MiB of records)
+static const size_t SNAPSHOT_RECORDS = 1 << 20;
+// Write out early when this many records are queued
+static const size_t MAX_QUEUED = 4096;
+
+struct FileHeader {
+  uint64_t magic;
+  uint32_t version;
+  uint32_t record_size;
+  uint64_t job_hash;
+  uint64_t total;
+  uint64_t count; // snapshot: number of (word, bits) pairs
+  uint64_t reserved[3];
+};
+
+static_assert(sizeof(FileHeader) == 64, "journal header must stay 64 bytes");
+static_assert(sizeof(JournalRecord) == 48, "journal records must stay 48 bytes");
+
+// Entry of `<path>.digests`
+struct DigestEntry {
+  uint64_t idx;
+  uint64_t x;
+  uint64_t sum;
+};
+
+static uint64_t fnv1a(const std::string &s) {
+  uint64_t h = 0xCBF29CE484222325ULL;
+  for (unsigned char c : s) {
+    h ^= c;
+    h *= 0x100000001B3ULL;
+  }
+  return h;
+}
+
+static uint32_t crc32(const void *data, size_t len) {
+  static uint32_t table[256];
+  static bool ready = [] {
+    for (uint32_t i = 0; i < 256; i++) {
+      uint32_t c = i;
+      for (int k = 0; k < 8; k++) c = (c & 1) ? 0xEDB88320U ^ (c >> 1) : c >> 1;
+      table[i] = c;
+    }
+    return true;
+  }();
+  (void)ready;
+  uint32_t crc = 0xFFFFFFFFU;
+  const uint8_t *p = (const uint8_t *)data;
+  for (size_t i = 0; i < len; i++) {
+    crc = table[(crc ^ p[i]) & 0xFF] ^ (crc >> 8);
+  }
+  return crc ^ 0xFFFFFFFFU;
+}
+
+static uint32_t record_crc(JournalRecord record) {
+  record.crc = 0;
+  return crc32(&record, sizeof(record));
+}
+
+static bool read_full(int fd, void *buf, size_t len) {
+  uint8_t *p = (uint8_t *)buf;
+  while (len > 0) {
+    ssize_t n = read(fd, p, len);
+    if (n <= 0) {
+      return false;
+    }
+    p += n;
+    len -= (size_t)n;
+  }
+  return true;
+}
+
+static bool write_full(int fd, const void *buf, size_t len) {
+  const uint8_t *p = (const uint8_t *)buf;
+  while (len > 0) {
+    ssize_t n = write(fd, p, len);
+    if (n <= 0) {
+      return false;
+    }
+    p += n;
+    len -= (size_t)n;
+  }
+  return true;
+}
+
+static FileHeader make_header(uint64_t magic, uint32_t record_size, uint64_t job_hash, uint64_t total) {
+  FileHeader header;
+  memset(&header, 0, sizeof(header));
+  header.magic = magic;
+  header.version = JOURNAL_VERSION;
+  header.record_size = record_size;
+  header.job_hash = job_hash;
+  header.total = total;
+  return header;
+}
+
+static bool header_matches(const FileHeader &header, uint64_t magic, uint32_t record_size,
+                           uint64_t job_hash, uint64_t total) {
+  return header.magic == magic && header.version == JOURNAL_VERSION &&
+         header.record_size == record_size && header.job_hash == job_hash && header.total == total;
+}
+
+// Open a snapshot and check it belongs to the job. Returns the fd, -1 if there
+// is none, -2 if it belongs to another job.
+static int open_snapshot(const std::string &path, uint64_t job_hash, uint64_t total, FileHeader &header) {
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return -1;
+  }
+  if (!read_full(fd, &header, sizeof(header)) ||
+      !header_matches(header, SNAPSHOT_MAGIC, 16, job_hash, total)) {
+    close(fd);
+    return -2;
+  }
+  return fd;
+}
+
+// Read valid records from the current position up to the first torn or corrupt one.
+// Returns the number of valid records.
+static uint64_t replay(int fd, uint64_t total, const std::function<void(uint64_t)> &on_complete,
+                       std::map<uint64_t, JournalRecord> &partials) {
+  std::vector<JournalRecord> block(4096);
+  uint64_t valid = 0;
+  for (;;) {
+    ssize_t n = read(fd, block.data(), block.size() * sizeof(JournalRecord));
+    if (n <= 0) {
+      return valid;
+    }
+    size_t records = (size_t)n / sizeof(JournalRecord);
+    for (size_t i = 0; i < records; i++) {
+      const JournalRecord &record = block[i];
+      if (record.crc != record_crc(record)) {
+        return valid;
+      }
+      if (record.idx < total && record.type == JOURNAL_COMPLETE) {
+        on_complete(record.idx);
+        partials.erase(record.idx);
+      } else if (record.idx < total && record.type == JOURNAL_PARTIAL) {
+        partials[record.idx] = record;
+      }
+      valid++;
+    }
+    if ((size_t)n % sizeof(JournalRecord) != 0) {
+      return valid; // torn last record
+    }
+  }
+}
+
+CheckpointJournal::~CheckpointJournal() {
+  Close();
+}
+
+bool CheckpointJournal::Load(const std::string &path, const std::string &job_key, uint64_t total,
+                             std::vector<uint64_t> &completed, std::vector<JournalPartial> &partial) {
+  return Load(path, job_key, total, [&completed](uint64_t idx) { completed.push_back(idx); }, partial);
+}
+
+bool CheckpointJournal::IsJournal(const std::string &path) {
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return false;
+  }
+  uint64_t magic = 0;
+  bool journal = read_full(fd, &magic, sizeof(magic)) && magic == JOURNAL_MAGIC;
+  close(fd);
+  return journal;
+}
+
+// The snapshot of `path` as (word, bits) pairs to `on_word`, bits past
+// `total` cleared, then the journal's completions to `on_complete`
+static bool load_files(const std::string &path, const std::string &job_key, uint64_t total,
+                       const std::function<void(uint64_t, uint64_t)> &on_word,
+                       const std::function<void(uint64_t)> &on_complete, std::vector<JournalPartial> &partial) {
+  uint64_t job_hash = fnv1a(job_key);
+
+  FileHeader header;
+  int snap = open_snapshot(path + ".snap", job_hash, total, header);
+  if (snap == -2) {
+    return false;
+  }
+  if (snap >= 0) {
+    std::vector<uint64_t> block(8192);
+    uint64_t left = header.count;
+    while (left > 0) {
+      size_t pairs = (size_t)std::min<uint64_t>(left, block.size() / 2);
+      if (!read_full(snap, block.data(), pairs * 16)) {
+        break;
+      }
+      for (size_t i = 0; i < pairs; i++) {
+        uint64_t word = block[2 * i], bits = block[2 * i + 1];
+        if (word >= (total + 63) / 64) {
+          continue;
+        }
+        if (word == total / 64) {
+          bits &= (1ULL << (total % 64)) - 1;
+        }
+        if (bits) {
+          on_word(word, bits);
+        }
+      }
+      left -= pairs;
+    }
+    close(snap);
+  }
+
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return true;
+  }
+  bool ok = read_full(fd, &header, sizeof(header)) &&
+            header_matches(header, JOURNAL_MAGIC, sizeof(JournalRecord), job_hash, total);
+  if (ok) {
+    std::map<uint64_t, JournalRecord> partials;
+    replay(fd, total, on_complete, partials);
+    for (auto &entry : partials) {
+      ChunkDigest digest;
+      digest.x = entry.second.digest_x;
+      digest.sum = entry.second.digest_sum;
+      partial.push_back({entry.first, entry.second.value, entry.second.aux, digest});
+    }
+  }
+  close(fd);
+  return ok;
+}
+
+bool CheckpointJournal::Load(const std::string &path, const std::string &job_key, uint64_t total,
+                             const std::function<void(uint64_t)> &on_complete,
+                             std::vector<JournalPartial> &partial) {
+  auto expand = [&on_complete](uint64_t word, uint64_t bits) {
+    for (; bits; bits &= bits - 1) {
+      on_complete(word * 64 + (uint64_t)__builtin_ctzll(bits));
+    }
+  };
+  return load_files(path, job_key, total, expand, on_complete, partial);
+}
+
+bool CheckpointJournal::Load(const std::string &path, const std::string &job_key, uint64_t total,
+                             std::vector<uint64_t> &words, std::vector<uint64_t> &completed,
+                             std::vector<JournalPartial> &partial) {
+  auto keep = [&words](uint64_t word, uint64_t bits) {
+    words.push_back(word);
+    words.push_back(bits);
+  };
+  return load_files(path, job_key, total, keep, [&completed](uint64_t idx) { completed.push_back(idx); },
+                    partial);
+}
+
+bool CheckpointJournal::Open(const std::string &journal_path, const std::string &job_key,
+                             uint64_t job_total, int sync_ms) {
+  std::lock_guard<std::mutex> lock(mtx);
+  path = journal_path;
+  job_hash = fnv1a(job_key);
+  total = job_total;
+  fsync_ms = sync_ms;
+  last_sync = std::chrono::steady_clock::now();
+
+  FileHeader header;
+  int snap = open_snapshot(path + ".snap", job_hash, total, header);
+  if (snap == -2) {
+    return false;
+  }
+  if (snap >= 0) {
+    close(snap);
+  }
+
+  fd = open(path.c_str(), O_RDWR | O_CREAT, 0644);
+  if (fd < 0) {
+    return false;
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    close(fd);
+    fd = -1;
+    return false;
+  }
+  if (st.st_size == 0) {
+    header = make_header(JOURNAL_MAGIC, sizeof(JournalRecord), job_hash, total);
+    if (!write_full(fd, &header, sizeof(header)) || fdatasync(fd) != 0) {
+      close(fd);
+      fd = -1;
+      return false;
+    }
+    return true;
+  }
+
+  if (!read_full(fd, &header, sizeof(header)) ||
+      !header_matches(header, JOURNAL_MAGIC, sizeof(JournalRecord), job_hash, total)) {
+    close(fd);
+    fd = -1;
+    return false;
+  }
+  // Drop a torn tail so new records follow the last good one; what is already
+  // in the journal goes into the next snapshot
+  uint64_t valid = replay(fd, total, [this](uint64_t idx) { unsnapshotted.push_back(idx); }, partials);
+  off_t end = (off_t)(sizeof(header) + valid * sizeof(JournalRecord));
+  if (ftruncate(fd, end) != 0 || lseek(fd, end, SEEK_SET) != end) {
+    close(fd);
+    fd = -1;
+    return false;
+  }
+  return true;
+}
+
+void CheckpointJournal::Append(const JournalRecord &record) {
+  JournalRecord r = record;
+  r.crc = record_crc(r);
+
+  std::lock_guard<std::mutex> lock(mtx);
+  if (fd < 0) {
+    return;
+  }
+  queued.push_back(r);
+  if (r.type == JOURNAL_COMPLETE) {
+    unsnapshotted.push_back(r.idx);
+    partials.erase(r.idx);
+  } else if (r.type == JOURNAL_PARTIAL) {
+    partials[r.idx] = r;
+  }
+  if (fsync_ms == 0 || queued.size() >= MAX_QUEUED ||
+      std::chrono::steady_clock::now() - last_sync >= std::chrono::milliseconds(fsync_ms)) {
+    FlushLocked();
+  }
+  // Nobody calls Tick (the coordinator); keep the journal bounded anyway
+  if (unsnapshotted.size() >= 2 * SNAPSHOT_RECORDS) {
+    SnapshotLocked();
+  }
+}
+
+void CheckpointJournal::Complete(uint64_t idx, const ChunkDigest &digest) {
+  JournalRecord record;
+  memset(&record, 0, sizeof(record));
+  record.type = JOURNAL_COMPLETE;
+  record.idx = idx;
+  record.digest_x = digest.x;
+  record.digest_sum = digest.sum;
+  Append(record);
+}
+
+void CheckpointJournal::Partial(const JournalPartial &partial) {
+  JournalRecord record;
+  memset(&record, 0, sizeof(record));
+  record.type = JOURNAL_PARTIAL;
+  record.idx = partial.idx;
+  record.value = partial.offset_lo;
+  record.aux = partial.offset_hi;
+  record.digest_x = partial.digest.x;
+  record.digest_sum = partial.digest.sum;
+  Append(record);
+}
+
+bool CheckpointJournal::FlushLocked() {
+  last_sync = std::chrono::steady_clock::now();
+  if (queued.empty()) {
+    return true;
+  }
+  auto began = std::chrono::steady_clock::now();
+  bool ok = write_full(fd, queued.data(), queued.size() * sizeof(JournalRecord)) && fdatasync(fd) == 0;
+  if (on_sync) {
+    on_sync(std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - began).count());
+  }
+  if (ok) {
+    queued.clear();
+  } else {
+    perror("[!] Checkpoint journal write failed");
+  }
+  return ok;
+}
+
+void CheckpointJournal::Flush() {
+  std::lock_guard<std::mutex> lock(mtx);
+  if (fd >= 0) {
+    FlushLocked();
+  }
+}
+
+void CheckpointJournal::Tick() {
+  std::lock_guard<std::mutex> lock(mtx);
+  if (fd < 0) {
+    return;
+  }
+  if (!queued.empty() &&
+      std::chrono::steady_clock::now() - last_sync >= std::chrono::milliseconds(fsync_ms)) {
+    FlushLocked();
+  }
+  if (unsnapshotted.size() >= SNAPSHOT_RECORDS) {
+    SnapshotLocked();
+  }
+}
+
+// Merge the sorted completions since the last snapshot into a new snapshot
+// file, streaming the old one, then truncate the journal. Completions wait on
+// the mutex meanwhile; this happens once per SNAPSHOT_RECORDS of them.
+bool CheckpointJournal::SnapshotLocked() {
+  if (!FlushLocked()) {
+    return false;
+  }
+  if (unsnapshotted.empty()) {
+    return true;
+  }
+
+  std::sort(unsnapshotted.begin(), unsnapshotted.end());
+  std::vector<std::pair<uint64_t, uint64_t>> fresh; // (word, bits)
+  for (uint64_t idx : unsnapshotted) {
+    if (fresh.empty() || fresh.back().first != idx / 64) {
+      fresh.push_back({idx / 64, 0});
+    }
+    fresh.back().second |= 1ULL << (idx % 64);
+  }
+
+  std::string snap_path = path + ".snap";
+  std::string tmp_path = snap_path + ".tmp";
+  FileHeader header;
+  int old = open_snapshot(snap_path, job_hash, total, header);
+  uint64_t old_left = old >= 0 ? header.count : 0;
+  int out = open(tmp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (out < 0) {
+    if (old >= 0) close(old);
+    return false;
+  }
+
+  FileHeader out_header = make_header(SNAPSHOT_MAGIC, 16, job_hash, total);
+  bool ok = write_full(out, &out_header, sizeof(out_header));
+  std::vector<uint64_t> in_block, out_block;
+  size_t in_pos = 0;
+  auto next_old = [&](uint64_t &word, uint64_t &bits) {
+    if (in_pos == in_block.size()) {
+      if (old_left == 0) return false;
+      size_t pairs = (size_t)std::min<uint64_t>(old_left, 4096);
+      in_block.resize(pairs * 2);
+      if (!read_full(old, in_block.data(), pairs * 16)) return false;
+      old_left -= pairs;
+      in_pos = 0;
+    }
+    word = in_block[in_pos];
+    bits = in_block[in_pos + 1];
+    in_pos += 2;
+    return true;
+  };
+  auto emit = [&](uint64_t word, uint64_t bits) {
+    out_block.push_back(word);
+    out_block.push_back(bits);
+    out_header.count++;
+    if (out_block.size() >= 8192) {
+      ok = ok && write_full(out, out_block.data(), out_block.size() * 8);
+      out_block.clear();
+    }
+  };
+
+  uint64_t word = 0, bits = 0;
+  bool have_old = old >= 0 && next_old(word, bits);
+  size_t f = 0;
+  while (have_old || f < fresh.size()) {
+    if (have_old && (f == fresh.size() || word < fresh[f].first)) {
+      emit(word, bits);
+      have_old = next_old(word, bits);
+    } else if (have_old && word == fresh[f].first) {
+      emit(word, bits | fresh[f].second);
+      f++;
+      have_old = next_old(word, bits);
+    } else {
+      emit(fresh[f].first, fresh[f].second);
+      f++;
+    }
+  }
+  ok = ok && write_full(out, out_block.data(), out_block.size() * 8);
+  ok = ok && pwrite(out, &out_header, sizeof(out_header), 0) == (ssize_t)sizeof(out_header);
+  ok = ok && fsync(out) == 0;
+  close(out);
+  if (old >= 0) close(old);
+  if (!ok || rename(tmp_path.c_str(), snap_path.c_str()) != 0) {
+    unlink(tmp_path.c_str());
+    perror("[!] Checkpoint snapshot failed");
+    return false;
+  }
+
+  if (!SaveDigestsLocked()) {
+    perror("[!] Saving chunk digests failed");
+    return false;
+  }
+
+  // Records up to here are in the snapshot. A crash before the truncate only
+  // replays them again, which is harmless.
+  off_t end = (off_t)sizeof(FileHeader);
+  if (ftruncate(fd, end) != 0 || lseek(fd, end, SEEK_SET) != end || fdatasync(fd) != 0) {
+    perror("[!] Checkpoint journal truncate failed");
+    return false;
+  }
+  unsnapshotted.clear();
+  // The snapshot only holds completions; interrupted chunks start the new journal
+  for (auto &entry : partials) {
+    queued.push_back(entry.second);
+  }
+  return FlushLocked();
+}
+
+// Append the digests of the completions in the journal to `<path>.digests`
+bool CheckpointJournal::SaveDigestsLocked() {
+  std::string digests_path = path + ".digests";
+  int out = open(digests_path.c_str(), O_RDWR | O_CREAT | O_APPEND, 0644);
+  if (out < 0) {
+    return false;
+  }
+  FileHeader header;
+  bool ok;
+  if (lseek(out, 0, SEEK_END) == 0) {
+    header = make_header(DIGESTS_MAGIC, sizeof(DigestEntry), job_hash, total);
+    ok = write_full(out, &header, sizeof(header));
+  } else {
+    ok = pread(out, &header, sizeof(header), 0) == (ssize_t)sizeof(header) &&
+         header_matches(header, DIGESTS_MAGIC, sizeof(DigestEntry), job_hash, total);
+  }
+
+  std::vector<JournalRecord> block(4096);
+  std::vector<DigestEntry> entries;
+  off_t offset = sizeof(FileHeader);
+  for (;;) {
+    ssize_t n = ok ? pread(fd, block.data(), block.size() * sizeof(JournalRecord), offset) : 0;
+    if (n <= 0) {
+      break;
+    }
+    size_t records = (size_t)n / sizeof(JournalRecord);
+    entries.clear();
+    for (size_t i = 0; i < records; i++) {
+      const JournalRecord &record = block[i];
+      if (record.type == JOURNAL_COMPLETE && (record.digest_x | record.digest_sum) != 0) {
+        entries.push_back({record.idx, record.digest_x, record.digest_sum});
+      }
+    }
+    ok = write_full(out, entries.data(), entries.size() * sizeof(DigestEntry));
+    offset += (off_t)(records * sizeof(JournalRecord));
+    if (records < block.size()) {
+      break;
+    }
+  }
+  ok = ok && fdatasync(out) == 0;
+  close(out);
+  return ok;
+}
+
+bool CheckpointJournal::LoadDigests(const std::string &path, const std::string &job_key, uint64_t total,
+                                    const std::function<void(uint64_t, const ChunkDigest &)> &on_digest) {
+  uint64_t job_hash = fnv1a(job_key);
+  FileHeader header;
+
+  int fd = open((path + ".digests").c_str(), O_RDONLY);
+  if (fd >= 0) {
+    if (!read_full(fd, &header, sizeof(header)) ||
+        !header_matches(header, DIGESTS_MAGIC, sizeof(DigestEntry), job_hash, total)) {
+      close(fd);
+      return false;
+    }
+    std::vector<DigestEntry> block(4096);
+    ssize_t n;
+    while ((n = read(fd, block.data(), block.size() * sizeof(DigestEntry))) > 0) {
+      for (size_t i = 0; i < (size_t)n / sizeof(DigestEntry); i++) {
+        ChunkDigest digest;
+        digest.x = block[i].x;
+        digest.sum = block[i].sum;
+        if (block[i].idx < total) on_digest(block[i].idx, digest);
+      }
+    }
+    close(fd);
+  }
+
+  fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return true;
+  }
+  bool ok = read_full(fd, &header, sizeof(header)) &&
+            header_matches(header, JOURNAL_MAGIC, sizeof(JournalRecord), job_hash, total);
+  std::vector<JournalRecord> block(4096);
+  ssize_t n;
+  while (ok && (n = read(fd, block.data(), block.size() * sizeof(JournalRecord))) > 0) {
+    for (size_t i = 0; i < (size_t)n / sizeof(JournalRecord); i++) {
+      const JournalRecord &record = block[i];
+      if (record.crc != record_crc(record)) {
+        close(fd);
+        return true;
+      }
+      ChunkDigest digest;
+      digest.x = record.digest_x;
+      digest.sum = record.digest_sum;
+      if (record.type == JOURNAL_COMPLETE && record.idx < total && !digest.IsEmpty()) {
+        on_digest(record.idx, digest);
+      }
+    }
+  }
+  close(fd);
+  return ok;
+}
+
+bool CheckpointJournal::Snapshot() {
+  std::lock_guard<std::mutex> lock(mtx);
+  return fd >= 0 && SnapshotLocked();
+}
+
+void CheckpointJournal::Close() {
+  std::lock_guard<std::mutex> lock(mtx);
+  if (fd < 0) {
+    return;
+  }
+  SnapshotLocked();
+  close(fd);
+  fd = -1;
+  queued.clear();
+  unsnapshotted.clear();
+  partials.clear();
+}
@@ -0,0 +1,197 @@
+#include "Metrics.h"
+#include "Net.h"
+
+#include <cmath>
+#include <cstdio>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+LatencyHistogram::LatencyHistogram() {
+  for (int i = 0; i < BUCKETS; i++) {
+    buckets[i] = 0;
+  }
+}
+
+// Values below 2^SUB_BITS get a bucket each; above, the top SUB_BITS bits
+// after the leading one pick the bucket within the power of two.
+int LatencyHistogram::BucketOf(uint64_t micros) {
+  if (micros < (1u << SUB_BITS)) {
+    return (int)micros;
+  }
+  int log2 = 63 - __builtin_clzll(micros);
+  int sub = (int)(micros >> (log2 - SUB_BITS)) & ((1 << SUB_BITS) - 1);
+  return ((log2 - SUB_BITS + 1) << SUB_BITS) + sub;
+}
+
+uint64_t LatencyHistogram::BucketLimit(int bucket) {
+  if (bucket < (1 << SUB_BITS)) {
+    return (uint64_t)bucket;
+  }
+  int log2 = (bucket >> SUB_BITS) + SUB_BITS - 1;
+  uint64_t sub = (uint64_t)(bucket & ((1 << SUB_BITS) - 1));
+  uint64_t width = 1ULL << (log2 - SUB_BITS);
+  return (1ULL << log2) + (sub + 1) * width - 1;
+}
+
+void LatencyHistogram::Record(uint64_t micros) {
+  buckets[BucketOf(micros)].fetch_add(1, std::memory_order_relaxed);
+  count.fetch_add(1, std::memory_order_relaxed);
+  sum_us.fetch_add(micros, std::memory_order_relaxed);
+}
+
+uint64_t LatencyHistogram::Percentile(double p) const {
+  uint64_t total = 0;
+  uint64_t counts[BUCKETS];
+  for (int i = 0; i < BUCKETS; i++) {
+    counts[i] = buckets[i].load(std::memory_order_relaxed);
+    total += counts[i];
+  }
+  if (total == 0) {
+    return 0;
+  }
+  uint64_t rank = (uint64_t)std::ceil(total * p / 100);
+  if (rank == 0) {
+    rank = 1;
+  }
+  uint64_t seen = 0;
+  for (int i = 0; i < BUCKETS; i++) {
+    seen += counts[i];
+    if (seen >= rank) {
+      return BucketLimit(i);
+    }
+  }
+  return BucketLimit(BUCKETS - 1);
+}
+
+void LatencyHistogram::Write(std::string &out, const std::string &name, const std::string &labels,
+                             int min_log2, int max_log2) const {
+  std::string prefix = labels.empty() ? "" : labels + ",";
+  char line[256];
+  uint64_t cumulative = 0;
+  int next = 0;
+  for (int log2 = min_log2; log2 <= max_log2; log2++) {
+    // Bucket boundaries fall on powers of two, so the counts below 2^log2 are exact
+    int end = BucketOf(1ULL << log2);
+    for (; next < end; next++) {
+      cumulative += buckets[next].load(std::memory_order_relaxed);
+    }
+    snprintf(line, sizeof(line), "%s_bucket{%sle=\"%g\"} %llu\n", name.c_str(), prefix.c_str(),
+             (double)(1ULL << log2) / 1e6, (unsigned long long)cumulative);
+    out += line;
+  }
+  uint64_t total = Count();
+  snprintf(line, sizeof(line), "%s_bucket{%sle=\"+Inf\"} %llu\n", name.c_str(), prefix.c_str(),
+           (unsigned long long)total);
+  out += line;
+  std::string braces = labels.empty() ? "" : "{" + labels + "}";
+  snprintf(line, sizeof(line), "%s_sum%s %.6f\n%s_count%s %llu\n", name.c_str(), braces.c_str(),
+           sum_us.load(std::memory_order_relaxed) / 1e6, name.c_str(), braces.c_str(),
+           (unsigned long long)total);
+  out += line;
+}
+
+void MetricsText::Family(const std::string &name, const char *type, const std::string &help) {
+  out += "# HELP " + name + " " + help + "\n# TYPE " + name + " " + type + "\n";
+}
+
+void MetricsText::Sample(const std::string &name, const std::string &labels, double value) {
+  char num[64];
+  snprintf(num, sizeof(num), "%.17g", value);
+  out += name;
+  if (!labels.empty()) {
+    out += "{" + labels + "}";
+  }
+  out += " ";
+  out += num;
+  out += "\n";
+}
+
+std::string metric_label(const std::string &name, const std::string &value) {
+  std::string escaped;
+  for (char c : value) {
+    if (c == '\\' || c == '"') {
+      escaped += '\\';
+      escaped += c;
+    } else if (c == '\n') {
+      escaped += "\\n";
+    } else {
+      escaped += c;
+    }
+  }
+  return name + "=\"" + escaped + "\"";
+}
+
+static bool send_all(int fd, const std::string &data) {
+  size_t sent = 0;
+  while (sent < data.size()) {
+    ssize_t n = send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+    if (n <= 0) {
+      return false;
+    }
+    sent += (size_t)n;
+  }
+  return true;
+}
+
+bool ServeMetrics(const std::string &addr, const std::atomic<bool> &stop,
+                  const std::function<std::string()> &render) {
+  int listen_fd = Net::listen_on(addr);
+  if (listen_fd < 0) {
+    return false;
+  }
+
+  while (!stop) {
+    pollfd pfd = {listen_fd, POLLIN, 0};
+    if (poll(&pfd, 1, 250) <= 0) {
+      continue;
+    }
+    int fd = accept(listen_fd, nullptr, nullptr);
+    if (fd < 0) {
+      continue;
+    }
+    // One scrape at a time; a client that goes quiet is dropped
+    timeval timeout = {5, 0};
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    std::string request;
+    char buf[1024];
+    while (request.find("\r\n\r\n") == std::string::npos && request.size() < 8192) {
+      ssize_t n = recv(fd, buf, sizeof(buf), 0);
+      if (n <= 0) {
+        break;
+      }
+      request.append(buf, (size_t)n);
+    }
+    if (request.compare(0, 4, "GET ") == 0) {
+      std::string body = render();
+      send_all(fd, "HTTP/1.0 200 OK\r\n"
+                   "Content-Type: text/plain; version=0.0.4\r\n"
+                   "Content-Length: " + std::to_string(body.size()) + "\r\n"
+                   "Connection: close\r\n\r\n" + body);
+    } else if (!request.empty()) {
+      send_all(fd, "HTTP/1.0 405 Method Not Allowed\r\nContent-Length: 0\r\nConnection: close\r\n\r\n");
+    }
+    close(fd);
+  }
+  close(listen_fd);
+  if (addr.compare(0, 5, "unix:") == 0) {
+    unlink(addr.substr(5).c_str());
+  }
+  return true;
+}
+
+bool WriteMetricsFile(const std::string &path, const std::string &text) {
+  std::string temp = path + ".tmp";
+  FILE *file = fopen(temp.c_str(), "w");
+  if (!file) {
+    return false;
+  }
+  bool ok = fwrite(text.data(), 1, text.size(), file) == text.size();
+  ok = fclose(file) == 0 && ok;
+  if (!ok || rename(temp.c_str(), path.c_str()) != 0) {
+    unlink(temp.c_str());
+    return false;
+  }
+  return true;
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <stdint.h>
+#include <string>
+
+/*---------------------------------------------------------------
+    Prometheus text exposition (format 0.0.4).
+
+    Served over HTTP by ServeMetrics (any GET returns the metrics),
+    or written to a file by WriteMetricsFile for a textfile
+    collector. The caller renders the whole page on each request
+    from its own counters; nothing here keeps global state.
+  --------------------------------------------------------------*/
+
+// Log-linear (HDR style) histogram of durations in microseconds: every
+// power of two is split into 4 buckets, so any value is placed within 25%
+// from a microsecond up to years. Recording is lock free.
+class LatencyHistogram {
+
+public:
+
+  LatencyHistogram();
+
+  void Record(uint64_t micros);
+
+  uint64_t Count() const { return count.load(std::memory_order_relaxed); }
+
+  // Upper bound of the bucket holding the p-th percentile (0 < p <= 100), 0 when empty
+  uint64_t Percentile(double p) const;
+
+  // Cumulative `le` buckets in seconds at every power of two of microseconds
+  // from 2^min_log2 to 2^max_log2, then +Inf, _sum and _count.
+  void Write(std::string &out, const std::string &name, const std::string &labels,
+             int min_log2 = 6, int max_log2 = 36) const;
+
+  static const int SUB_BITS = 2;
+  static const int BUCKETS = (64 - SUB_BITS + 1) << SUB_BITS;
+
+  static int BucketOf(uint64_t micros);
+  static uint64_t BucketLimit(int bucket); // largest value in the bucket
+
+private:
+
+  std::atomic<uint64_t> buckets[BUCKETS];
+  std::atomic<uint64_t> count{0};
+  std::atomic<uint64_t> sum_us{0};
+
+};
+
+// Builds an exposition page. Call Family once per metric name, then add its samples.
+class MetricsText {
+
+public:
+
+  // type: counter, gauge or histogram
+  void Family(const std::string &name, const char *type, const std::string &help);
+  void Sample(const std::string &name, const std::string &labels, double value);
+
+  std::string &Text() { return out; }
+
+private:
+
+  std::string out;
+
+};
+
+// `name="value"` with the value escaped
+std::string metric_label(const std::string &name, const std::string &value);
+
+// Answer HTTP requests on `addr` (see Net::listen_on) with render() until
+// `stop` is set. Bind to 127.0.0.1:<port> to keep it local. Returns false if
+// the address could not be bound.
+bool ServeMetrics(const std::string &addr, const std::atomic<bool> &stop,
+                  const std::function<std::string()> &render);
+
+// Replace `path` with `text` atomically (write a temporary file and rename)
+bool WriteMetricsFile(const std::string &path, const std::string &text);
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <string>
+
+namespace Net {
+
+// Addresses are either "unix:/path/to.sock" or "host:port" (TCP).
+// For listening, an empty host ("":port) binds to all interfaces.
+
+// Returns a listening socket or -1.
+int listen_on(const std::string &addr);
+
+// Returns a connected socket or -1.
+int connect_to(const std::string &addr);
+
+/*---------------------------------------------------------------
+    Newline-delimited text messages over a stream socket
+  --------------------------------------------------------------*/
+class LineConn {
+
+public:
+
+  explicit LineConn(int fd = -1) : fd(fd) {}
+
+  bool ReadLine(std::string &line);
+  bool WriteLine(const std::string &line);
+  void Close();
+  int Fd() const { return fd; }
+
+private:
+
+  int fd;
+  std::string buf;
+
+};
+
+} // namespace Net
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <stdint.h>
+#include <string>
+#include <unordered_set>
+
+#include "Address.h"
+#include "ChunkDigest.hpp"
+#include "Profiler.h"
+#include "TargetFilter.h"
+#include "config.h"
+#include "include/secp256k1.h"
+
+/*---------------------------------------------------------------
+    The scan engine: walk the public keys of a key interval in
+    batches of SCAN_BATCH, hash both encodings of each and look them
+    up in the targets, folding every hash into the interval's digest.
+
+    A batch is the SCAN_BATCH keys from its first one, or fewer when the
+    interval ends inside it: keys past the end belong to the next
+    range and are neither checked, folded nor counted.
+  --------------------------------------------------------------*/
+
+// Throughput of one worker (or one EC/hash pair), written by its own threads
+// and only read by the others. Padded so neighbouring workers never share a
+// cache line: counting keys stays in the worker's own cache instead of
+// bouncing one shared counter between every core.
+struct alignas(64) WorkerStats {
+  std::atomic<uint64_t> keys{0};    // keys of finished ranges
+  std::atomic<uint64_t> busy_us{0}; // time spent scanning those keys
+  std::atomic<uint64_t> scanned{0}; // every key scanned, updated per batch
+  std::atomic<uint64_t> filter_passes{0}; // hashes the target filter let through to a lookup
+  std::atomic<bool> active{false};  // still claiming ranges
+
+  // One thread counts into `scanned`, so a plain load and store will do
+  // where a fetch_add would lock the bus
+  void CountKeys(uint64_t n) {
+    scanned.store(scanned.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+  }
+  // Same, from the thread hashing this worker's keys
+  void CountFilterPasses(uint64_t n) {
+    filter_passes.store(filter_passes.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+  }
+};
+
+// Keys per batch: one pass of the 16-lane hash kernels, two of the 8-lane ones
+static const int SCAN_BATCH = 16;
+
+// A key whose hash160 is a target: its private key and the hash in hex,
+// from the uncompressed or the compressed public key
+typedef std::function<void(const Int &privkey, const std::string &hash160_hex, bool compressed)> HitHandler;
+
+// This thread's stage profile, null unless profiling
+extern thread_local ThreadProfile *thread_profile;
+
+// Compute the key interval [range_start, range_end) of a range index
+void range_bounds(Config &config, const ChunkIndex &range_idx, Int &range_start, Int &range_end);
+
+// Keys of the batch starting at `next` that are before `end`: SCAN_BATCH, fewer at the
+// end of an interval, 0 past it
+int batch_keys(const Int &next, const Int &end);
+
+// EC stage: serialize the SCAN_BATCH public keys starting at `current` and advance it past them
+void compute_pubkeys(Secp256K1 *s, Point &current, SerializedPubKey pubkeys[SCAN_BATCH]);
+
+// Hash stage: hash both encodings of the first `count` of SCAN_BATCH consecutive keys,
+// the first being `first`, fold the hashes into the range's digest and pass
+// any that are targets to `on_hit`. `filter` is over the same targets and
+// decides which hashes are looked up at all; the ones it lets through are
+// counted into `stats`.
+void check_pubkeys(const SerializedPubKey pubkeys[SCAN_BATCH], const Int &first, int count,
+                   const std::unordered_set<std::string> &targets, const TargetFilter &filter,
+                   const HitHandler &on_hit, ChunkDigest &digest, WorkerStats &stats);
+
+// Scan from `start` up to `end`, or until `stop` is set, leaving `start` at
+// the first key not scanned and folding the hashes into `digest`. Keys are
+// counted into `stats` as they go. Returns the number of keys scanned.
+uint64_t scan_range(Secp256K1 *s, Int &start, Int end, const std::unordered_set<std::string> &targets,
+                    const TargetFilter &filter, const HitHandler &on_hit, ChunkDigest &digest, WorkerStats &stats,
+                    const std::atomic<bool> &stop);
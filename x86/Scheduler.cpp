@@ -0,0 +1,217 @@
+#include "Scheduler.h"
+
+#include <algorithm>
+
+void ChunkScheduler::Init(const ChunkIndex &total, uint64_t seed) {
+  std::lock_guard<std::mutex> lock(mtx);
+  perm.Init(total, seed);
+  cursor = ChunkIndex();
+  restored.clear();
+  restored_runs.clear();
+  restored_words.clear();
+  scanned_count = 0;
+}
+
+bool ChunkScheduler::InRestoredRun(const ChunkIndex &idx) const {
+  auto it = restored_runs.upper_bound(idx);
+  if (it == restored_runs.begin()) {
+    return false;
+  }
+  --it;
+  return idx <= it->second;
+}
+
+bool ChunkScheduler::InRestoredWords(const ChunkIndex &idx) const {
+  if (restored_words.empty() || !idx.FitsUint64()) {
+    return false;
+  }
+  uint64_t i = idx.ToUint64();
+  auto it = std::lower_bound(restored_words.begin(), restored_words.end(), std::make_pair(i / 64, (uint64_t)0));
+  return it != restored_words.end() && it->first == i / 64 && (it->second >> (i % 64) & 1);
+}
+
+uint64_t ChunkScheduler::TakeRestoredWords(uint64_t first, uint64_t last) {
+  uint64_t count = 0;
+  auto it = std::lower_bound(restored_words.begin(), restored_words.end(), std::make_pair(first / 64, (uint64_t)0));
+  for (; it != restored_words.end() && it->first <= last / 64; ++it) {
+    uint64_t bits = it->second;
+    if (it->first == first / 64) bits &= ~0ULL << (first % 64);
+    if (it->first == last / 64 && last % 64 != 63) bits &= (2ULL << (last % 64)) - 1;
+    count += (uint64_t)__builtin_popcountll(bits);
+    it->second &= ~bits;
+  }
+  return count;
+}
+
+bool ChunkScheduler::MarkScanned(const ChunkIndex &idx) {
+  std::lock_guard<std::mutex> lock(mtx);
+  if (!(idx < perm.Total())) {
+    return false;
+  }
+  if (InRestoredRun(idx) || InRestoredWords(idx) || !restored.insert(idx).second) {
+    return false;
+  }
+  scanned_count++;
+  return true;
+}
+
+uint64_t ChunkScheduler::MarkScannedRange(const ChunkInterval &run) {
+  std::lock_guard<std::mutex> lock(mtx);
+  if (run.last < run.first || !(run.first < perm.Total())) {
+    return 0;
+  }
+  ChunkInterval clipped = run;
+  ChunkIndex last_chunk = perm.Total();
+  last_chunk.Sub(ChunkIndex(1));
+  if (clipped.last > last_chunk) {
+    clipped.last = last_chunk;
+  }
+
+  // Fold in the runs it overlaps, counting only the chunks that are new
+  ChunkInterval merged = clipped;
+  ChunkIndex added = clipped.Size();
+  auto it = restored_runs.upper_bound(merged.first);
+  if (it != restored_runs.begin() && std::prev(it)->second >= merged.first) {
+    --it;
+  }
+  while (it != restored_runs.end() && it->first <= merged.last) {
+    ChunkInterval overlap = {it->first > clipped.first ? it->first : clipped.first,
+                             it->second < clipped.last ? it->second : clipped.last};
+    added.Sub(overlap.Size());
+    if (it->first < merged.first) merged.first = it->first;
+    if (it->second > merged.last) merged.last = it->second;
+    it = restored_runs.erase(it);
+  }
+  restored_runs[merged.first] = merged.last;
+
+  for (auto single = restored.begin(); single != restored.end();) {
+    if (clipped.first <= *single && *single <= clipped.last) {
+      added.Sub(ChunkIndex(1));
+      single = restored.erase(single);
+    } else {
+      ++single;
+    }
+  }
+
+  // The run now holds these chunks; words are only restored for jobs of
+  // fewer than 2^64 chunks
+  if (!restored_words.empty()) {
+    added.Sub(ChunkIndex(TakeRestoredWords(clipped.first.ToUint64(), clipped.last.ToUint64())));
+  }
+
+  uint64_t count = added.FitsUint64() ? added.ToUint64() : UINT64_MAX;
+  scanned_count += count;
+  return count;
+}
+
+uint64_t ChunkScheduler::MarkScannedWords(const std::vector<uint64_t> &pairs) {
+  std::lock_guard<std::mutex> lock(mtx);
+  if (!perm.Total().FitsUint64()) {
+    return 0;
+  }
+  uint64_t total = perm.Total().ToUint64();
+  bool checked = !restored.empty() || !restored_runs.empty();
+
+  std::vector<std::pair<uint64_t, uint64_t>> words;
+  words.reserve(restored_words.size() + pairs.size() / 2);
+  auto old = restored_words.begin();
+  uint64_t added = 0;
+  for (size_t i = 0; i + 1 < pairs.size(); i += 2) {
+    uint64_t word = pairs[i], bits = pairs[i + 1];
+    if (word >= (total + 63) / 64) {
+      break;
+    }
+    if (word == total / 64) {
+      bits &= (1ULL << (total % 64)) - 1;
+    }
+    // Chunks recorded one by one or as runs stay there and are counted already
+    if (checked) {
+      for (uint64_t rest = bits; rest; rest &= rest - 1) {
+        ChunkIndex idx(word * 64 + (uint64_t)__builtin_ctzll(rest));
+        if (InRestoredRun(idx) || restored.count(idx)) {
+          bits &= ~(1ULL << (idx.ToUint64() % 64));
+        }
+      }
+    }
+    for (; old != restored_words.end() && old->first < word; ++old) {
+      words.push_back(*old);
+    }
+    if (old != restored_words.end() && old->first == word) {
+      bits &= ~old->second;
+      words.push_back({word, old->second | bits});
+      ++old;
+    } else if (bits) {
+      words.push_back({word, bits});
+    }
+    added += (uint64_t)__builtin_popcountll(bits);
+  }
+  words.insert(words.end(), old, restored_words.end());
+  restored_words.swap(words);
+  scanned_count += added;
+  return added;
+}
+
+bool ChunkScheduler::Claim(ChunkIndex &idx) {
+  std::lock_guard<std::mutex> lock(mtx);
+
+  while (cursor < perm.Total()) {
+    idx = perm.At(cursor);
+    cursor.Add(1);
+
+    // Each index comes up exactly once, so a restored entry can be
+    // dropped as soon as the cursor passes it.
+    if (!restored.empty() && restored.erase(idx)) {
+      continue;
+    }
+    if (!restored_runs.empty() && InRestoredRun(idx)) {
+      continue;
+    }
+    if (InRestoredWords(idx)) {
+      continue;
+    }
+    scanned_count++;
+    return true;
+  }
+  return false;
+}
+
+bool ChunkScheduler::Exhausted() {
+  std::lock_guard<std::mutex> lock(mtx);
+  if (!(cursor < perm.Total())) {
+    return true;
+  }
+  // Everything may have been restored from the checkpoint already.
+  return perm.Total().FitsUint64() && scanned_count >= perm.Total().ToUint64();
+}
+
+int FairShare::Add(double weight) {
+  std::lock_guard<std::mutex> lock(mtx);
+  // Start level with the busiest-served job so a newcomer cannot monopolize the pool
+  double vtime = 0;
+  for (const Entry &e : entries) {
+    if (!e.retired && e.vtime > vtime) vtime = e.vtime;
+  }
+  entries.push_back({weight > 0 ? weight : 1, vtime, false});
+  return (int)entries.size() - 1;
+}
+
+int FairShare::Pick() {
+  std::lock_guard<std::mutex> lock(mtx);
+  int best = -1;
+  for (size_t i = 0; i < entries.size(); i++) {
+    if (!entries[i].retired && (best < 0 || entries[i].vtime < entries[best].vtime)) {
+      best = (int)i;
+    }
+  }
+  return best;
+}
+
+void FairShare::Charge(int job, double cost) {
+  std::lock_guard<std::mutex> lock(mtx);
+  entries[job].vtime += cost / entries[job].weight;
+}
+
+void FairShare::Retire(int job) {
+  std::lock_guard<std::mutex> lock(mtx);
+  entries[job].retired = true;
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <deque>
+#include <mutex>
+#include <string>
+
+#include "ChunkIndex.hpp"
+
+/*---------------------------------------------------------------
+    Range progress shared by several processes on one host through
+    a memory-mapped file.
+
+    The file holds a header (job id, permutation seed, a shared
+    cursor and completion counter), a table of per-process slots and
+    a completion bitmap. Processes claim ranges by atomically bumping
+    the cursor, so no two processes are ever handed the same range.
+    Claimed ranges are stamped into the claiming process's slot. When
+    a process dies, or its heartbeat goes stale, the survivors adopt
+    its stamped ranges.
+  --------------------------------------------------------------*/
+
+// Largest job (in ranges) a progress file can describe: 2^34 bits = 2 GiB bitmap
+#define MAX_SHARED_RANGES (1ULL << 34)
+
+class SharedProgress {
+
+public:
+
+  ~SharedProgress();
+
+  // Map the progress file, creating and initializing it if needed.
+  // job_key identifies the job; opening a file made for another job fails.
+  bool Open(const std::string &path, const std::string &job_key,
+            const ChunkIndex &total, int lease_timeout);
+  void Close();
+
+  // Import a range completed in a previous run.
+  void MarkScanned(const ChunkIndex &idx);
+
+  // Claim a range no other process holds. Returns false once all ranges were issued
+  // and no abandoned ranges are left to adopt.
+  bool Claim(ChunkIndex &idx);
+
+  // Returns false if the range was already marked as completed.
+  bool Complete(const ChunkIndex &idx);
+
+  bool IsCompleted(const ChunkIndex &idx) const;
+
+  // Refresh this process's lease stamp.
+  void Heartbeat();
+
+  uint64_t CompletedCount() const;
+
+private:
+
+  struct Header;
+  struct Slot;
+
+  Slot *SlotAt(int i) const;
+  uint64_t *Bitmap() const;
+  bool IsAlive(const Slot *slot, uint64_t now) const;
+  bool StampLease(uint64_t idx);
+  void RecoverOrphans();
+
+  std::mutex mtx;
+  int fd = -1;
+  void *map = nullptr;
+  size_t map_size = 0;
+  Header *header = nullptr;
+  Slot *own = nullptr;
+  uint64_t total = 0;
+  int lease_timeout = 300;
+  uint64_t last_recovery = 0;
+  ChunkPermutation perm;
+  std::deque<uint64_t> pending; // adopted ranges waiting to be handed out
+
+};
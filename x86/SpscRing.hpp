@@ -0,0 +1,81 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <thread>
+
+/*---------------------------------------------------------------
+    Bounded single-producer / single-consumer ring.
+
+    Used to hand batches from an EC thread to a hashing thread
+    running on the sibling SMT thread of the same core. Slots are
+    filled and read in place, so a batch is never copied. Waiting
+    spins with a pause hint first (cheap for the sibling sharing the
+    core), then yields.
+  --------------------------------------------------------------*/
+
+template <typename T, size_t N>
+class SpscRing {
+
+  static_assert(N >= 2 && (N & (N - 1)) == 0, "ring size must be a power of two");
+
+public:
+
+  // Producer: free slot to fill, or nullptr once the ring was closed.
+  T *BeginPush() {
+    size_t t = tail.load(std::memory_order_relaxed);
+    for (int spins = 0; t - head.load(std::memory_order_acquire) == N; spins++) {
+      if (closed.load(std::memory_order_acquire)) return nullptr;
+      Wait(spins);
+    }
+    return &slots[t & (N - 1)];
+  }
+
+  // Producer: publish the slot returned by BeginPush.
+  void Push() {
+    tail.store(tail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+  }
+
+  // Consumer: oldest filled slot, or nullptr once closed and drained.
+  T *Front() {
+    size_t h = head.load(std::memory_order_relaxed);
+    for (int spins = 0; tail.load(std::memory_order_acquire) == h; spins++) {
+      // Re-check after seeing closed: the last Push may have raced with Close
+      if (closed.load(std::memory_order_acquire) && tail.load(std::memory_order_acquire) == h) {
+        return nullptr;
+      }
+      Wait(spins);
+    }
+    return &slots[h & (N - 1)];
+  }
+
+  // Consumer: release the slot returned by Front.
+  void Pop() {
+    head.store(head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+  }
+
+  // Either side: no more batches will be produced or consumed.
+  void Close() {
+    closed.store(true, std::memory_order_release);
+  }
+
+private:
+
+  static void Wait(int spins) {
+    if (spins < 64) {
+#if defined(__x86_64__) || defined(__i386__)
+      __builtin_ia32_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+      asm volatile("yield");
+#endif
+    } else {
+      std::this_thread::yield();
+    }
+  }
+
+  T slots[N];
+  alignas(64) std::atomic<size_t> head{0}; // next slot to consume
+  alignas(64) std::atomic<size_t> tail{0}; // next slot to fill
+  alignas(64) std::atomic<bool> closed{false};
+
+};
@@ -0,0 +1,90 @@
+#include "TargetFilter.h"
+
+#include <algorithm>
+#include <string.h>
+
+#include "HexUtil.hpp"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+static uint32_t prefix_of(const uint8_t *hash160) {
+  uint32_t prefix;
+  memcpy(&prefix, hash160, sizeof(prefix));
+  return prefix;
+}
+
+TargetFilter::TargetFilter(const std::unordered_set<std::string> &targets) {
+  std::vector<uint32_t> all;
+  all.reserve(targets.size());
+  for (const std::string &hex : targets) {
+    if (hex.size() != 40) {
+      continue; // not a hash160, can never match
+    }
+    std::vector<uint8_t> bytes = HexUtil::fromHex(hex);
+    all.push_back(prefix_of(bytes.data()));
+  }
+  std::sort(all.begin(), all.end());
+  all.erase(std::unique(all.begin(), all.end()), all.end());
+
+  if (all.size() <= MAX_COMPARED) {
+    prefixes = all;
+    return;
+  }
+
+  // About 16 bits per prefix keeps one non-target in 16 passing, up to
+  // 2^28 bits (32 MB); beyond that the bitmap fills and passes more
+  int bits_log2 = 16;
+  while (bits_log2 < 28 && ((uint64_t)1 << bits_log2) < all.size() * 16) {
+    bits_log2++;
+  }
+  shift = 32 - bits_log2;
+  bitmap.assign(((size_t)1 << bits_log2) / 64, 0);
+  for (uint32_t prefix : all) {
+    uint32_t bit = prefix >> shift;
+    bitmap[bit / 64] |= (uint64_t)1 << (bit % 64);
+  }
+}
+
+uint32_t TargetFilter::Screen(const uint8_t (*hash160s)[20], int count) const {
+  uint32_t candidates = 0;
+  if (!bitmap.empty()) {
+    for (int i = 0; i < count; i++) {
+      uint32_t bit = prefix_of(hash160s[i]) >> shift;
+      candidates |= (uint32_t)((bitmap[bit / 64] >> (bit % 64)) & 1) << i;
+    }
+    return candidates;
+  }
+  if (prefixes.empty()) {
+    return 0;
+  }
+
+#if defined(__SSE2__)
+  // Four lanes per compare; the lanes past `count` are zeros and masked off
+  alignas(16) uint32_t lanes[32];
+  for (int i = 0; i < count; i++) {
+    lanes[i] = prefix_of(hash160s[i]);
+  }
+  for (int i = count; i % 4; i++) {
+    lanes[i] = 0;
+  }
+  for (int group = 0; group < count; group += 4) {
+    __m128i batch = _mm_load_si128((const __m128i *)(lanes + group));
+    __m128i hits = _mm_setzero_si128();
+    for (uint32_t prefix : prefixes) {
+      hits = _mm_or_si128(hits, _mm_cmpeq_epi32(batch, _mm_set1_epi32((int)prefix)));
+    }
+    candidates |= (uint32_t)_mm_movemask_ps(_mm_castsi128_ps(hits)) << group;
+  }
+  return count >= 32 ? candidates : candidates & ((1u << count) - 1);
+#else
+  for (int i = 0; i < count; i++) {
+    uint32_t prefix = prefix_of(hash160s[i]);
+    for (uint32_t target : prefixes) {
+      candidates |= (uint32_t)(prefix == target) << i;
+    }
+  }
+  return candidates;
+#endif
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+/*---------------------------------------------------------------
+    Early reject in front of the target lookup: a batch of hash160s
+    is screened on the first 4 bytes of each (the first RIPEMD-160
+    state word), and only those that may be targets are hex-encoded
+    and looked up in the target set.
+
+    A few distinct prefixes are compared with the whole batch at
+    once in vector registers; more go through a bitmap indexed by
+    the top bits of the prefix. Neither ever rejects a target. A
+    non-target sometimes passes and the full lookup turns it down.
+  --------------------------------------------------------------*/
+class TargetFilter {
+
+public:
+
+  // Passes nothing: there are no targets
+  TargetFilter() = default;
+
+  // Over hash160s in hex, as the target sets hold them
+  explicit TargetFilter(const std::unordered_set<std::string> &targets);
+
+  // Bit i set if hash160s[i], of the first `count` (at most 32), may be a target
+  uint32_t Screen(const uint8_t (*hash160s)[20], int count) const;
+
+  // Prefixes compared directly, or 0 when the bitmap is used
+  size_t Compared() const { return prefixes.size(); }
+
+  // Most prefixes compared in registers before switching to the bitmap
+  static const size_t MAX_COMPARED = 16;
+
+private:
+
+  std::vector<uint32_t> prefixes; // distinct, when at most MAX_COMPARED
+  std::vector<uint64_t> bitmap;   // otherwise, 2^(32 - shift) bits
+  int shift = 32;
+
+};
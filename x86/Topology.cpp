@@ -0,0 +1,349 @@
+#include "Topology.h"
+
+#include <algorithm>
+#include <dirent.h>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <pthread.h>
+#include <sched.h>
+#include <thread>
+
+#ifdef HAVE_LIBNUMA
+#include <numa.h>
+#endif
+
+namespace Topology {
+
+bool parse_cpu_list(const std::string &list, std::vector<int> &cpus) {
+  cpus.clear();
+  size_t pos = 0;
+  while (pos < list.size()) {
+    size_t comma = list.find(',', pos);
+    std::string item = list.substr(pos, comma == std::string::npos ? std::string::npos : comma - pos);
+    pos = comma == std::string::npos ? list.size() : comma + 1;
+
+    item.erase(0, item.find_first_not_of(" \t\n"));
+    item.erase(item.find_last_not_of(" \t\n") + 1);
+    if (item.empty()) {
+      continue;
+    }
+    try {
+      size_t dash = item.find('-');
+      int first = std::stoi(item.substr(0, dash));
+      int last = dash == std::string::npos ? first : std::stoi(item.substr(dash + 1));
+      if (first < 0 || last < first) {
+        return false;
+      }
+      for (int cpu = first; cpu <= last; cpu++) {
+        cpus.push_back(cpu);
+      }
+    } catch (const std::exception &) {
+      return false;
+    }
+  }
+  std::sort(cpus.begin(), cpus.end());
+  cpus.erase(std::unique(cpus.begin(), cpus.end()), cpus.end());
+  return !cpus.empty();
+}
+
+std::vector<int> allowed_cpus() {
+  std::vector<int> cpus;
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+    for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+      if (CPU_ISSET(cpu, &set)) cpus.push_back(cpu);
+    }
+  }
+  if (cpus.empty()) {
+    unsigned n = std::thread::hardware_concurrency();
+    for (unsigned cpu = 0; cpu < (n ? n : 1); cpu++) cpus.push_back((int)cpu);
+  }
+  return cpus;
+}
+
+static std::vector<NumaNode> sysfs_nodes() {
+  std::vector<NumaNode> nodes;
+  DIR *dir = opendir("/sys/devices/system/node");
+  if (!dir) {
+    return nodes;
+  }
+  while (dirent *entry = readdir(dir)) {
+    std::string name = entry->d_name;
+    if (name.compare(0, 4, "node") != 0 || name.size() == 4 ||
+        name.find_first_not_of("0123456789", 4) != std::string::npos) {
+      continue;
+    }
+    std::ifstream file("/sys/devices/system/node/" + name + "/cpulist");
+    std::string list;
+    NumaNode node;
+    node.id = std::stoi(name.substr(4));
+    if (std::getline(file, list) && parse_cpu_list(list, node.cpus)) {
+      nodes.push_back(node);
+    }
+  }
+  closedir(dir);
+  return nodes;
+}
+
+std::vector<NumaNode> numa_nodes() {
+  std::vector<NumaNode> nodes;
+#ifdef HAVE_LIBNUMA
+  if (numa_available() >= 0) {
+    for (int id = 0; id <= numa_max_node(); id++) {
+      struct bitmask *mask = numa_allocate_cpumask();
+      NumaNode node;
+      node.id = id;
+      if (numa_node_to_cpus(id, mask) == 0) {
+        for (unsigned cpu = 0; cpu < mask->size; cpu++) {
+          if (numa_bitmask_isbitset(mask, cpu)) node.cpus.push_back((int)cpu);
+        }
+      }
+      numa_free_cpumask(mask);
+      if (!node.cpus.empty()) nodes.push_back(node);
+    }
+  }
+#endif
+  if (nodes.empty()) {
+    nodes = sysfs_nodes();
+  }
+
+  // Keep only CPUs we are allowed to run on (cpusets, taskset, containers)
+  std::vector<int> allowed = allowed_cpus();
+  std::vector<NumaNode> usable;
+  for (NumaNode &node : nodes) {
+    NumaNode kept;
+    kept.id = node.id;
+    for (int cpu : node.cpus) {
+      if (std::binary_search(allowed.begin(), allowed.end(), cpu)) kept.cpus.push_back(cpu);
+    }
+    if (!kept.cpus.empty()) usable.push_back(kept);
+  }
+  if (usable.empty()) {
+    NumaNode single;
+    single.id = 0;
+    single.cpus = allowed;
+    usable.push_back(single);
+  }
+  std::sort(usable.begin(), usable.end(),
+            [](const NumaNode &a, const NumaNode &b) { return a.id < b.id; });
+  return usable;
+}
+
+static bool read_line(const std::string &path, std::string &line) {
+  std::ifstream file(path);
+  return (bool)std::getline(file, line);
+}
+
+static int read_int(const std::string &path, int fallback) {
+  std::string line;
+  if (!read_line(path, line)) {
+    return fallback;
+  }
+  try {
+    return std::stoi(line);
+  } catch (const std::exception &) {
+    return fallback;
+  }
+}
+
+std::vector<CpuInfo> cpu_topology() {
+  std::vector<int> allowed = allowed_cpus();
+
+  // Intel hybrid parts expose one PMU per core type
+  std::vector<int> p_cores, e_cores;
+  std::string list;
+  if (read_line("/sys/devices/cpu_core/cpus", list)) parse_cpu_list(list, p_cores);
+  if (read_line("/sys/devices/cpu_atom/cpus", list)) parse_cpu_list(list, e_cores);
+
+  std::vector<CpuInfo> topology;
+  int max_capacity = 0;
+  bool from_freq = false;
+  for (int cpu : allowed) {
+    std::string base = "/sys/devices/system/cpu/cpu" + std::to_string(cpu);
+    CpuInfo info;
+    info.cpu = cpu;
+    info.core_id = read_int(base + "/topology/core_id", cpu);
+    info.package_id = read_int(base + "/topology/physical_package_id", 0);
+    if (!read_line(base + "/topology/thread_siblings_list", list) ||
+        !parse_cpu_list(list, info.siblings)) {
+      info.siblings = {cpu};
+    }
+    info.capacity = read_int(base + "/cpu_capacity", -1);
+    if (info.capacity < 0) {
+      info.capacity = read_int(base + "/cpufreq/cpuinfo_max_freq", 0);
+      from_freq = true;
+    }
+    info.kind = 0;
+    if (std::binary_search(p_cores.begin(), p_cores.end(), cpu)) info.kind = 'P';
+    if (std::binary_search(e_cores.begin(), e_cores.end(), cpu)) info.kind = 'E';
+    max_capacity = std::max(max_capacity, info.capacity);
+    topology.push_back(info);
+  }
+
+  // Normalize to 1024 and label big.LITTLE style parts by capacity
+  int min_capacity = max_capacity;
+  for (CpuInfo &info : topology) {
+    info.capacity = max_capacity > 0 && info.capacity > 0 ? (int)(info.capacity * 1024LL / max_capacity) : 1024;
+    min_capacity = std::min(min_capacity, info.capacity);
+  }
+  if (p_cores.empty() && e_cores.empty() && !from_freq && min_capacity < 1024) {
+    for (CpuInfo &info : topology) {
+      info.kind = info.capacity == 1024 ? 'P' : 'E';
+    }
+  }
+  return topology;
+}
+
+std::vector<int> placement_order(const std::vector<CpuInfo> &topology, const std::vector<int> &cpus) {
+  std::map<int, const CpuInfo *> by_cpu;
+  for (const CpuInfo &info : topology) {
+    by_cpu[info.cpu] = &info;
+  }
+
+  // Rank of each cpu among its SMT siblings (0 = first thread of the core)
+  std::vector<std::pair<std::pair<int, int>, int>> ranked; // ((sibling rank, -capacity), cpu)
+  for (int cpu : cpus) {
+    auto it = by_cpu.find(cpu);
+    int rank = 0, capacity = 1024;
+    if (it != by_cpu.end()) {
+      const std::vector<int> &siblings = it->second->siblings;
+      rank = (int)(std::find(siblings.begin(), siblings.end(), cpu) - siblings.begin());
+      capacity = it->second->capacity;
+    }
+    ranked.push_back({{rank, -capacity}, cpu});
+  }
+  std::stable_sort(ranked.begin(), ranked.end(),
+                   [](const std::pair<std::pair<int, int>, int> &a,
+                      const std::pair<std::pair<int, int>, int> &b) { return a.first < b.first; });
+
+  std::vector<int> order;
+  for (auto &entry : ranked) {
+    order.push_back(entry.second);
+  }
+  return order;
+}
+
+std::vector<int> pair_siblings(const std::vector<CpuInfo> &topology, const std::vector<int> &order) {
+  std::vector<int> paired;
+  std::vector<bool> used(order.size(), false);
+  for (size_t i = 0; i < order.size(); i++) {
+    if (used[i]) {
+      continue;
+    }
+    used[i] = true;
+    paired.push_back(order[i]);
+
+    const CpuInfo *info = nullptr;
+    for (const CpuInfo &candidate : topology) {
+      if (candidate.cpu == order[i]) info = &candidate;
+    }
+    if (!info) {
+      continue;
+    }
+    for (size_t j = i + 1; j < order.size(); j++) {
+      if (!used[j] && order[j] != order[i] &&
+          std::find(info->siblings.begin(), info->siblings.end(), order[j]) != info->siblings.end()) {
+        used[j] = true;
+        paired.push_back(order[j]);
+        break;
+      }
+    }
+  }
+  return paired;
+}
+
+// Mount point of the cgroup v2 hierarchy, or "" without one
+static std::string cgroup2_mount() {
+  std::ifstream file("/proc/self/mountinfo");
+  std::string line;
+  while (std::getline(file, line)) {
+    size_t sep = line.find(" - ");
+    if (sep == std::string::npos || line.compare(sep + 3, 8, "cgroup2 ") != 0) {
+      continue;
+    }
+    std::istringstream fields(line.substr(0, sep));
+    std::string id, parent, dev, root, mount;
+    fields >> id >> parent >> dev >> root >> mount;
+    return mount;
+  }
+  return "";
+}
+
+int cgroup_cpu_limit() {
+  std::string mount = cgroup2_mount();
+  if (mount.empty()) {
+    return 0;
+  }
+  std::ifstream file("/proc/self/cgroup");
+  std::string line, path;
+  while (std::getline(file, line)) {
+    if (line.compare(0, 3, "0::") == 0) {
+      path = line.substr(3);
+    }
+  }
+  if (path.empty() || path[0] != '/') {
+    return 0;
+  }
+
+  int limit = 0;
+  for (;;) {
+    std::string max;
+    if (read_line(mount + path + "/cpu.max", max)) {
+      std::istringstream fields(max);
+      std::string quota;
+      double period = 0;
+      fields >> quota >> period;
+      if (quota != "max" && period > 0) {
+        try {
+          // Round down: a fractional CPU is throttled time, not a free thread
+          int cpus = std::max((int)(std::stod(quota) / period), 1);
+          if (limit == 0 || cpus < limit) limit = cpus;
+        } catch (const std::exception &) {
+          // Unparsable quota: this level does not limit us
+        }
+      }
+    }
+    if (path == "/") {
+      break;
+    }
+    size_t slash = path.find_last_of('/');
+    path = slash == 0 ? "/" : path.substr(0, slash);
+  }
+  return limit;
+}
+
+int node_index_of_cpu(const std::vector<NumaNode> &nodes, int cpu) {
+  for (size_t i = 0; i < nodes.size(); i++) {
+    if (std::binary_search(nodes[i].cpus.begin(), nodes[i].cpus.end(), cpu)) {
+      return (int)i;
+    }
+  }
+  return 0;
+}
+
+bool pin_thread(int cpu) {
+  return pin_thread(std::vector<int>{cpu});
+}
+
+bool pin_thread(const std::vector<int> &cpus) {
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  for (int cpu : cpus) {
+    if (cpu >= 0 && cpu < CPU_SETSIZE) CPU_SET(cpu, &set);
+  }
+  return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+}
+
+void prefer_node(int node) {
+#ifdef HAVE_LIBNUMA
+  if (numa_available() >= 0) {
+    numa_set_preferred(node);
+  }
+#else
+  (void)node;
+#endif
+}
+
+} // namespace Topology
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+namespace Topology {
+
+struct NumaNode {
+  int id;
+  std::vector<int> cpus; // usable by this process
+};
+
+struct CpuInfo {
+  int cpu;
+  int core_id;           // physical core id within the package
+  int package_id;
+  std::vector<int> siblings; // SMT threads sharing this core, including cpu
+  int capacity;          // relative speed, 1024 = fastest class of core
+  char kind;             // 'P' / 'E' on hybrid parts, 0 otherwise
+};
+
+// Parse a kernel cpu list such as "0-3,8,10-11". Returns false on bad input.
+bool parse_cpu_list(const std::string &list, std::vector<int> &cpus);
+
+// CPUs this process may run on (sched_getaffinity).
+std::vector<int> allowed_cpus();
+
+// NUMA nodes restricted to allowed_cpus(). Uses libnuma when built with
+// HAVE_LIBNUMA, sysfs otherwise; falls back to a single node 0.
+std::vector<NumaNode> numa_nodes();
+
+// Index into `nodes` of the node holding `cpu`, or 0 if unknown.
+int node_index_of_cpu(const std::vector<NumaNode> &nodes, int cpu);
+
+// Per-CPU topology for allowed_cpus(), read from sysfs. Hybrid parts are
+// detected through /sys/devices/cpu_core and cpu_atom (Intel) or
+// cpu_capacity (ARM big.LITTLE); cpufreq's max frequency is the fallback
+// for capacity.
+std::vector<CpuInfo> cpu_topology();
+
+// Order CPUs for placement: one thread per physical core first, faster
+// cores first, then the remaining SMT siblings.
+std::vector<int> placement_order(const std::vector<CpuInfo> &topology, const std::vector<int> &cpus);
+
+// Reorder `order` so that each CPU is directly followed by an SMT sibling from
+// the same list, when it has one.
+std::vector<int> pair_siblings(const std::vector<CpuInfo> &topology, const std::vector<int> &order);
+
+// Whole CPUs granted by the cgroup v2 cpu.max quota (quota / period, rounded
+// down, at least 1; the tightest along the cgroup path), or 0 when unlimited.
+// cpuset limits already show up in allowed_cpus().
+int cgroup_cpu_limit();
+
+// Pin the calling thread to one CPU / to a set of CPUs.
+bool pin_thread(int cpu);
+bool pin_thread(const std::vector<int> &cpus);
+
+// Ask the allocator to place the calling thread's new pages on `node`.
+// A no-op without libnuma, where first-touch after pinning does the same.
+void prefer_node(int node);
+
+} // namespace Topology
@@ -0,0 +1,200 @@
+#include "WorkerPool.h"
+#include "Net.h"
+
+#include <algorithm>
+#include <poll.h>
+#include <sstream>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+WorkerPool::WorkerPool(int capacity_slots, int slot_threads, std::function<void(int)> body)
+    : capacity(std::max(capacity_slots, 1)), slot_threads(std::max(slot_threads, 1)),
+      body(body), requested(capacity), state(new std::atomic<int>[capacity]),
+      threads(capacity) {
+  for (int i = 0; i < capacity; i++) {
+    state[i] = IDLE;
+  }
+}
+
+WorkerPool::~WorkerPool() {
+  Finish();
+  Join();
+}
+
+int WorkerPool::ToSlots(int workers) const {
+  return std::min(std::max(workers / slot_threads, 1), capacity);
+}
+
+void WorkerPool::SetRequested(int workers) {
+  requested.store(ToSlots(workers));
+}
+
+void WorkerPool::SetLimit(int workers) {
+  limit = workers > 0 ? ToSlots(workers) : 0;
+}
+
+// Grow and Shrink retry against whatever another thread stored first: the
+// main loop applies SIGUSR1/SIGUSR2 while the control socket thread runs
+// GROW, SHRINK and WORKERS, and neither resize may be lost
+void WorkerPool::Grow() {
+  int current = requested.load();
+  while (!requested.compare_exchange_weak(current, std::min(current + 1, capacity))) {
+  }
+}
+
+void WorkerPool::Shrink() {
+  int current = requested.load();
+  while (!requested.compare_exchange_weak(current, std::max(current - 1, 1))) {
+  }
+}
+
+int WorkerPool::Requested() const {
+  return requested * slot_threads;
+}
+
+int WorkerPool::Limit() const {
+  return limit * slot_threads;
+}
+
+int WorkerPool::TargetSlots() const {
+  int target = requested;
+  int cap = limit;
+  if (cap > 0 && cap < target) {
+    target = cap;
+  }
+  return target;
+}
+
+int WorkerPool::Target() const {
+  return TargetSlots() * slot_threads;
+}
+
+int WorkerPool::Running() const {
+  int running = 0;
+  for (int i = 0; i < capacity; i++) {
+    running += state[i] == RUNNING;
+  }
+  return running * slot_threads;
+}
+
+bool WorkerPool::ShouldPark(int slot) const {
+  int below = 0;
+  for (int i = 0; i < slot; i++) {
+    below += state[i] == RUNNING;
+  }
+  return below >= TargetSlots();
+}
+
+void WorkerPool::Retire(int slot) {
+  state[slot] = RETIRED;
+}
+
+void WorkerPool::Finish() {
+  finished = true;
+}
+
+void WorkerPool::Reconcile() {
+  std::lock_guard<std::mutex> lock(mtx);
+  // A retired slot keeps its place in the target: the tail policy took it
+  // out so slower workers stay off the remaining ranges, not to be replaced
+  int running = 0;
+  for (int i = 0; i < capacity; i++) {
+    if (state[i] != RUNNING && threads[i].joinable()) {
+      threads[i].join();
+    }
+    running += state[i] != IDLE;
+  }
+
+  // Fill from the lowest idle slot so parked workers are always the highest ones
+  for (int i = 0; i < capacity && running < TargetSlots() && !finished; i++) {
+    if (state[i] != IDLE || threads[i].joinable()) {
+      continue;
+    }
+    state[i] = RUNNING;
+    running++;
+    threads[i] = std::thread([this, i]() {
+      body(i);
+      int expected = RUNNING;
+      state[i].compare_exchange_strong(expected, IDLE);
+    });
+  }
+}
+
+bool WorkerPool::Done() {
+  std::lock_guard<std::mutex> lock(mtx);
+  bool startable = false;
+  for (int i = 0; i < capacity; i++) {
+    if (state[i] == RUNNING) {
+      return false;
+    }
+    startable = startable || state[i] == IDLE;
+  }
+  return finished || !startable;
+}
+
+void WorkerPool::Join() {
+  std::lock_guard<std::mutex> lock(mtx);
+  for (auto &thread : threads) {
+    if (thread.joinable()) {
+      thread.join();
+    }
+  }
+}
+
+std::string WorkerPool::Command(const std::string &line) {
+  std::istringstream iss(line);
+  std::string cmd;
+  iss >> cmd;
+  if (cmd == "WORKERS") {
+    int workers = 0;
+    if (!(iss >> workers) || workers <= 0) {
+      return "ERROR expected WORKERS <n>";
+    }
+    SetRequested(workers);
+  } else if (cmd == "GROW") {
+    Grow();
+  } else if (cmd == "SHRINK") {
+    Shrink();
+  } else if (cmd == "STATUS") {
+    return "WORKERS " + std::to_string(Target()) + " RUNNING " + std::to_string(Running()) +
+           " REQUESTED " + std::to_string(Requested()) + " LIMIT " + std::to_string(Limit());
+  } else {
+    return "ERROR unknown command";
+  }
+  return "OK " + std::to_string(Target());
+}
+
+bool WorkerPool::ServeControl(const std::string &addr, const std::atomic<bool> &stop) {
+  int listen_fd = Net::listen_on(addr);
+  if (listen_fd < 0) {
+    return false;
+  }
+
+  while (!stop) {
+    pollfd pfd = {listen_fd, POLLIN, 0};
+    if (poll(&pfd, 1, 250) <= 0) {
+      continue;
+    }
+    int fd = accept(listen_fd, nullptr, nullptr);
+    if (fd < 0) {
+      continue;
+    }
+    // Commands are tiny; a client that goes quiet is dropped instead of blocking the others
+    timeval timeout = {5, 0};
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    Net::LineConn conn(fd);
+    std::string line;
+    while (!stop && conn.ReadLine(line)) {
+      if (!conn.WriteLine(Command(line))) {
+        break;
+      }
+    }
+    conn.Close();
+  }
+  close(listen_fd);
+  if (addr.compare(0, 5, "unix:") == 0) {
+    unlink(addr.substr(5).c_str());
+  }
+  return true;
+}
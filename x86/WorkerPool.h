@@ -0,0 +1,91 @@
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/*---------------------------------------------------------------
+    Worker pool whose size can change while it runs.
+
+    Each slot runs `body(slot)` on its own thread. A body checks
+    ShouldPark(slot) between chunks and returns when it is true, so
+    shrinking takes effect at a chunk boundary and no progress is
+    lost; growing starts threads for idle slots. The target size is
+    the requested size clamped by an external limit (the cgroup CPU
+    quota) and by the pool capacity.
+
+    Sizes on the public interface count worker threads. A slot may
+    run several threads (an SMT pair runs two), so they are converted
+    to slots by dividing by `slot_threads`.
+  --------------------------------------------------------------*/
+class WorkerPool {
+
+public:
+
+  WorkerPool(int capacity_slots, int slot_threads, std::function<void(int)> body);
+  ~WorkerPool();
+
+  // Requested number of worker threads; clamped to the capacity, at least one slot.
+  void SetRequested(int workers);
+  // Threads the environment allows (cgroup quota, cpuset); 0 means no limit.
+  void SetLimit(int workers);
+  void Grow();
+  void Shrink();
+
+  int Requested() const;
+  int Limit() const;
+  int Target() const;  // worker threads the pool is converging to
+  int Running() const; // worker threads currently running
+
+  // Slot running worker thread `worker` (threads are numbered slot * slot_threads + i).
+  int SlotOf(int worker) const { return worker / slot_threads; }
+
+  // True once `slot` should return at its next chunk boundary: lower
+  // slots already fill the target.
+  bool ShouldPark(int slot) const;
+
+  // The slot stops for good (for example the tail policy told it to). It
+  // still counts toward the target, so no idle slot is started in its place.
+  void Retire(int slot);
+  // No more work: no slot is started again.
+  void Finish();
+
+  // Start idle slots up to the target and reap threads that returned.
+  void Reconcile();
+
+  // True when no slot runs and none will be started again.
+  bool Done();
+
+  // Wait for every started thread.
+  void Join();
+
+  // Control protocol, one command per line:
+  //   WORKERS <n> / GROW / SHRINK -> OK <target>
+  //   STATUS -> WORKERS <target> RUNNING <running> REQUESTED <requested> LIMIT <limit>
+  std::string Command(const std::string &line);
+
+  // Answer control commands on `addr` (see Net::listen_on) until `stop` is set.
+  bool ServeControl(const std::string &addr, const std::atomic<bool> &stop);
+
+private:
+
+  enum { IDLE = 0, RUNNING = 1, RETIRED = 2 };
+
+  int ToSlots(int workers) const;
+  int TargetSlots() const;
+
+  int capacity;
+  int slot_threads;
+  std::function<void(int)> body;
+  std::atomic<int> requested;
+  std::atomic<int> limit{0};
+  std::atomic<bool> finished{false};
+  std::unique_ptr<std::atomic<int>[]> state;
+  std::mutex mtx; // guards threads
+  std::vector<std::thread> threads;
+
+};
@@ -0,0 +1,478 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <random>
+#include <sstream>
+#include <stdint.h>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+#include "../Address.h"
+#include "../Scheduler.h"
+#include "../TargetFilter.h"
+#include "../include/IntGroup.h"
+#include "../include/secp256k1.h"
+
+/*---------------------------------------------------------------
+    Microbenchmarks of the hot path, one number per component.
+
+    Each benchmark is run for a calibrated number of iterations,
+    five times; the median is reported as ns/op and, where an op
+    stands for a number of keys, keys/sec. Results go to stdout
+    (or --out) as JSON so they can be saved and compared with
+    --compare, which exits non-zero on a regression.
+  --------------------------------------------------------------*/
+
+struct Result {
+  std::string name;
+  double ns_per_op;
+  double keys_per_op; // 0 when an op is not a number of keys
+  uint64_t iterations;
+};
+
+struct Options {
+  std::string filter;
+  double min_time = 0.2; // seconds per repetition
+  uint64_t max_targets = 1000000;
+  std::string out;
+  std::string compare;
+  double threshold = 10; // percent
+  std::string isa;       // hash kernels, the fastest supported when empty
+};
+
+static Options options;
+static std::vector<Result> results;
+static volatile uint64_t sink;
+
+static const int REPETITIONS = 5;
+
+static double now_seconds() {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Time `op(n)`, which runs n iterations, and record the median ns per iteration
+template <typename Op>
+static void run(const std::string &name, double keys_per_op, Op op) {
+  if (!options.filter.empty() && name.find(options.filter) == std::string::npos) {
+    return;
+  }
+  // Warm up and double n until one repetition takes long enough
+  uint64_t n = 1;
+  for (;;) {
+    double start = now_seconds();
+    op(n);
+    double elapsed = now_seconds() - start;
+    if (elapsed >= options.min_time || n >= (1ULL << 40)) {
+      break;
+    }
+    n = elapsed > options.min_time / 64 ? (uint64_t)(n * options.min_time / elapsed) + 1 : n * 2;
+  }
+  std::vector<double> samples;
+  for (int r = 0; r < REPETITIONS; ++r) {
+    double start = now_seconds();
+    op(n);
+    samples.push_back((now_seconds() - start) * 1e9 / n);
+  }
+  std::sort(samples.begin(), samples.end());
+  Result result = {name, samples[REPETITIONS / 2], keys_per_op, n};
+  results.push_back(result);
+  if (keys_per_op > 0) {
+    fprintf(stderr, "%-28s %12.1f ns/op %14.0f keys/sec\n", name.c_str(), result.ns_per_op,
+            keys_per_op * 1e9 / result.ns_per_op);
+  } else {
+    fprintf(stderr, "%-28s %12.1f ns/op %14.0f ops/sec\n", name.c_str(), result.ns_per_op, 1e9 / result.ns_per_op);
+  }
+}
+
+static void bench_hashes() {
+  uint8_t buffers[8][65];
+  const uint8_t *inputs[8];
+  size_t lengths[8];
+  uint8_t sha_out[8][32];
+  uint8_t rmd_out[8][RIPEMD160_DIGEST_SIZE];
+  std::mt19937_64 rng(1);
+  for (int i = 0; i < 8; ++i) {
+    for (int j = 0; j < 65; ++j) buffers[i][j] = (uint8_t)rng();
+    inputs[i] = buffers[i];
+  }
+
+  // Feeding an output byte back into the input keeps iterations dependent
+  for (size_t length : {(size_t)33, (size_t)65}) {
+    for (int i = 0; i < 8; ++i) lengths[i] = length;
+    run("sha256_8x/" + std::to_string(length), 8, [&](uint64_t n) {
+      for (uint64_t i = 0; i < n; ++i) {
+        sha256_8x(inputs, lengths, sha_out);
+        buffers[0][1] ^= sha_out[0][0];
+      }
+    });
+  }
+
+  for (int i = 0; i < 8; ++i) lengths[i] = 32;
+  run("ripemd160_8x/32", 8, [&](uint64_t n) {
+    for (uint64_t i = 0; i < n; ++i) {
+      ripemd160_8x(inputs, lengths, rmd_out);
+      buffers[0][1] ^= rmd_out[0][0];
+    }
+  });
+
+  for (size_t length : {(size_t)33, (size_t)65}) {
+    for (int i = 0; i < 8; ++i) lengths[i] = length;
+    run("hash160_8x/" + std::to_string(length), 8, [&](uint64_t n) {
+      for (uint64_t i = 0; i < n; ++i) {
+        Address::pubkeys_to_hash160_8x(inputs, lengths, rmd_out);
+        buffers[0][1] ^= rmd_out[0][0];
+      }
+    });
+  }
+}
+
+// The 16-lane calls the scan loop makes: one pass of the AVX-512 kernels, two
+// 8-lane calls with the others
+static void bench_hashes_16() {
+  uint8_t buffers[16][65];
+  const uint8_t *inputs[16];
+  size_t lengths[16];
+  uint8_t sha_out[16][32];
+  uint8_t rmd_out[16][RIPEMD160_DIGEST_SIZE];
+  std::mt19937_64 rng(2);
+  for (int i = 0; i < 16; ++i) {
+    for (int j = 0; j < 65; ++j) buffers[i][j] = (uint8_t)rng();
+    inputs[i] = buffers[i];
+  }
+
+  for (size_t length : {(size_t)33, (size_t)65}) {
+    for (int i = 0; i < 16; ++i) lengths[i] = length;
+    run("sha256_16x/" + std::to_string(length), 16, [&](uint64_t n) {
+      for (uint64_t i = 0; i < n; ++i) {
+        sha256_16x(inputs, lengths, sha_out);
+        buffers[0][1] ^= sha_out[0][0];
+      }
+    });
+  }
+
+  for (int i = 0; i < 16; ++i) lengths[i] = 32;
+  run("ripemd160_16x/32", 16, [&](uint64_t n) {
+    for (uint64_t i = 0; i < n; ++i) {
+      ripemd160_16x(inputs, lengths, rmd_out);
+      buffers[0][1] ^= rmd_out[0][0];
+    }
+  });
+
+  for (size_t length : {(size_t)33, (size_t)65}) {
+    for (int i = 0; i < 16; ++i) lengths[i] = length;
+    run("hash160_16x/" + std::to_string(length), 16, [&](uint64_t n) {
+      for (uint64_t i = 0; i < n; ++i) {
+        Address::pubkeys_to_hash160_16x(inputs, lengths, rmd_out);
+        buffers[0][1] ^= rmd_out[0][0];
+      }
+    });
+  }
+}
+
+// hash160 of 16 keys with every kernel set this CPU supports, named
+// hash160_16x/<length>/<set>: which SHA-256 backend wins (SHA-NI against 8
+// or 16 vector lanes) differs from host to host
+static void bench_kernel_sets() {
+  std::string chosen = hash_isa_name();
+  uint8_t buffers[16][65];
+  const uint8_t *inputs[16];
+  size_t lengths[16];
+  uint8_t rmd_out[16][RIPEMD160_DIGEST_SIZE];
+  std::mt19937_64 rng(3);
+  for (int i = 0; i < 16; ++i) {
+    for (int j = 0; j < 65; ++j) buffers[i][j] = (uint8_t)rng();
+    inputs[i] = buffers[i];
+  }
+
+  for (int k = 0; k < hash_isa_count(); ++k) {
+    const char *isa = hash_isa_at(k);
+    if (hash_select_isa(isa) != 0) {
+      continue;
+    }
+    for (size_t length : {(size_t)33, (size_t)65}) {
+      for (int i = 0; i < 16; ++i) lengths[i] = length;
+      run("hash160_16x/" + std::to_string(length) + "/" + isa, 16, [&](uint64_t n) {
+        for (uint64_t i = 0; i < n; ++i) {
+          Address::pubkeys_to_hash160_16x(inputs, lengths, rmd_out);
+          buffers[0][1] ^= rmd_out[0][0];
+        }
+      });
+    }
+  }
+  hash_select_isa(chosen.c_str());
+}
+
+static void bench_ec(Secp256K1 &secp) {
+  Int key((uint64_t)0x1234567890ABCDEFULL);
+  Point point = secp.ComputePublicKey(&key, true);
+
+  run("serialize_pubkey", 1, [&](uint64_t n) {
+    for (uint64_t i = 0; i < n; ++i) {
+      SerializedPubKey serialized = Address::serialize_pubkey(point);
+      sink += serialized.compressed[1];
+    }
+  });
+
+  run("secp256k1/NextKey", 1, [&](uint64_t n) {
+    for (uint64_t i = 0; i < n; ++i) point = secp.NextKey(point);
+  });
+
+  run("secp256k1/AddAffine", 1, [&](uint64_t n) {
+    for (uint64_t i = 0; i < n; ++i) point = secp.AddAffine(point, secp.G);
+  });
+
+  run("secp256k1/ComputePublicKey", 1, [&](uint64_t n) {
+    for (uint64_t i = 0; i < n; ++i) {
+      Point p = secp.ComputePublicKey(&key, true);
+      key.AddOne();
+      sink += p.x.bits64[0];
+    }
+  });
+
+  // One op inverts the whole group; inverting twice gives the inputs back
+  for (int size : {16, 256, 4096}) {
+    std::vector<Int> ints(size);
+    for (int i = 0; i < size; ++i) ints[i].SetInt32((uint32_t)(i + 2));
+    IntGroup group(size);
+    group.Set(ints.data());
+    run("IntGroup::ModInv/" + std::to_string(size), size, [&](uint64_t n) {
+      for (uint64_t i = 0; i < n; ++i) group.ModInv();
+    });
+  }
+}
+
+static std::string random_hash160_hex(std::mt19937_64 &rng) {
+  static const char digits[] = "0123456789abcdef";
+  std::string hex(RIPEMD160_DIGEST_SIZE * 2, '0');
+  for (size_t i = 0; i < hex.size(); i += 16) {
+    uint64_t r = rng();
+    for (size_t j = i; j < i + 16 && j < hex.size(); ++j, r >>= 4) hex[j] = digits[r & 15];
+  }
+  return hex;
+}
+
+// Target lookups as check_pubkeys does them: every key is a miss but the one found.
+// screen/<size> is the prefix filter in front of them, per hash of a batch.
+static void bench_lookups() {
+  std::vector<uint64_t> sizes = {1, 1000, 1000000, 100000000};
+  for (uint64_t size : sizes) {
+    bool wanted = options.filter.empty() || ("lookup/hit/" + std::to_string(size)).find(options.filter) !=
+                                                 std::string::npos ||
+                  ("lookup/miss/" + std::to_string(size)).find(options.filter) != std::string::npos ||
+                  ("screen/" + std::to_string(size)).find(options.filter) != std::string::npos;
+    if (!wanted) {
+      continue;
+    }
+    // About 100 bytes per entry
+    if (size > options.max_targets) {
+      fprintf(stderr, "%-28s skipped, raise --max-targets to run it\n",
+              ("lookup/" + std::to_string(size)).c_str());
+      continue;
+    }
+    std::mt19937_64 rng(size);
+    std::unordered_set<std::string> targets;
+    targets.reserve(size);
+    std::vector<std::string> hits, misses;
+    for (uint64_t i = 0; i < size; ++i) {
+      std::string hex = random_hash160_hex(rng);
+      if (hits.size() < 4096) hits.push_back(hex);
+      targets.insert(std::move(hex));
+    }
+    for (int i = 0; i < 4096; ++i) misses.push_back(random_hash160_hex(rng));
+
+    for (int hit = 1; hit >= 0; --hit) {
+      const std::vector<std::string> &probes = hit ? hits : misses;
+      run(std::string(hit ? "lookup/hit/" : "lookup/miss/") + std::to_string(size), 0, [&](uint64_t n) {
+        uint64_t found = 0;
+        for (uint64_t i = 0; i < n; ++i) found += targets.find(probes[i % probes.size()]) != targets.end();
+        sink += found;
+      });
+    }
+
+    TargetFilter filter(targets);
+    std::vector<uint8_t> miss_bytes(misses.size() * 20);
+    for (size_t i = 0; i < misses.size(); ++i) {
+      for (int j = 0; j < 20; ++j) miss_bytes[i * 20 + j] = (uint8_t)std::stoi(misses[i].substr(2 * j, 2), nullptr, 16);
+    }
+    const uint8_t(*batches)[20] = (const uint8_t(*)[20])miss_bytes.data();
+    run("screen/" + std::to_string(size), 0, [&](uint64_t n) {
+      uint64_t passed = 0;
+      for (uint64_t i = 0; i < n; i += 16) passed += __builtin_popcount(filter.Screen(batches + i % misses.size(), 16));
+      sink += passed;
+    });
+  }
+}
+
+// Range claims from several threads, as get_random_range does them for a local
+// job: the range mutex, then the scheduler
+static void bench_claims() {
+  unsigned cores = std::max(1u, std::thread::hardware_concurrency());
+  std::vector<unsigned> counts = {1, 2, 4, 8};
+  if (std::find(counts.begin(), counts.end(), cores) == counts.end()) counts.push_back(cores);
+  for (unsigned threads : counts) {
+    ChunkScheduler scheduler;
+    scheduler.Init(ChunkIndex(1ULL << 62), 1);
+    std::mutex range_mutex;
+    run("claim_range/" + std::to_string(threads), 0, [&](uint64_t n) {
+      std::vector<std::thread> pool;
+      for (unsigned t = 0; t < threads; ++t) {
+        uint64_t claims = n / threads + (t < n % threads);
+        pool.emplace_back([&, claims]() {
+          ChunkIndex idx;
+          for (uint64_t i = 0; i < claims; ++i) {
+            { std::lock_guard<std::mutex> lock(range_mutex); }
+            scheduler.Claim(idx);
+          }
+        });
+      }
+      for (auto &t : pool) t.join();
+    });
+  }
+}
+
+static std::string to_json() {
+  std::ostringstream out;
+  out << "{\n  \"isa\": \"" << hash_isa_name() << "\",\n  \"benchmarks\": [\n";
+  for (size_t i = 0; i < results.size(); ++i) {
+    const Result &r = results[i];
+    char line[256];
+    if (r.keys_per_op > 0) {
+      snprintf(line, sizeof(line),
+               "    {\"name\": \"%s\", \"ns_per_op\": %.2f, \"keys_per_sec\": %.0f, \"iterations\": %llu}",
+               r.name.c_str(), r.ns_per_op, r.keys_per_op * 1e9 / r.ns_per_op, (unsigned long long)r.iterations);
+    } else {
+      snprintf(line, sizeof(line), "    {\"name\": \"%s\", \"ns_per_op\": %.2f, \"iterations\": %llu}",
+               r.name.c_str(), r.ns_per_op, (unsigned long long)r.iterations);
+    }
+    out << line << (i + 1 < results.size() ? ",\n" : "\n");
+  }
+  out << "  ]\n}\n";
+  return out.str();
+}
+
+// name -> ns/op of a file written by to_json
+static bool load_baseline(const std::string &path, std::map<std::string, double> &baseline) {
+  std::ifstream file(path);
+  if (!file.is_open()) {
+    return false;
+  }
+  std::string line;
+  while (std::getline(file, line)) {
+    size_t name_at = line.find("\"name\": \"");
+    size_t ns_at = line.find("\"ns_per_op\": ");
+    if (name_at == std::string::npos || ns_at == std::string::npos) {
+      continue;
+    }
+    name_at += 9;
+    std::string name = line.substr(name_at, line.find('"', name_at) - name_at);
+    baseline[name] = strtod(line.c_str() + ns_at + 13, nullptr);
+  }
+  return true;
+}
+
+// Returns the number of benchmarks slower than the baseline by more than the threshold
+static int compare(const std::map<std::string, double> &baseline) {
+  int regressions = 0;
+  fprintf(stderr, "\n%-28s %12s %12s %8s\n", "benchmark", "baseline", "now", "change");
+  for (const Result &r : results) {
+    auto it = baseline.find(r.name);
+    if (it == baseline.end() || it->second <= 0) {
+      fprintf(stderr, "%-28s %12s %12.1f %8s\n", r.name.c_str(), "-", r.ns_per_op, "new");
+      continue;
+    }
+    double change = (r.ns_per_op / it->second - 1) * 100;
+    bool regressed = change > options.threshold;
+    regressions += regressed;
+    fprintf(stderr, "%-28s %12.1f %12.1f %+7.1f%%%s\n", r.name.c_str(), it->second, r.ns_per_op, change,
+            regressed ? "  REGRESSION" : "");
+  }
+  return regressions;
+}
+
+static void usage(const char *prog) {
+  fprintf(stderr,
+          "Usage: %s [--filter <substring>] [--min-time <seconds>] [--max-targets <n>]\n"
+          "          [--out <file.json>] [--compare <baseline.json>] [--threshold <percent>]\n"
+          "          [--force-isa <name>]\n",
+          prog);
+}
+
+int main(int argc, char **argv) {
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    bool has_value = i + 1 < argc;
+    if (arg == "--filter" && has_value) {
+      options.filter = argv[++i];
+    } else if (arg == "--min-time" && has_value) {
+      options.min_time = atof(argv[++i]);
+    } else if (arg == "--max-targets" && has_value) {
+      options.max_targets = strtoull(argv[++i], nullptr, 10);
+    } else if (arg == "--out" && has_value) {
+      options.out = argv[++i];
+    } else if (arg == "--compare" && has_value) {
+      options.compare = argv[++i];
+    } else if (arg == "--threshold" && has_value) {
+      options.threshold = atof(argv[++i]);
+    } else if (arg == "--force-isa" && has_value) {
+      options.isa = argv[++i];
+    } else {
+      usage(argv[0]);
+      return 1;
+    }
+  }
+  if (options.min_time <= 0) {
+    usage(argv[0]);
+    return 1;
+  }
+
+  std::map<std::string, double> baseline;
+  if (!options.compare.empty() && !load_baseline(options.compare, baseline)) {
+    fprintf(stderr, "Cannot read baseline %s\n", options.compare.c_str());
+    return 1;
+  }
+
+  if (hash_select_isa(options.isa.empty() ? nullptr : options.isa.c_str()) != 0) {
+    fprintf(stderr, "Hash kernels %s unknown or not supported by this CPU\n", options.isa.c_str());
+    return 1;
+  }
+  fprintf(stderr, "Hash kernels: %s\n", hash_isa_name());
+
+  Secp256K1 secp;
+  secp.Init();
+
+  bench_hashes();
+  bench_hashes_16();
+  bench_kernel_sets();
+  bench_ec(secp);
+  bench_lookups();
+  bench_claims();
+
+  std::string json = to_json();
+  if (options.out.empty()) {
+    fputs(json.c_str(), stdout);
+  } else {
+    std::ofstream file(options.out);
+    file << json;
+    if (!file.good()) {
+      fprintf(stderr, "Cannot write %s\n", options.out.c_str());
+      return 1;
+    }
+  }
+
+  if (!options.compare.empty()) {
+    int regressions = compare(baseline);
+    if (regressions > 0) {
+      fprintf(stderr, "%d benchmark(s) slower than the baseline by more than %.0f%%\n", regressions,
+              options.threshold);
+      return 2;
+    }
+  }
+  return 0;
+}
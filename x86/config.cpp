@@ -1,19 +1,164 @@
 #include "config.h"
+#include "Topology.h"
 #include <iostream>
 #include <fstream>
 #include <sstream>
 #include <vector>
 #include <string>
 
-int load_config(std::string path, Config &config) {
+// Settings of the worker pool, shared by load_config and load_job_list.
+// Returns 1 if handled, 0 if `key` is not a pool setting, -1 on a bad value.
+static int parse_pool_setting(const std::string &key, const std::string &value, Config &config) {
+    if (key == "workers") {
+        try {
+            config.workers = std::stoi(value);
+        } catch (const std::exception& e) {
+            std::cerr << "Error parsing workers: " << e.what() << std::endl;
+            return -1;
+        }
+    } else if (key == "cpu_affinity") {
+        std::vector<int> cpus;
+        if (value != "none" && value != "auto" && !Topology::parse_cpu_list(value, cpus)) {
+            std::cerr << "Error parsing cpu_affinity: expected none, auto or a cpu list" << std::endl;
+            return -1;
+        }
+        config.cpu_affinity = value;
+    } else if (key == "control_socket") {
+        config.control_socket = value;
+    } else if (key == "metrics_listen") {
+        config.metrics_listen = value;
+    } else if (key == "metrics_file") {
+        config.metrics_file = value;
+    } else if (key == "log_json") {
+        // Workers and the speed monitor write stdout under their own locks,
+        // so JSON lines there would land mid-line
+        if (value == "-") {
+            std::cerr << "Error parsing log_json: expected a file path, stdout is the console log" << std::endl;
+            return -1;
+        }
+        config.log_json = value;
+    } else if (key == "log_lines_per_second") {
+        try {
+            config.log_lines_per_second = std::stoi(value);
+        } catch (const std::exception& e) {
+            std::cerr << "Error parsing log_lines_per_second: " << e.what() << std::endl;
+            return -1;
+        }
+    } else if (key == "smt_pairing" || key == "tail_scheduling") {
+        const char *other = key == "smt_pairing" ? "split" : "speed";
+        if (value != "none" && value != other) {
+            std::cerr << "Error parsing " << key << ": expected none or " << other << std::endl;
+            return -1;
+        }
+        if (key == "smt_pairing") {
+            config.smt_pairing = value;
+        } else {
+            config.tail_scheduling = value;
+        }
+    } else {
+        return 0;
+    }
+    return 1;
+}
+
+// Index of the range starting at the hex key `value`. Returns false if no range starts there.
+static bool range_index(Config &config, const std::string &value, ChunkIndex &idx) {
+    Int offset;
+    offset.SetBase16((char*)value.c_str());
+    if (offset.IsLower(config.range_start)) {
+        std::cerr << "Ignoring range outside of the job: " << value << std::endl;
+        return false;
+    }
+    offset.Sub(config.range_start);
+    Int rem;
+    offset.Div(config.range_size, &rem);
+    idx = ChunkIndex::FromInt(offset);
+    if (!rem.IsZero() || !(idx < config.total_ranges)) {
+        std::cerr << "Ignoring range outside of the job: " << value << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// `range: <range start> [<digest>]`
+static bool parse_range(Config &config, const std::string &value, ChunkIndex &idx, ChunkDigest &digest) {
+    std::istringstream fields(value);
+    std::string start, recorded;
+    if (!(fields >> start) || !range_index(config, start, idx)) {
+        return false;
+    }
+    if (fields >> recorded && !digest.Parse(recorded)) {
+        std::cerr << "Ignoring digest of range: " << value << std::endl;
+        digest = ChunkDigest();
+    }
+    return true;
+}
+
+// `ranges: <first range start> <last range start>`
+static bool parse_run(Config &config, const std::string &value, ChunkInterval &run) {
+    std::istringstream fields(value);
+    std::string first, last;
+    if (!(fields >> first >> last) || !range_index(config, first, run.first) ||
+        !range_index(config, last, run.last) || run.last < run.first) {
+        std::cerr << "Ignoring run of ranges: " << value << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// `partial: <range start> <next key to scan> [<digest so far>]`
+static bool parse_partial(Config &config, const std::string &value, PartialRange &partial) {
+    std::istringstream fields(value);
+    std::string start, next, recorded;
+    Int first, last;
+    if (!(fields >> start >> next) || !range_index(config, start, partial.idx)) {
+        std::cerr << "Ignoring partial range: " << value << std::endl;
+        return false;
+    }
+    partial.next.SetBase16((char*)next.c_str());
+    first.SetBase16((char*)start.c_str());
+    last = first;
+    last.Add(config.range_size);
+    if (partial.next.IsLower(&first) || !partial.next.IsLower(&last) ||
+        (fields >> recorded && !partial.digest.Parse(recorded))) {
+        std::cerr << "Ignoring partial range: " << value << std::endl;
+        return false;
+    }
+    return true;
+}
+
+static void set_pool_defaults(Config &config) {
+    config.workers = 1;
+    config.cpu_affinity = "none";
+    config.smt_pairing = "none";
+    config.tail_scheduling = "none";
+    config.control_socket = "";
+    config.metrics_listen = "";
+    config.metrics_file = "";
+    config.log_json = "";
+    config.log_lines_per_second = 10;
+}
+
+int load_config(std::string path, Config &config, bool read_checkpoint) {
     config.range_start = new Int();
     config.range_end = new Int();
     config.range_size = new Int();
-    config.workers = 1;
+    set_pool_defaults(config);
     config.addresses = std::vector<std::string>();
-    config.scanned_ranges = std::vector<Int *>();
+    config.scanned_ranges = std::vector<ChunkIndex>();
+    config.partial_ranges = std::vector<PartialRange>();
+    config.scanned_runs = std::vector<ChunkInterval>();
+    config.scanned_words = std::vector<uint64_t>();
     config.found_keys_file = "found_keys.txt";
-    config.total_ranges = 0;
+    config.total_ranges = ChunkIndex();
+    config.lease_seconds = 60;
+    config.lease_timeout = 300;
+    config.shared_progress = "";
+    config.checkpoint_journal = "";
+    config.journal_fsync_ms = 1000;
+    std::vector<std::string> range_lines;
+    std::vector<std::string> runs_lines;
+    std::vector<std::string> partial_lines;
     
     // Track required fields
     bool has_range_start = false;
@@ -46,25 +191,57 @@ int load_config(std::string path, Config &config) {
             } else if (key == "range_size") {
                 config.range_size->SetBase16((char*)value.c_str());
                 has_range_size = true;
-            } else if (key == "workers") {
-                try {
-                    config.workers = std::stoi(value);
-                    has_workers = true;
-                } catch (const std::exception& e) {
-                    std::cerr << "Error parsing workers: " << e.what() << std::endl;
+            } else if (int pool = parse_pool_setting(key, value, config)) {
+                if (pool == -1) {
                     file.close();
                     free_config(config);
                     return -1;
                 }
+                has_workers = has_workers || key == "workers";
             } else if (key == "address") {
                 config.addresses.push_back(value);
                 has_address = true;
             } else if (key == "range") {
-                Int* range = new Int();
-                range->SetBase16((char*)value.c_str());
-                config.scanned_ranges.push_back(range);
+                if (read_checkpoint) range_lines.push_back(value);
+            } else if (key == "ranges") {
+                if (read_checkpoint) runs_lines.push_back(value);
+            } else if (key == "partial") {
+                if (read_checkpoint) partial_lines.push_back(value);
             } else if (key == "found_keys_file") {
                 config.found_keys_file = value;
+            } else if (key == "shared_progress") {
+                config.shared_progress = value;
+            } else if (key == "checkpoint_journal") {
+                config.checkpoint_journal = value;
+            } else if (key == "journal_fsync_ms") {
+                try {
+                    config.journal_fsync_ms = std::stoi(value);
+                    if (config.journal_fsync_ms < 0) {
+                        throw std::invalid_argument("must not be negative");
+                    }
+                } catch (const std::exception& e) {
+                    std::cerr << "Error parsing journal_fsync_ms: " << e.what() << std::endl;
+                    file.close();
+                    free_config(config);
+                    return -1;
+                }
+            } else if (key == "lease_seconds" || key == "lease_timeout") {
+                try {
+                    int seconds = std::stoi(value);
+                    if (seconds <= 0) {
+                        throw std::invalid_argument("must be positive");
+                    }
+                    if (key == "lease_seconds") {
+                        config.lease_seconds = seconds;
+                    } else {
+                        config.lease_timeout = seconds;
+                    }
+                } catch (const std::exception& e) {
+                    std::cerr << "Error parsing " << key << ": " << e.what() << std::endl;
+                    file.close();
+                    free_config(config);
+                    return -1;
+                }
             }
         }
     }
@@ -78,17 +255,153 @@ int load_config(std::string path, Config &config) {
         return -1;
     }
 
-    // Pre-compute total number of ranges
+    if (compute_total_ranges(config) == -1) {
+        free_config(config);
+        return -1;
+    }
+
+    // Turn the scanned range starts into range indices
+    for (std::string &value : range_lines) {
+        ChunkIndex idx;
+        ChunkDigest digest;
+        if (parse_range(config, value, idx, digest)) {
+            config.scanned_ranges.push_back(idx);
+        }
+    }
+    for (std::string &value : runs_lines) {
+        ChunkInterval run;
+        if (parse_run(config, value, run)) {
+            config.scanned_runs.push_back(run);
+        }
+    }
+    for (std::string &value : partial_lines) {
+        PartialRange partial;
+        if (parse_partial(config, value, partial)) {
+            config.partial_ranges.push_back(partial);
+        }
+    }
+
+    return 0;
+}
+
+int stream_checkpoint(std::string path, Config &config,
+                      const std::function<void(const ChunkInterval &)> &on_run,
+                      const std::function<void(const PartialRange &)> &on_partial,
+                      const std::function<void(const ChunkIndex &, const ChunkDigest &)> &on_digest) {
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        std::cerr << "Could not open config file: " << path << std::endl;
+        return -1;
+    }
+
+    std::string line;
+    while (std::getline(file, line)) {
+        std::istringstream iss(line);
+        std::string key, value;
+        if (!std::getline(iss, key, ':') || !std::getline(iss, value)) {
+            continue;
+        }
+        value.erase(0, value.find_first_not_of(" \t"));
+
+        ChunkInterval run;
+        PartialRange partial;
+        ChunkDigest digest;
+        if (key == "range" && parse_range(config, value, run.first, digest)) {
+            run.last = run.first;
+            on_run(run);
+            if (on_digest && !digest.IsEmpty()) on_digest(run.first, digest);
+        } else if (key == "ranges" && parse_run(config, value, run)) {
+            on_run(run);
+        } else if (key == "partial" && parse_partial(config, value, partial)) {
+            on_partial(partial);
+        }
+    }
+    return 0;
+}
+
+int load_job_list(std::string path, Config &settings, std::vector<JobListEntry> &jobs) {
+    settings.range_start = nullptr;
+    settings.range_end = nullptr;
+    settings.range_size = nullptr;
+    set_pool_defaults(settings);
+    jobs.clear();
+
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        std::cerr << "Could not open job list: " << path << std::endl;
+        return -1;
+    }
+
+    // Job config paths are relative to the job list
+    std::string dir;
+    size_t slash = path.find_last_of('/');
+    if (slash != std::string::npos) {
+        dir = path.substr(0, slash + 1);
+    }
+
+    std::string line;
+    while (std::getline(file, line)) {
+        std::istringstream iss(line);
+        std::string key, value;
+        if (!std::getline(iss, key, ':') || !std::getline(iss, value)) {
+            continue;
+        }
+        value.erase(0, value.find_first_not_of(" \t"));
+
+        int pool = parse_pool_setting(key, value, settings);
+        if (pool == -1) {
+            return -1;
+        }
+        if (pool == 0 && key == "job") {
+            std::istringstream fields(value);
+            JobListEntry job;
+            std::string weight;
+            job.weight = 1;
+            try {
+                if (!(fields >> job.config_file)) {
+                    throw std::invalid_argument("missing config file");
+                }
+                if (fields >> weight) {
+                    job.weight = std::stod(weight);
+                }
+                if (job.weight <= 0) {
+                    throw std::invalid_argument("weight must be positive");
+                }
+            } catch (const std::exception& e) {
+                std::cerr << "Error parsing job: " << e.what() << std::endl;
+                return -1;
+            }
+            if (job.config_file[0] != '/') {
+                job.config_file = dir + job.config_file;
+            }
+            jobs.push_back(job);
+        }
+    }
+
+    if (jobs.empty()) {
+        std::cerr << "Job list has no job: lines" << std::endl;
+        return -1;
+    }
+    return 0;
+}
+
+int compute_total_ranges(Config &config) {
+    if (config.range_size->IsZero() || config.range_end->IsLower(config.range_start)) {
+        std::cerr << "Invalid range: range_size must be non-zero and range_end >= range_start" << std::endl;
+        return -1;
+    }
+
+    // Pre-compute total number of ranges. range_end is inclusive and the
+    // last range may be partial, so round up.
     Int total_ranges = *config.range_end;
     total_ranges.Sub(config.range_start);
-    total_ranges.Div(config.range_size);
-    Int uint64_max(UINT64_MAX);
-    if (total_ranges.IsGreater(&uint64_max)) {
-        config.total_ranges = UINT64_MAX;
-    } else {
-        config.total_ranges = std::stoull(total_ranges.GetBase10());
+    total_ranges.AddOne();
+    Int remainder;
+    total_ranges.Div(config.range_size, &remainder);
+    if (!remainder.IsZero()) {
+        total_ranges.AddOne();
     }
-
+    config.total_ranges = ChunkIndex::FromInt(total_ranges);
     return 0;
 }
 
@@ -96,11 +409,14 @@ void free_config(Config &config) {
     delete config.range_start;
     delete config.range_end;
     delete config.range_size;
+    config.range_start = nullptr;
+    config.range_end = nullptr;
+    config.range_size = nullptr;
     
-    for (Int *range : config.scanned_ranges) {
-        delete range;
-    }
     config.scanned_ranges.clear();
+    config.partial_ranges.clear();
+    config.scanned_runs.clear();
+    config.scanned_words.clear();
 }
 
 void save_default_config(std::string path) {
@@ -123,7 +439,7 @@ void save_default_config(std::string path) {
     
     config.workers = 1;
     config.addresses = {"1PWo3JeB9jrGwfHDNpdGK54CRas7fsVzXU"};
-    config.scanned_ranges = std::vector<Int *>();
+    config.scanned_ranges = std::vector<ChunkIndex>();
     config.found_keys_file = "found_keys.txt";
 
     std::ofstream file(path);
@@ -135,9 +451,6 @@ void save_default_config(std::string path) {
     for (std::string address : config.addresses) {
         file << "address: " << address << std::endl;
     }
-    for (Int *range : config.scanned_ranges) {
-        file << "range: " << range->GetBase16() << std::endl;
-    }
     file << "found_keys_file: " << config.found_keys_file << std::endl;
     file.close();
     
@@ -152,8 +465,42 @@ void print_config(Config &config) {
     std::cout << "Range end:     " << "0x" << config.range_end->GetBase16() << std::endl;
     std::cout << "Range size:    " << "0x" << config.range_size->GetBase16() << std::endl;
     std::cout << "Addresses:     " << config.addresses.size() << std::endl;
-    std::cout << "Scanned:       " << config.scanned_ranges.size() << "/" << config.total_ranges << std::endl;
+    ChunkIndex scanned((uint64_t)config.scanned_ranges.size());
+    for (const ChunkInterval &run : config.scanned_runs) {
+        scanned.Add(run.Size());
+    }
+    for (size_t i = 1; i < config.scanned_words.size(); i += 2) {
+        scanned.Add(ChunkIndex((uint64_t)__builtin_popcountll(config.scanned_words[i])));
+    }
+    std::cout << "Scanned:       " << scanned.GetBase10() << "/" << config.total_ranges.GetBase10() << std::endl;
     std::cout << "Workers:       " << config.workers << std::endl;
+    if (config.cpu_affinity != "none") {
+        std::cout << "CPU affinity:  " << config.cpu_affinity << std::endl;
+    }
+    if (config.smt_pairing != "none") {
+        std::cout << "SMT pairing:   " << config.smt_pairing << std::endl;
+    }
+    if (config.tail_scheduling != "none") {
+        std::cout << "Tail policy:   " << config.tail_scheduling << std::endl;
+    }
+    if (!config.control_socket.empty()) {
+        std::cout << "Control:       " << config.control_socket << std::endl;
+    }
+    if (!config.metrics_listen.empty()) {
+        std::cout << "Metrics:       " << config.metrics_listen << std::endl;
+    }
+    if (!config.metrics_file.empty()) {
+        std::cout << "Metrics file:  " << config.metrics_file << std::endl;
+    }
+    if (!config.log_json.empty()) {
+        std::cout << "JSON log:      " << config.log_json << std::endl;
+    }
     std::cout << "Found keys:    " << config.found_keys_file << std::endl;
+    if (!config.shared_progress.empty()) {
+        std::cout << "Progress file: " << config.shared_progress << std::endl;
+    }
+    if (!config.checkpoint_journal.empty()) {
+        std::cout << "Journal:       " << config.checkpoint_journal << std::endl;
+    }
     std::cout << "================================================" << std::endl;
 }
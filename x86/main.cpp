@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <cctype>
 #include <iostream>
 #include <unordered_set>
@@ -10,31 +11,120 @@
 #include <condition_variable>
 #include <chrono>
 #include <iomanip>
+#include <csignal>
+#include <deque>
+#include <map>
+#include <memory>
+#include <set>
+#include <sstream>
+#include <unistd.h>
 
 #include "base58.hpp"
 #include "include/secp256k1.h"
 #include "config.h"
 #include "Address.h"
 #include "HexUtil.hpp"
+#include "Scheduler.h"
+#include "Coordinator.h"
+#include "SharedProgress.h"
+#include "Journal.h"
+#include "Checkpoint.h"
+#include "Topology.h"
+#include "SpscRing.hpp"
+#include "WorkerPool.h"
+#include "Metrics.h"
+#include "Profiler.h"
+#include "EventLog.h"
+#include "Scanner.h"
 
 #define PROGRAM_NAME "BitCrackCPU"
 
-std::unordered_set<std::string> hash160_set;
+// One scan job: a key interval, its targets and its checkpoint. --resume runs
+// a single job; --jobs serves several from the same worker pool.
+struct Job {
+  int id = 0;             // index in jobs
+  std::string config_file;
+  Config config;
+  double weight = 1;
+  double chunk_keys = 0;  // keys per range, charged to the job's fair share
+  ChunkScheduler scheduler;
+  SharedProgress progress;
+  bool shared = false;    // progress is open (shared_progress is configured)
+  CheckpointJournal journal; // open when checkpoint_journal is configured
+  std::deque<PartialRange> resume; // interrupted ranges to finish first, guarded by range_mutex
+  std::unordered_set<std::string> targets;
+  // Per NUMA node copies of targets, empty unless workers are pinned on a multi-node host
+  std::vector<std::unordered_set<std::string>> target_replicas;
+  // Prefix screen over targets, read by every worker before any lookup
+  TargetFilter target_filter;
+  // Per NUMA node copies of target_filter, built alongside target_replicas
+  std::vector<TargetFilter> filter_replicas;
+  std::atomic<uint64_t> ranges_completed{0};
+  // Ranges claimed by this process's workers and those finished (completed or
+  // interrupted), for the metrics
+  std::atomic<uint64_t> ranges_claimed{0};
+  std::atomic<uint64_t> ranges_finished{0};
+  std::atomic<uint64_t> ranges_interrupted{0};
+  LatencyHistogram range_time;   // scanning time of each completed range
+  LatencyHistogram journal_sync; // write and fdatasync of the journal
+};
+std::vector<std::unique_ptr<Job>> jobs; // index == id in fair_share
+FairShare fair_share;
+
+// secp256k1 contexts, one per NUMA node that runs workers (a single one
+// otherwise). The generator tables are read-only after Init, so all workers
+// and all jobs on a node share them instead of building one set per thread.
+std::vector<std::unique_ptr<Secp256K1>> ec_contexts;
+
+struct WorkerPlacement {
+  int cpu;
+  int node;    // NUMA node id
+  int replica; // index into ec_contexts and each job's target_replicas
+};
+std::vector<WorkerPlacement> worker_placement; // empty when cpu_affinity is none
+std::vector<Topology::CpuInfo> cpu_topology;
+
+std::unique_ptr<WorkerStats[]> worker_stats;
+uint64_t worker_stats_count = 0;
+
+// Keys handed from the EC thread to the hashing thread of an SMT pair
+struct KeyBatch {
+  SerializedPubKey pubkeys[SCAN_BATCH];
+  Int first;            // private key of pubkeys[0]
+  Job *job;
+  ChunkIndex range_idx;
+  int count;            // keys of the batch in its range: SCAN_BATCH, fewer at the range end
+  bool last;            // final batch of its range, cut short by a drain if it ends before the range
+  ChunkDigest carried;  // digest of the keys scanned before the range was resumed
+};
+typedef SpscRing<KeyBatch, 64> KeyBatchRing;
 std::mutex config_mutex;
 std::mutex range_mutex;
 std::mutex found_keys_mutex;
 std::mutex speed_mutex;
 std::condition_variable range_cv;
 std::atomic<bool> shutdown_flag(false);
-std::atomic<uint64_t> total_ranges_completed(0);
-std::atomic<uint64_t> total_keys_processed(0);
+// SIGINT / SIGTERM or the end of --time-budget: finish the current batch,
+// record how far each range got and stop claiming
+std::atomic<bool> drain_requested(false);
+std::atomic<uint64_t> target_hits(0);
+std::atomic<uint64_t> last_keys_per_second(0); // over the speed monitor's last second
+CoordinatorClient *coordinator_client = nullptr; // set in --worker mode
+WorkerPool *worker_pool = nullptr;
+// SIGUSR1 / SIGUSR2 grow / shrink the pool by one worker (or SMT pair)
+std::atomic<int> pool_grow_signals(0);
+std::atomic<int> pool_shrink_signals(0);
+std::deque<ChunkIndex> leased_ranges;            // guarded by range_mutex
+bool leasing = false; // a worker is waiting on a LEASE reply, guarded by range_mutex
+Profiler *profiler = nullptr;                    // set by --profile
+EventLog *event_log = nullptr; // status output, printed directly while it is not running
 std::chrono::time_point<std::chrono::steady_clock> start_time;
 
-void decode_addresses_into_hash160(Config &config) {
-  for (auto address : config.addresses) {
+void decode_addresses_into_hash160(Job &job) {
+  for (auto address : job.config.addresses) {
     auto hash160 = base58::ExtractHash160(address);
     auto hash160_hex = HexUtil::toHex(hash160.data(), 20);
-    hash160_set.insert(hash160_hex);
+    job.targets.insert(hash160_hex);
   }
 }
 
@@ -49,207 +139,412 @@ void save_found_key(const std::string& privkey, const std::string& address, cons
     std::lock_guard<std::mutex> cerr_lock(config_mutex);
     std::cerr << "[!] Failed to write to found keys file: " << found_keys_file << std::endl;
   }
+
+  // Central collection on the coordinator; the local file is kept as a backup
+  if (coordinator_client && !coordinator_client->Found(privkey, address)) {
+    std::lock_guard<std::mutex> cerr_lock(config_mutex);
+    std::cerr << "[!] Failed to report found key to coordinator" << std::endl;
+  }
+}
+
+// Print and save a key the scan engine found, for a job writing to `found_keys_file`
+HitHandler report_hits(const std::string& found_keys_file) {
+  return [found_keys_file](const Int& privkey, const std::string& hash160_hex, bool) {
+    target_hits.fetch_add(1, std::memory_order_relaxed);
+    Int key = privkey;
+    auto address = Address::encodeP2PKH_Mainnet(hash160_hex);
+    auto key_hex = key.GetBase16();
+    {
+      std::lock_guard<std::mutex> cout_lock(config_mutex);
+      std::cout << "Found Private Key: 0x" << key_hex << " Address: " << address << std::endl;
+    }
+    save_found_key(key_hex, address, found_keys_file);
+  };
+}
+
+// Chunks completed so far: restored plus claimed locally, completed in --worker mode,
+// or completed by every process sharing the progress file
+uint64_t scanned_count(Job& job) {
+  if (coordinator_client) {
+    return job.ranges_completed;
+  }
+  if (job.shared) {
+    return job.progress.CompletedCount();
+  }
+  return job.scheduler.ScannedCount();
 }
 
-void scan_range(
-  Secp256K1 *s,
-  Int start,
-  Int end,
-  const std::string& found_keys_file
-) {
-  // Compute the start pubkey.
-  Point current = s->ComputePublicKey(&start, true);
+// Keys scanned by all workers since the start
+uint64_t total_keys_processed() {
+  uint64_t keys = 0;
+  for (uint64_t w = 0; w < worker_stats_count; w++) {
+    keys += worker_stats[w].scanned.load(std::memory_order_relaxed);
+  }
+  return keys;
+}
 
-  Point G = s->G;
+double average_keys_per_second() {
+  auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+      std::chrono::steady_clock::now() - start_time).count();
+  return elapsed > 0 ? total_keys_processed() * 1000.0 / elapsed : 0;
+}
 
-  while (start.IsLower(&end)) {
-    std::vector<SerializedPubKey> pubkeys(8);
-    for (int i = 0; i < 8; i++) {
-      pubkeys[i] = Address::serialize_pubkey(current);
-      current = s->NextKey(current);
-    }
+// Keys per second a worker achieved on the ranges it finished, 0 before the first one
+double worker_rate(uint64_t worker_id) {
+  if (worker_id >= worker_stats_count) {
+    return 0;
+  }
+  uint64_t busy_us = worker_stats[worker_id].busy_us.load(std::memory_order_relaxed);
+  uint64_t keys = worker_stats[worker_id].keys.load(std::memory_order_relaxed);
+  return busy_us > 0 ? keys * 1e6 / busy_us : 0;
+}
 
-   std::vector<std::array<unsigned char, 65>> uncomp_pubkeys(8);
-    std::vector<std::array<unsigned char, 33>> comp_pubkeys(8);
-    for (int i = 0; i < 8; i++) {
-      uncomp_pubkeys[i] = pubkeys[i].uncompressed;
-      comp_pubkeys[i] = pubkeys[i].compressed;
-    }
+// Returns the time spent on the range in microseconds
+uint64_t record_range_stats(uint64_t worker_id, uint64_t keys,
+                            std::chrono::steady_clock::time_point began) {
+  auto busy = std::chrono::duration_cast<std::chrono::microseconds>(
+      std::chrono::steady_clock::now() - began).count();
+  worker_stats[worker_id].keys.fetch_add(keys, std::memory_order_relaxed);
+  worker_stats[worker_id].busy_us.fetch_add((uint64_t)busy, std::memory_order_relaxed);
+  return (uint64_t)busy;
+}
 
-    const uint8_t *uncomp_pubkeys_ptrs[8];
-    for (int i = 0; i < 8; i++) {
-      uncomp_pubkeys_ptrs[i] = uncomp_pubkeys[i].data();
+// tail_scheduling: speed. A worker should not claim a range it would finish
+// only after the other workers have cleared everything that is left; on
+// hybrid or SMT-shared cores the slowest worker otherwise sets the job's end.
+bool should_leave_tail(Config& settings, uint64_t worker_id) {
+  if (settings.tail_scheduling != "speed" || coordinator_client) {
+    return false;
+  }
+  // Only the local scheduler knows how many ranges are still unclaimed
+  ChunkIndex remaining;
+  for (auto& job : jobs) {
+    if (job->shared) {
+      return false;
     }
-    const size_t lengths[8] = {65, 65, 65, 65, 65, 65, 65, 65};
-    std::vector<std::string> hash160_uncomp =
-      Address::pubkeys_to_hash160_hex_8x(uncomp_pubkeys_ptrs, lengths);
-    
-    const uint8_t *comp_pubkeys_ptrs[8];
-    for (int i = 0; i < 8; i++) {
-      comp_pubkeys_ptrs[i] = comp_pubkeys[i].data();
-    }
-    const size_t comp_lengths[8] = {33, 33, 33, 33, 33, 33, 33, 33};
-    std::vector<std::string> hash160_comp =
-      Address::pubkeys_to_hash160_hex_8x(comp_pubkeys_ptrs, comp_lengths);
-
-    for (int i = 0; i < 8; i++) {
-      Int found_privkey = start;
-      found_privkey.Add(i);
-     
-      bool found_uncomp = false;
-      bool found_comp = false;
-      std::string uncomp_hash = hash160_uncomp[i];
-      std::string comp_hash = hash160_comp[i];
-      
-      found_uncomp = hash160_set.find(uncomp_hash) != hash160_set.end();
-      found_comp = hash160_set.find(comp_hash) != hash160_set.end();
-
-      if (found_uncomp) {
-        auto address = Address::encodeP2PKH_Mainnet(uncomp_hash);
-        auto privkey = found_privkey.GetBase16();
-        {
-          std::lock_guard<std::mutex> cout_lock(config_mutex);
-          std::cout << "Found Private Key: 0x" << privkey << " Address: " << address << std::endl;
-        }
-        save_found_key(privkey, address, found_keys_file);
-      }
+    ChunkIndex left = job->scheduler.Total();
+    left.Sub(ChunkIndex(job->scheduler.ScannedCount()));
+    remaining.Add(left);
+  }
+  double mine = worker_rate(worker_id);
+  if (!remaining.FitsUint64() || mine <= 0) {
+    return false;
+  }
 
-      if (found_comp) {
-        auto address = Address::encodeP2PKH_Mainnet(comp_hash);
-        auto privkey = found_privkey.GetBase16();
-        {
-          std::lock_guard<std::mutex> cout_lock(config_mutex);
-          std::cout << "Found Private Key: 0x" << privkey << " Address: " << address << std::endl;
-        }
-        save_found_key(privkey, address, found_keys_file);
-      }
+  double others = 0;
+  for (uint64_t w = 0; w < worker_stats_count; w++) {
+    if (w != worker_id && worker_stats[w].active.load(std::memory_order_relaxed)) {
+      others += worker_rate(w);
     }
-    start.Add(8);
-    // Increment keys processed counter
-    total_keys_processed += 8;
   }
+  return others > mine * remaining.ToUint64();
 }
 
-// Check if a range has already been scanned
-bool is_range_scanned(const Int& range_start, const std::vector<Int*>& scanned_ranges) {
-  for (const auto& range : scanned_ranges) {
-    if (range->IsEqual(const_cast<Int*>(&range_start))) {
+// Take the next range leased from the coordinator, asking for more when the local queue runs dry.
+// One worker asks at a time, without range_mutex, so resumed ranges and the
+// other workers never wait on the network; the rest wait for its reply.
+bool lease_range(Config& config, ChunkIndex& range_idx) {
+  std::unique_lock<std::mutex> lock(range_mutex);
+
+  while (!shutdown_flag && !drain_requested) {
+    if (!leased_ranges.empty()) {
+      range_idx = leased_ranges.front();
+      leased_ranges.pop_front();
       return true;
     }
+    if (leasing) {
+      range_cv.wait_for(lock, std::chrono::milliseconds(100));
+      continue;
+    }
+
+    std::vector<ChunkIndex> chunks;
+    int wait_ms = 1000;
+    int threads = worker_pool ? worker_pool->Target() : config.workers;
+    leasing = true;
+    lock.unlock();
+    auto result = coordinator_client->Lease(threads, average_keys_per_second(), chunks, wait_ms);
+    lock.lock();
+    leasing = false;
+    range_cv.notify_all();
+    if (result == CoordinatorClient::LEASE_OK) {
+      leased_ranges.insert(leased_ranges.end(), chunks.begin(), chunks.end());
+    } else if (result == CoordinatorClient::LEASE_WAIT) {
+      // Other workers hold the remaining leases; they may expire and come back
+      range_cv.wait_for(lock, std::chrono::milliseconds(wait_ms));
+    } else {
+      return false;
+    }
   }
   return false;
 }
 
-// Get a random unscanned range
-bool get_random_range(Config& config, Int& range_start, Int& range_end) {
-  std::lock_guard<std::mutex> lock(range_mutex);
-
-  uint64_t num_ranges_int = config.total_ranges;
-  
-  // Check if all ranges are scanned
-  if (config.scanned_ranges.size() >= num_ranges_int) {
-    return false;
+// Get a random unscanned range of a job, or one a previous run was interrupted
+// in. Scanning starts at `scan_start`, the range start unless resuming, and
+// `digest` holds the digest of the keys before it.
+bool get_random_range(Job& job, ChunkIndex& range_idx, Int& range_start, Int& range_end, Int& scan_start,
+                      ChunkDigest& digest) {
+  {
+    std::lock_guard<std::mutex> lock(range_mutex);
+    if (!job.resume.empty()) {
+      range_idx = job.resume.front().idx;
+      scan_start = job.resume.front().next;
+      digest = job.resume.front().digest;
+      job.resume.pop_front();
+      range_bounds(job.config, range_idx, range_start, range_end);
+      return true;
+    }
   }
-  
-  // Thread-local random generator
-  static thread_local std::mt19937_64 gen(std::random_device{}());
-  std::uniform_int_distribution<uint64_t> dist(0, num_ranges_int - 1);
-  
-  // Get a random unscanned range
-  int max_attempts = 1000;
-  int attempts = 0;
-  
-  while (attempts < max_attempts) {
-    uint64_t range_idx = dist(gen);
-    
-    range_start = *config.range_start;
-    Int range_size_multiplier(range_idx);
-    range_size_multiplier.Mult(config.range_size);
-    range_start.Add(&range_size_multiplier);
-    
-    range_end = range_start;
-    range_end.Add(config.range_size);
-    
-    // Make sure range_end doesn't exceed the total range
-    if (range_end.IsGreater(config.range_end)) {
-      range_end.Set(config.range_end);
+
+  if (coordinator_client) {
+    if (!lease_range(job.config, range_idx)) {
+      return false;
     }
-    
-    // Check if this range has already been scanned
-    if (!is_range_scanned(range_start, config.scanned_ranges)) {
-      // Mark this range as scanned immediately to prevent other workers from getting it
-      Int* range_copy = new Int(range_start);
-      config.scanned_ranges.push_back(range_copy);
-      return true;
+  } else if (job.shared) {
+    if (!job.progress.Claim(range_idx)) {
+      return false;
     }
-    
-    attempts++;
+  } else if (!job.scheduler.Claim(range_idx)) {
+    return false;
   }
-  
-  return false;
+
+  range_bounds(job.config, range_idx, range_start, range_end);
+  scan_start = range_start;
+  digest = ChunkDigest();
+  return true;
 }
 
-// Save a completed range to the config file
-void save_completed_range(Config& config, const std::string& config_file, Int& range_start) {
-  std::lock_guard<std::mutex> lock(config_mutex);
-  
-  // No need to add to scanned ranges again - already added in get_random_range
-  // Just save to config file
-  std::ofstream file(config_file, std::ios::app);
-  if (file.is_open()) {
-    file << "range: " << range_start.GetBase16() << std::endl;
-    file.close();
-    
-    // Print progress
-    uint64_t total_ranges = config.total_ranges;
-    
-    // Increment total ranges completed counter
-    total_ranges_completed++;
-    
-    // Calculate and display speed
-    auto now = std::chrono::steady_clock::now();
-    auto elapsed_seconds = std::chrono::duration_cast<std::chrono::seconds>(now - start_time).count();
-    
-    if (elapsed_seconds > 0) {
-      // Calculate keys per second (ranges * range_size / seconds)
-      double ranges_per_second = static_cast<double>(total_ranges_completed) / elapsed_seconds;
-      double keys_per_second = ranges_per_second * std::stoull(config.range_size->GetBase10());
-      
-      std::lock_guard<std::mutex> speed_lock(speed_mutex);
-      std::cout << "[+] Completed range: 0x" << range_start.GetBase16() 
-                << " (" << config.scanned_ranges.size() << "/" 
-                << total_ranges << ") - "
-                << std::fixed << std::setprecision(2) << keys_per_second << " keys/sec" << std::endl;
+// Text line and JSON object of a status event, on the logger thread
+void format_event(const LogEvent& event, std::string& text, std::string& json) {
+  Job& job = *jobs[event.job];
+  Int range_start, range_end;
+  range_bounds(job.config, event.range, range_start, range_end);
+  std::string start_hex = range_start.GetBase16();
+  std::string total_ranges = job.config.total_ranges.GetBase10();
+  // Keys per second over the whole run: completed ranges * range size / seconds
+  double keys_per_second = event.elapsed_ms >= 1000 ? event.completed * job.chunk_keys * 1000 / event.elapsed_ms : 0;
+
+  std::ostringstream line;
+  line << (jobs.size() > 1 ? "[+] [" + job.config_file + "] " : "[+] ")
+       << "Completed range: 0x" << start_hex << " (" << event.scanned << "/" << total_ranges << ")";
+  if (event.elapsed_ms >= 1000) {
+    line << " - " << std::fixed << std::setprecision(2) << keys_per_second << " keys/sec";
+  }
+  text = line.str();
+
+  std::ostringstream object;
+  object << "{\"time_ms\":" << event.unix_ms << ",\"event\":\"range_completed\",\"job\":"
+         << json_string(job.config_file) << ",\"range_start\":\"0x" << start_hex << "\",\"scanned\":"
+         << event.scanned << ",\"total\":" << total_ranges << ",\"keys_per_second\":"
+         << std::fixed << std::setprecision(2) << keys_per_second << "}";
+  json = object.str();
+}
+
+// Hand an event to the logger thread, or print it here when there is none
+void post_event(const LogEvent& event) {
+  if (event_log) {
+    event_log->Post(event);
+    return;
+  }
+  std::string text, json;
+  format_event(event, text, json);
+  std::lock_guard<std::mutex> speed_lock(speed_mutex);
+  std::cout << text << std::endl;
+}
+
+// Save a completed range, with the digest of its hashes, to the job's checkpoint
+void save_completed_range(Job& job, const ChunkIndex& range_idx, Int& range_start, const ChunkDigest& digest) {
+  bool saved = false;
+  if (coordinator_client) {
+    // The coordinator keeps the central checkpoint. The client serializes its
+    // own requests, so config_mutex is not held while waiting on the reply
+    saved = coordinator_client->Complete(range_idx, digest);
+  } else {
+    std::lock_guard<std::mutex> lock(config_mutex);
+    if (job.shared) {
+      // The progress file is the checkpoint for every process sharing it
+      job.progress.Complete(range_idx);
+      saved = true;
+    } else if (job.journal.IsOpen()) {
+      job.journal.Complete(range_idx.ToUint64(), digest);
+      saved = true;
     } else {
-      std::cout << "[+] Completed range: 0x" << range_start.GetBase16() 
-                << " (" << config.scanned_ranges.size() << "/" 
-                << total_ranges << ")" << std::endl;
+      // No need to add to scanned ranges again - already added in get_random_range
+      // Just save to config file
+      std::ofstream file(job.config_file, std::ios::app);
+      if (file.is_open()) {
+        file << "range: " << range_start.GetBase16();
+        if (!digest.IsEmpty()) {
+          file << " " << digest.ToString();
+        }
+        file << std::endl;
+        file.close();
+        saved = true;
+      }
     }
+  }
+
+  if (saved) {
+    // Reported by the logger thread; formatting stays off the workers
+    LogEvent event;
+    event.kind = LOG_RANGE_COMPLETED;
+    event.job = job.id;
+    event.range = range_idx;
+    event.completed = ++job.ranges_completed;
+    event.scanned = scanned_count(job);
+    event.elapsed_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - start_time).count();
+    event.unix_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    post_event(event);
   } else {
     std::cerr << "[!] Failed to update config file with completed range." << std::endl;
   }
 }
 
+// Record how far a drained range got so the next run resumes there. Ranges
+// leased from a coordinator or a progress file go back to it on exit and are
+// scanned again from their start.
+void save_partial_range(Job& job, const ChunkIndex& range_idx, Int& range_start, Int& next,
+                        const ChunkDigest& digest) {
+  std::lock_guard<std::mutex> lock(config_mutex);
+  if (coordinator_client || job.shared) {
+    return;
+  }
+
+  bool saved = false;
+  if (job.journal.IsOpen()) {
+    Int offset = next;
+    offset.Sub(&range_start);
+    job.journal.Partial({range_idx.ToUint64(), offset.bits64[0], offset.bits64[1], digest});
+    saved = true;
+  } else {
+    std::ofstream file(job.config_file, std::ios::app);
+    if (file.is_open()) {
+      file << "partial: " << range_start.GetBase16() << " " << next.GetBase16() << " "
+           << digest.ToString() << std::endl;
+      file.close();
+      saved = true;
+    }
+  }
+
+  if (saved) {
+    std::string label = jobs.size() > 1 ? "[+] [" + job.config_file + "] " : "[+] ";
+    std::cout << label << "Interrupted range: 0x" << range_start.GetBase16()
+              << " at 0x" << next.GetBase16() << std::endl;
+  } else {
+    std::cerr << "[!] Failed to update config file with interrupted range." << std::endl;
+  }
+}
+
+// Pin the calling worker as planned by plan_worker_placement and return its
+// NUMA replica index
+int apply_placement(int worker_id) {
+  if ((size_t)worker_id >= worker_placement.size()) {
+    return 0;
+  }
+  const WorkerPlacement& place = worker_placement[worker_id];
+  if (!Topology::pin_thread(place.cpu)) {
+    std::lock_guard<std::mutex> cerr_lock(config_mutex);
+    std::cerr << "[!] Worker " << worker_id << " could not be pinned to CPU " << place.cpu << std::endl;
+  }
+  Topology::prefer_node(place.node);
+  return place.replica;
+}
+
+Secp256K1* ec_context(int replica) {
+  return ec_contexts[(size_t)replica < ec_contexts.size() ? replica : 0].get();
+}
+
+const std::unordered_set<std::string>& job_targets(const Job& job, int replica) {
+  return (size_t)replica < job.target_replicas.size() ? job.target_replicas[replica] : job.targets;
+}
+
+const TargetFilter& job_filter(const Job& job, int replica) {
+  return (size_t)replica < job.filter_replicas.size() ? job.filter_replicas[replica] : job.target_filter;
+}
+
+// Claim the next range from the job whose fair share is furthest behind,
+// unless the pool is shrinking or the tail policy tells this worker to stop.
+// Returns the job, or nullptr when this worker should return.
+Job* claim_range(Config& settings, int worker_id, ChunkIndex& range_idx, Int& range_start,
+                 Int& range_end, Int& scan_start, ChunkDigest& digest) {
+  int slot = worker_pool->SlotOf(worker_id);
+  if (drain_requested) {
+    return nullptr;
+  }
+  if (worker_pool->ShouldPark(slot)) {
+    std::lock_guard<std::mutex> cout_lock(config_mutex);
+    std::cout << "[+] Worker " << worker_id << " parked, pool target is "
+              << worker_pool->Target() << std::endl;
+    return nullptr;
+  }
+  if (should_leave_tail(settings, worker_id)) {
+    worker_pool->Retire(slot);
+    std::lock_guard<std::mutex> cout_lock(config_mutex);
+    std::cout << "[+] Worker " << worker_id << " leaves the remaining ranges to faster workers" << std::endl;
+    return nullptr;
+  }
+  for (;;) {
+    int share = fair_share.Pick();
+    if (share < 0) {
+      worker_pool->Finish();
+      std::lock_guard<std::mutex> cout_lock(config_mutex);
+      std::cout << "[+] Worker " << worker_id << " found no more ranges to scan" << std::endl;
+      return nullptr;
+    }
+    Job& job = *jobs[share];
+    if (get_random_range(job, range_idx, range_start, range_end, scan_start, digest)) {
+      fair_share.Charge(share, job.chunk_keys);
+      job.ranges_claimed++;
+      return &job;
+    }
+    fair_share.Retire(share);
+  }
+}
+
+// Save a range a worker stopped scanning: completed when `next` reached its
+// end, interrupted otherwise
+void finish_range(Job& job, const ChunkIndex& range_idx, Int& range_start, Int& next, Int& range_end,
+                  const ChunkDigest& digest, uint64_t busy_us) {
+  if (next.IsLower(&range_end)) {
+    save_partial_range(job, range_idx, range_start, next, digest);
+    job.ranges_interrupted++;
+  } else {
+    save_completed_range(job, range_idx, range_start, digest);
+    job.range_time.Record(busy_us);
+  }
+  job.ranges_finished++;
+}
+
+// Hand the calling thread's profile back as it exits; parked workers are
+// started again on new threads, each with a profile of its own
+void unregister_profile() {
+  if (thread_profile) {
+    profiler->Unregister(thread_profile);
+    thread_profile = nullptr;
+  }
+}
+
 // Worker thread function
-void worker_thread(int worker_id, Config& config, const std::string& config_file) {
+void worker_thread(int worker_id, Config& settings) {
   {
     std::lock_guard<std::mutex> cout_lock(config_mutex);
     //std::cout << "[+] Starting worker " << worker_id << std::endl;
   }
-  
-  // Create secp256k1 context for this thread
-  Secp256K1* s = new Secp256K1();
-  s->Init();
+
+  int replica = apply_placement(worker_id);
+  Secp256K1* s = ec_context(replica);
+  thread_profile = profiler ? profiler->Register() : nullptr;
+  worker_stats[worker_id].active = true;
   
   while (!shutdown_flag) {
-    Int range_start, range_end;
+    ChunkIndex range_idx;
+    Int range_start, range_end, next;
+    ChunkDigest digest;
     
     // Get a random range to scan
-    if (!get_random_range(config, range_start, range_end)) {
-      {
-        std::lock_guard<std::mutex> cout_lock(config_mutex);
-        std::cout << "[+] Worker " << worker_id << " found no more ranges to scan" << std::endl;
-      }
+    Job* job = claim_range(settings, worker_id, range_idx, range_start, range_end, next, digest);
+    if (!job) {
       break;
     }
     
@@ -260,23 +555,309 @@ void worker_thread(int worker_id, Config& config, const std::string& config_file
     }
     
     // Scan the range
-    scan_range(s, range_start, range_end, config.found_keys_file);
+    auto began = std::chrono::steady_clock::now();
+    uint64_t keys = scan_range(s, next, range_end, job_targets(*job, replica), job_filter(*job, replica),
+                               report_hits(job->config.found_keys_file), digest, worker_stats[worker_id],
+                               drain_requested);
+    uint64_t busy_us = record_range_stats(worker_id, keys, began);
     
-    // Save the completed range
-    save_completed_range(config, config_file, range_start);
+    // Save the completed range, or how far it got when draining
+    finish_range(*job, range_idx, range_start, next, range_end, digest, busy_us);
+    if (next.IsLower(&range_end)) {
+      break;
+    }
   }
   
-  delete s;
+  worker_stats[worker_id].active = false;
+  unregister_profile();
   {
     std::lock_guard<std::mutex> cout_lock(config_mutex);
     std::cout << "[+] Worker " << worker_id << " finished" << std::endl;
   }
 }
 
+// smt_pairing: split. The EC half of a pair: claims ranges and walks their
+// public keys, handing them to the hashing thread on the sibling SMT thread.
+// The scalar big-integer work here and the vector hashing there compete for
+// different execution ports, so the two share a core better than two full workers.
+void ec_thread(int worker_id, Config& settings, KeyBatchRing& ring) {
+  Secp256K1* s = ec_context(apply_placement(worker_id));
+  thread_profile = profiler ? profiler->Register() : nullptr;
+  worker_stats[worker_id].active = true;
+
+  bool closed = false;
+  while (!shutdown_flag && !closed) {
+    ChunkIndex range_idx;
+    Int range_start, range_end, first;
+    ChunkDigest carried;
+    Job* job = claim_range(settings, worker_id, range_idx, range_start, range_end, first, carried);
+    if (!job) {
+      break;
+    }
+
+    Point current = s->ComputePublicKey(&first, true);
+    int count;
+    while ((count = batch_keys(first, range_end)) > 0) {
+      KeyBatch* batch = ring.BeginPush();
+      if (!batch) {
+        closed = true;
+        break;
+      }
+      compute_pubkeys(s, current, batch->pubkeys);
+      batch->first = first;
+      batch->job = job;
+      batch->range_idx = range_idx;
+      batch->carried = carried;
+      batch->count = count;
+      first.Add((uint64_t)count);
+      bool interrupted = drain_requested.load(std::memory_order_relaxed) && first.IsLower(&range_end);
+      batch->last = interrupted || !first.IsLower(&range_end);
+      ring.Push();
+      if (interrupted) {
+        break;
+      }
+    }
+  }
+
+  ring.Close();
+  worker_stats[worker_id].active = false;
+  unregister_profile();
+}
+
+// The hashing half of a pair: checks the keys and completes each range after
+// its last batch. Throughput is credited to the pair's EC thread.
+void hash_thread(int worker_id, int ec_worker_id, KeyBatchRing& ring) {
+  int replica = apply_placement(worker_id);
+  thread_profile = profiler ? profiler->Register() : nullptr;
+
+  uint64_t range_keys = 0;
+  ChunkDigest digest;
+  Job* hits_job = nullptr;
+  HitHandler on_hit;
+  auto began = std::chrono::steady_clock::now();
+  while (KeyBatch* batch = ring.Front()) {
+    if (range_keys == 0) {
+      began = std::chrono::steady_clock::now();
+      digest = batch->carried;
+    }
+    Job* job = batch->job;
+    if (job != hits_job) {
+      on_hit = report_hits(job->config.found_keys_file);
+      hits_job = job;
+    }
+    check_pubkeys(batch->pubkeys, batch->first, batch->count, job_targets(*job, replica), job_filter(*job, replica),
+                  on_hit, digest, worker_stats[ec_worker_id]);
+    range_keys += batch->count;
+    worker_stats[ec_worker_id].CountKeys(batch->count);
+
+    bool last = batch->last;
+    ChunkIndex range_idx = batch->range_idx;
+    Int next = batch->first;
+    next.Add((uint64_t)batch->count);
+    ring.Pop();
+    if (last) {
+      uint64_t busy_us = record_range_stats(ec_worker_id, range_keys, began);
+      range_keys = 0;
+      Int range_start, range_end;
+      range_bounds(job->config, range_idx, range_start, range_end);
+      finish_range(*job, range_idx, range_start, next, range_end, digest, busy_us);
+    }
+  }
+  unregister_profile();
+
+  {
+    std::lock_guard<std::mutex> cout_lock(config_mutex);
+    std::cout << "[+] Workers " << ec_worker_id << "+" << worker_id << " finished" << std::endl;
+  }
+}
+
+// Body of one pool slot: a worker, or an EC/hash pair with smt_pairing: split
+void run_slot(int slot, int slot_threads, Config& settings) {
+  int first = slot * slot_threads;
+  if (slot_threads == 2) {
+    std::unique_ptr<KeyBatchRing> ring(new KeyBatchRing());
+    std::thread hasher(hash_thread, first + 1, first, std::ref(*ring));
+    ec_thread(first, settings, *ring);
+    hasher.join();
+  } else {
+    worker_thread(first, settings);
+  }
+}
+
+// Worker threads the environment lets us run: the usable CPUs (cpuset,
+// affinity), further capped by the cgroup CPU quota
+int cpu_limit() {
+  int cpus = (int)Topology::allowed_cpus().size();
+  int quota = Topology::cgroup_cpu_limit();
+  return quota > 0 && quota < cpus ? quota : cpus;
+}
+
+void drain_signal_handler(int sig) {
+  drain_requested = true;
+  // A second Ctrl+C stops at once
+  signal(sig, SIG_DFL);
+}
+
+void pool_signal_handler(int sig) {
+  if (sig == SIGUSR1) {
+    pool_grow_signals++;
+  } else {
+    pool_shrink_signals++;
+  }
+}
+
+// Per worker speed and where it ran, to spot slow cores and SMT contention
+void print_worker_throughput(uint64_t pairs) {
+  std::map<int, const Topology::CpuInfo*> by_cpu;
+  for (const Topology::CpuInfo& info : cpu_topology) {
+    by_cpu[info.cpu] = &info;
+  }
+
+  for (uint64_t w = 0; w < worker_stats_count; w++) {
+    if (worker_stats[w].keys == 0) {
+      continue;
+    }
+    bool paired = w < pairs * 2;
+    std::cout << "[+] Worker" << (paired ? "s " : " ") << w;
+    if (paired) {
+      std::cout << "+" << w + 1;
+    }
+    if (w < worker_placement.size()) {
+      std::cout << " on CPU " << worker_placement[w].cpu;
+      if (paired && w + 1 < worker_placement.size()) {
+        std::cout << "," << worker_placement[w + 1].cpu;
+      }
+      auto it = by_cpu.find(worker_placement[w].cpu);
+      if (it != by_cpu.end()) {
+        std::cout << " (package " << it->second->package_id << " core " << it->second->core_id;
+        if (it->second->kind) {
+          std::cout << ", " << it->second->kind << "-core";
+        }
+        std::cout << ")";
+      }
+    }
+    std::cout << ": " << std::fixed << std::setprecision(2) << worker_rate(w) << " keys/sec" << std::endl;
+  }
+}
+
+// Prometheus page for metrics_listen / metrics_file. Worker slots count from 0
+// in pool order; with smt_pairing: split a pair reports under its EC thread.
+std::string render_metrics() {
+  MetricsText page;
+  page.Family("bitcrack_keys_total", "counter", "Keys scanned by all workers.");
+  page.Sample("bitcrack_keys_total", "", (double)total_keys_processed());
+  page.Family("bitcrack_keys_per_second", "gauge", "Keys scanned over the last second.");
+  page.Sample("bitcrack_keys_per_second", "", (double)last_keys_per_second.load());
+  page.Family("bitcrack_target_hits_total", "counter", "Hashes that matched a target address.");
+  page.Sample("bitcrack_target_hits_total", "", (double)target_hits.load());
+  uint64_t filter_passes = 0;
+  for (uint64_t w = 0; w < worker_stats_count; w++) {
+    filter_passes += worker_stats[w].filter_passes.load(std::memory_order_relaxed);
+  }
+  uint64_t hits = target_hits.load();
+  page.Family("bitcrack_filter_false_positives_total", "counter",
+              "Hashes the target filter passed that matched no target.");
+  page.Sample("bitcrack_filter_false_positives_total", "", (double)(filter_passes > hits ? filter_passes - hits : 0));
+  if (worker_pool) {
+    page.Family("bitcrack_workers_running", "gauge", "Worker threads running.");
+    page.Sample("bitcrack_workers_running", "", (double)worker_pool->Running());
+  }
+
+  page.Family("bitcrack_worker_keys_total", "counter", "Keys scanned per worker.");
+  for (uint64_t w = 0; w < worker_stats_count; w++) {
+    uint64_t keys = worker_stats[w].scanned.load(std::memory_order_relaxed);
+    if (keys > 0 || worker_stats[w].active) {
+      page.Sample("bitcrack_worker_keys_total", metric_label("worker", std::to_string(w)), (double)keys);
+    }
+  }
+  page.Family("bitcrack_worker_keys_per_second", "gauge", "Per worker rate over its finished ranges.");
+  for (uint64_t w = 0; w < worker_stats_count; w++) {
+    if (worker_stats[w].keys.load(std::memory_order_relaxed) > 0) {
+      page.Sample("bitcrack_worker_keys_per_second", metric_label("worker", std::to_string(w)), worker_rate(w));
+    }
+  }
+
+  page.Family("bitcrack_chunks", "gauge", "Ranges in the job.");
+  for (auto& job : jobs) {
+    page.Sample("bitcrack_chunks", metric_label("job", job->config_file), job->config.total_ranges.ToDouble());
+  }
+  page.Family("bitcrack_chunks_scanned", "gauge", "Ranges of the job scanned so far, restored ones included.");
+  for (auto& job : jobs) {
+    page.Sample("bitcrack_chunks_scanned", metric_label("job", job->config_file), (double)scanned_count(*job));
+  }
+  page.Family("bitcrack_chunks_claimed_total", "counter", "Ranges claimed by this process.");
+  for (auto& job : jobs) {
+    page.Sample("bitcrack_chunks_claimed_total", metric_label("job", job->config_file), (double)job->ranges_claimed);
+  }
+  page.Family("bitcrack_chunks_completed_total", "counter", "Ranges completed by this process.");
+  for (auto& job : jobs) {
+    page.Sample("bitcrack_chunks_completed_total", metric_label("job", job->config_file),
+                (double)(job->ranges_finished - job->ranges_interrupted));
+  }
+  page.Family("bitcrack_chunks_interrupted_total", "counter", "Ranges left part way by a drain.");
+  for (auto& job : jobs) {
+    page.Sample("bitcrack_chunks_interrupted_total", metric_label("job", job->config_file),
+                (double)job->ranges_interrupted);
+  }
+  page.Family("bitcrack_chunks_in_flight", "gauge", "Ranges being scanned.");
+  for (auto& job : jobs) {
+    page.Sample("bitcrack_chunks_in_flight", metric_label("job", job->config_file),
+                (double)(job->ranges_claimed - job->ranges_finished));
+  }
+
+  page.Family("bitcrack_chunk_duration_seconds", "histogram", "Time to scan a range.");
+  for (auto& job : jobs) {
+    job->range_time.Write(page.Text(), "bitcrack_chunk_duration_seconds", metric_label("job", job->config_file));
+  }
+  page.Family("bitcrack_journal_sync_seconds", "histogram", "Checkpoint journal write and fdatasync time.");
+  for (auto& job : jobs) {
+    if (job->journal.IsOpen()) {
+      job->journal_sync.Write(page.Text(), "bitcrack_journal_sync_seconds", metric_label("job", job->config_file));
+    }
+  }
+  return page.Text();
+}
+
+// Name the workers that scanned at less than half the median rate over the
+// last window (a throttled core, or one shared with another busy process).
+// `window` holds each worker's key count at the start of the window, or
+// UINT64_MAX if it was not active then.
+void report_stragglers(std::vector<uint64_t>& window, double seconds) {
+  std::vector<std::pair<uint64_t, double>> rates;
+  for (uint64_t w = 0; w < worker_stats_count; w++) {
+    uint64_t keys = worker_stats[w].scanned.load(std::memory_order_relaxed);
+    bool active = worker_stats[w].active.load(std::memory_order_relaxed);
+    if (active && window[w] != UINT64_MAX) {
+      rates.push_back({w, (keys - window[w]) / seconds});
+    }
+    window[w] = active ? keys : UINT64_MAX;
+  }
+  if (rates.size() < 2) {
+    return;
+  }
+  std::vector<double> sorted;
+  for (auto& rate : rates) {
+    sorted.push_back(rate.second);
+  }
+  std::nth_element(sorted.begin(), sorted.begin() + sorted.size() / 2, sorted.end());
+  double median = sorted[sorted.size() / 2];
+
+  std::lock_guard<std::mutex> speed_lock(speed_mutex);
+  for (auto& rate : rates) {
+    if (rate.second < median / 2) {
+      std::cout << "[!] Worker " << rate.first << " is slow: " << std::fixed << std::setprecision(2)
+                << rate.second << " keys/sec, median " << median << std::endl;
+    }
+  }
+}
+
 // Speed monitoring function that runs in a separate thread
-void speed_monitor_thread() {
+void speed_monitor_thread(std::string metrics_file) {
   auto last_update_time = std::chrono::steady_clock::now();
   uint64_t last_keys_processed = 0;
+  int ticks = 0;
+  std::vector<uint64_t> straggler_window(worker_stats_count, UINT64_MAX);
+  auto straggler_window_start = last_update_time;
   
   while (!shutdown_flag) {
     // Update every second
@@ -286,12 +867,14 @@ void speed_monitor_thread() {
     auto total_elapsed = std::chrono::duration_cast<std::chrono::seconds>(now - start_time).count();
     auto update_elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(now - last_update_time).count();
     
-    uint64_t current_keys = total_keys_processed;
+    // Sums the per worker counters; nothing is shared while scanning
+    uint64_t current_keys = total_keys_processed();
     uint64_t keys_since_last = current_keys - last_keys_processed;
     
     if (update_elapsed > 0) {
       // Calculate current speed (keys processed in this interval)
       double current_keys_per_second = static_cast<double>(keys_since_last) / (update_elapsed / 1000.0);
+      last_keys_per_second = (uint64_t)current_keys_per_second;
       
       // Calculate average speed (all keys / total time)
       double avg_keys_per_second = total_elapsed > 0 ? 
@@ -306,17 +889,777 @@ void speed_monitor_thread() {
       last_update_time = now;
       last_keys_processed = current_keys;
     }
+
+    // Keep our leases alive while long ranges are being scanned
+    ++ticks;
+    if (coordinator_client && ticks % 10 == 0) {
+      coordinator_client->Heartbeat(average_keys_per_second());
+    }
+    if (!metrics_file.empty() && ticks % 5 == 0 && !WriteMetricsFile(metrics_file, render_metrics())) {
+      std::lock_guard<std::mutex> cerr_lock(config_mutex);
+      std::cerr << "[!] Failed to write metrics file " << metrics_file << std::endl;
+    }
+    if (ticks % 30 == 0) {
+      double seconds = std::chrono::duration<double>(now - straggler_window_start).count();
+      report_stragglers(straggler_window, seconds);
+      straggler_window_start = now;
+    }
+    for (auto& job : jobs) {
+      if (job->shared) {
+        job->progress.Heartbeat();
+      }
+      job->journal.Tick();
+    }
   }
   std::cout << std::endl; // Add newline after last update
 }
 
+// Decide which CPU each worker runs on, and give every NUMA node that runs
+// workers its own secp256k1 tables and copy of each job's targets
+void plan_worker_placement(Config& config, uint64_t worker_count) {
+  cpu_topology = Topology::cpu_topology();
+  std::set<std::pair<int, int>> cores;
+  int p_cores = 0, e_cores = 0;
+  for (const Topology::CpuInfo& info : cpu_topology) {
+    if (cores.insert({info.package_id, info.core_id}).second) {
+      p_cores += info.kind == 'P';
+      e_cores += info.kind == 'E';
+    }
+  }
+  std::cout << "[+] CPU topology: " << cpu_topology.size() << " threads on " << cores.size() << " cores";
+  if (p_cores || e_cores) {
+    std::cout << " (" << p_cores << " P-cores, " << e_cores << " E-cores)";
+  }
+  std::cout << std::endl;
+
+  if (config.cpu_affinity == "none") {
+    return;
+  }
+
+  std::vector<Topology::NumaNode> nodes = Topology::numa_nodes();
+  std::vector<int> cpus;
+  if (config.cpu_affinity == "auto") {
+    // Within a node: one thread per physical core first, fast cores first. An
+    // SMT pair needs both threads of one core, so keep siblings together then.
+    bool split = config.smt_pairing == "split";
+    std::vector<std::vector<int>> node_order;
+    for (const Topology::NumaNode& node : nodes) {
+      std::vector<int> order = Topology::placement_order(cpu_topology, node.cpus);
+      node_order.push_back(split ? Topology::pair_siblings(cpu_topology, order) : order);
+    }
+
+    // Alternate between nodes so each one gets its share of the workers
+    size_t step = split ? 2 : 1;
+    for (size_t k = 0; cpus.size() < worker_count; k += step) {
+      bool added = false;
+      for (const std::vector<int>& order : node_order) {
+        for (size_t j = k; j < k + step && j < order.size(); j++) {
+          cpus.push_back(order[j]);
+          added = true;
+        }
+      }
+      if (!added) {
+        break;
+      }
+    }
+  } else {
+    Topology::parse_cpu_list(config.cpu_affinity, cpus);
+  }
+  if (cpus.empty()) {
+    return;
+  }
+
+  for (uint64_t i = 0; i < worker_count; i++) {
+    WorkerPlacement place;
+    place.cpu = cpus[i % cpus.size()];
+    place.replica = Topology::node_index_of_cpu(nodes, place.cpu);
+    place.node = nodes[place.replica].id;
+    worker_placement.push_back(place);
+  }
+
+  std::cout << "[+] Pinning " << worker_count << " workers over " << nodes.size()
+            << " NUMA node(s)" << std::endl;
+  if (nodes.size() < 2) {
+    // Single node: every worker reads the shared context and each job's targets directly
+    return;
+  }
+
+  // Build each replica from a thread running on its node so the pages are local
+  ec_contexts.resize(nodes.size());
+  for (auto& job : jobs) {
+    job->target_replicas.resize(nodes.size());
+    job->filter_replicas.resize(nodes.size());
+  }
+  std::vector<std::thread> builders;
+  for (size_t n = 0; n < nodes.size(); n++) {
+    builders.push_back(std::thread([&nodes, n]() {
+      Topology::pin_thread(nodes[n].cpus);
+      Topology::prefer_node(nodes[n].id);
+      ec_contexts[n].reset(new Secp256K1());
+      ec_contexts[n]->Init();
+      for (auto& job : jobs) {
+        job->target_replicas[n] = job->targets;
+        job->filter_replicas[n] = TargetFilter(job->targets);
+      }
+    }));
+  }
+  for (auto& builder : builders) {
+    builder.join();
+  }
+}
+
+std::string job_key(const Config& config) {
+  return config.range_start->GetBase16() + ":" + config.range_end->GetBase16() + ":" +
+         config.range_size->GetBase16();
+}
+
+PartialRange journal_partial_range(Config& config, const JournalPartial& entry) {
+  PartialRange range;
+  Int range_end;
+  range.idx = ChunkIndex(entry.idx);
+  range_bounds(config, range.idx, range.next, range_end);
+  Int offset(entry.offset_lo);
+  offset.SetQWord(1, entry.offset_hi);
+  range.next.Add(&offset);
+  range.digest = entry.digest;
+  return range;
+}
+
+// Restore the job's checkpoint journal into scanned_words (the snapshot) and
+// scanned_ranges (the records after it), and open it for appending
+bool open_journal(Job& job) {
+  Config& config = job.config;
+  if (config.checkpoint_journal.empty()) {
+    return true;
+  }
+  if (!config.total_ranges.FitsUint64()) {
+    std::cerr << "[!] checkpoint_journal needs fewer than 2^64 ranges." << std::endl;
+    return false;
+  }
+  uint64_t total = config.total_ranges.ToUint64();
+  std::vector<uint64_t> words, completed;
+  std::vector<JournalPartial> partial;
+  job.journal.on_sync = [&job](uint64_t micros) { job.journal_sync.Record(micros); };
+  if (!CheckpointJournal::Load(config.checkpoint_journal, job_key(config), total, words, completed, partial) ||
+      !job.journal.Open(config.checkpoint_journal, job_key(config), total, config.journal_fsync_ms)) {
+    std::cerr << "[!] Failed to open checkpoint journal " << config.checkpoint_journal
+              << " (wrong job or unreadable)." << std::endl;
+    return false;
+  }
+  uint64_t restored = completed.size();
+  for (size_t i = 1; i < words.size(); i += 2) {
+    restored += (uint64_t)__builtin_popcountll(words[i]);
+  }
+  config.scanned_words.insert(config.scanned_words.end(), words.begin(), words.end());
+  for (uint64_t idx : completed) {
+    config.scanned_ranges.push_back(ChunkIndex(idx));
+  }
+  for (const JournalPartial& entry : partial) {
+    config.partial_ranges.push_back(journal_partial_range(config, entry));
+  }
+  std::cout << "[+] Restored " << restored << " ranges from " << config.checkpoint_journal << std::endl;
+  return true;
+}
+
+// Serve range leases to --worker processes; the coordinator itself does not scan
+int run_coordinator(const std::string& config_file, const std::string& listen_addr) {
+  std::cout << "[+] Loading config..." << std::endl;
+  jobs.emplace_back(new Job());
+  Job& job = *jobs.back();
+  Config& config = job.config;
+  job.config_file = config_file;
+  if (load_config(config_file, config) == -1) {
+    std::cerr << "[!] Failed to load config. Exiting." << std::endl;
+    return 1;
+  }
+  if (!open_journal(job)) {
+    free_config(config);
+    return 1;
+  }
+  print_config(config);
+  job.chunk_keys = ChunkIndex::FromInt(*config.range_size).ToDouble();
+
+  job.scheduler.Init(config.total_ranges, std::random_device{}());
+  job.scheduler.MarkScannedWords(config.scanned_words);
+  for (const ChunkInterval &run : config.scanned_runs) {
+    job.scheduler.MarkScannedRange(run);
+  }
+  for (const ChunkIndex &range_idx : config.scanned_ranges) {
+    job.scheduler.MarkScanned(range_idx);
+  }
+
+  JobSpec spec;
+  spec.range_start = config.range_start->GetBase16();
+  spec.range_end = config.range_end->GetBase16();
+  spec.range_size = config.range_size->GetBase16();
+  spec.addresses = config.addresses;
+
+  Coordinator coordinator(job.scheduler, spec, config.lease_seconds, config.lease_timeout);
+  coordinator.on_complete = [&](const ChunkIndex &range_idx, const ChunkDigest &digest) {
+    Int range_start, range_end;
+    range_bounds(config, range_idx, range_start, range_end);
+    save_completed_range(job, range_idx, range_start, digest);
+  };
+  coordinator.on_found = [&](const std::string &privkey, const std::string &address) {
+    {
+      std::lock_guard<std::mutex> cout_lock(config_mutex);
+      std::cout << "Found Private Key: 0x" << privkey << " Address: " << address << std::endl;
+    }
+    save_found_key(privkey, address, config.found_keys_file);
+  };
+
+  start_time = std::chrono::steady_clock::now();
+  std::cout << "[+] Coordinator listening on " << listen_addr << std::endl;
+  if (!coordinator.Serve(listen_addr)) {
+    std::cerr << "[!] Failed to listen on " << listen_addr << std::endl;
+    free_config(config);
+    return 1;
+  }
+
+  std::cout << "[+] Completed. Scanned " << job.scheduler.ScannedCount() << " ranges." << std::endl;
+  job.journal.Close();
+  free_config(config);
+  return 0;
+}
+
+// Build the job config from what the coordinator hands out
+int load_worker_config(const std::string& coordinator_addr, int workers,
+                       CoordinatorClient& client, Config& config) {
+  char host[256] = "worker";
+  gethostname(host, sizeof(host) - 1);
+  std::string name = std::string(host) + ":" + std::to_string(getpid());
+
+  JobSpec job;
+  if (!client.Connect(coordinator_addr, name, job)) {
+    std::cerr << "Could not get a job from coordinator: " << coordinator_addr << std::endl;
+    return -1;
+  }
+
+  config.range_start = new Int();
+  config.range_end = new Int();
+  config.range_size = new Int();
+  config.range_start->SetBase16((char*)job.range_start.c_str());
+  config.range_end->SetBase16((char*)job.range_end.c_str());
+  config.range_size->SetBase16((char*)job.range_size.c_str());
+  config.workers = workers;
+  config.addresses = job.addresses;
+  config.scanned_ranges = std::vector<ChunkIndex>();
+  config.found_keys_file = "found_keys.txt";
+  config.lease_seconds = 60;
+  config.lease_timeout = client.LeaseTimeout();
+  config.shared_progress = "";
+  config.checkpoint_journal = "";
+  config.journal_fsync_ms = 1000;
+  config.cpu_affinity = "none";
+  config.smt_pairing = "none";
+  config.tail_scheduling = "none";
+  config.control_socket = "";
+  config.log_lines_per_second = 10;
+  if (compute_total_ranges(config) == -1) {
+    free_config(config);
+    return -1;
+  }
+  return 0;
+}
+
+// Load a job's targets, restore its checkpoint and open its shared progress file
+bool prepare_job(Job& job) {
+  Config& config = job.config;
+  decode_addresses_into_hash160(job);
+  job.target_filter = TargetFilter(job.targets);
+  std::cout << "[+] Loaded " << job.targets.size() << " addresses into hash160 set." << std::endl;
+  std::cout << "[+] Found keys will be saved to " << config.found_keys_file << std::endl;
+  job.chunk_keys = ChunkIndex::FromInt(*config.range_size).ToDouble();
+  if (!coordinator_client && !open_journal(job)) {
+    return false;
+  }
+
+  job.scheduler.Init(config.total_ranges, std::random_device{}());
+  job.scheduler.MarkScannedWords(config.scanned_words);
+  for (const ChunkInterval &run : config.scanned_runs) {
+    job.scheduler.MarkScannedRange(run);
+  }
+  for (const ChunkIndex &range_idx : config.scanned_ranges) {
+    job.scheduler.MarkScanned(range_idx);
+  }
+
+  // Finish interrupted ranges first, from where they stopped (the latest
+  // record wins). Ranges completed since are skipped.
+  if (!coordinator_client && config.shared_progress.empty()) {
+    std::map<ChunkIndex, PartialRange> partial;
+    for (const PartialRange &range : config.partial_ranges) {
+      partial[range.idx] = range;
+    }
+    for (auto &entry : partial) {
+      if (job.scheduler.MarkScanned(entry.first)) {
+        job.resume.push_back(entry.second);
+      }
+    }
+    if (!job.resume.empty()) {
+      std::cout << "[+] Resuming " << job.resume.size() << " interrupted ranges" << std::endl;
+    }
+  }
+
+  if (!coordinator_client && !config.shared_progress.empty()) {
+    if (!job.progress.Open(config.shared_progress, job_key(config), config.total_ranges, config.lease_timeout)) {
+      std::cerr << "[!] Failed to open progress file " << config.shared_progress
+                << " (wrong job, no free slot, or more than " << MAX_SHARED_RANGES
+                << " ranges)." << std::endl;
+      return false;
+    }
+    for (const ChunkIndex &range_idx : config.scanned_ranges) {
+      job.progress.MarkScanned(range_idx);
+    }
+    // Progress files hold fewer than 2^64 ranges
+    for (const ChunkInterval &run : config.scanned_runs) {
+      for (uint64_t idx = run.first.ToUint64(); idx <= run.last.ToUint64(); idx++) {
+        job.progress.MarkScanned(ChunkIndex(idx));
+      }
+    }
+    for (size_t i = 0; i + 1 < config.scanned_words.size(); i += 2) {
+      for (uint64_t bits = config.scanned_words[i + 1]; bits; bits &= bits - 1) {
+        job.progress.MarkScanned(ChunkIndex(config.scanned_words[i] * 64 + (uint64_t)__builtin_ctzll(bits)));
+      }
+    }
+    job.shared = true;
+    std::cout << "[+] Sharing progress through " << config.shared_progress << " ("
+              << job.progress.CompletedCount() << " ranges completed)" << std::endl;
+  }
+  return true;
+}
+
+// Combine the checkpoints of one job, from any number of hosts or runs, into
+// a compacted config: job settings from the first config file, then the
+// scanned ranges as sorted `range:`/`ranges:` runs and the interrupted ranges
+// no input completed. Inputs are config files or checkpoint journals.
+int run_merge(const std::string& output, const std::vector<std::string>& inputs) {
+  std::string base;
+  for (const std::string& input : inputs) {
+    if (!CheckpointJournal::IsJournal(input)) {
+      base = input;
+      break;
+    }
+  }
+  Config config;
+  if (base.empty() || load_config(base, config, false) == -1) {
+    std::cerr << "[!] Merging needs at least one valid config file to describe the job." << std::endl;
+    return 1;
+  }
+  std::string key = job_key(config);
+
+  // Spill files can be large; keep them next to the output
+  size_t slash = output.find_last_of('/');
+  IntervalSorter sorter(slash == std::string::npos ? "." : output.substr(0, slash));
+  std::map<ChunkIndex, PartialRange> partial; // furthest point reached in each interrupted range
+  bool ok = true;
+  auto add_run = [&](const ChunkInterval& run) {
+    ok = sorter.Add(run) && ok;
+  };
+  auto add_partial = [&](PartialRange range) {
+    auto it = partial.find(range.idx);
+    if (it == partial.end() || it->second.next.IsLower(&range.next)) {
+      partial[range.idx] = range;
+    }
+  };
+
+  for (const std::string& input : inputs) {
+    std::cout << "[+] Reading " << input << "..." << std::endl;
+    if (CheckpointJournal::IsJournal(input)) {
+      std::vector<JournalPartial> entries;
+      if (!config.total_ranges.FitsUint64() ||
+          !CheckpointJournal::Load(input, key, config.total_ranges.ToUint64(), [&](uint64_t idx) {
+            add_run({ChunkIndex(idx), ChunkIndex(idx)});
+          }, entries)) {
+        std::cerr << "[!] " << input << " is the journal of another job." << std::endl;
+        free_config(config);
+        return 1;
+      }
+      for (const JournalPartial& entry : entries) {
+        add_partial(journal_partial_range(config, entry));
+      }
+      continue;
+    }
+    Config other;
+    if (load_config(input, other, false) == -1) {
+      free_config(config);
+      return 1;
+    }
+    bool same_job = job_key(other) == key;
+    free_config(other);
+    if (!same_job) {
+      std::cerr << "[!] " << input << " describes another job (range or range size differ)." << std::endl;
+      free_config(config);
+      return 1;
+    }
+    if (stream_checkpoint(input, config, add_run, add_partial) == -1) {
+      free_config(config);
+      return 1;
+    }
+  }
+  uint64_t entries = sorter.Added();
+  size_t spills = sorter.SpillFiles();
+
+  // Write next to the output and rename, so an input can be the output
+  std::string temp = output + ".tmp";
+  std::ofstream out(temp);
+  std::ifstream in(base);
+  std::string line;
+  while (out && std::getline(in, line)) {
+    std::string key_name = line.substr(0, line.find(':'));
+    if (key_name != "range" && key_name != "ranges" && key_name != "partial") {
+      out << line << std::endl;
+    }
+  }
+  in.close();
+
+  CoverageReport report(config.total_ranges);
+  std::vector<PartialRange> open_ranges;
+  auto next_partial = partial.begin();
+  ok = sorter.Merge([&](const ChunkInterval& run) {
+    // Interrupted ranges another input completed are dropped
+    for (; next_partial != partial.end() && next_partial->first <= run.last; ++next_partial) {
+      if (next_partial->first < run.first) {
+        open_ranges.push_back(next_partial->second);
+      }
+    }
+    Int first, last, range_end;
+    range_bounds(config, run.first, first, range_end);
+    if (run.first == run.last) {
+      out << "range: " << first.GetBase16() << "\n";
+    } else {
+      range_bounds(config, run.last, last, range_end);
+      out << "ranges: " << first.GetBase16() << " " << last.GetBase16() << "\n";
+    }
+    report.Add(run);
+  }) && ok;
+  report.Finish();
+  for (; next_partial != partial.end(); ++next_partial) {
+    open_ranges.push_back(next_partial->second);
+  }
+  for (PartialRange& range : open_ranges) {
+    Int first, range_end;
+    range_bounds(config, range.idx, first, range_end);
+    out << "partial: " << first.GetBase16() << " " << range.next.GetBase16() << " "
+        << range.digest.ToString() << "\n";
+  }
+  out.close();
+  if (!ok || !out || rename(temp.c_str(), output.c_str()) != 0) {
+    std::cerr << "[!] Failed to write " << output << std::endl;
+    unlink(temp.c_str());
+    free_config(config);
+    return 1;
+  }
+
+  std::cout << "[+] Merged " << entries << " checkpoint entries from " << inputs.size()
+            << " inputs into " << report.runs << " runs";
+  if (spills > 0) {
+    std::cout << " (sorted through " << spills << " spill files)";
+  }
+  std::cout << std::endl;
+  double percent = config.total_ranges.IsZero() ? 0 :
+                   report.covered.ToDouble() / config.total_ranges.ToDouble() * 100;
+  std::cout << "[+] Covered " << report.covered.GetBase10() << "/" << config.total_ranges.GetBase10()
+            << " ranges (" << std::fixed << std::setprecision(4) << percent << "%), "
+            << report.gaps << " gaps, " << open_ranges.size() << " interrupted ranges" << std::endl;
+  if (report.gaps > 0) {
+    Int first, last, range_end;
+    range_bounds(config, report.largest_gap.first, first, range_end);
+    range_bounds(config, report.largest_gap.last, last, range_end);
+    std::cout << "[+] Largest gap: " << report.largest_gap_size.GetBase10() << " ranges, 0x"
+              << first.GetBase16() << " to 0x" << last.GetBase16() << std::endl;
+  }
+  std::cout << "[+] Wrote " << output << std::endl;
+  free_config(config);
+  return 0;
+}
+
+// Rescan a random sample of the completed chunks that have a recorded digest
+// and compare. A chunk marked done without really being scanned (a bug, a
+// corrupted checkpoint, a worker that skipped work) cannot reproduce it.
+int run_verify(const std::string& config_file, int samples) {
+  Config config;
+  if (load_config(config_file, config, false) == -1) {
+    std::cerr << "[!] Failed to load config. Exiting." << std::endl;
+    return 1;
+  }
+
+  // Reservoir sample, so the checkpoint is never held in memory
+  std::mt19937_64 rng(std::random_device{}());
+  std::vector<std::pair<ChunkIndex, ChunkDigest>> sample;
+  uint64_t seen = 0;
+  auto add_digest = [&](const ChunkIndex& range_idx, const ChunkDigest& digest) {
+    seen++;
+    if (sample.size() < (size_t)samples) {
+      sample.push_back({range_idx, digest});
+    } else {
+      uint64_t slot = std::uniform_int_distribution<uint64_t>(0, seen - 1)(rng);
+      if (slot < sample.size()) {
+        sample[slot] = {range_idx, digest};
+      }
+    }
+  };
+  bool ok = stream_checkpoint(config_file, config, [](const ChunkInterval&) {},
+                              [](const PartialRange&) {}, add_digest) != -1;
+  if (ok && !config.checkpoint_journal.empty()) {
+    ok = config.total_ranges.FitsUint64() &&
+         CheckpointJournal::LoadDigests(config.checkpoint_journal, job_key(config),
+                                        config.total_ranges.ToUint64(),
+                                        [&](uint64_t idx, const ChunkDigest& digest) {
+                                          add_digest(ChunkIndex(idx), digest);
+                                        });
+    if (!ok) {
+      std::cerr << "[!] " << config.checkpoint_journal << " is the journal of another job." << std::endl;
+    }
+  }
+  if (!ok || sample.empty()) {
+    if (ok) {
+      std::cerr << "[!] No chunk digests recorded in " << config_file << std::endl;
+    }
+    free_config(config);
+    return 1;
+  }
+
+  std::cout << "[+] Rescanning " << sample.size() << " of " << seen << " chunks with a digest..." << std::endl;
+  Secp256K1 secp;
+  secp.Init();
+  const std::unordered_set<std::string> no_targets;
+  WorkerStats stats;
+  int mismatches = 0;
+  for (auto& entry : sample) {
+    Int range_start, range_end;
+    range_bounds(config, entry.first, range_start, range_end);
+    Int next = range_start;
+    ChunkDigest digest;
+    scan_range(&secp, next, range_end, no_targets, TargetFilter(), report_hits(config.found_keys_file), digest,
+               stats, shutdown_flag);
+    if (digest == entry.second) {
+      std::cout << "[+] Range 0x" << range_start.GetBase16() << ": OK" << std::endl;
+    } else {
+      mismatches++;
+      std::cout << "[!] Range 0x" << range_start.GetBase16() << ": digest mismatch, recorded "
+                << entry.second.ToString() << ", rescanned " << digest.ToString() << std::endl;
+    }
+  }
+  std::cout << "[+] " << sample.size() - mismatches << "/" << sample.size() << " chunks verified" << std::endl;
+  free_config(config);
+  return mismatches == 0 ? 0 : 1;
+}
+
+// Keys into worker 0's range of the planted target, so every step finds it
+static const uint64_t BENCHMARK_PLANT_OFFSET = 1 << 16;
+
+// Scan a synthetic in-memory job with 1, 2, 4... up to `max_workers` threads
+// for `seconds` each: every thread runs scan_range over its own range, worker
+// 0's holding a planted target. Nothing is written but the found key, which
+// goes to /dev/null. Reports keys/sec, keys/sec per thread, scaling against
+// one thread and how long worker 0 took to reach the target.
+int run_benchmark(int seconds, int max_workers) {
+  Secp256K1 secp;
+  secp.Init();
+
+  // A fixed start far from the small keys, one 2^64 key range per thread
+  Int base;
+  base.SetBase16((char*)"8000000000000000000000000000000000000000000000000000000000000000");
+  auto range_start = [&base](int worker) {
+    Int start((uint64_t)worker);
+    start.ShiftL(64);
+    start.Add(&base);
+    return start;
+  };
+
+  Int planted = range_start(0);
+  planted.Add(BENCHMARK_PLANT_OFFSET);
+  SerializedPubKey planted_pubkey = Address::serialize_pubkey(secp.ComputePublicKey(&planted, true));
+  const uint8_t *planted_ptrs[8];
+  size_t planted_lengths[8];
+  for (int i = 0; i < 8; i++) {
+    planted_ptrs[i] = planted_pubkey.compressed.data();
+    planted_lengths[i] = 33;
+  }
+  uint8_t planted_hash160[8][20];
+  Address::pubkeys_to_hash160_8x(planted_ptrs, planted_lengths, planted_hash160);
+  const std::unordered_set<std::string> targets = {HexUtil::toHex(planted_hash160[0], 20)};
+  const TargetFilter filter(targets);
+
+  std::vector<int> steps;
+  for (int workers = 1; workers < max_workers; workers *= 2) {
+    steps.push_back(workers);
+  }
+  steps.push_back(max_workers);
+  worker_stats.reset(new WorkerStats[max_workers]);
+  worker_stats_count = max_workers;
+
+  std::cout << "[+] Benchmark: " << seconds << " s per step, up to " << max_workers
+            << " threads, target planted " << BENCHMARK_PLANT_OFFSET << " keys into worker 0's range"
+            << std::endl;
+  std::vector<std::string> rows;
+  double single = 0;
+  for (int workers : steps) {
+    for (int w = 0; w < max_workers; w++) {
+      worker_stats[w].scanned = 0;
+      worker_stats[w].filter_passes = 0;
+    }
+    drain_requested = false;
+    target_hits = 0;
+
+    auto began = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    for (int w = 0; w < workers; w++) {
+      threads.emplace_back([&, w]() {
+        Int next = range_start(w);
+        Int end = range_start(w + 1);
+        ChunkDigest digest;
+        scan_range(&secp, next, end, targets, filter, report_hits("/dev/null"), digest, worker_stats[w],
+                   drain_requested);
+      });
+    }
+    double first_hit = -1;
+    auto until = began + std::chrono::seconds(seconds);
+    while (std::chrono::steady_clock::now() < until) {
+      if (first_hit < 0 && target_hits.load(std::memory_order_relaxed) > 0) {
+        first_hit = std::chrono::duration<double>(std::chrono::steady_clock::now() - began).count();
+      }
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    drain_requested = true;
+    for (auto& t : threads) {
+      t.join();
+    }
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - began).count();
+
+    double keys_per_second = total_keys_processed() / elapsed;
+    if (workers == 1) {
+      single = keys_per_second;
+    }
+    std::ostringstream row;
+    row << std::fixed << std::setw(8) << workers << std::setw(16) << std::setprecision(0) << keys_per_second
+        << std::setw(16) << keys_per_second / workers << std::setw(11) << std::setprecision(1)
+        << (single > 0 ? keys_per_second * 100 / (single * workers) : 0) << "%" << std::setw(14);
+    if (first_hit < 0) {
+      row << "not reached";
+    } else {
+      row << std::setprecision(3) << first_hit << " s";
+    }
+    rows.push_back(row.str());
+  }
+  drain_requested = false;
+
+  std::cout << " threads        keys/sec keys/sec/thread  efficiency     first hit" << std::endl;
+  for (const std::string& row : rows) {
+    std::cout << row << std::endl;
+  }
+  worker_stats.reset();
+  worker_stats_count = 0;
+  return 0;
+}
+
+// Pick the hash kernels, the fastest this CPU supports unless `force_isa`
+// names others, and report the choice
+bool select_hash_kernels(const std::string& force_isa) {
+  if (hash_select_isa(force_isa.empty() ? nullptr : force_isa.c_str()) != 0) {
+    std::string available;
+    for (int i = 0; i < hash_isa_count(); i++) {
+      if (hash_isa_supported(hash_isa_at(i))) {
+        available += std::string(available.empty() ? "" : ", ") + hash_isa_at(i);
+      }
+    }
+    std::cerr << "[!] --force-isa " << force_isa << ": unknown or not supported by this CPU (available: "
+              << available << ")" << std::endl;
+    return false;
+  }
+  std::cout << "[+] Hash kernels: " << hash_isa_name();
+  if (force_isa.empty() || force_isa == "auto") {
+    // Each supported set was timed hashing a batch of public keys
+    std::ostringstream timings;
+    timings << std::fixed << std::setprecision(1);
+    for (int i = 0; i < hash_isa_count(); i++) {
+      double ns = hash_isa_ns_per_key(hash_isa_at(i));
+      if (ns > 0) {
+        timings << (timings.tellp() > 0 ? ", " : "") << hash_isa_at(i) << " " << ns;
+      }
+    }
+    std::cout << " (fastest here, ns/key: " << timings.str() << ")";
+  } else {
+    std::cout << " (forced)";
+  }
+  std::cout << std::endl;
+  return true;
+}
+
+void free_jobs() {
+  for (auto& job : jobs) {
+    job->progress.Close();
+    job->journal.Close();
+    free_config(job->config);
+  }
+  jobs.clear();
+}
+
 int main(int argc, char *argv[]) {
   std::cout << "[+] Starting BitCrackCPU" << std::endl;
 
+  // Pull --time-budget, --profile and --force-isa out of the positional arguments
+  int time_budget = 0;
+  bool profile = false;
+  std::string force_isa;
+  for (int i = 2; i < argc;) {
+    std::string arg = argv[i];
+    int taken = 0;
+    if (arg == "--time-budget") {
+      time_budget = i + 1 < argc ? std::atoi(argv[i + 1]) : 0;
+      if (time_budget <= 0) {
+        std::cerr << "[!] --time-budget needs a number of seconds." << std::endl;
+        return 1;
+      }
+      taken = 2;
+    } else if (arg == "--profile") {
+      profile = true;
+      taken = 1;
+    } else if (arg == "--force-isa") {
+      if (i + 1 >= argc) {
+        std::cerr << "[!] --force-isa needs a kernel name." << std::endl;
+        return 1;
+      }
+      force_isa = argv[i + 1];
+      taken = 2;
+    } else {
+      i++;
+      continue;
+    }
+    for (int j = i; j + taken < argc; j++) {
+      argv[j] = argv[j + taken];
+    }
+    argc -= taken;
+  }
+
+  if (!select_hash_kernels(force_isa)) {
+    return 1;
+  }
+
+  if (argc >= 2 && std::string(argv[1]) == "--benchmark") {
+    int seconds = argc > 2 ? std::atoi(argv[2]) : 10;
+    int workers = argc > 3 ? std::atoi(argv[3]) : cpu_limit();
+    if (seconds <= 0 || workers <= 0) {
+      std::cerr << "[!] --benchmark needs a positive number of seconds and workers." << std::endl;
+      return 1;
+    }
+    return run_benchmark(seconds, workers);
+  }
+
   if (argc < 3) {
     std::cerr << "Usage: \n"
               << "  " << PROGRAM_NAME << " --create-config <config_file> \n"
-              << "  " << PROGRAM_NAME << " --resume <config_file>" << std::endl;
+              << "  " << PROGRAM_NAME << " --resume <config_file> \n"
+              << "  " << PROGRAM_NAME << " --jobs <job_list> \n"
+              << "  " << PROGRAM_NAME << " --coordinator <config_file> <listen_addr> \n"
+              << "  " << PROGRAM_NAME << " --worker <coordinator_addr> [workers] \n"
+              << "  " << PROGRAM_NAME << " --merge <output_config> <config_or_journal>... \n"
+              << "  " << PROGRAM_NAME << " --verify-chunk <config_file> [samples] \n"
+              << "  " << PROGRAM_NAME << " --benchmark [seconds] [workers] \n"
+              << "Addresses are unix:<path> or <host>:<port>. --resume, --jobs and --worker\n"
+              << "take --time-budget <seconds> to drain and exit after that long, and\n"
+              << "--profile to print where scanning time goes at exit. --force-isa <name>\n"
+              << "picks the hash kernels instead of the fastest supported ones." << std::endl;
     return 1;
   }
 
@@ -328,79 +1671,243 @@ int main(int argc, char *argv[]) {
     std::cout << "Config file created: " << config_file << std::endl;
     return 0;
   }
-  std::cout << "[+] Loading config..." << std::endl;
-  Config config;
-  int result = load_config(config_file, config);
-  if (result == -1) {
-    std::cerr << "[!] Failed to load config. Exiting." << std::endl;
-    return 1;
+
+  if (action == "--merge") {
+    if (argc < 4) {
+      std::cerr << "[!] Nothing to merge." << std::endl;
+      return 1;
+    }
+    return run_merge(config_file, std::vector<std::string>(argv + 3, argv + argc));
   }
-  print_config(config);
 
-  decode_addresses_into_hash160(config);
-  std::cout << "[+] Loaded " << hash160_set.size() << " addresses into hash160 set." << std::endl;
-  std::cout << "[+] Found keys will be saved to " << config.found_keys_file << std::endl;
+  if (action == "--verify-chunk") {
+    int samples = argc > 3 ? std::atoi(argv[3]) : 16;
+    if (samples <= 0) {
+      std::cerr << "[!] --verify-chunk needs a positive number of samples." << std::endl;
+      return 1;
+    }
+    return run_verify(config_file, samples);
+  }
+
+  if (action == "--coordinator") {
+    if (argc < 4) {
+      std::cerr << "[!] Missing listen address." << std::endl;
+      return 1;
+    }
+    return run_coordinator(config_file, argv[3]);
+  }
+
+  Config list_settings; // pool settings of a --jobs list
+  Config* settings = nullptr;
+  CoordinatorClient client;
+  if (action == "--worker") {
+    int workers = argc > 3 ? std::atoi(argv[3]) : (int)std::thread::hardware_concurrency();
+    if (workers <= 0) {
+      workers = 1;
+    }
+    std::cout << "[+] Connecting to coordinator " << config_file << "..." << std::endl;
+    jobs.emplace_back(new Job());
+    jobs.back()->config_file = config_file;
+    if (load_worker_config(config_file, workers, client, jobs.back()->config) == -1) {
+      std::cerr << "[!] Failed to load config. Exiting." << std::endl;
+      return 1;
+    }
+    coordinator_client = &client;
+    settings = &jobs.back()->config;
+  } else if (action == "--jobs") {
+    std::vector<JobListEntry> entries;
+    if (load_job_list(config_file, list_settings, entries) == -1) {
+      std::cerr << "[!] Failed to load job list. Exiting." << std::endl;
+      return 1;
+    }
+    for (const JobListEntry& entry : entries) {
+      std::cout << "[+] Loading job " << entry.config_file << "..." << std::endl;
+      std::unique_ptr<Job> job(new Job());
+      job->config_file = entry.config_file;
+      job->weight = entry.weight;
+      if (load_config(entry.config_file, job->config) == -1) {
+        std::cerr << "[!] Failed to load config. Exiting." << std::endl;
+        free_jobs();
+        return 1;
+      }
+      jobs.push_back(std::move(job));
+    }
+    settings = &list_settings;
+  } else {
+    std::cout << "[+] Loading config..." << std::endl;
+    jobs.emplace_back(new Job());
+    jobs.back()->config_file = config_file;
+    int result = load_config(config_file, jobs.back()->config);
+    if (result == -1) {
+      std::cerr << "[!] Failed to load config. Exiting." << std::endl;
+      return 1;
+    }
+    settings = &jobs.back()->config;
+  }
+
+  for (auto& job : jobs) {
+    print_config(job->config);
+    if (!prepare_job(*job)) {
+      free_jobs();
+      return 1;
+    }
+    job->id = fair_share.Add(job->weight);
+  }
+  if (jobs.size() > 1) {
+    std::cout << "[+] Serving " << jobs.size() << " jobs from one pool of " << settings->workers
+              << " workers" << std::endl;
+  }
 
-  uint64_t total_ranges = config.total_ranges;
+  // The pool can grow past the configured size up to the usable CPUs
+  bool split = settings->smt_pairing == "split";
+  int slot_threads = split ? 2 : 1;
+  int capacity = std::max(settings->workers, (int)Topology::allowed_cpus().size());
+  int slots = std::max(capacity / slot_threads, 1);
+  uint64_t worker_count = (uint64_t)slots * slot_threads;
+  plan_worker_placement(*settings, worker_count);
+  if (ec_contexts.empty()) {
+    ec_contexts.emplace_back(new Secp256K1());
+    ec_contexts.back()->Init();
+  }
+  worker_stats.reset(new WorkerStats[worker_count]);
+  worker_stats_count = worker_count;
 
-  uint64_t worker_count = config.workers;
-  std::vector<std::thread> threads;
+  // smt_pairing: split runs each slot as an EC/hash pair on workers 2k and 2k+1
+  uint64_t pairs = split ? slots : 0;
+  WorkerPool pool(slots, slot_threads, [&settings, slot_threads](int slot) {
+    run_slot(slot, slot_threads, *settings);
+  });
+  worker_pool = &pool;
+  pool.SetRequested(settings->workers);
+  int limit = cpu_limit();
+  pool.SetLimit(limit);
   
-  // Initialize start time and reset counters
   start_time = std::chrono::steady_clock::now();
-  total_ranges_completed = 0;
-  total_keys_processed = 0;
-  
-  std::cout << "[+] Starting " << worker_count << " workers..." << std::endl;
-  
-  // Create and start worker threads
-  for (uint64_t i = 0; i < worker_count; i++) {
-    threads.push_back(std::thread(worker_thread, i, std::ref(config), std::ref(config_file)));
+  std::unique_ptr<Profiler> stage_profiler;
+  if (profile) {
+    stage_profiler.reset(new Profiler(64, true, SCAN_BATCH));
+    profiler = stage_profiler.get();
   }
+  FILE* json_log = nullptr;
+  if (!settings->log_json.empty() && !(json_log = fopen(settings->log_json.c_str(), "a"))) {
+    std::cerr << "[!] Failed to open JSON log " << settings->log_json << std::endl;
+  }
+  EventLog status_log(format_event, stdout, speed_mutex, settings->log_lines_per_second, json_log);
+  status_log.Start();
+  event_log = &status_log;
+  
+  std::cout << "[+] Starting " << pool.Target() << " workers (" << settings->workers
+            << " requested, " << limit << " CPUs available)..." << std::endl;
+  pool.Reconcile();
   
   // Start speed monitoring thread
-  std::thread monitor_thread(speed_monitor_thread);
+  std::thread monitor_thread(speed_monitor_thread, settings->metrics_file);
+  std::thread metrics_thread;
+  if (!settings->metrics_listen.empty()) {
+    std::string metrics_addr = settings->metrics_listen;
+    metrics_thread = std::thread([metrics_addr]() {
+      if (!ServeMetrics(metrics_addr, shutdown_flag, render_metrics)) {
+        std::lock_guard<std::mutex> cerr_lock(config_mutex);
+        std::cerr << "[!] Failed to listen for metrics on " << metrics_addr << std::endl;
+      }
+    });
+  }
+  std::thread control_thread;
+  if (!settings->control_socket.empty()) {
+    std::string control_addr = settings->control_socket;
+    control_thread = std::thread([&pool, control_addr]() {
+      if (!pool.ServeControl(control_addr, shutdown_flag)) {
+        std::lock_guard<std::mutex> cerr_lock(config_mutex);
+        std::cerr << "[!] Failed to listen on control socket " << control_addr << std::endl;
+      }
+    });
+  }
+  signal(SIGINT, drain_signal_handler);
+  signal(SIGTERM, drain_signal_handler);
+  signal(SIGUSR1, pool_signal_handler);
+  signal(SIGUSR2, pool_signal_handler);
   
-  // Wait for user to press Ctrl+C or for all threads to complete
+  // Wait for user to press Ctrl+C or for all work to complete, resizing the
+  // pool on request and whenever the CPU quota changes
   std::cout << "[+] Press Ctrl+C to stop..." << std::endl;
-  try {
-    for (auto& thread : threads) {
-      thread.join();
+  bool draining = false;
+  for (int ticks = 1; !pool.Done(); ticks++) {
+    if (!draining && time_budget > 0 &&
+        std::chrono::steady_clock::now() - start_time >= std::chrono::seconds(time_budget)) {
+      drain_requested = true;
     }
-    
-    // Set shutdown flag to stop monitor thread
-    shutdown_flag = true;
-    if (monitor_thread.joinable()) {
-      monitor_thread.join();
-    }
-  } catch (const std::exception& e) {
-    // Set shutdown flag and wait for threads to complete
-    shutdown_flag = true;
-    range_cv.notify_all();
-    
-    for (auto& thread : threads) {
-      if (thread.joinable()) {
-        thread.join();
-      }
+    if (!draining && drain_requested) {
+      draining = true;
+      pool.Finish();
+      range_cv.notify_all();
+      std::lock_guard<std::mutex> cout_lock(config_mutex);
+      std::cout << "[+] Draining: workers stop after their current batch..." << std::endl;
     }
-    
-    if (monitor_thread.joinable()) {
-      monitor_thread.join();
+    for (int n = pool_grow_signals.exchange(0); n > 0; n--) {
+      pool.Grow();
+    }
+    for (int n = pool_shrink_signals.exchange(0); n > 0; n--) {
+      pool.Shrink();
     }
+    if (ticks % 25 == 0) {
+      int current = cpu_limit();
+      if (current != limit) {
+        limit = current;
+        pool.SetLimit(limit);
+        std::lock_guard<std::mutex> cout_lock(config_mutex);
+        std::cout << "[+] CPU limit is now " << limit << ", pool target " << pool.Target() << std::endl;
+      }
+    }
+    pool.Reconcile();
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+  }
+  pool.Join();
+  event_log = nullptr;
+  status_log.Stop();
+  if (json_log) {
+    fclose(json_log);
+  }
+  
+  // Set shutdown flag to stop the monitor and control threads
+  shutdown_flag = true;
+  range_cv.notify_all();
+  if (monitor_thread.joinable()) {
+    monitor_thread.join();
+  }
+  if (control_thread.joinable()) {
+    control_thread.join();
   }
+  if (metrics_thread.joinable()) {
+    metrics_thread.join();
+  }
+  worker_pool = nullptr;
   
   // Calculate final statistics
   auto end_time = std::chrono::steady_clock::now();
   auto elapsed_seconds = std::chrono::duration_cast<std::chrono::seconds>(end_time - start_time).count();
   
-  if (elapsed_seconds > 0 && total_keys_processed > 0) {
-    double keys_per_second = static_cast<double>(total_keys_processed) / elapsed_seconds;
+  uint64_t total_keys = total_keys_processed();
+  if (elapsed_seconds > 0 && total_keys > 0) {
+    double keys_per_second = static_cast<double>(total_keys) / elapsed_seconds;
     
     std::cout << "[+] Average speed: " << std::fixed << std::setprecision(2) 
               << keys_per_second << " keys/sec" << std::endl;
   }
+  print_worker_throughput(pairs);
+  if (profiler) {
+    std::cout << profiler->Report();
+    profiler = nullptr;
+  }
   
-  std::cout << "[+] Completed. Scanned " << config.scanned_ranges.size() << " ranges." << std::endl;
-  free_config(config);
+  for (auto& job : jobs) {
+    std::cout << "[+] " << (jobs.size() > 1 ? "[" + job->config_file + "] " : "")
+              << "Completed. Scanned " << scanned_count(*job) << " ranges." << std::endl;
+    if (job->range_time.Count() > 0) {
+      std::cout << "[+] Range time: p50 " << std::setprecision(3) << job->range_time.Percentile(50) / 1e6
+                << " s, p99 " << job->range_time.Percentile(99) / 1e6 << " s" << std::endl;
+    }
+  }
+  client.Close();
+  free_jobs();
   return 0;
 }
@@ -0,0 +1,142 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <stdint.h>
+#include <random>
+#include <vector>
+#include <openssl/evp.h>
+#include "../Hash/Hash.h"
+
+// Differential check of sha256_8x / ripemd160_8x and the 16-lane calls,
+// with every kernel set this CPU can run, against OpenSSL.
+//
+// Built as a standalone program it runs random inputs (iterations and seed
+// from the command line); built with -DLIBFUZZER it is a libFuzzer target.
+// Either way one input is 32 bytes of lane lengths (0..511 each, so the
+// lanes of a call mix block counts and padding cases) followed by the bytes
+// the lanes are filled from. The 8-lane calls hash the first 8 lanes, the
+// 16-lane ones all of them.
+
+static const int LANES = 16;
+static const size_t HEADER = 2 * LANES;
+
+static void openssl_digest(const EVP_MD *md, const uint8_t *data, size_t length, uint8_t *out) {
+    unsigned int out_length = 0;
+    if (!EVP_Digest(data, length, out, &out_length, md, nullptr)) {
+        printf("OpenSSL digest failed\n");
+        abort();
+    }
+}
+
+static void print_hex(const char *label, const uint8_t *data, size_t length) {
+    printf("%s", label);
+    for (size_t i = 0; i < length; ++i) printf("%02x", data[i]);
+    printf("\n");
+}
+
+// False (after printing the failing lane) if the selected kernels disagree with OpenSSL
+static bool check_kernels(const uint8_t *data, size_t size, bool wide) {
+    if (size < HEADER) {
+        return true;
+    }
+    const uint8_t *payload = data + HEADER;
+    size_t payload_size = size - HEADER;
+
+    std::vector<uint8_t> lanes[LANES];
+    const uint8_t *inputs[LANES];
+    size_t lengths[LANES];
+    for (int i = 0; i < LANES; ++i) {
+        lengths[i] = data[2 * i] | ((data[2 * i + 1] & 1) << 8);
+        lanes[i].resize(lengths[i] + 1); // never empty, so data() is a real buffer
+        for (size_t j = 0; j < lengths[i]; ++j) {
+            lanes[i][j] = payload_size ? payload[(j + i * 7) % payload_size] ^ (uint8_t)i : (uint8_t)(i + j);
+        }
+        inputs[i] = lanes[i].data();
+    }
+
+    uint8_t sha_out[LANES][SHA256_DIGEST_SIZE];
+    uint8_t rmd_out[LANES][RIPEMD160_DIGEST_SIZE];
+    int count = wide ? 16 : 8;
+    int failed = wide ? sha256_16x(inputs, lengths, sha_out) | ripemd160_16x(inputs, lengths, rmd_out)
+                      : sha256_8x(inputs, lengths, sha_out) | ripemd160_8x(inputs, lengths, rmd_out);
+    if (failed) {
+        printf("Hash kernel failed\n");
+        return false;
+    }
+    for (int i = 0; i < count; ++i) {
+        uint8_t sha_expect[SHA256_DIGEST_SIZE];
+        uint8_t rmd_expect[RIPEMD160_DIGEST_SIZE];
+        openssl_digest(EVP_sha256(), inputs[i], lengths[i], sha_expect);
+        openssl_digest(EVP_ripemd160(), inputs[i], lengths[i], rmd_expect);
+        bool sha_ok = memcmp(sha_out[i], sha_expect, SHA256_DIGEST_SIZE) == 0;
+        bool rmd_ok = memcmp(rmd_out[i], rmd_expect, RIPEMD160_DIGEST_SIZE) == 0;
+        if (!sha_ok || !rmd_ok) {
+            printf("%s mismatch in lane %d of %d, lengths", sha_ok ? "RIPEMD160" : "SHA256", i, count);
+            for (int l = 0; l < count; ++l) printf(" %zu", lengths[l]);
+            printf("\n");
+            print_hex("input:    ", inputs[i], lengths[i]);
+            print_hex("kernel:   ", sha_ok ? rmd_out[i] : sha_out[i], sha_ok ? RIPEMD160_DIGEST_SIZE : SHA256_DIGEST_SIZE);
+            print_hex("openssl:  ", sha_ok ? rmd_expect : sha_expect, sha_ok ? RIPEMD160_DIGEST_SIZE : SHA256_DIGEST_SIZE);
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool check_input(const uint8_t *data, size_t size) {
+    for (int i = 0; i < hash_isa_count(); ++i) {
+        const char *isa = hash_isa_at(i);
+        if (hash_select_isa(isa) != 0) {
+            continue;
+        }
+        for (bool wide : {false, true}) {
+            if (!check_kernels(data, size, wide)) {
+                printf("with %s kernels\n", isa);
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+#ifdef LIBFUZZER
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+    if (!check_input(data, size)) {
+        abort();
+    }
+    return 0;
+}
+
+#else
+
+int main(int argc, char **argv) {
+    long iterations = argc > 1 ? atol(argv[1]) : 3000;
+    uint64_t seed = argc > 2 ? strtoull(argv[2], nullptr, 10) : 1;
+    std::mt19937_64 rng(seed);
+
+    // Lengths around the padding and block boundaries of both hashes, and
+    // the 32 / 33 / 65 byte inputs of the scan path, come up often
+    static const size_t edges[] = {0, 1, 20, 32, 33, 55, 56, 57, 63, 64, 65, 119, 120, 127, 128, 511};
+    std::vector<uint8_t> input;
+    for (long n = 0; n < iterations; ++n) {
+        input.resize(HEADER + rng() % 600);
+        for (auto &b : input) b = (uint8_t)rng();
+        for (int i = 0; i < LANES; ++i) {
+            if (rng() % 2) {
+                size_t length = edges[rng() % (sizeof(edges) / sizeof(edges[0]))];
+                input[2 * i] = (uint8_t)length;
+                input[2 * i + 1] = (uint8_t)(length >> 8);
+            }
+        }
+        if (!check_input(input.data(), input.size())) {
+            printf("Failed at iteration %ld, seed %llu\n", n, (unsigned long long)seed);
+            return 1;
+        }
+    }
+
+    printf("All hash fuzz tests passed\n");
+    return 0;
+}
+
+#endif
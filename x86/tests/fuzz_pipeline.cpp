@@ -0,0 +1,169 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <stdint.h>
+#include <random>
+#include <string>
+#include <openssl/bn.h>
+#include <openssl/ec.h>
+#include <openssl/evp.h>
+#include <openssl/obj_mac.h>
+#include "../Address.h"
+#include "../include/secp256k1.h"
+
+// Differential check of the scan path, private key -> public keys ->
+// hash160, against OpenSSL. Eight consecutive keys are walked the way
+// compute_pubkeys does (ComputePublicKey, then NextKey) and hashed with
+// pubkeys_to_hash160_8x in both encodings.
+//
+// Built as a standalone program it runs random keys (iterations and seed
+// from the command line); built with -DLIBFUZZER it is a libFuzzer target
+// taking the first private key from the first 32 bytes of the input.
+
+static Secp256K1 secp;
+static EC_GROUP *group;
+static BN_CTX *bn_ctx;
+
+// Largest first key: the eight keys stay below the group order
+static const char *LAST_FIRST_KEY = "FFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFEBAAEDCE6AF48A03BBFD25E8CD0364138";
+
+static void init() {
+    static bool done = false;
+    if (done) {
+        return;
+    }
+    secp.Init();
+    group = EC_GROUP_new_by_curve_name(NID_secp256k1);
+    bn_ctx = BN_CTX_new();
+    done = true;
+}
+
+static void hash160(const uint8_t *data, size_t length, uint8_t out[RIPEMD160_DIGEST_SIZE]) {
+    uint8_t sha[SHA256_DIGEST_SIZE];
+    unsigned int out_length = 0;
+    if (!EVP_Digest(data, length, sha, &out_length, EVP_sha256(), nullptr) ||
+        !EVP_Digest(sha, sizeof(sha), out, &out_length, EVP_ripemd160(), nullptr)) {
+        printf("OpenSSL digest failed\n");
+        abort();
+    }
+}
+
+// hash160 of the public key of `key_hex`, uncompressed and compressed, by OpenSSL
+static void openssl_hash160(const std::string &key_hex, uint8_t uncompressed[RIPEMD160_DIGEST_SIZE],
+                            uint8_t compressed[RIPEMD160_DIGEST_SIZE]) {
+    BIGNUM *key = nullptr;
+    BN_hex2bn(&key, key_hex.c_str());
+    EC_POINT *point = EC_POINT_new(group);
+    uint8_t buf[65];
+    if (!EC_POINT_mul(group, point, key, nullptr, nullptr, bn_ctx) ||
+        EC_POINT_point2oct(group, point, POINT_CONVERSION_UNCOMPRESSED, buf, 65, bn_ctx) != 65) {
+        printf("OpenSSL point multiplication failed\n");
+        abort();
+    }
+    hash160(buf, 65, uncompressed);
+    EC_POINT_point2oct(group, point, POINT_CONVERSION_COMPRESSED, buf, 33, bn_ctx);
+    hash160(buf, 33, compressed);
+    EC_POINT_free(point);
+    BN_free(key);
+}
+
+// False (after printing the failing key) if the scan path disagrees with OpenSSL.
+// `first_hex` is a private key in [1, LAST_FIRST_KEY].
+static bool check_keys(const std::string &first_hex) {
+    Int first;
+    first.SetBase16((char *)first_hex.c_str());
+    Point points[8];
+    points[0] = secp.ComputePublicKey(&first, true);
+    for (int i = 1; i < 8; ++i) points[i] = secp.NextKey(points[i - 1]);
+
+    SerializedPubKey pubkeys[8];
+    const uint8_t *uncomp_ptrs[8], *comp_ptrs[8];
+    size_t uncomp_lengths[8], comp_lengths[8];
+    for (int i = 0; i < 8; ++i) {
+        pubkeys[i] = Address::serialize_pubkey(points[i]);
+        uncomp_ptrs[i] = pubkeys[i].uncompressed.data();
+        comp_ptrs[i] = pubkeys[i].compressed.data();
+        uncomp_lengths[i] = 65;
+        comp_lengths[i] = 33;
+    }
+    uint8_t uncomp_out[8][RIPEMD160_DIGEST_SIZE], comp_out[8][RIPEMD160_DIGEST_SIZE];
+    if (!Address::pubkeys_to_hash160_8x(uncomp_ptrs, uncomp_lengths, uncomp_out) ||
+        !Address::pubkeys_to_hash160_8x(comp_ptrs, comp_lengths, comp_out)) {
+        printf("hash160 kernels failed\n");
+        return false;
+    }
+
+    Int key = first;
+    for (int i = 0; i < 8; ++i, key.AddOne()) {
+        uint8_t uncomp_expect[RIPEMD160_DIGEST_SIZE], comp_expect[RIPEMD160_DIGEST_SIZE];
+        std::string key_hex = key.GetBase16();
+        openssl_hash160(key_hex, uncomp_expect, comp_expect);
+        if (memcmp(uncomp_out[i], uncomp_expect, RIPEMD160_DIGEST_SIZE) != 0 ||
+            memcmp(comp_out[i], comp_expect, RIPEMD160_DIGEST_SIZE) != 0) {
+            printf("hash160 mismatch for private key 0x%s (key %d of the batch)\n", key_hex.c_str(), i);
+            return false;
+        }
+    }
+    return true;
+}
+
+// First key from 32 random bytes, folded into [1, LAST_FIRST_KEY]
+static std::string key_from_bytes(const uint8_t bytes[32]) {
+    static const char digits[] = "0123456789ABCDEF";
+    std::string hex(64, '0');
+    for (int i = 0; i < 32; ++i) {
+        hex[2 * i] = digits[bytes[i] >> 4];
+        hex[2 * i + 1] = digits[bytes[i] & 15];
+    }
+    if (hex > LAST_FIRST_KEY) {
+        hex[0] = '7';
+    }
+    if (hex == std::string(64, '0')) {
+        hex[63] = '1';
+    }
+    return hex;
+}
+
+#ifdef LIBFUZZER
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+    if (size < 32) {
+        return 0;
+    }
+    init();
+    if (!check_keys(key_from_bytes(data))) {
+        abort();
+    }
+    return 0;
+}
+
+#else
+
+int main(int argc, char **argv) {
+    long iterations = argc > 1 ? atol(argv[1]) : 200;
+    uint64_t seed = argc > 2 ? strtoull(argv[2], nullptr, 10) : 1;
+    std::mt19937_64 rng(seed);
+    init();
+
+    // The smallest keys and the end of the key space first
+    if (!check_keys(std::string(63, '0') + "1") || !check_keys(LAST_FIRST_KEY)) {
+        return 1;
+    }
+    uint8_t bytes[32];
+    for (long n = 0; n < iterations; ++n) {
+        for (auto &b : bytes) b = (uint8_t)rng();
+        // Short keys too, as puzzle ranges are
+        int zeros = rng() % 4 == 0 ? (int)(rng() % 31) : 0;
+        memset(bytes, 0, zeros);
+        std::string key = key_from_bytes(bytes);
+        if (!check_keys(key)) {
+            printf("Failed at iteration %ld, seed %llu\n", n, (unsigned long long)seed);
+            return 1;
+        }
+    }
+
+    printf("All pipeline fuzz tests passed\n");
+    return 0;
+}
+
+#endif
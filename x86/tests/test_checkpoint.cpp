@@ -0,0 +1,119 @@
+#include <cstdio>
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include "../Checkpoint.h"
+
+static const uint64_t TOTAL = 200000;
+
+static ChunkInterval run_of(uint64_t first, uint64_t last) {
+    return {ChunkIndex(first), ChunkIndex(last)};
+}
+
+// Feeds random runs through a sorter that spills every `run_limit` runs and
+// compares the merged result with a bitmap.
+static bool check_merge(size_t run_limit, int count, uint64_t seed) {
+    IntervalSorter sorter("/tmp", run_limit);
+    std::vector<bool> covered(TOTAL, false);
+    for (int i = 0; i < count; ++i) {
+        seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+        uint64_t first = (seed >> 20) % TOTAL;
+        uint64_t len = (seed >> 50) % 8 == 0 ? (seed >> 8) % 40 : 0;
+        uint64_t last = first + len < TOTAL ? first + len : TOTAL - 1;
+        for (uint64_t c = first; c <= last; ++c) covered[c] = true;
+        if (!sorter.Add(run_of(first, last))) {
+            printf("Spill failed\n");
+            return false;
+        }
+    }
+    if (run_limit < (size_t)count && sorter.SpillFiles() == 0) {
+        printf("Sorter never spilled\n");
+        return false;
+    }
+
+    std::vector<bool> merged(TOTAL, false);
+    CoverageReport report{ChunkIndex(TOTAL)};
+    bool have = false, ok = true;
+    uint64_t prev_last = 0;
+    bool merged_ok = sorter.Merge([&](const ChunkInterval &run) {
+        uint64_t first = run.first.ToUint64(), last = run.last.ToUint64();
+        // Sorted, disjoint and not adjacent
+        if (have && first <= prev_last + 1) ok = false;
+        for (uint64_t c = first; c <= last && c < TOTAL; ++c) merged[c] = true;
+        have = true;
+        prev_last = last;
+        report.Add(run);
+    });
+    report.Finish();
+    if (!merged_ok || !ok || merged != covered) {
+        printf("Merge with run limit %zu does not match the input\n", run_limit);
+        return false;
+    }
+
+    uint64_t expect_covered = 0, expect_gaps = 0, largest = 0, gap = 0;
+    for (uint64_t c = 0; c <= TOTAL; ++c) {
+        if (c < TOTAL && !covered[c]) {
+            gap++;
+            continue;
+        }
+        if (c < TOTAL) expect_covered++;
+        if (gap) {
+            expect_gaps++;
+            if (gap > largest) largest = gap;
+        }
+        gap = 0;
+    }
+    if (report.covered.ToUint64() != expect_covered || report.gaps != expect_gaps ||
+        report.largest_gap_size.ToUint64() != largest) {
+        printf("Coverage %llu/%llu gaps %llu/%llu largest %llu/%llu\n",
+               (unsigned long long)report.covered.ToUint64(), (unsigned long long)expect_covered,
+               (unsigned long long)report.gaps, (unsigned long long)expect_gaps,
+               (unsigned long long)report.largest_gap_size.ToUint64(), (unsigned long long)largest);
+        return false;
+    }
+    return true;
+}
+
+int main() {
+    // In memory, a few spills, and more spills than one merge pass takes
+    if (!check_merge(1 << 20, 50000, 1)) return 1;
+    if (!check_merge(5000, 50000, 2)) return 1;
+    if (!check_merge(300, 50000, 3)) return 1;
+
+    // Runs at the top of the 256-bit index space do not wrap around
+    {
+        ChunkIndex top;
+        top.SetBase16("FFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFF");
+        ChunkIndex below = top;
+        below.Sub(ChunkIndex(5));
+        IntervalSorter sorter("/tmp", 1);
+        sorter.Add({below, top});
+        sorter.Add(run_of(0, 3));
+        sorter.Add({top, top});
+        std::vector<ChunkInterval> runs;
+        sorter.Merge([&](const ChunkInterval &run) { runs.push_back(run); });
+        if (runs.size() != 2 || runs[0].last != ChunkIndex(3) || runs[1].first != below ||
+            runs[1].last != top) {
+            printf("Runs at the end of the index space merged wrongly (%zu)\n", runs.size());
+            return 1;
+        }
+    }
+
+    // Fully covered and empty jobs
+    {
+        CoverageReport full{ChunkIndex(100)};
+        full.Add(run_of(0, 49));
+        full.Add(run_of(50, 99));
+        full.Finish();
+        CoverageReport empty{ChunkIndex(100)};
+        empty.Finish();
+        if (full.gaps != 0 || full.covered != ChunkIndex(100) || empty.gaps != 1 ||
+            empty.largest_gap.last != ChunkIndex(99)) {
+            printf("Coverage of full or empty job wrong\n");
+            return 1;
+        }
+    }
+
+    printf("All checkpoint tests passed\n");
+    return 0;
+}
@@ -0,0 +1,229 @@
+#include <cstdio>
+#include <cstring>
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <mutex>
+#include <thread>
+#include <chrono>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "../Coordinator.h"
+
+static const uint64_t TOTAL = 300;
+
+static bool connect_retry(CoordinatorClient &client, const std::string &addr, JobSpec &job) {
+    for (int i = 0; i < 100; ++i) {
+        if (client.Connect(addr, "test-" + std::to_string(getpid()), job)) return true;
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    }
+    return false;
+}
+
+// Leases and completes ranges until the coordinator says DONE.
+static int good_worker(const std::string &addr, bool report_found) {
+    CoordinatorClient client;
+    JobSpec job;
+    if (!connect_retry(client, addr, job)) return 2;
+    if (job.range_size != "1" || job.addresses.size() != 2 || job.addresses[1] != "1BitcoinEaterAddressDontSendf59kuE") {
+        return 3;
+    }
+
+    // Unknown speed: one range per thread
+    std::vector<ChunkIndex> chunks;
+    int wait_ms = 0;
+    if (client.Lease(2, 0, chunks, wait_ms) != CoordinatorClient::LEASE_OK || chunks.size() != 2) return 4;
+
+    for (;;) {
+        for (const ChunkIndex &idx : chunks) {
+            ChunkDigest digest;
+            digest.x = idx.ToUint64() + 1;
+            digest.sum = 7;
+            if (!client.Complete(idx, digest)) return 5;
+        }
+        if (report_found && !client.Found("DEADBEEF", "1TestAddress")) return 6;
+        report_found = false;
+
+        chunks.clear();
+        // 7 keys/sec * lease_seconds (1) / range_size (1) -> at most 7 ranges
+        auto result = client.Lease(2, 7, chunks, wait_ms);
+        if (result == CoordinatorClient::LEASE_OK) {
+            if (chunks.empty() || chunks.size() > 7) return 7;
+        } else if (result == CoordinatorClient::LEASE_WAIT) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(wait_ms));
+        } else {
+            return 0; // DONE or coordinator gone after finishing
+        }
+    }
+}
+
+// Leases a batch and disappears without completing anything.
+static int crashing_worker(const std::string &addr) {
+    CoordinatorClient client;
+    JobSpec job;
+    if (!connect_retry(client, addr, job)) return 2;
+    std::vector<ChunkIndex> chunks;
+    int wait_ms = 0;
+    client.Lease(1, 20, chunks, wait_ms);
+    _exit(0);
+}
+
+// Leases a batch and goes silent past the lease timeout while staying connected.
+static int stalled_worker(const std::string &addr) {
+    CoordinatorClient client;
+    JobSpec job;
+    if (!connect_retry(client, addr, job)) return 2;
+    std::vector<ChunkIndex> chunks;
+    int wait_ms = 0;
+    client.Lease(1, 20, chunks, wait_ms);
+    std::this_thread::sleep_for(std::chrono::milliseconds(2500));
+    // Late completions are accepted or reported stale, never double counted
+    for (const ChunkIndex &idx : chunks) client.Complete(idx);
+    return 0;
+}
+
+int main() {
+    std::string addr = "unix:/tmp/bitcrack_test_coordinator_" + std::to_string(getpid()) + ".sock";
+
+    std::vector<pid_t> children;
+    for (int i = 0; i < 5; ++i) {
+        pid_t pid = fork();
+        if (pid == 0) {
+            int rc;
+            if (i == 0) rc = crashing_worker(addr);
+            else if (i == 1) rc = stalled_worker(addr);
+            else {
+                // Let the faulty workers grab their leases first
+                std::this_thread::sleep_for(std::chrono::milliseconds(300));
+                rc = good_worker(addr, i == 2);
+            }
+            _exit(rc);
+        }
+        children.push_back(pid);
+    }
+
+    ChunkScheduler scheduler;
+    scheduler.Init(ChunkIndex(TOTAL), 42);
+    JobSpec job;
+    job.range_start = "1000";
+    job.range_end = "112B";
+    job.range_size = "1";
+    job.addresses = {"1rSnXMr63jdCuegJFuidJqWxUPV7AtUf7", "1BitcoinEaterAddressDontSendf59kuE"};
+
+    std::mutex mtx;
+    std::vector<int> completions(TOTAL, 0);
+    int found = 0;
+    bool bad_index = false;
+
+    Coordinator coordinator(scheduler, job, 1, 1);
+    coordinator.on_complete = [&](const ChunkIndex &idx, const ChunkDigest &digest) {
+        std::lock_guard<std::mutex> lock(mtx);
+        if (!idx.FitsUint64() || idx.ToUint64() >= TOTAL) bad_index = true;
+        else if (!digest.IsEmpty() && (digest.x != idx.ToUint64() + 1 || digest.sum != 7)) bad_index = true;
+        else completions[idx.ToUint64()]++;
+    };
+    coordinator.on_found = [&](const std::string &privkey, const std::string &address) {
+        std::lock_guard<std::mutex> lock(mtx);
+        if (privkey == "DEADBEEF" && address == "1TestAddress") found++;
+    };
+
+    std::thread watchdog([&] {
+        for (int i = 0; i < 300 && coordinator.Completed() < TOTAL; ++i) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        }
+        coordinator.Stop();
+    });
+    bool served = coordinator.Serve(addr);
+    watchdog.join();
+
+    int failed_children = 0;
+    for (pid_t pid : children) {
+        int status = 0;
+        waitpid(pid, &status, 0);
+        if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+            printf("Worker %d exited with status %d\n", (int)pid, WEXITSTATUS(status));
+            failed_children++;
+        }
+    }
+
+    if (!served) {
+        printf("Coordinator failed to listen on %s\n", addr.c_str());
+        return 1;
+    }
+    if (failed_children || bad_index) return 1;
+    for (uint64_t i = 0; i < TOTAL; ++i) {
+        if (completions[i] != 1) {
+            printf("Range %llu completed %d times\n", (unsigned long long)i, completions[i]);
+            return 1;
+        }
+    }
+    if (coordinator.Completed() != TOTAL || found != 1) {
+        printf("Completed %llu ranges, %d found keys\n",
+               (unsigned long long)coordinator.Completed(), found);
+        return 1;
+    }
+
+    // Workers coming and going: handlers of closed connections are joined
+    // while serving, not kept until Serve returns
+    {
+        std::string churn_addr = addr + ".churn";
+        ChunkScheduler churn_scheduler;
+        churn_scheduler.Init(ChunkIndex(TOTAL), 7);
+        Coordinator churn(churn_scheduler, job, 1, 1);
+        std::thread server([&] { churn.Serve(churn_addr); });
+        bool connected = true;
+        for (int i = 0; i < 50 && connected; ++i) {
+            CoordinatorClient client;
+            JobSpec churn_job;
+            connected = connect_retry(client, churn_addr, churn_job);
+            client.Close();
+        }
+        size_t left = churn.Handlers();
+        for (int i = 0; i < 40 && left > 0; ++i) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+            left = churn.Handlers();
+        }
+        churn.Stop();
+        server.join();
+        if (!connected || left > 0) {
+            printf("%zu connection handlers left unjoined\n", left);
+            return 1;
+        }
+    }
+
+    // A worker whose lease expired cannot complete the chunk once it has
+    // been leased to someone else; the new holder's completion counts
+    {
+        std::string late_addr = addr + ".late";
+        ChunkScheduler late_scheduler;
+        late_scheduler.Init(ChunkIndex(1), 3);
+        Coordinator late(late_scheduler, job, 1, 1);
+        std::thread server([&] { late.Serve(late_addr); });
+        CoordinatorClient slow, fast;
+        JobSpec late_job;
+        std::vector<ChunkIndex> slow_chunks, fast_chunks;
+        int wait_ms = 0;
+        bool ok = connect_retry(slow, late_addr, late_job) &&
+                  slow.Lease(1, 0, slow_chunks, wait_ms) == CoordinatorClient::LEASE_OK;
+        std::this_thread::sleep_for(std::chrono::milliseconds(1600));
+        ok = ok && connect_retry(fast, late_addr, late_job) &&
+             fast.Lease(1, 0, fast_chunks, wait_ms) == CoordinatorClient::LEASE_OK &&
+             fast_chunks.size() == 1 && fast_chunks[0] == slow_chunks[0];
+        ok = ok && slow.Complete(slow_chunks[0]);
+        uint64_t after_late = late.Completed();
+        ok = ok && fast.Complete(fast_chunks[0]);
+        uint64_t after_holder = late.Completed();
+        slow.Close();
+        fast.Close();
+        late.Stop();
+        server.join();
+        if (!ok || after_late != 0 || after_holder != 1) {
+            printf("Late completion accepted: %llu completed before the holder's, %llu after\n",
+                   (unsigned long long)after_late, (unsigned long long)after_holder);
+            return 1;
+        }
+    }
+
+    printf("All coordinator tests passed\n");
+    return 0;
+}
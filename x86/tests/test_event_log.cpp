@@ -0,0 +1,141 @@
+#include <cstdio>
+#include <cstring>
+#include <stdint.h>
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+#include "../EventLog.h"
+
+static const int PRODUCERS = 4;
+static const int PER_PRODUCER = 100000;
+
+// Lines of a file, removing it
+static std::vector<std::string> read_lines(const std::string &path) {
+    std::vector<std::string> lines;
+    FILE *file = fopen(path.c_str(), "r");
+    char buf[512];
+    while (file && fgets(buf, sizeof(buf), file)) {
+        buf[strcspn(buf, "\n")] = 0;
+        lines.push_back(buf);
+    }
+    if (file) fclose(file);
+    unlink(path.c_str());
+    return lines;
+}
+
+int main() {
+    // Several producers against one consumer: nothing lost or duplicated,
+    // each producer's values in order
+    {
+        MpscQueue<uint64_t, 1024> queue;
+        std::atomic<int> running(PRODUCERS);
+        std::vector<std::thread> producers;
+        for (int p = 0; p < PRODUCERS; ++p) {
+            producers.emplace_back([&, p]() {
+                for (uint64_t i = 0; i < PER_PRODUCER; ++i) {
+                    while (!queue.TryPush(((uint64_t)p << 32) | i)) std::this_thread::yield();
+                }
+                running--;
+            });
+        }
+        std::vector<uint64_t> next(PRODUCERS, 0);
+        uint64_t value, popped = 0;
+        bool ordered = true;
+        while (popped < (uint64_t)PRODUCERS * PER_PRODUCER) {
+            if (!queue.TryPop(value)) {
+                std::this_thread::yield();
+                continue;
+            }
+            int p = (int)(value >> 32);
+            ordered = ordered && p < PRODUCERS && (value & 0xFFFFFFFF) == next[p];
+            if (p < PRODUCERS) next[p]++;
+            popped++;
+        }
+        for (auto &t : producers) t.join();
+        if (!ordered || running != 0 || queue.TryPop(value)) {
+            printf("Queue popped %llu values, ordered %d\n", (unsigned long long)popped, ordered);
+            return 1;
+        }
+    }
+
+    // A full queue refuses instead of blocking
+    {
+        MpscQueue<int, 4> queue;
+        int v;
+        bool ok = queue.TryPush(1) && queue.TryPush(2) && queue.TryPush(3) && queue.TryPush(4) &&
+                  !queue.TryPush(5) && queue.TryPop(v) && v == 1 && queue.TryPush(5);
+        if (!ok) {
+            printf("Full queue handled wrongly\n");
+            return 1;
+        }
+    }
+
+    if (json_string("a\"b\\c\n") != "\"a\\\"b\\\\c\\u000a\"") {
+        printf("JSON escaping wrong: %s\n", json_string("a\"b\\c\n").c_str());
+        return 1;
+    }
+
+    // Text lines are rate limited, JSON lines are all written
+    std::string text_path = "/tmp/bitcrack_test_log_" + std::to_string(getpid()) + ".txt";
+    std::string json_path = "/tmp/bitcrack_test_log_" + std::to_string(getpid()) + ".json";
+    FILE *text_out = fopen(text_path.c_str(), "w");
+    FILE *json_out = fopen(json_path.c_str(), "w");
+    std::mutex text_mutex;
+    EventLog log([](const LogEvent &event, std::string &text, std::string &json) {
+        text = "range " + std::to_string(event.completed);
+        json = "{\"range\":" + std::to_string(event.completed) + "}";
+    }, text_out, text_mutex, 5, json_out);
+    log.Start();
+    LogEvent event = {};
+    for (uint64_t i = 1; i <= 200; ++i) {
+        event.completed = i;
+        if (!log.Post(event)) {
+            printf("Event %llu dropped with room in the queue\n", (unsigned long long)i);
+            return 1;
+        }
+    }
+    log.Stop();
+    fclose(text_out);
+    fclose(json_out);
+
+    std::vector<std::string> text = read_lines(text_path), json = read_lines(json_path);
+    if (json.size() != 200 || json[199] != "{\"range\":200}") {
+        printf("JSON log has %zu lines\n", json.size());
+        return 1;
+    }
+    if (text.size() != 6 || text[0] != "range 1" || text[4] != "range 5" ||
+        text[5] != "range 200 (195 more lines skipped)") {
+        printf("Text log has %zu lines, last '%s'\n", text.size(), text.empty() ? "" : text.back().c_str());
+        return 1;
+    }
+
+    // Posting never blocks: overflow is counted and reported
+    {
+        std::string path = "/tmp/bitcrack_test_log_drop_" + std::to_string(getpid());
+        FILE *out = fopen(path.c_str(), "w");
+        EventLog slow([](const LogEvent &, std::string &text, std::string &) { text = "x"; },
+                      out, text_mutex, 0, nullptr);
+        // Not started: nothing drains the queue
+        uint64_t accepted = 0;
+        for (size_t i = 0; i < EventLog::QUEUE_SIZE + 100; ++i) accepted += slow.Post(event);
+        if (accepted != EventLog::QUEUE_SIZE || slow.Dropped() != 100) {
+            printf("Accepted %llu events, dropped %llu\n", (unsigned long long)accepted,
+                   (unsigned long long)slow.Dropped());
+            return 1;
+        }
+        slow.Start();
+        slow.Stop();
+        fclose(out);
+        std::vector<std::string> lines = read_lines(path);
+        if (lines.size() != 1 || lines[0].find("100 status events dropped") == std::string::npos) {
+            printf("Drops reported as '%s'\n", lines.empty() ? "" : lines[0].c_str());
+            return 1;
+        }
+    }
+
+    printf("All event log tests passed\n");
+    return 0;
+}
@@ -12,7 +12,8 @@ static void to_hex(const uint8_t* digest, size_t len, char* out) {
     out[len*2] = '\0';
 }
 
-int main() {
+// The known-answer vectors with the selected kernels
+static bool check_vectors() {
     const char* messages[8] = {"", "abc", "hello world", "BitCrack",
                                 "test", "1234567890", "OpenAI", "foo bar"};
     const char* sha_expect[8] = {
@@ -46,11 +47,11 @@ int main() {
 
     if (sha256_8x(inputs, lengths, sha_out) != 0) {
         printf("sha256_8x failed\n");
-        return 1;
+        return false;
     }
     if (ripemd160_8x(inputs, lengths, rip_out) != 0) {
         printf("ripemd160_8x failed\n");
-        return 1;
+        return false;
     }
 
     char hexbuf[65];
@@ -58,7 +59,7 @@ int main() {
         to_hex(sha_out[i], SHA256_DIGEST_SIZE, hexbuf);
         if (strcmp(hexbuf, sha_expect[i]) != 0) {
             printf("SHA256 mismatch %d: %s != %s\n", i, hexbuf, sha_expect[i]);
-            return 1;
+            return false;
         }
     }
 
@@ -67,10 +68,95 @@ int main() {
         to_hex(rip_out[i], RIPEMD160_DIGEST_SIZE, hexbuf2);
         if (strcmp(hexbuf2, ripemd_expect[i]) != 0) {
             printf("RIPEMD160 mismatch %d: %s != %s\n", i, hexbuf2, ripemd_expect[i]);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// 16-lane calls must match the AVX2 kernels lane for lane (the scalar
+// ones without AVX2), with every lane at a different length
+static bool check_16_lanes() {
+    static const size_t lane_lengths[16] = {0, 1, 32, 33, 55, 56, 63, 64, 65, 100, 119, 120, 127, 128, 200, 300};
+    static uint8_t buffers[16][300];
+    const uint8_t* inputs[16];
+    size_t lengths[16];
+    for (int i = 0; i < 16; ++i) {
+        for (size_t j = 0; j < lane_lengths[i]; ++j) {
+            buffers[i][j] = (uint8_t)(i * 31 + j * 7 + 1);
+        }
+        inputs[i] = buffers[i];
+        lengths[i] = lane_lengths[i];
+    }
+
+    const char* reference = hash_isa_supported("avx2") ? "avx2" : "scalar";
+    uint8_t sha_ref[16][SHA256_DIGEST_SIZE];
+    uint8_t rip_ref[16][RIPEMD160_DIGEST_SIZE];
+    hash_select_isa(reference);
+    for (int half = 0; half < 16; half += 8) {
+        if (sha256_8x(inputs + half, lengths + half, sha_ref + half) != 0 ||
+            ripemd160_8x(inputs + half, lengths + half, rip_ref + half) != 0) {
+            printf("%s kernels failed\n", reference);
+            return false;
+        }
+    }
+
+    for (int k = 0; k < hash_isa_count(); ++k) {
+        const char* isa = hash_isa_at(k);
+        if (hash_select_isa(isa) != 0) {
+            continue;
+        }
+        uint8_t sha_out[16][SHA256_DIGEST_SIZE];
+        uint8_t rip_out[16][RIPEMD160_DIGEST_SIZE];
+        if (sha256_16x(inputs, lengths, sha_out) != 0 || ripemd160_16x(inputs, lengths, rip_out) != 0) {
+            printf("16-lane %s kernels failed\n", isa);
+            return false;
+        }
+        for (int i = 0; i < 16; ++i) {
+            if (memcmp(sha_out[i], sha_ref[i], SHA256_DIGEST_SIZE) != 0 ||
+                memcmp(rip_out[i], rip_ref[i], RIPEMD160_DIGEST_SIZE) != 0) {
+                printf("16-lane %s kernels differ from %s in lane %d (%zu bytes)\n", isa, reference, i, lengths[i]);
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+int main() {
+    // Every kernel set this CPU can run; the scalar one always can
+    if (!hash_isa_supported("scalar") || hash_select_isa("no-such-isa") == 0) {
+        printf("Kernel selection broken\n");
+        return 1;
+    }
+    for (int i = 0; i < hash_isa_count(); ++i) {
+        const char* isa = hash_isa_at(i);
+        if (!hash_isa_supported(isa)) {
+            printf("Skipping %s kernels, not supported by this CPU\n", isa);
+            continue;
+        }
+        if (hash_select_isa(isa) != 0 || strcmp(hash_isa_name(), isa) != 0) {
+            printf("Could not select %s kernels\n", isa);
             return 1;
         }
+        if (!check_vectors()) {
+            printf("with %s kernels\n", isa);
+            return 1;
+        }
+    }
+
+    if (!check_16_lanes()) {
+        return 1;
+    }
+
+    // "auto" times every supported set and keeps one of them
+    if (hash_select_isa("auto") != 0 || !hash_isa_supported(hash_isa_name()) ||
+        hash_isa_ns_per_key(hash_isa_name()) <= 0) {
+        printf("Timed kernel selection broken\n");
+        return 1;
     }
 
-    printf("All AVX2 hash tests passed\n");
+    printf("All hash tests passed\n");
     return 0;
 }
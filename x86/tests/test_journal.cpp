@@ -0,0 +1,214 @@
+#include <algorithm>
+#include <cstdio>
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "../Journal.h"
+
+static const uint64_t TOTAL = 100000;
+static const char *JOB = "1000:2387:1";
+
+static bool load_sorted(const std::string &path, std::vector<uint64_t> &completed) {
+    std::vector<JournalPartial> partial;
+    completed.clear();
+    if (!CheckpointJournal::Load(path, JOB, TOTAL, completed, partial)) return false;
+    std::sort(completed.begin(), completed.end());
+    completed.erase(std::unique(completed.begin(), completed.end()), completed.end());
+    return true;
+}
+
+static bool expect(const std::string &path, const std::vector<uint64_t> &want, const char *what) {
+    std::vector<uint64_t> got;
+    if (!load_sorted(path, got)) {
+        printf("%s: load failed\n", what);
+        return false;
+    }
+    if (got != want) {
+        printf("%s: restored %zu ranges, expected %zu\n", what, got.size(), want.size());
+        return false;
+    }
+    return true;
+}
+
+int main() {
+    std::string path = "/tmp/bitcrack_test_journal_" + std::to_string(getpid());
+    std::string snap = path + ".snap";
+    std::string digests = path + ".digests";
+    unlink(path.c_str());
+    unlink(snap.c_str());
+    unlink(digests.c_str());
+    std::vector<uint64_t> want;
+
+    // Nothing on disk is an empty checkpoint
+    if (!expect(path, want, "Missing journal")) return 1;
+
+    // Plain records, group committed
+    {
+        CheckpointJournal journal;
+        if (!journal.Open(path, JOB, TOTAL, 1000)) {
+            printf("Failed to create journal\n");
+            return 1;
+        }
+        for (uint64_t i = 0; i < TOTAL; i += 7) {
+            journal.Complete(i);
+            want.push_back(i);
+        }
+        journal.Flush();
+        if (!expect(path, want, "Journal records")) return 1;
+
+        // Fold into the snapshot, then keep appending after it
+        if (!journal.Snapshot()) {
+            printf("Snapshot failed\n");
+            return 1;
+        }
+        struct stat st;
+        if (stat(path.c_str(), &st) != 0 || st.st_size != 64) {
+            printf("Journal not truncated after snapshot\n");
+            return 1;
+        }
+        if (!expect(path, want, "Snapshot")) return 1;
+        for (uint64_t i = 3; i < TOTAL; i += 11) {
+            journal.Complete(i);
+            want.push_back(i);
+        }
+        journal.Flush();
+    }
+    std::sort(want.begin(), want.end());
+    want.erase(std::unique(want.begin(), want.end()), want.end());
+    if (!expect(path, want, "Snapshot plus journal")) return 1;
+
+    // The snapshot comes back as words, the records after it one by one
+    {
+        std::vector<uint64_t> words, tail, got;
+        std::vector<JournalPartial> partial;
+        if (!CheckpointJournal::Load(path, JOB, TOTAL, words, tail, partial)) {
+            printf("Word load failed\n");
+            return 1;
+        }
+        for (size_t i = 0; i + 1 < words.size(); i += 2) {
+            if (words[i + 1] == 0 || (i >= 2 && words[i] <= words[i - 2])) {
+                printf("Snapshot words not sorted or empty at %zu\n", i);
+                return 1;
+            }
+            for (uint64_t bits = words[i + 1]; bits; bits &= bits - 1) {
+                got.push_back(words[i] * 64 + (uint64_t)__builtin_ctzll(bits));
+            }
+        }
+        size_t snapshot_chunks = got.size();
+        got.insert(got.end(), tail.begin(), tail.end());
+        std::sort(got.begin(), got.end());
+        got.erase(std::unique(got.begin(), got.end()), got.end());
+        if (got != want || snapshot_chunks == 0) {
+            printf("Words restored %zu ranges (%zu from the snapshot), expected %zu\n",
+                   got.size(), snapshot_chunks, want.size());
+            return 1;
+        }
+    }
+
+    // A torn record at the end is dropped, and the next Open appends after the
+    // last good one
+    {
+        int fd = open(path.c_str(), O_WRONLY | O_APPEND);
+        char garbage[20] = {1, 2, 3};
+        if (fd < 0 || write(fd, garbage, sizeof(garbage)) != (ssize_t)sizeof(garbage)) {
+            printf("Failed to tear the journal\n");
+            return 1;
+        }
+        close(fd);
+        if (!expect(path, want, "Torn tail")) return 1;
+
+        CheckpointJournal journal;
+        if (!journal.Open(path, JOB, TOTAL, 0)) {
+            printf("Failed to reopen torn journal\n");
+            return 1;
+        }
+        journal.Complete(1);
+        want.insert(std::lower_bound(want.begin(), want.end(), 1), 1);
+        if (!expect(path, want, "Append after torn tail")) return 1;
+    }
+
+    // A corrupt record ends the replay
+    {
+        struct stat st;
+        stat(path.c_str(), &st);
+        int fd = open(path.c_str(), O_WRONLY);
+        CheckpointJournal journal;
+        if (!journal.Open(path, JOB, TOTAL, 0)) return 1;
+        journal.Complete(2);
+        uint64_t bad = TOTAL - 1;
+        if (fd < 0 || pwrite(fd, &bad, sizeof(bad), st.st_size + 8) != (ssize_t)sizeof(bad)) {
+            printf("Failed to corrupt the journal\n");
+            return 1;
+        }
+        close(fd);
+        std::vector<uint64_t> got;
+        load_sorted(path, got);
+        if (std::binary_search(got.begin(), got.end(), bad) || std::binary_search(got.begin(), got.end(), 2)) {
+            printf("Replayed a corrupt record\n");
+            return 1;
+        }
+    }
+
+    // Interrupted chunks survive a snapshot until they complete; the latest
+    // offset wins
+    {
+        CheckpointJournal journal;
+        if (!journal.Open(path, JOB, TOTAL, 1000)) return 1;
+        ChunkDigest some;
+        some.x = 0x1234;
+        journal.Partial({5, 64, 0, ChunkDigest()});
+        journal.Partial({5, 128, 1, some});
+        journal.Partial({6, 8, 0, ChunkDigest()});
+        journal.Complete(6);
+        journal.Partial({9, 16, 0, ChunkDigest()});
+        if (!journal.Snapshot()) return 1;
+        journal.Complete(9);
+    }
+    std::vector<uint64_t> done;
+    std::vector<JournalPartial> partial;
+    if (!CheckpointJournal::Load(path, JOB, TOTAL, done, partial) || partial.size() != 1 ||
+        partial[0].idx != 5 || partial[0].offset_lo != 128 || partial[0].offset_hi != 1 ||
+        partial[0].digest.x != 0x1234) {
+        printf("Interrupted chunks not restored (%zu)\n", partial.size());
+        return 1;
+    }
+
+    // Digests of completed chunks are kept across snapshots
+    {
+        CheckpointJournal journal;
+        if (!journal.Open(path, JOB, TOTAL, 1000)) return 1;
+        for (uint64_t i = 50000; i < 50100; ++i) {
+            ChunkDigest digest;
+            digest.x = i * 3;
+            digest.sum = i * 5;
+            journal.Complete(i, digest);
+            if (i == 50049 && !journal.Snapshot()) return 1;
+        }
+    }
+    int matched = 0, wrong = 0;
+    if (!CheckpointJournal::LoadDigests(path, JOB, TOTAL, [&](uint64_t idx, const ChunkDigest &digest) {
+            if (digest.x == idx * 3 && digest.sum == idx * 5) matched++;
+            else wrong++;
+        }) || matched < 100 || wrong != 0) {
+        printf("Digests restored %d, wrong %d\n", matched, wrong);
+        return 1;
+    }
+
+    // Journals of another job are rejected
+    std::vector<uint64_t> other;
+    CheckpointJournal journal;
+    if (CheckpointJournal::Load(path, "1000:2387:2", TOTAL, other, partial) ||
+        journal.Open(path, JOB, TOTAL + 1, 0)) {
+        printf("Opened a journal made for another job\n");
+        return 1;
+    }
+
+    unlink(path.c_str());
+    unlink(snap.c_str());
+    unlink(digests.c_str());
+    printf("All journal tests passed\n");
+    return 0;
+}
@@ -0,0 +1,107 @@
+#include <cstdio>
+#include <stdint.h>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <sys/socket.h>
+#include "../Metrics.h"
+#include "../Net.h"
+
+// Count of the `le` bucket line in an exposition page, -1 if missing
+static long long bucket_count(const std::string &text, const std::string &le) {
+    std::string key = "le=\"" + le + "\"} ";
+    size_t at = text.find(key);
+    return at == std::string::npos ? -1 : std::stoll(text.substr(at + key.size()));
+}
+
+int main() {
+    // Every value lands in a bucket whose limit covers it within 25%
+    for (uint64_t v = 0; v < 1000000; v = v * 3 / 2 + 1) {
+        int b = LatencyHistogram::BucketOf(v);
+        uint64_t limit = LatencyHistogram::BucketLimit(b);
+        uint64_t below = b > 0 ? LatencyHistogram::BucketLimit(b - 1) : 0;
+        if (b >= LatencyHistogram::BUCKETS || limit < v || (b > 0 && below >= v) ||
+            (v >= 4 && limit > v + v / 4)) {
+            printf("Value %llu in bucket %d with limit %llu\n", (unsigned long long)v, b,
+                   (unsigned long long)limit);
+            return 1;
+        }
+    }
+    if (LatencyHistogram::BucketOf(UINT64_MAX) != LatencyHistogram::BUCKETS - 1 ||
+        LatencyHistogram::BucketLimit(LatencyHistogram::BUCKETS - 1) != UINT64_MAX) {
+        printf("Top bucket does not end at UINT64_MAX\n");
+        return 1;
+    }
+
+    // Percentiles and cumulative buckets
+    LatencyHistogram hist;
+    for (int i = 1; i <= 1000; ++i) hist.Record(1000 * i); // 1 ms .. 1 s
+    uint64_t p50 = hist.Percentile(50), p99 = hist.Percentile(99);
+    if (hist.Count() != 1000 || p50 < 500000 || p50 > 625000 || p99 < 990000 || p99 > 1240000) {
+        printf("Percentiles off: p50 %llu p99 %llu\n", (unsigned long long)p50, (unsigned long long)p99);
+        return 1;
+    }
+    std::string text;
+    hist.Write(text, "chunk_seconds", "job=\"a\"");
+    // 2^19 us = 0.524288 s holds 1..524 ms
+    if (bucket_count(text, "0.524288") != 524 || bucket_count(text, "+Inf") != 1000 ||
+        text.find("chunk_seconds_count{job=\"a\"} 1000\n") == std::string::npos ||
+        text.find("chunk_seconds_sum{job=\"a\"} 500.500000\n") == std::string::npos) {
+        printf("Histogram exposition wrong:\n%s", text.c_str());
+        return 1;
+    }
+
+    MetricsText page;
+    page.Family("keys_total", "counter", "Keys scanned.");
+    page.Sample("keys_total", metric_label("job", "a\"b"), 42);
+    if (page.Text() != "# HELP keys_total Keys scanned.\n# TYPE keys_total counter\n"
+                       "keys_total{job=\"a\\\"b\"} 42\n") {
+        printf("Exposition text wrong:\n%s", page.Text().c_str());
+        return 1;
+    }
+
+    // Scraped over a socket
+    std::string addr = "unix:/tmp/bitcrack_test_metrics_" + std::to_string(getpid());
+    std::atomic<bool> stop(false);
+    std::thread server([&]() { ServeMetrics(addr, stop, [&]() { return page.Text(); }); });
+    int fd = -1;
+    for (int i = 0; i < 100 && fd < 0; ++i) {
+        fd = Net::connect_to(addr);
+        if (fd < 0) std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    std::string request = "GET /metrics HTTP/1.1\r\nHost: localhost\r\n\r\n", reply;
+    send(fd, request.data(), request.size(), 0);
+    char buf[512];
+    ssize_t n;
+    while ((n = recv(fd, buf, sizeof(buf), 0)) > 0) reply.append(buf, (size_t)n);
+    close(fd);
+    stop = true;
+    server.join();
+    if (reply.compare(0, 15, "HTTP/1.0 200 OK") != 0 ||
+        reply.substr(reply.find("\r\n\r\n") + 4) != page.Text()) {
+        printf("Scrape answered:\n%s\n", reply.c_str());
+        return 1;
+    }
+
+    // Textfile output replaces the file whole
+    std::string path = "/tmp/bitcrack_test_metrics_" + std::to_string(getpid()) + ".prom";
+    if (!WriteMetricsFile(path, "old\n") || !WriteMetricsFile(path, page.Text())) {
+        printf("Could not write metrics file\n");
+        return 1;
+    }
+    std::ifstream in(path);
+    std::stringstream written;
+    written << in.rdbuf();
+    unlink(path.c_str());
+    if (written.str() != page.Text()) {
+        printf("Metrics file holds:\n%s", written.str().c_str());
+        return 1;
+    }
+
+    printf("All metrics tests passed\n");
+    return 0;
+}
@@ -0,0 +1,96 @@
+#include <cstdio>
+#include <stdint.h>
+#include <chrono>
+#include <string>
+#include <thread>
+#include "../Profiler.h"
+
+static volatile uint64_t sink;
+
+// Busy work for about `micros` microseconds
+static void spin(int micros) {
+    auto until = std::chrono::steady_clock::now() + std::chrono::microseconds(micros);
+    uint64_t x = 1;
+    while (std::chrono::steady_clock::now() < until) x = x * 6364136223846793005ULL + 1;
+    sink = x;
+}
+
+int main() {
+    Profiler profiler(4);
+    ThreadProfile *main_profile = profiler.Register();
+
+    // Two threads, as with smt_pairing: split, each sampling its own stages.
+    // One after the other, so the busy loops do not share a core.
+    std::thread other([&]() {
+        ThreadProfile *profile = profiler.Register();
+        for (int i = 0; i < 40; ++i) {
+            if (!profile->Due(STAGE_HASH)) continue;
+            profile->Begin();
+            spin(300);
+            profile->Mark(STAGE_HASH);
+            spin(100);
+            profile->Mark(STAGE_LOOKUP);
+        }
+    });
+    other.join();
+    for (int i = 0; i < 40; ++i) {
+        if (!main_profile->Due(STAGE_EC_STEP)) continue;
+        main_profile->Begin();
+        spin(600);
+        main_profile->Mark(STAGE_EC_STEP);
+        spin(200);
+        main_profile->Mark(STAGE_SERIALIZE);
+    }
+
+    // One call in four sampled, per stage
+    if (main_profile->Totals(STAGE_EC_STEP).marks != 10 || main_profile->Totals(STAGE_HASH).marks != 0) {
+        printf("Sampled %llu EC batches, expected 10\n",
+               (unsigned long long)main_profile->Totals(STAGE_EC_STEP).marks);
+        return 1;
+    }
+    double ec = (double)main_profile->Totals(STAGE_EC_STEP).ticks;
+    double serialize = (double)main_profile->Totals(STAGE_SERIALIZE).ticks;
+    if (ec < serialize * 2 || ec > serialize * 4.5) {
+        printf("EC/serialize tick ratio %.2f, expected about 3\n", ec / serialize);
+        return 1;
+    }
+
+    // 10 batches of 8 keys per stage: EC 600 us / 8 = 75000 ns per key
+    std::string report = profiler.Report();
+    if (report.find("EC step") == std::string::npos || report.find("lookup") == std::string::npos ||
+        report.find("(10 batches)") == std::string::npos) {
+        printf("Report incomplete:\n%s", report.c_str());
+        return 1;
+    }
+    size_t at = report.find("EC step");
+    double share = 0, ns_per_key = 0;
+    if (sscanf(report.c_str() + at, "EC step %lf%% %lf", &share, &ns_per_key) != 2 ||
+        ns_per_key < 70000 || ns_per_key > 100000 || share < 40 || share > 60) {
+        printf("EC step reported %.1f%% and %.1f ns/key:\n%s", share, ns_per_key, report.c_str());
+        return 1;
+    }
+
+    // Threads that exit hand their totals back: the report keeps them and
+    // nothing stays registered, however many threads come and go
+    {
+        Profiler churn(1);
+        for (int n = 0; n < 200; ++n) {
+            std::thread worker([&]() {
+                ThreadProfile *profile = churn.Register();
+                profile->Due(STAGE_HASH);
+                profile->Begin();
+                profile->Mark(STAGE_HASH);
+                churn.Unregister(profile);
+            });
+            worker.join();
+        }
+        if (churn.Registered() != 0 || churn.Report().find("(200 batches)") == std::string::npos) {
+            printf("After 200 threads: %zu profiles registered, report:\n%s", churn.Registered(),
+                   churn.Report().c_str());
+            return 1;
+        }
+    }
+
+    printf("All profiler tests passed\n");
+    return 0;
+}
@@ -0,0 +1,166 @@
+#include <cstdio>
+#include <stdint.h>
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+#include "../HexUtil.hpp"
+#include "../Scanner.h"
+#include "../Scheduler.h"
+
+// Planted-key runs of the scan engine: small jobs claimed through the
+// scheduler and scanned with scan_range, the way workers of a local job do,
+// checking exactly which keys are found and that every key is scanned once.
+
+static Secp256K1 secp;
+
+// hash160 of one encoding of a key's public key, computed directly from the key
+static std::string hash160_of(uint64_t key, bool compressed) {
+    Int k(key);
+    SerializedPubKey pubkey = Address::serialize_pubkey(secp.ComputePublicKey(&k, true));
+    const uint8_t *ptrs[8];
+    size_t lengths[8];
+    for (int i = 0; i < 8; ++i) {
+        ptrs[i] = compressed ? pubkey.compressed.data() : pubkey.uncompressed.data();
+        lengths[i] = compressed ? 33 : 65;
+    }
+    uint8_t out[8][RIPEMD160_DIGEST_SIZE];
+    Address::pubkeys_to_hash160_8x(ptrs, lengths, out);
+    return HexUtil::toHex(out[0], RIPEMD160_DIGEST_SIZE);
+}
+
+struct Run {
+    std::map<std::pair<uint64_t, bool>, int> hits; // (key, compressed) -> times found
+    uint64_t keys = 0;                             // keys counted by the workers
+    uint64_t filter_passes = 0;                    // hashes the filter let through
+    std::map<uint64_t, ChunkDigest> digests;       // per range index
+};
+
+// Scan every range of [first, last] in chunks of `range_size` with `workers` threads
+static Run run_job(uint64_t first, uint64_t last, uint64_t range_size,
+                   const std::unordered_set<std::string> &targets, int workers) {
+    Config config;
+    config.range_start = new Int(first);
+    config.range_end = new Int(last);
+    config.range_size = new Int(range_size);
+    compute_total_ranges(config);
+
+    ChunkScheduler scheduler;
+    scheduler.Init(config.total_ranges, 7);
+    std::mutex mutex;
+    std::atomic<bool> stop(false);
+    std::vector<WorkerStats> stats(workers);
+    Run run;
+    HitHandler on_hit = [&](const Int &privkey, const std::string &, bool compressed) {
+        std::lock_guard<std::mutex> lock(mutex);
+        run.hits[{privkey.bits64[0], compressed}]++;
+    };
+
+    TargetFilter filter(targets);
+    std::vector<std::thread> threads;
+    for (int w = 0; w < workers; ++w) {
+        threads.emplace_back([&, w]() {
+            ChunkIndex idx;
+            for (;;) {
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    if (!scheduler.Claim(idx)) break;
+                }
+                Int start, end;
+                range_bounds(config, idx, start, end);
+                ChunkDigest digest;
+                scan_range(&secp, start, end, targets, filter, on_hit, digest, stats[w], stop);
+                std::lock_guard<std::mutex> lock(mutex);
+                run.digests[idx.ToUint64()] = digest;
+            }
+        });
+    }
+    for (auto &t : threads) t.join();
+    for (auto &s : stats) {
+        run.keys += s.scanned;
+        run.filter_passes += s.filter_passes;
+    }
+    free_config(config);
+    return run;
+}
+
+int main() {
+    secp.Init();
+
+    // Coverage: every key of the job and 8 keys either side are targets.
+    // 300 keys in ranges of 37: range ends fall mid-batch and the last
+    // range holds 4 keys. Each key must be found once, none outside.
+    const uint64_t first = 0x1000, last = 0x1000 + 299;
+    std::unordered_set<std::string> all_keys;
+    for (uint64_t k = first - 8; k <= last + 8; ++k) all_keys.insert(hash160_of(k, true));
+    for (int workers : {1, 2, 3, 5}) {
+        Run run = run_job(first, last, 37, all_keys, workers);
+        if (run.keys != 300 || run.hits.size() != 300 || run.filter_passes < 300) {
+            printf("%d workers: %llu keys counted, %zu found, %llu filter passes, expected 300\n", workers,
+                   (unsigned long long)run.keys, run.hits.size(), (unsigned long long)run.filter_passes);
+            return 1;
+        }
+        for (auto &hit : run.hits) {
+            if (hit.first.first < first || hit.first.first > last || hit.second != 1 || !hit.first.second) {
+                printf("%d workers: key 0x%llx found %d times\n", workers, (unsigned long long)hit.first.first,
+                       hit.second);
+                return 1;
+            }
+        }
+    }
+
+    // Planted keys: the first and last keys of the job, both sides of range
+    // boundaries, and both encodings, in ranges that are and are not
+    // multiples of the batch size
+    for (uint64_t range_size : {64, 50}) {
+        const uint64_t job_first = 1, job_last = 500;
+        std::set<std::pair<uint64_t, bool>> planted = {
+            {job_first, false},
+            {job_last, true},
+            {range_size, true},          // last key of the first range
+            {range_size + 1, false},     // first key of the second range
+            {3 * range_size, false},
+            {3 * range_size + 1, true},
+            {123, true},
+            {123, false},
+        };
+        std::unordered_set<std::string> targets;
+        for (auto &p : planted) targets.insert(hash160_of(p.first, p.second));
+        // Near misses: the keys just outside the job
+        targets.insert(hash160_of(job_last + 1, true));
+        targets.insert(hash160_of(job_last + 1, false));
+
+        Run reference;
+        for (int workers : {1, 4}) {
+            Run run = run_job(job_first, job_last, range_size, targets, workers);
+            std::set<std::pair<uint64_t, bool>> found;
+            bool once = true;
+            for (auto &hit : run.hits) {
+                found.insert(hit.first);
+                once = once && hit.second == 1;
+            }
+            if (found != planted || !once || run.keys != job_last - job_first + 1) {
+                printf("Ranges of %llu, %d workers: %zu of %zu planted keys found, %llu keys counted\n",
+                       (unsigned long long)range_size, workers, found.size(), planted.size(),
+                       (unsigned long long)run.keys);
+                return 1;
+            }
+            // The digests of a range do not depend on who scanned it
+            if (workers == 1) {
+                reference = run;
+            } else if (run.digests != reference.digests) {
+                printf("Ranges of %llu: digests differ between 1 and %d workers\n", (unsigned long long)range_size,
+                       workers);
+                return 1;
+            }
+        }
+    }
+
+    printf("All scan tests passed\n");
+    return 0;
+}
@@ -0,0 +1,209 @@
+#include <cstdio>
+#include <cstring>
+#include <stdint.h>
+#include <vector>
+#include <unordered_set>
+#include "../Scheduler.h"
+
+// Every index in [0, total) must be claimed exactly once.
+static bool check_exhaustive(uint64_t total, uint64_t seed) {
+    ChunkScheduler sched;
+    sched.Init(ChunkIndex(total), seed);
+    std::vector<char> seen(total, 0);
+    ChunkIndex idx;
+    uint64_t claimed = 0;
+    while (sched.Claim(idx)) {
+        if (!idx.FitsUint64() || idx.ToUint64() >= total) {
+            printf("Index out of range for total %llu: %s\n",
+                   (unsigned long long)total, idx.GetBase16().c_str());
+            return false;
+        }
+        if (seen[idx.ToUint64()]++) {
+            printf("Index claimed twice for total %llu: %llu\n",
+                   (unsigned long long)total, (unsigned long long)idx.ToUint64());
+            return false;
+        }
+        claimed++;
+    }
+    if (claimed != total || sched.ScannedCount() != total) {
+        printf("Claimed %llu of %llu indices\n",
+               (unsigned long long)claimed, (unsigned long long)total);
+        return false;
+    }
+    return true;
+}
+
+// Draws from a job wider than 2^64 (or 2^128) must reach the high limbs.
+static bool check_wide(const char *total_hex, int min_bits) {
+    ChunkIndex total;
+    total.SetBase16(total_hex);
+    ChunkScheduler sched;
+    sched.Init(total, 1234);
+    std::unordered_set<ChunkIndex, ChunkIndexHash> seen;
+    int high = 0;
+    for (int i = 0; i < 4096; ++i) {
+        ChunkIndex idx;
+        if (!sched.Claim(idx)) {
+            printf("Claim failed on wide job %s\n", total_hex);
+            return false;
+        }
+        if (!(idx < total) || !seen.insert(idx).second) {
+            printf("Bad index on wide job %s: %s\n", total_hex, idx.GetBase16().c_str());
+            return false;
+        }
+        if (idx.GetBitLength() > min_bits) high++;
+    }
+    if (high < 2048) {
+        printf("Wide job %s only reached %d/4096 indices above 2^%d\n", total_hex, high, min_bits);
+        return false;
+    }
+    return true;
+}
+
+int main() {
+    const uint64_t totals[] = {1, 2, 3, 7, 8, 9, 100, 127, 128, 129, 1000, 65537};
+    for (uint64_t total : totals) {
+        for (uint64_t seed = 0; seed < 4; ++seed) {
+            if (!check_exhaustive(total, seed)) return 1;
+        }
+    }
+
+    if (!check_wide("10000000000000000000", 60)) return 1;           // 2^76
+    if (!check_wide("FFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFF", 128)) return 1; // 2^144 - 1
+    if (!check_wide("FFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFEBAAEDCE6AF48A03BBFD25E8CD0364140", 200)) return 1;
+
+    // Restored chunks are skipped and counted.
+    {
+        ChunkScheduler sched;
+        sched.Init(ChunkIndex(100), 99);
+        for (uint64_t i = 0; i < 100; i += 3) sched.MarkScanned(ChunkIndex(i));
+        if (sched.MarkScanned(ChunkIndex(0)) || sched.MarkScanned(ChunkIndex(100))) {
+            printf("Duplicate or out of range checkpoint entry accepted\n");
+            return 1;
+        }
+        ChunkIndex idx;
+        int claimed = 0;
+        while (sched.Claim(idx)) {
+            if (idx.ToUint64() % 3 == 0) {
+                printf("Restored chunk %llu claimed again\n", (unsigned long long)idx.ToUint64());
+                return 1;
+            }
+            claimed++;
+        }
+        if (claimed != 66 || sched.ScannedCount() != 100) {
+            printf("Resume claimed %d chunks, scanned count %llu\n",
+                   claimed, (unsigned long long)sched.ScannedCount());
+            return 1;
+        }
+    }
+
+    // Restored runs are skipped and counted once, even when they overlap
+    // each other or single entries.
+    {
+        ChunkScheduler sched;
+        sched.Init(ChunkIndex(1000), 5);
+        sched.MarkScanned(ChunkIndex(15));
+        uint64_t added = sched.MarkScannedRange({ChunkIndex(10), ChunkIndex(19)});
+        added += sched.MarkScannedRange({ChunkIndex(15), ChunkIndex(29)});
+        added += sched.MarkScannedRange({ChunkIndex(990), ChunkIndex(5000)});
+        if (added != 29 || sched.ScannedCount() != 30 || sched.MarkScanned(ChunkIndex(20))) {
+            printf("Restored runs counted %llu, scanned count %llu\n",
+                   (unsigned long long)added, (unsigned long long)sched.ScannedCount());
+            return 1;
+        }
+        ChunkIndex idx;
+        int claimed = 0;
+        while (sched.Claim(idx)) {
+            uint64_t i = idx.ToUint64();
+            if ((i >= 10 && i <= 29) || i >= 990) {
+                printf("Restored run chunk %llu claimed again\n", (unsigned long long)i);
+                return 1;
+            }
+            claimed++;
+        }
+        if (claimed != 970 || sched.ScannedCount() != 1000) {
+            printf("Resume after runs claimed %d chunks\n", claimed);
+            return 1;
+        }
+    }
+
+    // Restored snapshot words are skipped and counted once alongside runs
+    // and single entries; bits past the last chunk are ignored.
+    {
+        ChunkScheduler sched;
+        sched.Init(ChunkIndex(1000), 9);
+        sched.MarkScanned(ChunkIndex(3));
+        sched.MarkScannedRange({ChunkIndex(60), ChunkIndex(69)});
+        // Word 0: chunks 0-7 and 60-63; word 1: chunks 64-71; word 15: 960-999 plus junk
+        std::vector<uint64_t> words = {0, 0xFFULL | 0xFULL << 60, 1, 0xFF, 15, ~0ULL};
+        uint64_t added = sched.MarkScannedWords(words);
+        added += sched.MarkScannedWords(words);
+        added += sched.MarkScannedRange({ChunkIndex(70), ChunkIndex(79)});
+        if (added != 7 + 2 + 40 + 8 || sched.ScannedCount() != 68 ||
+            sched.MarkScanned(ChunkIndex(5)) || sched.MarkScanned(ChunkIndex(999)) ||
+            !sched.MarkScanned(ChunkIndex(8))) {
+            printf("Restored words counted %llu, scanned count %llu\n",
+                   (unsigned long long)added, (unsigned long long)sched.ScannedCount());
+            return 1;
+        }
+        ChunkIndex idx;
+        int claimed = 0;
+        while (sched.Claim(idx)) {
+            uint64_t i = idx.ToUint64();
+            if (i <= 8 || (i >= 60 && i <= 79) || i >= 960) {
+                printf("Restored word chunk %llu claimed again\n", (unsigned long long)i);
+                return 1;
+            }
+            claimed++;
+        }
+        if (claimed != 931 || sched.ScannedCount() != 1000) {
+            printf("Resume after words claimed %d chunks\n", claimed);
+            return 1;
+        }
+    }
+
+    // Decimal/hex round trip across limbs.
+    {
+        ChunkIndex v;
+        v.SetBase16("0x1000000000000000000000000000000000");
+        if (v.GetBase10() != "5444517870735015415413993718908291383296" ||
+            v.GetBase16() != "1000000000000000000000000000000000") {
+            printf("ChunkIndex string conversion mismatch: %s\n", v.GetBase10().c_str());
+            return 1;
+        }
+    }
+
+    // Fair share follows the weights, in keys, and skips retired jobs.
+    {
+        FairShare fair;
+        int small = fair.Add(1), big = fair.Add(3), wide = fair.Add(1);
+        uint64_t keys[3] = {0, 0, 0};
+        for (int i = 0; i < 10000; ++i) {
+            int job = fair.Pick();
+            double cost = job == wide ? 4096 : 1024; // wider chunks, same weight as `small`
+            keys[job] += (uint64_t)cost;
+            fair.Charge(job, cost);
+        }
+        double ratio = (double)keys[big] / keys[small];
+        double wide_ratio = (double)keys[wide] / keys[small];
+        if (ratio < 2.9 || ratio > 3.1 || wide_ratio < 0.9 || wide_ratio > 1.1) {
+            printf("Fair share off: %llu/%llu/%llu keys\n", (unsigned long long)keys[small],
+                   (unsigned long long)keys[big], (unsigned long long)keys[wide]);
+            return 1;
+        }
+        fair.Retire(small);
+        fair.Retire(wide);
+        if (fair.Pick() != big) {
+            printf("Fair share picked a retired job\n");
+            return 1;
+        }
+        fair.Retire(big);
+        if (fair.Pick() != -1) {
+            printf("Fair share picked a job after all were retired\n");
+            return 1;
+        }
+    }
+
+    printf("All scheduler tests passed\n");
+    return 0;
+}
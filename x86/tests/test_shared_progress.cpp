@@ -0,0 +1,134 @@
+#include <cstdio>
+#include <cstring>
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <thread>
+#include <chrono>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "../SharedProgress.h"
+
+static const uint64_t TOTAL = 5000;
+static const char *JOB = "1000:2387:1";
+
+// Claims and completes ranges until every range in the file is done.
+static int worker(const std::string &path) {
+    SharedProgress progress;
+    if (!progress.Open(path, JOB, ChunkIndex(TOTAL), 1)) return 2;
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(20);
+    while (progress.CompletedCount() < TOTAL) {
+        if (std::chrono::steady_clock::now() > deadline) return 3;
+        ChunkIndex idx;
+        if (!progress.Claim(idx)) {
+            // Only abandoned leases are left; wait for them to become adoptable
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+            continue;
+        }
+        if (!progress.Complete(idx)) {
+            printf("Range %llu completed twice\n", (unsigned long long)idx.ToUint64());
+            return 4;
+        }
+    }
+    progress.Close();
+    return 0;
+}
+
+// Claims a few ranges and dies without completing or closing.
+static int crashing_worker(const std::string &path) {
+    SharedProgress progress;
+    if (!progress.Open(path, JOB, ChunkIndex(TOTAL), 1)) return 2;
+    for (int i = 0; i < 10; ++i) {
+        ChunkIndex idx;
+        progress.Claim(idx);
+    }
+    _exit(0);
+}
+
+// Claims a few ranges and closes cleanly, leaving them leased in a free slot.
+static int closing_worker(const std::string &path) {
+    SharedProgress progress;
+    if (!progress.Open(path, JOB, ChunkIndex(TOTAL), 1)) return 2;
+    for (int i = 0; i < 10; ++i) {
+        ChunkIndex idx;
+        progress.Claim(idx);
+    }
+    progress.Close();
+    return 0;
+}
+
+int main() {
+    std::string path = "/tmp/bitcrack_test_progress_" + std::to_string(getpid());
+    unlink(path.c_str());
+
+    // Seed the file with a checkpoint from a previous run
+    {
+        SharedProgress progress;
+        if (!progress.Open(path, JOB, ChunkIndex(TOTAL), 1)) {
+            printf("Failed to create progress file\n");
+            return 1;
+        }
+        for (uint64_t i = 0; i < TOTAL; i += 7) progress.MarkScanned(ChunkIndex(i));
+        progress.Close();
+    }
+
+    pid_t crasher = fork();
+    if (crasher == 0) _exit(crashing_worker(path));
+    int status = 0;
+    waitpid(crasher, &status, 0);
+
+    // The workers below race to take over its slot or recover its leases;
+    // either way each range is adopted once
+    pid_t closer = fork();
+    if (closer == 0) _exit(closing_worker(path));
+    waitpid(closer, &status, 0);
+
+    std::vector<pid_t> children;
+    for (int i = 0; i < 4; ++i) {
+        pid_t pid = fork();
+        if (pid == 0) _exit(worker(path));
+        children.push_back(pid);
+    }
+    int failed = 0;
+    for (pid_t pid : children) {
+        waitpid(pid, &status, 0);
+        if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+            printf("Worker %d exited with status %d\n", (int)pid, WEXITSTATUS(status));
+            failed++;
+        }
+    }
+    if (failed) return 1;
+
+    SharedProgress progress;
+    if (!progress.Open(path, JOB, ChunkIndex(TOTAL), 1)) {
+        printf("Failed to reopen progress file\n");
+        return 1;
+    }
+    if (progress.CompletedCount() != TOTAL) {
+        printf("Completed %llu of %llu ranges\n",
+               (unsigned long long)progress.CompletedCount(), (unsigned long long)TOTAL);
+        return 1;
+    }
+    for (uint64_t i = 0; i < TOTAL; ++i) {
+        if (!progress.IsCompleted(ChunkIndex(i))) {
+            printf("Range %llu not marked completed\n", (unsigned long long)i);
+            return 1;
+        }
+    }
+    ChunkIndex idx;
+    if (progress.Claim(idx)) {
+        printf("Claimed range %llu from a finished job\n", (unsigned long long)idx.ToUint64());
+        return 1;
+    }
+    progress.Close();
+
+    SharedProgress other;
+    if (other.Open(path, "1000:2387:2", ChunkIndex(TOTAL), 1)) {
+        printf("Opened a progress file made for another job\n");
+        return 1;
+    }
+    unlink(path.c_str());
+
+    printf("All shared progress tests passed\n");
+    return 0;
+}
@@ -0,0 +1,87 @@
+#include <cstdio>
+#include <cstring>
+#include <stdint.h>
+#include <random>
+#include <string>
+#include <unordered_set>
+#include <vector>
+#include "../HexUtil.hpp"
+#include "../TargetFilter.h"
+
+static int failures = 0;
+
+static void check(bool ok, const char *what, size_t targets) {
+    if (!ok) {
+        printf("FAIL: %s (%zu targets)\n", what, targets);
+        failures++;
+    }
+}
+
+static void random_hash(std::mt19937_64 &rng, uint8_t out[20]) {
+    for (int i = 0; i < 20; ++i) out[i] = (uint8_t)rng();
+}
+
+// Every target passes wherever it sits in a batch, and few non-targets do
+static void check_size(size_t size, std::mt19937_64 &rng) {
+    std::vector<std::vector<uint8_t>> hashes(size, std::vector<uint8_t>(20));
+    std::unordered_set<std::string> targets;
+    for (auto &hash : hashes) {
+        random_hash(rng, hash.data());
+        targets.insert(HexUtil::toHex(hash.data(), 20));
+    }
+    TargetFilter filter(targets);
+    check((filter.Compared() != 0) == (size <= TargetFilter::MAX_COMPARED), "compared or bitmap", size);
+
+    uint8_t batch[16][20];
+    for (size_t t = 0; t < size; ++t) {
+        int lane = (int)(t % 16);
+        for (int i = 0; i < 16; ++i) random_hash(rng, batch[i]);
+        memcpy(batch[lane], hashes[t].data(), 20);
+        uint32_t mask = filter.Screen(batch, 16);
+        if (!(mask >> lane & 1)) {
+            check(false, "target rejected", size);
+            return;
+        }
+    }
+
+    int passed = 0, screened = 0;
+    for (int n = 0; n < 4096; ++n) {
+        for (int i = 0; i < 16; ++i) random_hash(rng, batch[i]);
+        passed += __builtin_popcount(filter.Screen(batch, 16));
+        screened += 16;
+    }
+    // One in 2^32 per prefix compared, about one in 16 through the bitmap
+    double rate = (double)passed / screened;
+    check(rate < (size <= TargetFilter::MAX_COMPARED ? 0.001 : 0.1), "non-targets pass", size);
+}
+
+int main() {
+    std::mt19937_64 rng(7);
+    uint8_t batch[16][20];
+    for (int i = 0; i < 16; ++i) random_hash(rng, batch[i]);
+
+    // No targets: nothing passes
+    TargetFilter empty;
+    check(empty.Screen(batch, 16) == 0, "empty filter passes a hash", 0);
+    TargetFilter none((std::unordered_set<std::string>()));
+    check(none.Screen(batch, 16) == 0, "filter over no targets passes a hash", 0);
+
+    // Lanes past `count` never pass, even when they hold a target
+    std::unordered_set<std::string> last = {HexUtil::toHex(batch[15], 20), HexUtil::toHex(batch[2], 20)};
+    TargetFilter filter(last);
+    check(filter.Screen(batch, 16) == ((1u << 15) | (1u << 2)), "targets at lanes 2 and 15", last.size());
+    check(filter.Screen(batch, 15) == (1u << 2), "count of 15 masks lane 15", last.size());
+    check(filter.Screen(batch, 3) == (1u << 2), "count of 3", last.size());
+    check(filter.Screen(batch, 0) == 0, "count of 0", last.size());
+
+    for (size_t size : {1, 5, 16, 17, 1000, 100000}) {
+        check_size(size, rng);
+    }
+
+    if (failures) {
+        printf("%d target filter tests failed\n", failures);
+        return 1;
+    }
+    printf("All target filter tests passed\n");
+    return 0;
+}
@@ -0,0 +1,101 @@
+#include <cstdio>
+#include <stdint.h>
+#include <algorithm>
+#include <thread>
+#include <vector>
+#include "../Topology.h"
+#include "../SpscRing.hpp"
+
+static Topology::CpuInfo cpu(int id, int core, std::vector<int> siblings, int capacity) {
+    Topology::CpuInfo info;
+    info.cpu = id;
+    info.core_id = core;
+    info.package_id = 0;
+    info.siblings = siblings;
+    info.capacity = capacity;
+    info.kind = capacity == 1024 ? 'P' : 'E';
+    return info;
+}
+
+static bool same(const std::vector<int> &got, const std::vector<int> &want, const char *what) {
+    if (got == want) return true;
+    printf("%s:", what);
+    for (int c : got) printf(" %d", c);
+    printf("\n");
+    return false;
+}
+
+// Hybrid part: two SMT P-cores (0+1, 2+3) and two single-thread E-cores (4, 5).
+static bool check_placement() {
+    std::vector<Topology::CpuInfo> topo = {
+        cpu(0, 0, {0, 1}, 1024), cpu(1, 0, {0, 1}, 1024),
+        cpu(2, 1, {2, 3}, 1024), cpu(3, 1, {2, 3}, 1024),
+        cpu(4, 2, {4}, 600),     cpu(5, 3, {5}, 600),
+    };
+    std::vector<int> all = {0, 1, 2, 3, 4, 5};
+
+    // Physical cores first, P before E, SMT siblings last
+    std::vector<int> order = Topology::placement_order(topo, all);
+    if (!same(order, {0, 2, 4, 5, 1, 3}, "placement order")) return false;
+
+    // Siblings follow their first thread; cores without SMT stay single
+    if (!same(Topology::pair_siblings(topo, order), {0, 1, 2, 3, 4, 5}, "paired order")) return false;
+
+    // Only the requested CPUs are placed
+    if (!same(Topology::placement_order(topo, {1, 3, 5}), {5, 1, 3}, "subset order")) return false;
+    return true;
+}
+
+// The host's own topology must at least be self-consistent.
+static bool check_host() {
+    std::vector<Topology::CpuInfo> topo = Topology::cpu_topology();
+    if (topo.size() != Topology::allowed_cpus().size()) {
+        printf("Topology has %zu CPUs, %zu allowed\n", topo.size(), Topology::allowed_cpus().size());
+        return false;
+    }
+    for (const Topology::CpuInfo &info : topo) {
+        if (std::find(info.siblings.begin(), info.siblings.end(), info.cpu) == info.siblings.end() ||
+            info.capacity <= 0 || info.capacity > 1024) {
+            printf("Bad topology entry for CPU %d\n", info.cpu);
+            return false;
+        }
+    }
+    return true;
+}
+
+// Every item pushed arrives once, in order, and Close ends the consumer.
+static bool check_ring() {
+    static SpscRing<uint64_t, 8> ring;
+    const uint64_t count = 200000;
+    std::thread producer([]() {
+        for (uint64_t i = 0; i < count; ++i) {
+            uint64_t *slot = ring.BeginPush();
+            if (!slot) return;
+            *slot = i;
+            ring.Push();
+        }
+        ring.Close();
+    });
+    uint64_t expected = 0;
+    bool ok = true;
+    while (uint64_t *slot = ring.Front()) {
+        if (*slot != expected) ok = false;
+        expected++;
+        ring.Pop();
+    }
+    producer.join();
+    if (!ok || expected != count) {
+        printf("Ring delivered %llu of %llu items%s\n", (unsigned long long)expected,
+               (unsigned long long)count, ok ? "" : " out of order");
+        return false;
+    }
+    return true;
+}
+
+int main() {
+    if (!check_placement()) return 1;
+    if (!check_host()) return 1;
+    if (!check_ring()) return 1;
+    printf("All topology tests passed\n");
+    return 0;
+}
@@ -0,0 +1,153 @@
+#include <cstdio>
+#include <stdint.h>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+#include "../WorkerPool.h"
+#include "../Net.h"
+
+static const int CHUNKS = 3000;
+static std::atomic<int> next_chunk(0);
+static std::atomic<int> done_chunks(0);
+static WorkerPool *pool = nullptr;
+
+// A worker: claims "chunks" until none are left or the pool parks it.
+static void body(int slot) {
+    for (;;) {
+        if (pool->ShouldPark(slot)) return;
+        int chunk = next_chunk++;
+        if (chunk >= CHUNKS) {
+            pool->Finish();
+            return;
+        }
+        std::this_thread::sleep_for(std::chrono::microseconds(200));
+        done_chunks++;
+    }
+}
+
+// Reconcile until the running count settles on `want` (or time runs out).
+static bool settle(int want) {
+    for (int i = 0; i < 400; ++i) {
+        pool->Reconcile();
+        if (pool->Running() == want) return true;
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    printf("Pool running %d workers, expected %d (target %d)\n", pool->Running(), want, pool->Target());
+    return false;
+}
+
+int main() {
+    // Pairs of threads per slot: sizes are given and reported in threads
+    WorkerPool p(8, 2, body);
+    pool = &p;
+    p.SetRequested(8);
+    if (p.Target() != 8 || !settle(8)) return 1;
+
+    p.SetRequested(4);
+    if (p.Target() != 4 || !settle(4)) return 1;
+
+    // A quota below the request wins; lifting it restores the request
+    p.SetLimit(2);
+    if (p.Target() != 2 || !settle(2)) return 1;
+    p.SetLimit(0);
+    p.Grow();
+    if (p.Target() != 6 || !settle(6)) return 1;
+
+    if (p.Command("WORKERS 100") != "OK 16" || p.Command("SHRINK") != "OK 14" ||
+        p.Command("WORKERS 0").compare(0, 5, "ERROR") != 0 || p.Command("BOGUS").compare(0, 5, "ERROR") != 0) {
+        printf("Control commands answered unexpectedly\n");
+        return 1;
+    }
+
+    // Over a socket, as an operator would
+    std::string addr = "unix:/tmp/bitcrack_test_pool_" + std::to_string(getpid());
+    std::atomic<bool> stop(false);
+    std::thread control([&]() { p.ServeControl(addr, stop); });
+    Net::LineConn conn;
+    for (int i = 0; i < 100 && conn.Fd() < 0; ++i) {
+        int fd = Net::connect_to(addr);
+        if (fd >= 0) conn = Net::LineConn(fd);
+        else std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    std::string reply;
+    if (!conn.WriteLine("WORKERS 2") || !conn.ReadLine(reply) || reply != "OK 2" ||
+        !conn.WriteLine("STATUS") || !conn.ReadLine(reply) || reply.compare(0, 10, "WORKERS 2 ") != 0) {
+        printf("Control socket answered '%s'\n", reply.c_str());
+        return 1;
+    }
+    conn.Close();
+    stop = true;
+    control.join();
+    if (!settle(2)) return 1;
+
+    // Work runs to completion through all the resizing, every chunk exactly once
+    while (!p.Done()) {
+        p.Reconcile();
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    p.Join();
+    if (done_chunks != CHUNKS) {
+        printf("Completed %d of %d chunks\n", done_chunks.load(), CHUNKS);
+        return 1;
+    }
+
+    // A retired slot is not replaced by an idle one: the tail policy retires
+    // slow workers so that only the faster ones take the remaining ranges
+    {
+        std::atomic<bool> release(false);
+        std::atomic<int> started(0);
+        WorkerPool *r_ptr = nullptr;
+        WorkerPool r(4, 1, [&](int slot) {
+            started++;
+            if (slot == 0) {
+                r_ptr->Retire(0);
+                return;
+            }
+            while (!release) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        });
+        r_ptr = &r;
+        r.SetRequested(2);
+        r.Reconcile();
+        for (int i = 0; i < 200 && started < 2; ++i) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+        for (int i = 0; i < 10; ++i) {
+            r.Reconcile();
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+        bool replaced = started != 2 || r.Running() != 1;
+        release = true;
+        r.Finish();
+        r.Join();
+        if (replaced) {
+            printf("Retired slot replaced: %d workers started, %d running\n", started.load(), r.Running());
+            return 1;
+        }
+    }
+
+    // Resizes from several threads at once are never lost
+    {
+        WorkerPool q(4096, 1, [](int) {});
+        q.SetRequested(2048);
+        std::vector<std::thread> resizers;
+        for (int t = 0; t < 4; ++t) {
+            resizers.emplace_back([&q]() {
+                for (int i = 0; i < 20000; ++i) {
+                    q.Grow();
+                    q.Shrink();
+                }
+            });
+        }
+        for (auto &t : resizers) t.join();
+        if (q.Requested() != 2048) {
+            printf("Concurrent grow/shrink left %d workers requested, expected 2048\n", q.Requested());
+            return 1;
+        }
+    }
+
+    printf("All worker pool tests passed\n");
+    return 0;
+}